@@ -1,25 +1,551 @@
-
+// bench_rs_string.c — micro-benchmarks for rs_string
+// Usage: bench [--filter SUBSTR] [--reps N] [--min-ms MS] [--json FILE|-] [--quick]
+// Each case is calibrated to batches of at least --min-ms, run once as warmup, then
+// timed --reps times on the monotonic clock. Reported: median ns/op, the median
+// absolute deviation (as % of the median), the fastest batch and bytes/s at the median.
+// --json writes the same results for nightly comparison (`-` = stdout).
+#define _GNU_SOURCE             /* memmem, clock_gettime */
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include "rs_string.h"
+#include "rs_string_num.h"
+#include "rs_string_match.h"
+#include "rs_string_sort.h"
+#include "rs_string_api.h"
+#define RS_ENABLE_FLUENT 1
+#include "rs_string_fluent.h"
+
+#if defined(__GLIBC__) || defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+  #define BENCH_HAVE_MEMMEM 1
+#endif
+
+#define BENCH_MAX_REPS 101
+
+static volatile size_t bench_sink;   /* results land here so the work is not dead code */
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+#if defined(CLOCK_MONOTONIC)
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Fixtures
+
+typedef struct {
+    size_t     n;           /* the size being swept */
+    char*      buf;         /* n bytes of input text, NUL-terminated */
+    char*      key;         /* needle (ends the text, so searches run to the end) */
+    size_t     klen;
+    rs_string  s, t;        /* a string holding buf, and a scratch string */
+    rs_matcher m;
+    unsigned char* u16;     /* buf as UTF-16LE, for the reverse transcode */
+    size_t     u16n;
+    rs_sv*     keys;        /* views into buf to sort, and their scratch copy */
+    rs_sv*     work;
+    size_t     nkeys;
+} bench_ctx;
+
+static uint32_t bench_rng = 2463534242u;
+static uint32_t rnd(void) { bench_rng ^= bench_rng << 13; bench_rng ^= bench_rng >> 17; bench_rng ^= bench_rng << 5; return bench_rng; }
+
+/* lowercase text with a word separator every ~8 bytes and the key in the last bytes */
+static void fx_text(bench_ctx* c) {
+    c->buf = (char*)malloc(c->n + 1);
+    for (size_t i = 0; i < c->n; ++i) c->buf[i] = rnd() % 9 ? (char)('a' + rnd() % 26) : ',';
+    c->buf[c->n] = '\0';
+    c->key = "zqxjzqxj";
+    c->klen = c->n < 8 ? c->n : 8;
+    memcpy(c->buf + c->n - c->klen, c->key, c->klen);
+    rs_string_init(&c->s);
+    rs_string_init(&c->t);
+    rs_string_assign(&c->s, (rs_sv){ c->buf, c->n });
+}
+
+/* text padded with whitespace on both sides (a quarter of the length each) */
+static void fx_padded(bench_ctx* c) {
+    fx_text(c);
+    for (size_t i = 0; i < c->n / 4; ++i) c->buf[i] = c->buf[c->n - 1 - i] = i & 1 ? '\t' : ' ';
+    rs_string_assign(&c->s, (rs_sv){ c->buf, c->n });
+}
+
+/* mixed-width UTF-8: ASCII runs with 2-, 3- and 4-byte sequences */
+static void fx_utf8(bench_ctx* c) {
+    static const char* pieces[] = { "abcd", "\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80", "xyz " };
+    c->buf = (char*)malloc(c->n + 1);
+    size_t w = 0;
+    for (;;) {
+        const char* p = pieces[rnd() % 5];
+        size_t k = strlen(p);
+        if (w + k > c->n) break;
+        memcpy(c->buf + w, p, k);
+        w += k;
+    }
+    memset(c->buf + w, 'a', c->n - w);
+    c->buf[c->n] = '\0';
+    rs_string_init(&c->s);
+    rs_string_init(&c->t);
+    rs_string_assign(&c->s, (rs_sv){ c->buf, c->n });
+    rs_utf16_from_utf8_bytes((rs_sv){ c->buf, c->n }, 1, 0, (rs_alloc){0}, &c->u16, &c->u16n);
+}
+
+static void fx_matcher(bench_ctx* c) {
+    rs_sv pats[] = { { "qQq", 3 }, { "zqxj", 4 }, { "jJjj", 4 }, { "xXv", 3 } };
+    fx_text(c);
+    rs_matcher_init(&c->m, pats, 4);
+}
+
+static void fx_matcher_many(bench_ctx* c) {
+    static char words[32][6];
+    rs_sv pats[32];
+    fx_text(c);
+    for (int k = 0; k < 32; ++k) {
+        snprintf(words[k], sizeof words[k], "q%c%cz", 'a' + k % 26, 'a' + (k * 7) % 26);
+        pats[k] = (rs_sv){ words[k], 4 };
+    }
+    rs_matcher_init(&c->m, pats, 32);
+}
+
+/* one key per 8 bytes of text, 4..27 bytes long: words with shared prefixes and ties */
+static void fx_keys(bench_ctx* c) {
+    fx_text(c);
+    c->nkeys = c->n / 8 ? c->n / 8 : 1;
+    c->keys = (rs_sv*)malloc(c->nkeys * sizeof(rs_sv));
+    c->work = (rs_sv*)malloc(c->nkeys * sizeof(rs_sv));
+    for (size_t i = 0; i < c->nkeys; ++i) {
+        size_t at = rnd() % c->n, len = 4 + rnd() % 24;
+        c->keys[i] = (rs_sv){ c->buf + at, len < c->n - at ? len : c->n - at };
+    }
+}
+
+static void fx_free(bench_ctx* c) {
+    rs_string_free(&c->s);
+    rs_string_free(&c->t);
+    rs_matcher_free(&c->m);
+    free(c->buf);
+    free(c->u16);
+    free(c->keys);
+    free(c->work);
+    memset(c, 0, sizeof *c);
+}
+
+// Cases: each runs its operation `iters` times
+
+static void b_append(bench_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        rs_string s; rs_string_init(&s);
+        for (size_t i = 0; i < c->n; i += 6) rs_string_append(&s, (rs_sv){ c->buf + i, c->n - i < 6 ? c->n - i : 6 });
+        bench_sink += rs_string_len(&s);
+        rs_string_free(&s);
+    }
+}
+
+static void b_copy(bench_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        rs_string s = rs_string_from_val(c->buf);
+        bench_sink += rs_string_len(&s);
+        rs_string_free(&s);
+    }
+}
+
+static void b_find(bench_ctx* c, size_t iters) {
+    rs_sv k = { c->key, c->klen };
+    for (size_t it = 0; it < iters; ++it) bench_sink += rs_string_find(&c->s, k, 0);
+}
+
+static void b_strstr(bench_ctx* c, size_t iters) {
+    char k[9];
+    memcpy(k, c->key, c->klen);
+    k[c->klen] = '\0';
+    for (size_t it = 0; it < iters; ++it) bench_sink += (size_t)(strstr(c->buf, k) - c->buf);
+}
+
+#ifdef BENCH_HAVE_MEMMEM
+static void b_memmem(bench_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) bench_sink += (size_t)((char*)memmem(c->buf, c->n, c->key, c->klen) - c->buf);
+}
+#endif
+
+static void b_find_any(bench_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) bench_sink += rs_string_find_any(&c->s, &c->m, 0, NULL);
+}
+
+static void b_split_iter(bench_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        rs_sv_split_iter si;
+        rs_sv tok;
+        rs_sv_split_iter_init(&si, rs_string_sv(&c->s), (rs_sv){ ",", 1 }, 0);
+        while (rs_sv_split_iter_next(&si, &tok)) bench_sink += tok.len;
+    }
+}
+
+static void b_tokenize(bench_ctx* c, size_t iters) {
+    rs_sv out[64];
+    for (size_t it = 0; it < iters; ++it) {
+        rs_sv_tokenizer t;
+        size_t k;
+        rs_sv_tokenizer_init_byte(&t, rs_string_sv(&c->s), ',', 0);
+        while ((k = rs_sv_tokenize(&t, out, 64)) != 0) bench_sink += k;
+    }
+}
+
+static void b_trim(bench_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        rs_string_assign(&c->t, rs_string_sv(&c->s));
+        rs_string_trim(&c->t);
+        bench_sink += rs_string_len(&c->t);
+    }
+}
+
+static void b_insert_erase(bench_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        rs_string_insert(&c->s, c->n / 2, (rs_sv){ "[inserted]", 10 });
+        rs_string_erase(&c->s, c->n / 2, 10);
+    }
+    bench_sink += rs_string_len(&c->s);
+}
 
-static double secs(clock_t a, clock_t b) { return (double)(b - a) / CLOCKS_PER_SEC; }
+static void b_share(bench_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        rs_string_share(&c->t, &c->s);
+        bench_sink += rs_string_len(&c->t);
+    }
+    rs_string_free(&c->t);
+}
 
-int main(void) {
-    const int N = 200000;
-    rs_string s = rs_string_from_val("");
-    clock_t t0 = clock();
-    for (int i = 0; i < N ; ++i) {
-        rs_string_push_cstr(&s, "abcdef");
+static void b_cow_write(bench_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        rs_string_share(&c->t, &c->s);
+        rs_string_push_char(&c->t, '!');   /* the first write copies */
+        bench_sink += rs_string_len(&c->t);
     }
-    clock_t t1 = clock();
-    printf("append: %d * 6 bytes -> len=%zu in %.3f s\n", N, rs_string_len(&s), secs(t0,t1));
+    rs_string_free(&c->t);
+}
 
-    clock_t t2 = clock();
-    rs_string_replace_all(&s, rs_sv_from_cstr("ab"), rs_sv_from_cstr("AB"));
-    clock_t t3 = clock();
-    printf("replace_all 'ab'->'AB' in %.3f s\n", secs(t2,t3));
+static void b_replace_all(bench_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        rs_string_assign(&c->t, rs_string_sv(&c->s));
+        bench_sink += (size_t)rs_string_replace_all(&c->t, (rs_sv){ ",", 1 }, (rs_sv){ ", ", 2 });
+    }
+}
+
+static void b_replace_many(bench_ctx* c, size_t iters) {
+    rs_sv repl[32];
+    for (size_t k = 0; k < c->m.n; ++k) repl[k] = (rs_sv){ "***", 3 };
+    for (size_t it = 0; it < iters; ++it) {
+        rs_string_assign(&c->t, rs_string_sv(&c->s));
+        bench_sink += (size_t)rs_string_replace_many(&c->t, &c->m, repl);
+    }
+}
+
+static void b_sort_views(bench_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        memcpy(c->work, c->keys, c->nkeys * sizeof(rs_sv));
+        rs_sort_views(c->work, c->nkeys);
+        bench_sink += c->work[0].len;
+    }
+}
+
+static int cmp_sv(const void* a, const void* b) { return rs_sv_cmp(*(const rs_sv*)a, *(const rs_sv*)b); }
+
+static void b_qsort_views(bench_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        memcpy(c->work, c->keys, c->nkeys * sizeof(rs_sv));
+        qsort(c->work, c->nkeys, sizeof(rs_sv), cmp_sv);
+        bench_sink += c->work[0].len;
+    }
+}
 
-    rs_string_free(&s);
+/* one small edit sequence through each front end */
+static void b_direct(bench_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        rs_string_clear(&c->t);
+        rs_string_append(&c->t, (rs_sv){ "key", 3 });
+        rs_string_push_char(&c->t, '=');
+        rs_string_append(&c->t, (rs_sv){ c->buf, c->n < 8 ? c->n : 8 });
+        rs_string_trim(&c->t);
+        bench_sink += rs_string_len(&c->t);
+    }
+}
+
+static void b_api(bench_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        rs(clear)(&c->t);
+        rs(append)(&c->t, (rs_sv){ "key", 3 });
+        rs(push_char)(&c->t, '=');
+        rs(append)(&c->t, (rs_sv){ c->buf, c->n < 8 ? c->n : 8 });
+        rs(trim)(&c->t);
+        bench_sink += rs(len)(&c->t);
+    }
+}
+
+/* the constant table: direct only where the optimizer folds it */
+static void b_api_table(bench_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        rs_api_table()->clear(&c->t);
+        rs_api_table()->append(&c->t, (rs_sv){ "key", 3 });
+        rs_api_table()->push_char(&c->t, '=');
+        rs_api_table()->append(&c->t, (rs_sv){ c->buf, c->n < 8 ? c->n : 8 });
+        rs_api_table()->trim(&c->t);
+        bench_sink += rs_api_table()->len(&c->t);
+    }
+}
+
+/* "opaque": the same table read through a pointer the compiler cannot see through,
+ * which is what an indirect call costs where the table does not fold */
+static const rs_api* volatile bench_api;
+
+static void b_api_opaque(bench_ctx* c, size_t iters) {
+    bench_api = rs_api_table();
+    for (size_t it = 0; it < iters; ++it) {
+        bench_api->clear(&c->t);
+        bench_api->append(&c->t, (rs_sv){ "key", 3 });
+        bench_api->push_char(&c->t, '=');
+        bench_api->append(&c->t, (rs_sv){ c->buf, c->n < 8 ? c->n : 8 });
+        bench_api->trim(&c->t);
+        bench_sink += bench_api->len(&c->t);
+    }
+}
+
+static void b_fluent(bench_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        RS(&c->t, clear(), append((rs_sv){ "key", 3 }), push_char('='), append((rs_sv){ c->buf, c->n < 8 ? c->n : 8 }), trim());
+        bench_sink += rs_string_len(&c->t);
+    }
+}
+
+static void b_hash(bench_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) bench_sink += (size_t)rs_sv_hash(rs_string_sv(&c->s));
+}
+
+static void b_appendf(bench_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        rs_string_clear(&c->t);
+        rs_string_appendf(&c->t, "id=%zu name=%s score=%.3f", it, "benchmark", (double)it * 0.25);
+        bench_sink += rs_string_len(&c->t);
+    }
+}
+
+static void b_snprintf(bench_ctx* c, size_t iters) {
+    char out[128];
+    (void)c;
+    for (size_t it = 0; it < iters; ++it)
+        bench_sink += (size_t)snprintf(out, sizeof out, "id=%zu name=%s score=%.3f", it, "benchmark", (double)it * 0.25);
+}
+
+static void b_append_num(bench_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        rs_string_clear(&c->t);
+        rs_string_append_i64(&c->t, (int64_t)it * 7919);
+        rs_string_push_char(&c->t, ' ');
+        rs_string_append_f64(&c->t, (double)it * 0.1);
+        bench_sink += rs_string_len(&c->t);
+    }
+}
+
+static void b_utf8_validate(bench_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) bench_sink += rs_utf8_validate(rs_string_sv(&c->s));
+}
+
+static void b_utf8_count(bench_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) bench_sink += rs_utf8_count(rs_string_sv(&c->s));
+}
+
+static void b_utf8_to_16(bench_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        unsigned char* out = NULL;
+        size_t n = 0;
+        rs_utf16_from_utf8_bytes(rs_string_sv(&c->s), 1, 0, (rs_alloc){0}, &out, &n);
+        bench_sink += n;
+        free(out);
+    }
+}
+
+static void b_utf16_to_8(bench_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        rs_string_clear(&c->t);
+        rs_utf8_from_utf16_bytes(&c->t, (rs_sv){ (const char*)c->u16, c->u16n }, 1);
+        bench_sink += rs_string_len(&c->t);
+    }
+}
+
+// Registry
+
+typedef struct {
+    const char* name;
+    const char* impl;                   /* "rs", or the libc baseline it compares to */
+    void (*setup)(bench_ctx*);
+    void (*run)(bench_ctx*, size_t);
+    int         sweep;                  /* 0: size-independent, 1: small sizes, 2: all sizes */
+} bench_case;
+
+static const bench_case bench_cases[] = {
+    { "append",          "rs",     fx_text,         b_append,        2 },
+    { "copy",            "rs",     fx_text,         b_copy,          2 },
+    { "find",            "rs",     fx_text,         b_find,          2 },
+    { "find",            "strstr", fx_text,         b_strstr,        2 },
+#ifdef BENCH_HAVE_MEMMEM
+    { "find",            "memmem", fx_text,         b_memmem,        2 },
+#endif
+    { "find_any/4",      "rs",     fx_matcher,      b_find_any,      2 },
+    { "find_any/32",     "rs",     fx_matcher_many, b_find_any,      2 },
+    { "split_iter",      "rs",     fx_text,         b_split_iter,    2 },
+    { "tokenize",        "rs",     fx_text,         b_tokenize,      2 },
+    { "trim",            "rs",     fx_padded,       b_trim,          2 },
+    { "insert_erase",    "rs",     fx_text,         b_insert_erase,  2 },
+    { "share",           "rs",     fx_text,         b_share,         1 },
+    { "cow_write",       "rs",     fx_text,         b_cow_write,     2 },
+    { "replace_all",     "rs",     fx_text,         b_replace_all,   2 },
+    { "replace_many/32", "rs",     fx_matcher_many, b_replace_many,  2 },
+    { "sort_views",      "rs",     fx_keys,         b_sort_views,    2 },
+    { "sort_views",      "qsort",  fx_keys,         b_qsort_views,   2 },
+    { "hash",            "rs",     fx_text,         b_hash,          2 },
+    { "front_end",       "direct", fx_text,         b_direct,        0 },
+    { "front_end",       "rs(f)",  fx_text,         b_api,           0 },
+    { "front_end",       "table",  fx_text,         b_api_table,     0 },
+    { "front_end",       "opaque", fx_text,         b_api_opaque,    0 },
+    { "front_end",       "fluent", fx_text,         b_fluent,        0 },
+    { "appendf",         "rs",     fx_text,         b_appendf,       0 },
+    { "appendf",         "snprintf", fx_text,       b_snprintf,      0 },
+    { "append_i64_f64",  "rs",     fx_text,         b_append_num,    0 },
+    { "utf8_validate",   "rs",     fx_utf8,         b_utf8_validate, 2 },
+    { "utf8_count",      "rs",     fx_utf8,         b_utf8_count,    2 },
+    { "utf8_to_utf16",   "rs",     fx_utf8,         b_utf8_to_16,    2 },
+    { "utf16_to_utf8",   "rs",     fx_utf8,         b_utf16_to_8,    2 },
+};
+
+/* both sides of the inline capacity, then cache-sized and memory-sized inputs */
+static const size_t bench_sizes[] = { 8, RS_SSO_CAP, RS_SSO_CAP + 1, 64, 1024, 64 * 1024, 1024 * 1024 };
+
+typedef struct {
+    double median, mad, min;            /* ns per operation */
+    size_t iters;                       /* operations per batch */
+} bench_result;
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double median_of(double* v, int n) {
+    qsort(v, (size_t)n, sizeof *v, cmp_double);
+    return n & 1 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+static bench_result bench_measure(const bench_case* bc, bench_ctx* c, int reps, double min_ns) {
+    double t[BENCH_MAX_REPS], dev[BENCH_MAX_REPS];
+    bench_result r;
+    size_t iters = 1;
+
+    /* calibrate: grow the batch until it is long enough to time reliably */
+    for (;;) {
+        uint64_t t0 = now_ns();
+        bc->run(c, iters);
+        double el = (double)(now_ns() - t0);
+        if (el >= min_ns || iters >= ((size_t)1 << 40)) break;
+        iters = el <= 0 ? iters * 16 : (size_t)((double)iters * (min_ns * 1.2 / el)) + 1;
+    }
+    bc->run(c, iters);                  /* warmup at the final batch size */
+
+    for (int i = 0; i < reps; ++i) {
+        uint64_t t0 = now_ns();
+        bc->run(c, iters);
+        t[i] = (double)(now_ns() - t0) / (double)iters;
+    }
+    r.iters = iters;
+    r.median = median_of(t, reps);
+    r.min = t[0];
+    for (int i = 0; i < reps; ++i) dev[i] = t[i] > r.median ? t[i] - r.median : r.median - t[i];
+    r.mad = median_of(dev, reps);
+    return r;
+}
+
+static void json_str(FILE* f, const char* s) {
+    fputc('"', f);
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') fputc('\\', f);
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+static void usage(void) {
+    fputs("usage: bench [--filter SUBSTR] [--reps N] [--min-ms MS] [--json FILE|-] [--quick]\n", stderr);
+}
+
+int main(int argc, char** argv) {
+    const char* filter = NULL;
+    const char* json = NULL;
+    int reps = 11;
+    double min_ms = 2.0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--filter") && i + 1 < argc) filter = argv[++i];
+        else if (!strcmp(argv[i], "--reps") && i + 1 < argc) reps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--min-ms") && i + 1 < argc) min_ms = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--json") && i + 1 < argc) json = argv[++i];
+        else if (!strcmp(argv[i], "--quick")) { reps = 5; min_ms = 0.2; }
+        else { usage(); return 2; }
+    }
+    if (reps < 1) reps = 1;
+    if (reps > BENCH_MAX_REPS) reps = BENCH_MAX_REPS;
+
+    FILE* jf = NULL;
+    if (json) {
+        jf = strcmp(json, "-") ? fopen(json, "w") : stdout;
+        if (!jf) { perror(json); return 1; }
+        fprintf(jf, "{\n  \"schema\": 1,\n  \"layout\": \"%s\",\n  \"simd\": %s,\n  \"sso_cap\": %zu,\n"
+                    "  \"reps\": %d,\n  \"min_ms\": %g,\n  \"results\": [",
+                RS_LAYOUT_COMPACT ? "compact" : "classic",
+#ifdef RS_NO_SIMD
+                "false",
+#else
+                "true",
+#endif
+                (size_t)RS_SSO_CAP, reps, min_ms);
+    }
+    FILE* out = jf == stdout ? stderr : stdout;   /* keep stdout clean for `--json -` */
+    fprintf(out, "%-16s %-9s %8s %12s %7s %12s %12s\n", "case", "impl", "size", "ns/op", "±mad%", "min ns/op", "MB/s");
+
+    int first = 1;
+    for (size_t k = 0; k < sizeof bench_cases / sizeof *bench_cases; ++k) {
+        const bench_case* bc = &bench_cases[k];
+        if (filter && !strstr(bc->name, filter) && !strstr(bc->impl, filter)) continue;
+
+        size_t nsizes = bc->sweep == 0 ? 1 : bc->sweep == 1 ? 4 : sizeof bench_sizes / sizeof *bench_sizes;
+        for (size_t z = 0; z < nsizes; ++z) {
+            bench_ctx c;
+            memset(&c, 0, sizeof c);
+            c.n = bc->sweep == 0 ? 64 : bench_sizes[z];
+            bc->setup(&c);
+
+            bench_result r = bench_measure(bc, &c, reps, min_ms * 1e6);
+            double bps = bc->sweep ? (double)c.n * 1e9 / r.median : 0;
+            fprintf(out, "%-16s %-9s %8zu %12.1f %6.1f%% %12.1f %12.1f\n", bc->name, bc->impl, bc->sweep ? c.n : 0,
+                    r.median, 100 * r.mad / r.median, r.min, bps / 1e6);
+
+            if (jf) {
+                fprintf(jf, "%s\n    { \"name\": ", first ? "" : ",");
+                json_str(jf, bc->name);
+                fputs(", \"impl\": ", jf);
+                json_str(jf, bc->impl);
+                fprintf(jf, ", \"size\": %zu, \"iters\": %zu, \"ns_per_op\": %.3f, \"mad_ns\": %.3f,"
+                            " \"min_ns\": %.3f, \"bytes_per_sec\": %.0f }",
+                        bc->sweep ? c.n : 0, r.iters, r.median, r.mad, r.min, bps);
+                first = 0;
+            }
+            fx_free(&c);
+        }
+    }
+
+    if (jf) {
+        fputs("\n  ]\n}\n", jf);
+        if (jf != stdout) fclose(jf);
+    }
     return 0;
 }
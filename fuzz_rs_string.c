@@ -0,0 +1,554 @@
+// fuzz_rs_string.c — differential fuzz target for rs_string
+// Usage: fuzz_rs_string [--runs N] [--seed S] [FILE...]
+//        (libFuzzer) clang -g -O1 -fsanitize=fuzzer,address,undefined -DRS_FUZZ_NO_MAIN fuzz_rs_string.c
+//        (AFL)       afl-clang-fast -g fuzz_rs_string.c -o fz && afl-fuzz -i seeds -o out -- ./fz @@
+// Every input is a program: the first byte picks a hooked allocation to fail (or none), the
+// rest is a stream of opcodes and operands run against four rs_string slots and two
+// ropes, and against a plain byte-buffer model of each. After every op all slots must
+// match their models byte for byte, stay terminated, and an op that returned -1 must
+// have seen the injected failure and left its string unchanged. Strings are moved onto
+// a counting allocator so the hooks can be checked too: when the program ends, every
+// block it handed out must have come back. Without FILE arguments the standalone
+// driver runs --runs random programs (a failing one is saved to fuzz-crash.bin).
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "rs_string.h"
+#include "rs_string_rope.h"
+
+#define FZ_SLOTS 4
+#define FZ_ROPES 2
+#define FZ_MAX_TEXT 4096
+
+// Reference model: a length and a malloc'd buffer, edited with memmove
+
+typedef struct { char* p; size_t len; } fz_model;
+
+static void m_reserve(fz_model* m, size_t n) {
+    m->p = (char*)realloc(m->p, n + 1);
+    if (!m->p) abort();
+}
+static void m_set(fz_model* m, const char* p, size_t n) {
+    char* t = (char*)malloc(n + 1);           /* p may point into m */
+    if (!t) abort();
+    memcpy(t, p, n);
+    free(m->p);
+    m->p = t;
+    m->len = n;
+}
+static void m_insert(fz_model* m, size_t pos, const char* p, size_t n) {
+    fz_model t = { NULL, 0 };
+    m_set(&t, p, n);
+    if (pos > m->len) pos = m->len;
+    m_reserve(m, m->len + n);
+    memmove(m->p + pos + n, m->p + pos, m->len - pos);
+    memcpy(m->p + pos, t.p, n);
+    m->len += n;
+    free(t.p);
+}
+static void m_erase(fz_model* m, size_t pos, size_t n) {
+    if (pos > m->len) return;
+    if (n > m->len - pos) n = m->len - pos;
+    memmove(m->p + pos, m->p + pos + n, m->len - pos - n);
+    m->len -= n;
+}
+static size_t m_find(const char* h, size_t hn, const char* x, size_t xn, size_t from) {
+    if (from > hn) return (size_t)-1;
+    for (size_t i = from; i + xn <= hn; ++i)
+        if (memcmp(h + i, x, xn) == 0) return i;
+    return (size_t)-1;
+}
+static size_t m_rfind(const char* h, size_t hn, const char* x, size_t xn, size_t from) {
+    if (xn > hn) return (size_t)-1;
+    size_t i = hn - xn < from ? hn - xn : from;
+    for (;; --i) {
+        if (memcmp(h + i, x, xn) == 0) return i;
+        if (i == 0) return (size_t)-1;
+    }
+}
+static int m_cmp(const fz_model* a, const fz_model* b) {
+    size_t n = a->len < b->len ? a->len : b->len;
+    int c = n ? memcmp(a->p, b->p, n) : 0;
+    if (c) return c < 0 ? -1 : 1;
+    return a->len < b->len ? -1 : a->len > b->len;
+}
+
+// Counting allocator with one injectable failure
+
+static struct {
+    long   live;          /* blocks handed out and not yet freed */
+    long   calls;         /* malloc/realloc calls so far */
+    long   fail_at;       /* call number that returns NULL (0 = none) */
+    int    failed;        /* the injected failure happened during the current op */
+} fz_heap;
+
+static int fz_should_fail(void) {
+    if (++fz_heap.calls != fz_heap.fail_at) return 0;
+    fz_heap.failed = 1;
+    return 1;
+}
+static void* fz_m(size_t n, void* ctx) {
+    (void)ctx;
+    if (fz_should_fail()) return NULL;
+    void* p = malloc(n);
+    if (p) ++fz_heap.live;
+    return p;
+}
+static void* fz_r(void* p, size_t n, void* ctx) {
+    (void)ctx;
+    if (fz_should_fail()) return NULL;
+    void* q = realloc(p, n);
+    if (q && !p) ++fz_heap.live;
+    return q;
+}
+static void fz_f(void* p, void* ctx) {
+    (void)ctx;
+    if (p) --fz_heap.live;
+    free(p);
+}
+static const rs_alloc fz_alloc = { fz_m, fz_r, fz_f, NULL, NULL, NULL, NULL };
+
+// Input stream: reads past the end yield zeros, so every prefix is a valid program
+
+typedef struct { const uint8_t* p; size_t n; } fz_in;
+
+static unsigned fz_u8(fz_in* in) {
+    if (!in->n) return 0;
+    --in->n;
+    return *in->p++;
+}
+static size_t fz_u16(fz_in* in) { size_t hi = fz_u8(in); return hi << 8 | fz_u8(in); }
+
+/* a position or count around [0, len]: mostly in range, sometimes one past, or npos */
+static size_t fz_pos(fz_in* in, size_t len) {
+    size_t v = fz_u16(in);
+    return v == 0xFFFF ? (size_t)-1 : v % (len + 2);
+}
+
+/* Operand text in one of two scratch buffers: short or long, over a small alphabet
+ * (so finds and replaces hit) that includes NUL and whitespace, or raw input bytes. */
+static char fz_scratch[2][FZ_MAX_TEXT];
+
+static rs_sv fz_text(fz_in* in, int k) {
+    unsigned b = fz_u8(in);
+    size_t len = b < 0xE0 ? b % 24 : (size_t)(b - 0xDF) * 128;
+    uint32_t x = (uint32_t)fz_u16(in) * 2654435761u | 1;
+    char* p = fz_scratch[k];
+
+    if (len > FZ_MAX_TEXT) len = FZ_MAX_TEXT;
+    if (b & 1 && len <= in->n) {
+        memcpy(p, in->p, len);
+        in->p += len;
+        in->n -= len;
+    } else {
+        static const char alpha[] = "aabaA \t.\0";
+        for (size_t i = 0; i < len; ++i) {
+            x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+            p[i] = alpha[x % (sizeof alpha - 1)];
+        }
+    }
+    return (rs_sv){ p, len };
+}
+
+// Checks
+
+static const uint8_t* fz_input;   /* the program being run, for the crash file */
+static size_t         fz_input_n;
+static int            fz_save_crash;
+
+static void fz_fail(const char* what, int op, int slot, int line) {
+    fprintf(stderr, "fuzz_rs_string: %s (op %d, slot %d, line %d)\n", what, op, slot, line);
+    if (fz_save_crash) {
+        FILE* f = fopen("fuzz-crash.bin", "wb");
+        if (f) {
+            fwrite(fz_input, 1, fz_input_n, f);
+            fclose(f);
+            fprintf(stderr, "fuzz_rs_string: input saved to fuzz-crash.bin\n");
+        }
+    }
+    abort();
+}
+#define FZ_CHECK(c, what) do { if (!(c)) fz_fail(what, op, i, __LINE__); } while (0)
+
+/* Content through the view, and the same bytes terminated through rs_string_cstr. */
+static int fz_same(const rs_string* s, const fz_model* m) {
+    rs_sv v = rs_string_sv(s);
+
+    if (v.len != m->len || rs_string_cap(s) < v.len || (v.len && memcmp(v.data, m->p, v.len) != 0)) return 0;
+
+    const char* p = rs_string_cstr(s);
+    return p == v.data && p[v.len] == '\0';
+}
+
+static int fz_rope_same(const rs_rope* r, const fz_model* m) {
+    size_t at = 0;
+    rs_sv piece;
+
+    if (rs_rope_len(r) != m->len) return 0;
+    for (rs_rope_iter it = rs_rope_iter_begin(r); rs_rope_iter_next(&it, &piece); at += piece.len)
+        if (piece.len == 0 || at + piece.len > m->len || memcmp(piece.data, m->p + at, piece.len) != 0) return 0;
+    return at == m->len;
+}
+
+// Program
+
+enum {
+    OP_ASSIGN, OP_ASSIGN_SELF, OP_APPEND, OP_APPEND_MANY, OP_PUSH_CHAR, OP_INSERT, OP_ERASE,
+    OP_REPLACE_FIRST, OP_REPLACE_ALL, OP_TRIM, OP_TRIM_CUT, OP_CASE, OP_CLEAR, OP_RESERVE,
+    OP_HOOK, OP_SHRINK, OP_SHARE, OP_SLICE, OP_FREE, OP_APPENDF, OP_PRINTF, OP_PREPARE,
+    OP_RESIZE, OP_FIND, OP_COMPARE, OP_ROPE_INSERT, OP_ROPE_APPEND, OP_ROPE_ERASE,
+    OP_ROPE_SUBSTR, OP_ROPE_SHARE, OP_ROPE_STRING, OP_COUNT
+};
+
+static size_t fz_ops_run;
+
+static void fz_run(const uint8_t* data, size_t size) {
+    fz_in in = { data, size };
+    rs_string s[FZ_SLOTS];
+    fz_model  m[FZ_SLOTS] = { { NULL, 0 } };
+    rs_rope   r[FZ_ROPES];
+    fz_model  rm[FZ_ROPES] = { { NULL, 0 } };
+    unsigned  first = fz_u8(&in);
+
+    memset(&fz_heap, 0, sizeof fz_heap);
+    fz_heap.fail_at = first & 0x80 ? (long)(first & 0x1F) + 1 + FZ_SLOTS : 0;
+
+    /* slots start out on the hook (an empty heap buffer) and keep it as they grow */
+    for (int k = 0; k < FZ_SLOTS; ++k) {
+        rs_string_init(&s[k]);
+        m_set(&m[k], "", 0);
+        if (rs_string_reserve_ex(&s[k], RS_SSO_CAP + 1, fz_alloc) != 0) abort();
+    }
+    for (int k = 0; k < FZ_ROPES; ++k) { rs_rope_init(&r[k]); m_set(&rm[k], "", 0); }
+
+    for (int op = 0; in.n; ++op) {
+        unsigned code = fz_u8(&in) % OP_COUNT;
+        int i = (int)(fz_u8(&in) % FZ_SLOTS), j = (int)(fz_u8(&in) % FZ_SLOTS);
+        fz_model* mi = &m[i];
+        size_t len = mi->len;
+        int rc = 0;
+
+        fz_heap.failed = 0;
+        ++fz_ops_run;
+
+        switch (code) {
+        case OP_ASSIGN: {
+            rs_sv v = fz_text(&in, 0);
+            if ((rc = rs_string_assign(&s[i], v)) == 0) m_set(mi, v.data, v.len);
+            break;
+        }
+        case OP_ASSIGN_SELF: {        /* the view points into the string itself */
+            size_t pos = fz_pos(&in, len), n = fz_pos(&in, len);
+            rs_sv v = rs_sv_substr(rs_string_sv(&s[i]), pos, n);
+            size_t at = (size_t)(v.data - rs_string_sv(&s[i]).data);
+            if ((rc = rs_string_assign(&s[i], v)) == 0) m_set(mi, mi->p + at, v.len);
+            break;
+        }
+        case OP_APPEND: {
+            rs_sv v = fz_text(&in, 0);
+            if ((rc = rs_string_append(&s[i], v)) == 0) m_insert(mi, len, v.data, v.len);
+            break;
+        }
+        case OP_APPEND_MANY: {        /* documented to accept parts that point into s */
+            size_t pos = fz_pos(&in, len), n = fz_pos(&in, len);
+            rs_sv self = rs_sv_substr(rs_string_sv(&s[i]), pos, n);
+            size_t at = (size_t)(self.data - rs_string_sv(&s[i]).data);
+            rs_sv parts[3] = { fz_text(&in, 0), self, fz_text(&in, 1) };
+            fz_model want = { NULL, 0 };
+            m_set(&want, mi->p, len);
+            m_insert(&want, want.len, parts[0].data, parts[0].len);
+            m_insert(&want, want.len, mi->p + at, self.len);
+            m_insert(&want, want.len, parts[2].data, parts[2].len);
+            if ((rc = rs_string_append_many(&s[i], parts, 3)) == 0) { free(mi->p); *mi = want; }
+            else free(want.p);
+            break;
+        }
+        case OP_PUSH_CHAR: {
+            char c = (char)fz_u8(&in);
+            if ((rc = rs_string_push_char(&s[i], c)) == 0) m_insert(mi, len, &c, 1);
+            break;
+        }
+        case OP_INSERT: {
+            size_t pos = fz_pos(&in, len);
+            rs_sv v = fz_text(&in, 0);
+            if ((rc = rs_string_insert(&s[i], pos, v)) == 0) m_insert(mi, pos, v.data, v.len);
+            break;
+        }
+        case OP_ERASE: {
+            size_t pos = fz_pos(&in, len), n = fz_pos(&in, len);
+            if ((rc = rs_string_erase(&s[i], pos, n)) == 0) m_erase(mi, pos, n);
+            break;
+        }
+        case OP_REPLACE_FIRST: {
+            rs_sv from = fz_text(&in, 0), to = fz_text(&in, 1);
+            size_t at = m_find(mi->p, len, from.data, from.len, 0);
+            if ((rc = rs_string_replace_first(&s[i], from, to)) == 0 && at != (size_t)-1) {
+                m_erase(mi, at, from.len);
+                m_insert(mi, at, to.data, to.len);
+            }
+            break;
+        }
+        case OP_REPLACE_ALL: {
+            rs_sv from = fz_text(&in, 0), to = fz_text(&in, 1);
+            fz_model want = { NULL, 0 };
+            int count = 0;
+            size_t r0 = 0, at;
+            while (from.len && (at = m_find(mi->p, len, from.data, from.len, r0)) != (size_t)-1) {
+                r0 = at + from.len;
+                ++count;
+            }
+            m_reserve(&want, len - count * from.len + count * to.len);   /* sized once: results get large */
+            for (r0 = 0; count && (at = m_find(mi->p, len, from.data, from.len, r0)) != (size_t)-1; r0 = at + from.len) {
+                memcpy(want.p + want.len, mi->p + r0, at - r0);
+                memcpy(want.p + want.len + at - r0, to.data, to.len);
+                want.len += at - r0 + to.len;
+            }
+            memcpy(want.p + want.len, mi->p + r0, len - r0);
+            want.len += len - r0;
+            rc = rs_string_replace_all(&s[i], from, to);
+            if (rc >= 0) {
+                FZ_CHECK(rc == count, "replace_all count");
+                if (count) { free(mi->p); *mi = want; want.p = NULL; }
+                rc = 0;
+            }
+            free(want.p);
+            break;
+        }
+        case OP_TRIM: {
+            unsigned how = fz_u8(&in) % 3;
+            size_t a = 0, b = len;
+            if (how != 1) while (a < b && (unsigned char)mi->p[a] <= 0x20) ++a;
+            if (how != 0) while (b > a && (unsigned char)mi->p[b - 1] <= 0x20) --b;
+            rc = how == 0 ? rs_string_trim_left(&s[i]) : how == 1 ? rs_string_trim_right(&s[i]) : rs_string_trim(&s[i]);
+            if (rc == 0) { m_erase(mi, b, len); m_erase(mi, 0, a); }
+            break;
+        }
+        case OP_TRIM_CUT: {
+            rs_sv cut = fz_text(&in, 0);
+            size_t a = 0, b = len;
+            while (b > 0 && memchr(cut.data, mi->p[b - 1], cut.len)) --b;
+            while (a < b && memchr(cut.data, mi->p[a], cut.len)) ++a;
+            if ((rc = rs_string_trim_cut(&s[i], cut)) == 0) { m_erase(mi, b, len); m_erase(mi, 0, a); }
+            break;
+        }
+        case OP_CASE: {
+            int up = fz_u8(&in) & 1;
+            rc = up ? rs_string_to_upper_ascii(&s[i]) : rs_string_to_lower_ascii(&s[i]);
+            if (rc == 0)
+                for (size_t k = 0; k < len; ++k) {
+                    char c = mi->p[k];
+                    if (up && c >= 'a' && c <= 'z') mi->p[k] = (char)(c - 32);
+                    if (!up && c >= 'A' && c <= 'Z') mi->p[k] = (char)(c + 32);
+                }
+            break;
+        }
+        case OP_CLEAR:
+            if ((rc = rs_string_clear(&s[i])) == 0) mi->len = 0;
+            break;
+        case OP_RESERVE:
+            rc = rs_string_reserve(&s[i], fz_u16(&in) % (2 * FZ_MAX_TEXT));
+            break;
+        case OP_HOOK:                 /* grow onto the counting allocator (only from inline) */
+            rc = rs_string_reserve_ex(&s[i], RS_SSO_CAP + 1 + fz_u8(&in) + len, fz_alloc);
+            break;
+        case OP_SHRINK:
+            rc = rs_string_shrink_to_fit(&s[i]);
+            break;
+        case OP_SHARE:
+            rs_string_share(&s[i], &s[j]);
+            if (i != j) m_set(mi, m[j].p, m[j].len);
+            break;
+        case OP_SLICE: {
+            size_t pos = fz_pos(&in, m[j].len), n = fz_pos(&in, m[j].len);
+            rs_sv v = rs_sv_substr((rs_sv){ m[j].p, m[j].len }, pos, n);
+            if ((rc = rs_string_slice(&s[i], &s[j], pos, n)) == 0) m_set(mi, v.data, v.len);
+            break;
+        }
+        case OP_FREE:
+            rs_string_free(&s[i]);
+            mi->len = 0;
+            break;
+        case OP_APPENDF: {            /* %s of the string itself is documented to work */
+            unsigned k = fz_u8(&in);
+            int self = k & 1;
+            rs_sv v = fz_text(&in, 0);
+            const char* arg = self ? rs_string_sv(&s[i]).data : v.data;
+            int argn = self ? (int)len : (int)v.len;
+            char* want = NULL;
+            int wn = snprintf(NULL, 0, "%.*s#%u", argn, arg, k);
+            want = (char*)malloc((size_t)wn + 1);
+            if (!want) abort();
+            snprintf(want, (size_t)wn + 1, "%.*s#%u", argn, arg, k);
+            rc = rs_string_appendf(&s[i], "%.*s#%u", argn, arg, k);
+            if (rc >= 0) {
+                FZ_CHECK(rc == wn, "appendf length");
+                m_insert(mi, len, want, (size_t)wn);
+                rc = 0;
+            }
+            free(want);
+            break;
+        }
+        case OP_PRINTF: {
+            rs_sv v = fz_text(&in, 0);
+            char want[FZ_MAX_TEXT + 8];
+            int wn = snprintf(want, sizeof want, "[%.*s]", (int)v.len, v.data);
+            rc = rs_string_printf(&s[i], "[%.*s]", (int)v.len, v.data);
+            if (rc >= 0) {
+                FZ_CHECK(rc == wn, "printf length");
+                m_set(mi, want, (size_t)wn);
+                rc = 0;
+            }
+            break;
+        }
+        case OP_PREPARE: {
+            rs_sv v = fz_text(&in, 0);
+            size_t keep = fz_pos(&in, v.len);
+            char* p = rs_string_prepare(&s[i], v.len);
+            if (!p) { rc = -1; break; }
+            memcpy(p, v.data, v.len);
+            if (keep > v.len) keep = v.len;
+            FZ_CHECK(rs_string_commit(&s[i], keep) == 0, "commit");
+            m_insert(mi, len, v.data, keep);
+            break;
+        }
+        case OP_RESIZE: {
+            size_t n = fz_u16(&in) % (2 * FZ_MAX_TEXT);
+            char* p = rs_string_resize_uninit(&s[i], n);
+            if (!p) { rc = -1; break; }
+            if (n > len) memset(p + len, 'z', n - len);
+            m_reserve(mi, n);
+            if (n > len) memset(mi->p + len, 'z', n - len);
+            mi->len = n;
+            break;
+        }
+        case OP_FIND: {               /* queries change nothing; compared with the model */
+            rs_sv x = fz_text(&in, 0);
+            size_t from = fz_pos(&in, len);
+            FZ_CHECK(rs_string_find(&s[i], x, from) == m_find(mi->p, len, x.data, x.len, from), "find");
+            FZ_CHECK(rs_string_rfind(&s[i], x, from) == m_rfind(mi->p, len, x.data, x.len, from), "rfind");
+            FZ_CHECK(!rs_string_starts_with(&s[i], x) == !(x.len <= len && memcmp(mi->p, x.data, x.len) == 0), "starts_with");
+            FZ_CHECK(!rs_string_ends_with(&s[i], x) == !(x.len <= len && memcmp(mi->p + len - x.len, x.data, x.len) == 0), "ends_with");
+            break;
+        }
+        case OP_COMPARE: {
+            int want = m_cmp(mi, &m[j]), got = rs_string_cmp(&s[i], &s[j]);
+            FZ_CHECK((got > 0) - (got < 0) == want, "cmp");
+            FZ_CHECK(rs_string_eq(&s[i], &s[j]) == (want == 0), "eq");
+            FZ_CHECK(rs_string_eq_sv(&s[i], (rs_sv){ m[j].p, m[j].len }) == (want == 0), "eq_sv");
+            FZ_CHECK(want != 0 || rs_string_hash(&s[i]) == rs_string_hash(&s[j]), "hash");
+            break;
+        }
+        case OP_ROPE_INSERT: {
+            int q = i % FZ_ROPES;
+            size_t pos = fz_pos(&in, rm[q].len);
+            rs_sv v = fz_text(&in, 0);
+            if ((rc = rs_rope_insert(&r[q], pos, v)) == 0) m_insert(&rm[q], pos, v.data, v.len);
+            break;
+        }
+        case OP_ROPE_APPEND: {
+            int q = i % FZ_ROPES;
+            rs_sv v = fz_text(&in, 0);
+            if ((rc = rs_rope_append(&r[q], v)) == 0) m_insert(&rm[q], rm[q].len, v.data, v.len);
+            break;
+        }
+        case OP_ROPE_ERASE: {
+            int q = i % FZ_ROPES;
+            size_t pos = fz_pos(&in, rm[q].len), n = fz_pos(&in, rm[q].len);
+            if ((rc = rs_rope_erase(&r[q], pos, n)) == 0) m_erase(&rm[q], pos, n);
+            break;
+        }
+        case OP_ROPE_SUBSTR: {
+            int q = i % FZ_ROPES, p = j % FZ_ROPES;
+            size_t pos = fz_pos(&in, rm[p].len), n = fz_pos(&in, rm[p].len);
+            rs_sv v = rs_sv_substr((rs_sv){ rm[p].p, rm[p].len }, pos, n);
+            if ((rc = rs_rope_substr(&r[q], &r[p], pos, n)) == 0) m_set(&rm[q], v.data, v.len);
+            break;
+        }
+        case OP_ROPE_SHARE: {
+            int q = i % FZ_ROPES, p = j % FZ_ROPES;
+            rs_rope_share(&r[q], &r[p]);
+            if (q != p) m_set(&rm[q], rm[p].p, rm[p].len);
+            break;
+        }
+        case OP_ROPE_STRING: {        /* the rope pins the slot's buffer; the slot stays writable */
+            int q = j % FZ_ROPES;
+            size_t pos = fz_pos(&in, rm[q].len);
+            if ((rc = rs_rope_insert_string(&r[q], pos, &s[i])) == 0) m_insert(&rm[q], pos, mi->p, len);
+            break;
+        }
+        }
+
+        FZ_CHECK(rc == 0 || fz_heap.failed, "failed without an allocation failure");
+        for (int k = 0; k < FZ_SLOTS; ++k)
+            if (!fz_same(&s[k], &m[k])) fz_fail("string differs from the model", op, k, __LINE__);
+        for (int k = 0; k < FZ_ROPES; ++k)
+            if (!fz_rope_same(&r[k], &rm[k])) fz_fail("rope differs from the model", op, k, __LINE__);
+    }
+
+    for (int k = 0; k < FZ_SLOTS; ++k) { rs_string_free(&s[k]); free(m[k].p); }
+    for (int k = 0; k < FZ_ROPES; ++k) { rs_rope_free(&r[k]); free(rm[k].p); }
+    if (fz_heap.live != 0) fz_fail("blocks leaked from the allocator hook", -1, -1, __LINE__);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    fz_input = data;
+    fz_input_n = size;
+    fz_run(data, size);
+    return 0;
+}
+
+#ifndef RS_FUZZ_NO_MAIN
+static int fz_file(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) { perror(path); return -1; }
+
+    uint8_t* buf = NULL;
+    size_t n = 0, cap = 0, got;
+    do {
+        if (n == cap && !(buf = (uint8_t*)realloc(buf, cap = cap ? 2 * cap : 4096))) abort();
+        n += got = fread(buf + n, 1, cap - n, f);
+    } while (got);
+    fclose(f);
+
+    LLVMFuzzerTestOneInput(buf, n);
+    free(buf);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    unsigned long runs = 10000, seed = 1;
+    int files = 0;
+
+    for (int a = 1; a < argc; ++a) {
+        if (!strcmp(argv[a], "--runs") && a + 1 < argc)      runs = strtoul(argv[++a], NULL, 10);
+        else if (!strcmp(argv[a], "--seed") && a + 1 < argc) seed = strtoul(argv[++a], NULL, 10);
+        else if (fz_file(argv[a]) == 0)                       ++files;
+        else return 1;
+    }
+    if (files) {
+        printf("fuzz_rs_string: %d input(s), %zu ops ok\n", files, fz_ops_run);
+        return 0;
+    }
+
+    /* random programs of up to 2 KiB; one in four fails an allocation */
+    static uint8_t prog[2048];
+    uint64_t x = seed * 0x9E3779B97F4A7C15u | 1;
+    fz_save_crash = 1;
+    for (unsigned long k = 0; k < runs; ++k) {
+        size_t n = 1;
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        n += x % sizeof prog;
+        for (size_t b = 0; b < n; ++b) {
+            x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+            prog[b] = (uint8_t)(x >> 32);
+        }
+        prog[0] = x & 3 ? prog[0] & 0x7F : prog[0] | 0x80;
+        LLVMFuzzerTestOneInput(prog, n);
+    }
+    printf("fuzz_rs_string: %lu runs, %zu ops ok (seed %lu)\n", runs, fz_ops_run, seed);
+    return 0;
+}
+#endif
@@ -34,11 +34,11 @@
 
 int main(void) {
     rs_string s = rs_string_from_val("  Hello");
-    rs()->trim(&s);
-    rs()->append(&s, rs_sv_from_cstr(", rs"));
-    rs()->replace_all(&s, rs_sv_from_cstr("rs"), rs_sv_from_cstr("rs_string"));
-    rs()->printf_(&s, "[%s] len=%zu", rs()->cstr(&s), rs()->len(&s));
-    puts(rs()->cstr(&s));
-    rs()->free_(&s);
+    rs(trim)(&s);
+    rs(append)(&s, rs_sv_from_cstr(", rs"));
+    rs(replace_all)(&s, rs_sv_from_cstr("rs"), rs_sv_from_cstr("rs_string"));
+    rs(printf_)(&s, "[%s] len=%zu", rs(cstr)(&s), rs(len)(&s));
+    puts(rs(cstr)(&s));
+    rs(free_)(&s);
     return 0;
 }
@@ -0,0 +1,372 @@
+// perf_rs_string.c — complexity gates for rs_string (the `perf_gate` target)
+// Usage: perf_rs_string [--filter SUBSTR] [--slack X]
+// Each timing gate runs one operation at a base size n and at 16n and compares ns/op.
+// The growth may not exceed what the documented bound allows, times --slack for cache
+// and timer noise (default 3): O(1) may grow 3x, O(log n) ~4x, O(n) 48x, O(n log n)
+// ~60x, while a quadratic slip grows 256x. Per size the best of 5 calibrated batches
+// counts, and a gate is retried twice before it fails, so noise alone does not trip it.
+// Where the documentation promises work rather than time (share copies nothing,
+// replace_all allocates once) the allocator hook counts it exactly, at 1 MiB.
+// Exits 1 if any bound is broken.
+#define _GNU_SOURCE             /* clock_gettime */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "rs_string.h"
+#include "rs_string_rope.h"
+#include "rs_string_sort.h"
+
+#define PERF_GROWTH 16          /* the large size is PERF_GROWTH times the base size */
+#define PERF_REPS   5
+#define PERF_MIN_NS 5e6         /* batches of at least 5 ms */
+#define PERF_TRIES  3
+
+static volatile size_t perf_sink;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+#if defined(CLOCK_MONOTONIC)
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Fixtures
+
+typedef struct {
+    size_t    n;
+    char*     buf;              /* n bytes of text: lowercase words split by ',' */
+    rs_string s, t, u;          /* s holds buf, u an equal copy, t is scratch */
+    rs_rope   r, q;
+    rs_sv*    keys;             /* n views into buf, and their scratch copy */
+    rs_sv*    work;
+} perf_ctx;
+
+static uint32_t perf_rng = 2463534242u;
+static uint32_t rnd(void) { perf_rng ^= perf_rng << 13; perf_rng ^= perf_rng >> 17; perf_rng ^= perf_rng << 5; return perf_rng; }
+
+static void fx_text(perf_ctx* c) {
+    c->buf = (char*)malloc(c->n + 1);
+    for (size_t i = 0; i < c->n; ++i) c->buf[i] = rnd() % 9 ? (char)('a' + rnd() % 26) : ',';
+    c->buf[c->n] = '\0';
+    rs_string_init(&c->s);
+    rs_string_init(&c->t);
+    rs_string_init(&c->u);
+    rs_rope_init(&c->r);
+    rs_rope_init(&c->q);
+    rs_string_assign(&c->s, (rs_sv){ c->buf, c->n });
+    rs_string_assign(&c->u, (rs_sv){ c->buf, c->n });
+}
+
+/* the text between two runs of 8 spaces */
+static void fx_padded(perf_ctx* c) {
+    fx_text(c);
+    memset(c->buf, ' ', 8);             /* leading only: a shared trim that keeps the end stays O(1) */
+    rs_string_assign(&c->s, (rs_sv){ c->buf, c->n });
+}
+
+static void fx_rope(perf_ctx* c) {
+    fx_text(c);
+    for (size_t at = 0; at < c->n; at += 1000)
+        rs_rope_append(&c->r, rs_sv_substr((rs_sv){ c->buf, c->n }, at, 1000));
+}
+
+/* n / 8 views of 4..27 bytes at random offsets */
+static void fx_keys(perf_ctx* c) {
+    fx_text(c);
+    c->keys = (rs_sv*)malloc(c->n / 8 * sizeof(rs_sv));
+    c->work = (rs_sv*)malloc(c->n / 8 * sizeof(rs_sv));
+    for (size_t i = 0; i < c->n / 8; ++i) {
+        size_t at = rnd() % c->n, len = 4 + rnd() % 24;
+        c->keys[i] = (rs_sv){ c->buf + at, len < c->n - at ? len : c->n - at };
+    }
+}
+
+static void fx_free(perf_ctx* c) {
+    rs_string_free(&c->s);
+    rs_string_free(&c->t);
+    rs_string_free(&c->u);
+    rs_rope_free(&c->r);
+    rs_rope_free(&c->q);
+    free(c->buf);
+    free(c->keys);
+    free(c->work);
+    memset(c, 0, sizeof *c);
+}
+
+// Operations: each runs `iters` times
+
+static void p_share(perf_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        rs_string_share(&c->t, &c->s);
+        perf_sink += rs_string_len(&c->t);
+    }
+}
+
+static void p_slice(perf_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        rs_string_slice(&c->t, &c->s, c->n / 4, (size_t) - 1);
+        perf_sink += rs_string_len(&c->t);
+    }
+}
+
+static void p_trim_shared(perf_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        rs_string_share(&c->t, &c->s);
+        rs_string_trim(&c->t);
+        perf_sink += rs_string_len(&c->t);
+    }
+}
+
+static void p_rope_share(perf_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        rs_rope_share(&c->q, &c->r);
+        perf_sink += rs_rope_len(&c->q);
+    }
+}
+
+static void p_rope_edit(perf_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        rs_rope_insert(&c->r, c->n / 2, (rs_sv){ "[inserted]", 10 });
+        rs_rope_erase(&c->r, c->n / 2, 10);
+    }
+    perf_sink += rs_rope_len(&c->r);
+}
+
+static void p_push_char(perf_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        rs_string_free(&c->t);
+        for (size_t i = 0; i < c->n; ++i) rs_string_push_char(&c->t, c->buf[i]);
+        perf_sink += rs_string_len(&c->t);
+    }
+}
+
+static void p_replace(perf_ctx* c, size_t iters, rs_sv from, rs_sv to) {
+    for (size_t it = 0; it < iters; ++it) {
+        rs_string_assign(&c->t, rs_string_sv(&c->s));
+        perf_sink += (size_t)rs_string_replace_all(&c->t, from, to);
+    }
+}
+static void p_replace_grow(perf_ctx* c, size_t iters)   { p_replace(c, iters, (rs_sv){ ",", 1 }, (rs_sv){ ", ", 2 }); }
+static void p_replace_same(perf_ctx* c, size_t iters)   { p_replace(c, iters, (rs_sv){ ",", 1 }, (rs_sv){ ";", 1 }); }
+static void p_replace_shrink(perf_ctx* c, size_t iters) { p_replace(c, iters, (rs_sv){ ",", 1 }, (rs_sv){ "", 0 }); }
+
+static void p_find_miss(perf_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) perf_sink += rs_string_find(&c->s, (rs_sv){ "zqxj,zqx", 8 }, 0);
+}
+
+static void p_eq(perf_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) perf_sink += rs_string_eq(&c->s, &c->u);
+}
+
+static void p_split(perf_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        rs_sv_split_iter si;
+        rs_sv tok;
+        rs_sv_split_iter_init(&si, rs_string_sv(&c->s), (rs_sv){ ",", 1 }, 0);
+        while (rs_sv_split_iter_next(&si, &tok)) perf_sink += tok.len;
+    }
+}
+
+static void p_utf8(perf_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) perf_sink += rs_utf8_validate(rs_string_sv(&c->s));
+}
+
+static void p_sort(perf_ctx* c, size_t iters) {
+    for (size_t it = 0; it < iters; ++it) {
+        memcpy(c->work, c->keys, c->n / 8 * sizeof(rs_sv));
+        rs_sort_views(c->work, c->n / 8);
+        perf_sink += c->work[0].len;
+    }
+}
+
+// Timing gates
+
+typedef enum { O_1, O_LOG_N, O_N, O_N_LOG_N } perf_bound;
+
+static const char* const perf_bound_name[] = { "O(1)", "O(log n)", "O(n)", "O(n log n)" };
+
+static double perf_cost(perf_bound b, double n) {
+    switch (b) {
+    case O_1:       return 1;
+    case O_LOG_N:   return log2(n);
+    case O_N:       return n;
+    case O_N_LOG_N: return n * log2(n);
+    }
+    return 1;
+}
+
+typedef struct {
+    const char* name;
+    perf_bound  bound;
+    size_t      n;              /* base size (bytes of text) */
+    void (*setup)(perf_ctx*);
+    void (*run)(perf_ctx*, size_t iters);
+} perf_gate;
+
+static const perf_gate perf_gates[] = {
+    { "share",          O_1,       4096,      fx_text,   p_share },
+    { "slice",          O_1,       4096,      fx_text,   p_slice },
+    { "trim_shared",    O_1,       4096,      fx_padded, p_trim_shared },
+    { "rope_share",     O_1,       64 * 1024, fx_rope,   p_rope_share },
+    { "rope_edit",      O_LOG_N,   64 * 1024, fx_rope,   p_rope_edit },
+    { "push_char",      O_N,       4096,      fx_text,   p_push_char },
+    { "replace_grow",   O_N,       4096,      fx_text,   p_replace_grow },
+    { "replace_same",   O_N,       4096,      fx_text,   p_replace_same },
+    { "replace_shrink", O_N,       4096,      fx_text,   p_replace_shrink },
+    { "find_miss",      O_N,       4096,      fx_text,   p_find_miss },
+    { "eq",             O_N,       4096,      fx_text,   p_eq },
+    { "split_iter",     O_N,       4096,      fx_text,   p_split },
+    { "utf8_validate",  O_N,       4096,      fx_text,   p_utf8 },
+    { "sort_views",     O_N_LOG_N, 16 * 1024, fx_keys,   p_sort },
+};
+
+/* best ns/op over PERF_REPS batches of at least PERF_MIN_NS */
+static double perf_measure(const perf_gate* g, size_t n) {
+    perf_ctx c;
+    size_t iters = 1;
+    double best = 0;
+
+    memset(&c, 0, sizeof c);
+    c.n = n;
+    g->setup(&c);
+    for (;;) {
+        uint64_t t0 = now_ns();
+        g->run(&c, iters);
+        double el = (double)(now_ns() - t0);
+        if (el >= PERF_MIN_NS || iters >= ((size_t)1 << 40)) break;
+        iters = el <= 0 ? iters * 16 : (size_t)((double)iters * (PERF_MIN_NS * 1.2 / el)) + 1;
+    }
+    for (int i = 0; i < PERF_REPS; ++i) {
+        uint64_t t0 = now_ns();
+        g->run(&c, iters);
+        double t = (double)(now_ns() - t0) / (double)iters;
+        if (i == 0 || t < best) best = t;
+    }
+    fx_free(&c);
+    return best;
+}
+
+// Work gates: counted through the allocator hook
+
+static long perf_allocs;       /* malloc and realloc calls */
+static long perf_live;         /* blocks not yet freed */
+
+static void* perf_m(size_t n, void* ctx)          { (void)ctx; ++perf_allocs; ++perf_live; return malloc(n); }
+static void* perf_r(void* p, size_t n, void* ctx) { (void)ctx; ++perf_allocs; perf_live += !p; return realloc(p, n); }
+static void  perf_f(void* p, void* ctx)           { (void)ctx; perf_live -= p != NULL; free(p); }
+
+/* a uniquely owned heap string of n bytes on the counting hook */
+static void perf_hooked(rs_string* s, const char* buf, size_t n) {
+    rs_alloc a = { perf_m, perf_r, perf_f, NULL, NULL, NULL, NULL };
+    rs_string_init(s);
+    rs_string_reserve_ex(s, n > RS_SSO_CAP ? n : RS_SSO_CAP + 1, a);
+    rs_string_assign(s, (rs_sv){ buf, n });
+}
+
+static int perf_work(const char* name, const char* what, long got, long limit, const char* filter) {
+    if (filter && !strstr(name, filter)) return 0;
+    int ok = got <= limit;
+    printf("%-16s %-10s %8d %10ld %8s %10s %8s %8ld   %s\n", name, what, 1 << 20, got, "", "", "", limit, ok ? "ok" : "FAIL");
+    return !ok;
+}
+
+static int perf_work_gates(const char* filter) {
+    const size_t n = 1 << 20;
+    perf_ctx c;
+    rs_string s, t;
+    int bad = 0;
+    long a0;
+
+    memset(&c, 0, sizeof c);
+    c.n = n;
+    fx_padded(&c);
+    perf_hooked(&s, c.buf, n);
+    rs_string_init(&t);
+
+    a0 = perf_allocs;
+    for (int i = 0; i < 100; ++i) rs_string_share(&t, &s);
+    bad |= perf_work("share", "allocs", perf_allocs - a0, 0, filter);
+
+    a0 = perf_allocs;
+    for (int i = 0; i < 100; ++i) rs_string_slice(&t, &s, 1000, (size_t) - 1);
+    bad |= perf_work("slice", "allocs", perf_allocs - a0, 0, filter);
+
+    a0 = perf_allocs;
+    for (int i = 0; i < 100; ++i) { rs_string_share(&t, &s); rs_string_trim(&t); }
+    bad |= perf_work("trim_shared", "allocs", perf_allocs - a0, 0, filter);
+    rs_string_free(&t);
+
+    perf_hooked(&t, c.buf, n);          /* unique from here on */
+    a0 = perf_allocs;
+    rs_string_replace_all(&t, (rs_sv){ ",", 1 }, (rs_sv){ ", ", 2 });
+    bad |= perf_work("replace_grow", "allocs", perf_allocs - a0, 1, filter);
+
+    a0 = perf_allocs;
+    rs_string_replace_all(&t, (rs_sv){ ", ", 2 }, (rs_sv){ ",", 1 });
+    bad |= perf_work("replace_shrink", "allocs", perf_allocs - a0, 0, filter);
+    rs_string_free(&t);
+
+    /* geometric growth: O(log n) reallocations for n pushes */
+    perf_hooked(&t, "", 0);
+    a0 = perf_allocs;
+    for (size_t i = 0; i < n; ++i) rs_string_push_char(&t, c.buf[i]);
+    bad |= perf_work("push_char", "allocs", perf_allocs - a0, 2 * 20 + 8, filter);
+    rs_string_free(&t);
+
+    rs_string_free(&s);
+    fx_free(&c);
+    bad |= perf_work("hook", "live", perf_live, 0, filter);
+    return bad;
+}
+
+static void usage(void) {
+    fputs("usage: perf_rs_string [--filter SUBSTR] [--slack X]\n", stderr);
+}
+
+int main(int argc, char** argv) {
+    const char* filter = NULL;
+    double slack = 3.0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--filter") && i + 1 < argc) filter = argv[++i];
+        else if (!strcmp(argv[i], "--slack") && i + 1 < argc) slack = atof(argv[++i]);
+        else { usage(); return 2; }
+    }
+
+    int gates = 0, broken = 0;
+
+    printf("%-16s %-10s %8s %10s %8s %10s %8s %8s\n", "gate", "bound", "n", "ns/op", "16n", "ns/op", "growth", "limit");
+    for (size_t g = 0; g < sizeof perf_gates / sizeof perf_gates[0]; ++g) {
+        const perf_gate* pg = &perf_gates[g];
+        size_t n0 = pg->n, n1 = pg->n * PERF_GROWTH;
+        double limit = slack * perf_cost(pg->bound, (double)n1) / perf_cost(pg->bound, (double)n0);
+        double t0 = 0, t1 = 0, growth = 0;
+
+        if (filter && !strstr(pg->name, filter)) continue;
+        for (int k = 0; k < PERF_TRIES; ++k) {
+            t0 = perf_measure(pg, n0);
+            t1 = perf_measure(pg, n1);
+            growth = t1 / (t0 > 0 ? t0 : 1e-3);
+            if (growth <= limit) break;
+        }
+        int ok = growth <= limit;
+        printf("%-16s %-10s %8zu %10.1f %8zu %10.1f %7.1fx %7.1fx   %s\n",
+               pg->name, perf_bound_name[pg->bound], n0, t0, n1, t1, growth, limit, ok ? "ok" : "FAIL");
+        ++gates;
+        broken += !ok;
+    }
+
+    int work_bad = perf_work_gates(filter);
+
+    if (broken || work_bad) {
+        printf("perf_gate: %d of %d timing gates broken%s\n", broken, gates, work_bad ? ", work bounds broken" : "");
+        return 1;
+    }
+    printf("perf_gate: all bounds hold\n");
+    return 0;
+}
@@ -22,7 +22,7 @@
 
 // rs_string.h - header-only dynamic string for C11 (English-only)
 // Features: SSO, length/capacity, string_view, basic COW (copy-on-write) with refcount,
-// trim/split/replace, printf helpers, adopt/steal, UTF helpers (stubs for brevity).
+// trim/split/replace, printf helpers, adopt/steal, UTF-8 <-> UTF-16/32 transcoders.
 // This is a compact implementation for demonstration and can be extended.
 //
 // Created by Raman Sharkovich on 24.09.25.
@@ -40,36 +40,324 @@
 #include <stdbool.h>
 
 // --- Config
+// RS_LAYOUT_COMPACT=1 selects a 24-byte rs_string (23 inline chars, tag in the last byte)
+#ifndef RS_LAYOUT_COMPACT
+#define RS_LAYOUT_COMPACT 0
+#endif
+
+#if RS_LAYOUT_COMPACT
+  #ifdef RS_SSO_CAP
+    #error "RS_SSO_CAP is fixed by RS_LAYOUT_COMPACT (three words minus the tag byte)"
+  #endif
+  #define RS_SSO_CAP (3 * sizeof(size_t) - 1)
+#endif
+
 #ifndef RS_SSO_CAP
 #define RS_SSO_CAP 22
 #endif
 
+// SIMD kernels: picked at compile time (SSE2/NEON) and at runtime (AVX2).
+// Define RS_NO_SIMD to force the portable scalar paths.
+#ifndef RS_NO_SIMD
+  #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define RS__SSE2 1
+    #include <emmintrin.h>
+  #endif
+  #if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define RS__AVX2_DISPATCH 1
+    #include <immintrin.h>
+  #endif
+  #if defined(__SSSE3__) || defined(__AVX__)
+    #define RS__SSSE3 1
+    #include <tmmintrin.h>
+  #endif
+  #if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+    #define RS__NEON 1
+    #include <arm_neon.h>
+    #if defined(__aarch64__) || defined(_M_ARM64)
+      #define RS__NEON64 1 /* vqtbl1q / across-vector reductions */
+    #endif
+  #endif
+#endif
+
+#ifdef _MSC_VER
+  #include <intrin.h>
+  static inline unsigned rs__ctz32(uint32_t x) { unsigned long i; _BitScanForward(&i, x); return (unsigned)i; }
+  static inline unsigned rs__ctz64(uint64_t x) { unsigned long i; _BitScanForward64(&i, x); return (unsigned)i; }
+  static inline unsigned rs__popcnt32(uint32_t x) { return (unsigned)__popcnt(x); }
+  static inline unsigned rs__clz64(uint64_t x) { unsigned long i; _BitScanReverse64(&i, x); return 63u - (unsigned)i; }
+#else
+  static inline unsigned rs__ctz32(uint32_t x) { return (unsigned)__builtin_ctz(x);   }
+  static inline unsigned rs__ctz64(uint64_t x) { return (unsigned)__builtin_ctzll(x); }
+  static inline unsigned rs__popcnt32(uint32_t x) { return (unsigned)__builtin_popcount(x); }
+  static inline unsigned rs__clz64(uint64_t x) { return (unsigned)__builtin_clzll(x); }
+#endif
+
+#ifdef RS__AVX2_DISPATCH
+static inline int rs__cpu_has_avx2(void) {
+    static int has = -1;
+    if (has < 0) has = __builtin_cpu_supports("avx2") ? 1 : 0;
+    return has;
+}
+#endif
+
 // Optional atomic refcount
 #ifdef RS_ATOMIC_REFCOUNT
   #include <stdatomic.h>
   typedef _Atomic size_t rs_rc_t;
-  static inline size_t rs__rc_inc(rs_rc_t* p){ return atomic_fetch_add_explicit(p, 1, memory_order_acq_rel)+1; }
-  static inline size_t rs__rc_dec(rs_rc_t* p){ return atomic_fetch_sub_explicit(p, 1, memory_order_acq_rel)-1; }
+  /* A new reference comes from an existing one, so the increment orders nothing. The
+   * decrement releases this owner's writes; whoever drops the last reference acquires
+   * all of them before freeing. */
+  static inline size_t rs__rc_inc(rs_rc_t* p){ return atomic_fetch_add_explicit(p, 1, memory_order_relaxed)+1; }
+  static inline size_t rs__rc_dec(rs_rc_t* p){
+      size_t r = atomic_fetch_sub_explicit(p, 1, memory_order_release)-1;
+      if (r == 0) atomic_thread_fence(memory_order_acquire);
+      return r;
+  }
   static inline size_t rs__rc_get(rs_rc_t* p){ return atomic_load_explicit(p, memory_order_acquire); }
+  /* thread-confined counters (rs_string_confine): only one thread ever touches them */
+  static inline size_t rs__rc_inc_local(rs_rc_t* p) {
+      size_t r = atomic_load_explicit(p, memory_order_relaxed) + 1;
+      atomic_store_explicit(p, r, memory_order_relaxed);
+      return r;
+  }
+  static inline size_t rs__rc_dec_local(rs_rc_t* p) {
+      size_t r = atomic_load_explicit(p, memory_order_relaxed) - 1;
+      atomic_store_explicit(p, r, memory_order_relaxed);
+      return r;
+  }
+  /* cached facts about a shared buffer may be filled in by any reader */
+  typedef _Atomic uint64_t rs_memo_t;
+  static inline uint64_t rs__memo_get(rs_memo_t* p)             { return atomic_load_explicit(p, memory_order_relaxed); }
+  static inline void     rs__memo_set(rs_memo_t* p, uint64_t v) { atomic_store_explicit(p, v, memory_order_relaxed); }
+  static inline void     rs__memo_or(rs_memo_t* p, uint64_t v)  { atomic_fetch_or_explicit(p, v, memory_order_relaxed); }
 #else
   typedef size_t rs_rc_t;
   static inline size_t rs__rc_inc(rs_rc_t* p)       { return ++(*p); }
   static inline size_t rs__rc_dec(rs_rc_t* p)       { return --(*p); }
   static inline size_t rs__rc_get(const rs_rc_t* p) { return *p; }
+  #define rs__rc_inc_local rs__rc_inc
+  #define rs__rc_dec_local rs__rc_dec
+  typedef uint64_t rs_memo_t;
+  static inline uint64_t rs__memo_get(rs_memo_t* p)             { return *p; }
+  static inline void     rs__memo_set(rs_memo_t* p, uint64_t v) { *p = v; }
+  static inline void     rs__memo_or(rs_memo_t* p, uint64_t v)  { *p |= v; }
+#endif
+
+/* Drop one reference; true if it was the last. A sole owner skips the atomic RMW: with
+ * rc == 1 no other handle exists that could change the count. */
+static inline bool rs__rc_drop(rs_rc_t* p) { return rs__rc_get(p) == 1 || rs__rc_dec(p) == 0; }
+
+// Optional instrumentation
+// RS_STATS=1 counts what the string operations cost (rs_stats_snapshot / rs_stats_reset).
+// Each thread bumps its own counters; a snapshot sums every thread, live or exited.
+// Like the rest of the library the totals are per translation unit. With RS_STATS off
+// the counting compiles away and a snapshot is all zeros.
+#ifndef RS_STATS
+#define RS_STATS 0
+#endif
+
+/* (re)allocations by new capacity: <=64, <=256, <=1K, <=4K, <=16K, <=64K, <=1M, larger */
+#define RS_STATS_BUCKETS 8
+
+typedef struct {
+    uint64_t heap_promotions;     /* strings that outgrew (or never fit) the inline buffer */
+    uint64_t cow_copies;          /* writes and slices that had to copy a shared buffer */
+    uint64_t reallocs;            /* buffer (re)allocations on the growth path */
+    uint64_t reallocs_by_size[RS_STATS_BUCKETS];
+    uint64_t moved_bytes;         /* bytes shifted by insert / erase */
+    uint64_t finds;               /* find / rfind / find_any / find_all / count calls */
+    uint64_t replaces;            /* replace_* calls */
+} rs_stats;
+
+#if RS_STATS
+  #include <threads.h>
+  #include <stdatomic.h>
+
+  #define RS__STATS_N (sizeof(rs_stats) / sizeof(uint64_t))
+
+  /* one block per thread; the owner is the only writer, so relaxed load + store is a
+   * plain increment that a concurrent snapshot may still read */
+  typedef struct rs__stats_blk {
+      _Atomic uint64_t      c[RS__STATS_N];
+      struct rs__stats_blk* next;
+  } rs__stats_blk;
+
+  static once_flag rs__stats_once = ONCE_FLAG_INIT;
+  static struct {
+      mtx_t          mu;
+      tss_t          key;         /* folds a thread's block into `retired` when it exits */
+      rs__stats_blk* live;
+      uint64_t       retired[RS__STATS_N];
+  } rs__stats_g;
+
+  static _Thread_local rs__stats_blk* rs__stats_mine;
+
+  static inline void rs__stats_exit(void* p) {
+      rs__stats_blk* b = (rs__stats_blk*)p;
+
+      mtx_lock(&rs__stats_g.mu);
+      for (size_t i = 0; i < RS__STATS_N; ++i)
+          rs__stats_g.retired[i] += atomic_load_explicit(&b->c[i], memory_order_relaxed);
+      for (rs__stats_blk** q = &rs__stats_g.live; *q; q = &(*q)->next)
+          if (*q == b) { *q = b->next; break; }
+      mtx_unlock(&rs__stats_g.mu);
+      free(b);
+  }
+
+  static inline void rs__stats_start(void) {
+      mtx_init(&rs__stats_g.mu, mtx_plain);
+      tss_create(&rs__stats_g.key, rs__stats_exit);
+  }
+
+  static inline rs__stats_blk* rs__stats_blk_get(void) {
+      rs__stats_blk* b = rs__stats_mine;
+      if (b) return b;
+
+      call_once(&rs__stats_once, rs__stats_start);
+      if (!(b = (rs__stats_blk*)calloc(1, sizeof *b))) return NULL;
+
+      mtx_lock(&rs__stats_g.mu);
+      b->next = rs__stats_g.live;
+      rs__stats_g.live = b;
+      mtx_unlock(&rs__stats_g.mu);
+      tss_set(rs__stats_g.key, b);
+      return rs__stats_mine = b;
+  }
+
+  static inline void rs__stat_add(size_t i, uint64_t n) {
+      rs__stats_blk* b = rs__stats_blk_get();
+      if (b) atomic_store_explicit(&b->c[i], atomic_load_explicit(&b->c[i], memory_order_relaxed) + n,
+                                   memory_order_relaxed);
+  }
+
+  static inline size_t rs__stat_bucket(size_t cap) {
+      size_t b = 0;
+      for (size_t lim = 64; cap > lim && b < 6; lim *= 4) ++b;
+      return b < 6 ? b : cap <= ((size_t)1 << 20) ? 6 : 7;
+  }
+
+  #define RS__STAT(field, n) rs__stat_add(offsetof(rs_stats, field) / sizeof(uint64_t), (uint64_t)(n))
+  /* one (re)allocation of a buffer with capacity `cap` */
+  #define RS__STAT_REALLOC(cap)                                                              \
+      (RS__STAT(reallocs, 1),                                                                \
+       rs__stat_add(offsetof(rs_stats, reallocs_by_size) / sizeof(uint64_t) + rs__stat_bucket(cap), 1))
+#else
+  #define RS__STAT(field, n)    ((void)0)
+  #define RS__STAT_REALLOC(cap) ((void)0)
+#endif
+
+/* Totals so far, over every thread that has touched a counter. */
+static inline rs_stats rs_stats_snapshot(void) {
+    rs_stats st;
+    memset(&st, 0, sizeof st);
+#if RS_STATS
+    uint64_t* o = (uint64_t*)(void*)&st;
+
+    call_once(&rs__stats_once, rs__stats_start);
+    mtx_lock(&rs__stats_g.mu);
+    for (size_t i = 0; i < RS__STATS_N; ++i) o[i] = rs__stats_g.retired[i];
+    for (rs__stats_blk* b = rs__stats_g.live; b; b = b->next)
+        for (size_t i = 0; i < RS__STATS_N; ++i) o[i] += atomic_load_explicit(&b->c[i], memory_order_relaxed);
+    mtx_unlock(&rs__stats_g.mu);
+#endif
+    return st;
+}
+
+/* Zero every counter. An increment racing with the reset on another thread may survive
+ * it; reset between phases, not in the middle of one. */
+static inline void rs_stats_reset(void) {
+#if RS_STATS
+    call_once(&rs__stats_once, rs__stats_start);
+    mtx_lock(&rs__stats_g.mu);
+    memset(rs__stats_g.retired, 0, sizeof rs__stats_g.retired);
+    for (rs__stats_blk* b = rs__stats_g.live; b; b = b->next)
+        for (size_t i = 0; i < RS__STATS_N; ++i) atomic_store_explicit(&b->c[i], 0, memory_order_relaxed);
+    mtx_unlock(&rs__stats_g.mu);
 #endif
+}
 
 // Allocator hook
 typedef struct {
       void*(*m)(size_t, void*);
       void*(*r)(void*, size_t, void*);
       void (*f)(void*, void*); void* ctx;
+      size_t (*round)(size_t, void*); /* optional: real block size handed out for a request */
+      size_t (*grow)(size_t cap, size_t need, void*); /* optional: next capacity (rs_grow_default) */
+      size_t (*usable)(void*, void*); /* optional: real size of an allocated block */
   } rs_alloc;
 
 static inline void* rs__sys_malloc(size_t n, void* ctx) { (void)ctx; return malloc(n); }
 static inline void* rs__sys_realloc(void* p, size_t n, void* ctx) { (void)ctx; return realloc(p,n); }
 static inline void  rs__sys_free(void* p, void* ctx) { (void)ctx; free(p); }
-static inline rs_alloc rs_default_alloc(void) {
-    return (rs_alloc){ &rs__sys_malloc, &rs__sys_realloc, &rs__sys_free, NULL };
+
+/* The system allocator rounds blocks up (to 16 bytes, size classes, pages); that slack
+ * becomes capacity. Define RS_NO_USABLE_SIZE to keep capacities exact. */
+#if !defined(RS_NO_USABLE_SIZE) && defined(__GLIBC__)
+  #include <malloc.h>
+  #define RS__SYS_USABLE 1
+  static inline size_t rs__sys_usable(void* p, void* ctx) { (void)ctx; return malloc_usable_size(p); }
+#elif !defined(RS_NO_USABLE_SIZE) && defined(__APPLE__)
+  #include <malloc/malloc.h>
+  #define RS__SYS_USABLE 1
+  static inline size_t rs__sys_usable(void* p, void* ctx) { (void)ctx; return malloc_size(p); }
+#elif !defined(RS_NO_USABLE_SIZE) && defined(_MSC_VER)
+  #include <malloc.h>
+  #define RS__SYS_USABLE 1
+  static inline size_t rs__sys_usable(void* p, void* ctx) { (void)ctx; return _msize(p); }
+#endif
+
+static inline const rs_alloc* rs__sys_alloc(void) {
+#ifdef RS__SYS_USABLE
+    static const rs_alloc a = { &rs__sys_malloc, &rs__sys_realloc, &rs__sys_free, NULL, NULL, NULL, &rs__sys_usable };
+#else
+    static const rs_alloc a = { &rs__sys_malloc, &rs__sys_realloc, &rs__sys_free, NULL, NULL, NULL, NULL };
+#endif
+    return &a;
+}
+
+static inline rs_alloc rs_default_alloc(void) { return *rs__sys_alloc(); }
+
+static inline bool rs__alloc_same(const rs_alloc* x, const rs_alloc* y) {
+    return x->m == y->m && x->r == y->r && x->f == y->f && x->ctx == y->ctx
+           && x->round == y->round && x->grow == y->grow && x->usable == y->usable;
+}
+
+#ifndef __STDC_NO_ATOMICS__
+  #include <stdatomic.h>
+  #define RS__ALLOC_LIST(T)              _Atomic(T)
+  #define RS__ALLOC_LOAD(p)              atomic_load_explicit(p, memory_order_acquire)
+  #define RS__ALLOC_PUSH(p, head, n)     atomic_compare_exchange_weak_explicit(p, head, n, memory_order_release, memory_order_acquire)
+#else
+  #define RS__ALLOC_LIST(T)              T
+  #define RS__ALLOC_LOAD(p)              (*(p))
+  #define RS__ALLOC_PUSH(p, head, n)     (*(p) = (n), true)
+#endif
+
+typedef struct rs__alloc_copy {
+    rs_alloc a;
+    struct rs__alloc_copy* next;
+} rs__alloc_copy;
+
+/* Heap headers keep only a pointer to their allocator, so the descriptors the API takes
+ * by value are interned: a zeroed one (or the system's) maps to rs__sys_alloc, any other
+ * to a copy found in, or added to, a list that lives as long as the program (one entry
+ * per distinct descriptor, e.g. per arena). NULL if a new copy cannot be allocated. */
+static inline const rs_alloc* rs__alloc_intern(rs_alloc a) {
+    static RS__ALLOC_LIST(rs__alloc_copy*) copies;
+
+    if (!a.m || rs__alloc_same(&a, rs__sys_alloc())) return rs__sys_alloc();
+
+    rs__alloc_copy* head = RS__ALLOC_LOAD(&copies);
+    for (rs__alloc_copy* c = head; c; c = c->next)
+        if (rs__alloc_same(&c->a, &a)) return &c->a;
+
+    rs__alloc_copy* c = (rs__alloc_copy*)malloc(sizeof *c);
+    if (!c) return NULL;
+
+    c->a = a;
+    do c->next = head; while (!RS__ALLOC_PUSH(&copies, &head, c)); /* a racing twin is harmless */
+    return &c->a;
 }
 
 // string_view
@@ -81,407 +369,1753 @@ typedef struct {
 static inline rs_sv rs_sv_from_cstr(const char* s) { return (rs_sv){ s, s ? strlen(s) : 0 }; }
 static inline rs_sv rs_sv_substr(rs_sv s, size_t pos, size_t n) {
     if (pos > s.len) pos = s.len;
-    if (pos+n>s.len) n = s.len - pos;
+    if (n > s.len - pos) n = s.len - pos;
     return (rs_sv){ s.data + pos, n };
 }
 
-/* --- string_view split --- */
-typedef void (*rs_sv_split_cb)(rs_sv token, void* ctx);
+/* --- substring search ---
+ * Kernel is picked per needle: memchr for one byte, a SIMD first+last byte
+ * filter (SSE2 / AVX2 / NEON, scalar fallback) for short needles, and
+ * Horspool for long ones. All kernels return an offset or (size_t)-1. */
+#ifndef RS_FIND_SHORT_MAX
+#define RS_FIND_SHORT_MAX 32
+#endif
 
-static inline void cb_count(rs_sv t, void* ctx) {
-    int* n=(int*)ctx;
-    (*n)++;
+static inline size_t rs__find_byte(const char* h, size_t n, char c) {
+    const char* r = n ? (const char*)memchr(h, (unsigned char)c, n) : NULL;
+    return r ? (size_t)(r - h) : (size_t) - 1;
 }
 
-static inline void rs_sv_split(rs_sv s, rs_sv sep, int keep_empty, rs_sv_split_cb cb, void* ctx) {
-    size_t i = 0;
-    if (!cb) return;
-    if (sep.len == 0) {
-        if (s.len > 0 || keep_empty) cb(s, ctx);
-        return;
+/* scalar first-byte filter; also finishes the tails of the SIMD kernels */
+static inline size_t rs__find_scalar(const char* h, size_t n, const char* nd, size_t m, size_t i) {
+    while (i + m <= n) {
+        const char* c = (const char*)memchr(h + i, (unsigned char)nd[0], n - m + 1 - i);
+        if (!c) break;
+        i = (size_t)(c - h);
+        if (memcmp(h + i + 1, nd + 1, m - 1) == 0) return i;
+        ++i;
     }
+    return (size_t) - 1;
+}
 
-    while (i <= s.len) {
-        size_t pos = (size_t) - 1;
-        for (size_t j = i; j + sep.len <= s.len; ++j) {
-            if (memcmp(s.data + j, sep.data, sep.len) == 0) {
-                pos = j;
-                break;
-            }
-        }
-
-        if (pos == (size_t) - 1) {
-            rs_sv tok = { s.data + i, s.len - i };
-            if (tok.len > 0 || keep_empty)
-                cb(tok, ctx);
-            break;
-        } else {
-            rs_sv tok = { s.data + i, pos - i };
-            if (tok.len > 0 || keep_empty)
-                cb(tok, ctx);
+#ifdef RS__SSE2
+static inline size_t rs__find_sse2(const char* h, size_t n, const char* nd, size_t m) {
+    const __m128i first = _mm_set1_epi8(nd[0]);
+    const __m128i last  = _mm_set1_epi8(nd[m - 1]);
+    size_t i = 0;
 
-            i = pos + sep.len;
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        __m128i bf = _mm_loadu_si128((const __m128i*)(h + i));
+        __m128i bl = _mm_loadu_si128((const __m128i*)(h + i + m - 1));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(bf, first), _mm_cmpeq_epi8(bl, last)));
 
-            if (i == s.len && keep_empty) {
-                rs_sv empty = { s.data + i, 0 };
-                cb(empty, ctx);
-                break;
-            }
+        while (mask) {
+            unsigned bit = rs__ctz32(mask);
+            if (memcmp(h + i + bit + 1, nd + 1, m - 2) == 0) return i + bit;
+            mask &= mask - 1;
         }
     }
-}
 
-// Heap header (when not SSO)
-typedef struct { size_t cap; rs_rc_t rc; } rs__hdr;
+    return rs__find_scalar(h, n, nd, m, i);
+}
+#endif
 
-// rs_string with SSO + offset for future-ext
-typedef struct {
-    size_t len;
-    size_t off;                 /* offset reserved for future use */
-    char*  p;                   /* points to sso or heap buffer */
-    size_t cap;                 /* RS_SSO_CAP for SSO */
-    char   sso[RS_SSO_CAP + 1]; /* inline buffer */
-} rs_string;
+#ifdef RS__AVX2_DISPATCH
+__attribute__((target("avx2")))
+static inline size_t rs__find_avx2(const char* h, size_t n, const char* nd, size_t m) {
+    const __m256i first = _mm256_set1_epi8(nd[0]);
+    const __m256i last  = _mm256_set1_epi8(nd[m - 1]);
+    size_t i = 0;
 
-// Helpers
-static inline bool rs_string_is_heap(const rs_string* s)     { return s->p != s->sso; }
-static inline size_t rs_string_len(const rs_string* s)       { return s->len;         }
-static inline size_t rs_string_cap(const rs_string* s)       { return rs_string_is_heap(s) ? s->cap : RS_SSO_CAP; }
-static inline const char* rs_string_cstr(const rs_string* s) { return rs_string_is_heap(s) ? s->p   : s->sso;     }
-static inline size_t rs_string_avail(const rs_string* s) {
-    size_t cap = rs_string_cap(s);
-    return cap - s->len;
-}
+    for (; i + m - 1 + 32 <= n; i += 32) {
+        __m256i bf = _mm256_loadu_si256((const __m256i*)(h + i));
+        __m256i bl = _mm256_loadu_si256((const __m256i*)(h + i + m - 1));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(bf, first), _mm256_cmpeq_epi8(bl, last)));
 
-static inline rs__hdr* rs__hdr_from_ptr(char* p) { return (rs__hdr*)( (uint8_t*)p - sizeof(rs__hdr) ); }
-static inline char*    rs__ptr_from_hdr(rs__hdr* h) { return (char*)( (uint8_t*)h + sizeof(rs__hdr) ); }
+        while (mask) {
+            unsigned bit = rs__ctz32(mask);
+            if (memcmp(h + i + bit + 1, nd + 1, m - 2) == 0) return i + bit;
+            mask &= mask - 1;
+        }
+    }
 
-// Init/Free
-static inline void rs_string_init(rs_string* s) {
-    s->len = 0;
-    s->off = 0;
-    s->sso[0] = '\0';
-    s->p = s->sso;
-    s->cap = RS_SSO_CAP;
+    return rs__find_scalar(h, n, nd, m, i);
 }
+#endif
 
-static inline rs_string rs_string_from_val(const char* c) {
-    rs_string s;
-    rs_string_init(&s);
+#ifdef RS__NEON
+static inline size_t rs__find_neon(const char* h, size_t n, const char* nd, size_t m) {
+    const uint8x16_t first = vdupq_n_u8((uint8_t)nd[0]);
+    const uint8x16_t last  = vdupq_n_u8((uint8_t)nd[m - 1]);
+    size_t i = 0;
 
-    if(c && *c) {
-        size_t n = strlen(c);
-        if (n <= RS_SSO_CAP) {
-            memcpy(s.sso, c, n + 1);
-            s.len = n;
-        } else {
-            rs_alloc a = rs_default_alloc();
-            size_t cap = n;
-            rs__hdr* h = (rs__hdr*)a.m(sizeof(rs__hdr) + cap + 1, a.ctx);
-            h->cap = cap; h->rc = 1;
-            char* p = rs__ptr_from_hdr(h);
-            memcpy(p, c, n + 1);
-            s.p = p; s.cap = cap; s.len = n;
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        uint8x16_t bf = vld1q_u8((const uint8_t*)(h + i));
+        uint8x16_t bl = vld1q_u8((const uint8_t*)(h + i + m - 1));
+        uint8x16_t eq = vandq_u8(vceqq_u8(bf, first), vceqq_u8(bl, last));
+        /* 4 bits per lane */
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+
+        while (mask) {
+            unsigned bit = rs__ctz64(mask) >> 2;
+            if (memcmp(h + i + bit + 1, nd + 1, m - 2) == 0) return i + bit;
+            mask &= ~((uint64_t)0xF << (bit * 4));
         }
     }
 
-    return s;
+    return rs__find_scalar(h, n, nd, m, i);
 }
+#endif
 
-static inline int rs_string_from_cstr(rs_string* s, const char* c) {
-    *s = rs_string_from_val(c);
-    return 0;
+/* 2 <= m <= n */
+static inline size_t rs__find_short(const char* h, size_t n, const char* nd, size_t m) {
+#ifdef RS__AVX2_DISPATCH
+    if (rs__cpu_has_avx2()) return rs__find_avx2(h, n, nd, m);
+#endif
+#if defined(RS__SSE2)
+    return rs__find_sse2(h, n, nd, m);
+#elif defined(RS__NEON)
+    return rs__find_neon(h, n, nd, m);
+#else
+    return rs__find_scalar(h, n, nd, m, 0);
+#endif
 }
-static inline void rs__free_heap(rs_string* s) {
-    if (rs_string_is_heap(s)) {
-        rs__hdr* h = rs__hdr_from_ptr(s->p);
 
-        if (rs__rc_dec(&h->rc) == 0)
-            rs_default_alloc().f(h, NULL);
+static inline void rs__horspool_init(uint32_t skip[256], const char* nd, size_t m) {
+    uint32_t def = m > UINT32_MAX ? UINT32_MAX : (uint32_t)m;
+
+    for (int c = 0; c < 256; ++c) skip[c] = def;
+    for (size_t j = 0; j + 1 < m; ++j) {
+        size_t d = m - 1 - j;
+        skip[(unsigned char)nd[j]] = d > UINT32_MAX ? UINT32_MAX : (uint32_t)d;
     }
 }
 
-static inline void rs_string_free(rs_string* s) {
-    if (!s) return;
-    if (rs_string_is_heap(s))
-        rs__free_heap(s);
+static inline size_t rs__find_horspool(const char* h, size_t n, const char* nd, size_t m, const uint32_t skip[256]) {
+    const unsigned char last = (unsigned char)nd[m - 1];
+    size_t i = 0;
 
-    rs_string_init(s);
+    while (i + m <= n) {
+        unsigned char c = (unsigned char)h[i + m - 1];
+        if (c == last && memcmp(h + i, nd, m - 1) == 0) return i;
+        i += skip[c];
+    }
+
+    return (size_t) - 1;
 }
 
-// COW helpers
-static inline void rs__retain(rs_string* s) {
-    if (rs_string_is_heap(s)) {
-        rs__hdr* h = rs__hdr_from_ptr(s->p);
-        rs__rc_inc(&h->rc);
+enum { RS__FIND_EMPTY, RS__FIND_BYTE, RS__FIND_SHORT, RS__FIND_LONG };
+
+/* Precompiled needle, reusable across many haystacks. Does not own the needle bytes. */
+typedef struct {
+    rs_sv    needle;
+    int      kind;
+    uint32_t skip[256]; /* Horspool shift table, RS__FIND_LONG only */
+} rs_finder;
+
+static inline void rs_finder_init(rs_finder* f, rs_sv needle) {
+    f->needle = needle;
+    if      (needle.len == 0)                 f->kind = RS__FIND_EMPTY;
+    else if (needle.len == 1)                 f->kind = RS__FIND_BYTE;
+    else if (needle.len <= RS_FIND_SHORT_MAX) f->kind = RS__FIND_SHORT;
+    else {
+        f->kind = RS__FIND_LONG;
+        rs__horspool_init(f->skip, needle.data, needle.len);
     }
 }
 
-static inline void rs_string_share(rs_string* dst, const rs_string* src) {
-    if (dst == src) return;
+static inline size_t rs_finder_find(const rs_finder* f, rs_sv hay, size_t from) {
+    const size_t m = f->needle.len;
+    size_t r;
 
-    rs_string_free(dst);
-    if (rs_string_is_heap(src)) {
-        *dst = *src; /* share heap buffer, bump refcount */
-        rs__retain(dst); /* ++rc on the shared heap header */
-    } else { /* SSO: make an independent copy into dst->sso */
-        dst->len = src->len;
-        dst->off = 0;
-        dst->cap = RS_SSO_CAP;
-        memcpy(dst->sso, src->sso, src->len + 1);
-        dst->p = dst->sso;
+    if (from > hay.len) return (size_t) - 1;
+    if (f->kind == RS__FIND_EMPTY) return from;
+    if (hay.len - from < m) return (size_t) - 1;
+
+    switch (f->kind) {
+    case RS__FIND_BYTE:  r = rs__find_byte(hay.data + from, hay.len - from, f->needle.data[0]);       break;
+    case RS__FIND_SHORT: r = rs__find_short(hay.data + from, hay.len - from, f->needle.data, m);      break;
+    default:             r = rs__find_horspool(hay.data + from, hay.len - from, f->needle.data, m, f->skip); break;
     }
 
-    if (rs_string_is_heap(dst))
-        rs__retain(dst);
+    return r == (size_t) - 1 ? r : r + from;
 }
 
-static inline int rs__ensure_unique(rs_string* s, rs_alloc a) {
-    if (!rs_string_is_heap(s)) return 0;
-
-    rs__hdr* h = rs__hdr_from_ptr(s->p);
+/* One-shot search; long needles only pay for the Horspool table on long haystacks. */
+static inline size_t rs_sv_find(rs_sv hay, rs_sv needle, size_t from) {
+    const size_t m = needle.len;
 
-    if (rs__rc_get(&h->rc) == 1) return 0;
+    if (from > hay.len) return (size_t) - 1;
+    if (m == 0) return from;
+    if (hay.len - from < m) return (size_t) - 1;
 
-    size_t cap = h->cap;
-    rs__hdr* nh = (rs__hdr*)a.m(sizeof(rs__hdr) + cap + 1, a.ctx);
+    const char* h = hay.data + from;
+    size_t n = hay.len - from, r;
 
-    if (!nh) return -1;
-
-    nh->cap = cap; nh->rc = 1;
-    char* np = rs__ptr_from_hdr(nh);
-    memcpy(np, s->p, s->len + 1);
-    rs__rc_dec(&h->rc);
-    s->p = np;
-    s->cap = cap;
+    if (m == 1) {
+        r = rs__find_byte(h, n, needle.data[0]);
+    } else if (m <= RS_FIND_SHORT_MAX || n < 8 * m) {
+        r = rs__find_short(h, n, needle.data, m);
+    } else {
+        uint32_t skip[256];
+        rs__horspool_init(skip, needle.data, m);
+        r = rs__find_horspool(h, n, needle.data, m, skip);
+    }
 
-    return 0;
+    return r == (size_t) - 1 ? r : r + from;
 }
 
-// Reserve
-static inline int rs_string_reserve_ex(rs_string* s, size_t need, rs_alloc a) {
-    size_t cap = rs_string_cap(s);
+/* Reverse search: last match starting at or before `from` ((size_t)-1 = end). */
+static inline size_t rs_sv_rfind(rs_sv hay, rs_sv needle, size_t from) {
+    const size_t m = needle.len;
 
-    if (need <= cap)                  return 0;
-    if (rs__ensure_unique(s, a) != 0) return -1;
+    if (m > hay.len) return (size_t) - 1;
 
-    size_t ncap = cap + cap / 2 + 1;
-    if (ncap < need)
-        ncap = need;
+    size_t i = hay.len - m;
+    if (from < i) i = from;
+    if (m == 0) return i;
 
-    if (rs_string_is_heap(s)) {
-        rs__hdr* oh = rs__hdr_from_ptr(s->p);
-        rs__hdr* nh = (rs__hdr*)a.r(oh, sizeof(rs__hdr) + ncap + 1, a.ctx);
+    const char first = needle.data[0];
 
-        if (!nh) return -1;
+    for (;;) {
+        if (hay.data[i] == first && memcmp(hay.data + i + 1, needle.data + 1, m - 1) == 0)
+            return i;
+        if (i == 0) break;
+        --i;
+    }
 
-        nh->cap = ncap;
-        s->p = rs__ptr_from_hdr(nh);
-        s->cap = ncap;
-    } else {
-        rs__hdr* nh = (rs__hdr*)a.m(sizeof(rs__hdr) + ncap + 1, a.ctx);
+    return (size_t) - 1;
+}
 
-        if (!nh) return -1;
+/* --- hashing ---
+ * wyhash (final4): a fast 64-bit non-cryptographic hash. Output depends on the
+ * platform's byte order; do not persist it across architectures. */
+#if defined(__SIZEOF_INT128__)
+static inline void rs__mum(uint64_t* a, uint64_t* b) {
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r; *b = (uint64_t)(r >> 64);
+}
+#elif defined(_MSC_VER) && defined(_M_X64)
+static inline void rs__mum(uint64_t* a, uint64_t* b) { *a = _umul128(*a, *b, b); }
+#else
+static inline void rs__mum(uint64_t* a, uint64_t* b) {
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32), c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo; *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+}
+#endif
 
-        nh->cap = ncap;
-        nh->rc = 1;
-        char* np = rs__ptr_from_hdr(nh);
-        memcpy(np, s->sso, s->len + 1);
-        s->p = np;
-        s->cap = ncap;
+static inline uint64_t rs__mix(uint64_t a, uint64_t b) { rs__mum(&a, &b); return a ^ b; }
+static inline uint64_t rs__rd8(const uint8_t* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+static inline uint64_t rs__rd4(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+
+static inline uint64_t rs_sv_hash_seed(rs_sv v, uint64_t seed) {
+    static const uint64_t k[4] = { 0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull };
+    const uint8_t* p = (const uint8_t*)v.data;
+    size_t len = v.len;
+    uint64_t a, b;
+
+    seed ^= rs__mix(seed ^ k[0], k[1]);
+
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (rs__rd4(p) << 32) | rs__rd4(p + ((len >> 3) << 2));
+            b = (rs__rd4(p + len - 4) << 32) | rs__rd4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t s1 = seed, s2 = seed;
+            do {
+                seed = rs__mix(rs__rd8(p)      ^ k[1], rs__rd8(p + 8)  ^ seed);
+                s1   = rs__mix(rs__rd8(p + 16) ^ k[2], rs__rd8(p + 24) ^ s1);
+                s2   = rs__mix(rs__rd8(p + 32) ^ k[3], rs__rd8(p + 40) ^ s2);
+                p += 48; i -= 48;
+            } while (i > 48);
+            seed ^= s1 ^ s2;
+        }
+        while (i > 16) {
+            seed = rs__mix(rs__rd8(p) ^ k[1], rs__rd8(p + 8) ^ seed);
+            i -= 16; p += 16;
+        }
+        a = rs__rd8(p + i - 16);
+        b = rs__rd8(p + i - 8);
     }
 
-    return 0;
+    a ^= k[1]; b ^= seed;
+    rs__mum(&a, &b);
+
+    return rs__mix(a ^ k[0] ^ len, b ^ k[1]);
 }
 
-static inline int rs_string_reserve(rs_string* s, size_t need) {
-    return rs_string_reserve_ex(s, need, rs_default_alloc());
+static inline uint64_t rs_sv_hash(rs_sv v) { return rs_sv_hash_seed(v, 0); }
+
+/* --- string_view split ---
+ * All forms cut `s` at every separator and drop empty tokens unless keep_empty is set,
+ * so "a,,b," yields a, b (or a, "", b, "" with keep_empty). An empty separator yields
+ * `s` itself. Tokens point into `s`; nothing is allocated. */
+typedef void (*rs_sv_split_cb)(rs_sv token, void* ctx);
+
+static inline void cb_count(rs_sv t, void* ctx) {
+    int* n=(int*)ctx;
+    (*n)++;
 }
 
-// Assign/Append
-static inline int rs_string_assign(rs_string* s, rs_sv v) {
-    rs_alloc a = rs_default_alloc();
+/* Pull-style splitter on a (multi-byte) separator:
+ *   rs_sv_split_iter it; rs_sv tok;
+ *   rs_sv_split_iter_init(&it, s, rs_sv_from_cstr(", "), 0);
+ *   while (rs_sv_split_iter_next(&it, &tok)) ...
+ * Does not own `s` or the separator bytes. */
+typedef struct {
+    rs_sv     s;
+    size_t    i;          /* start of the next token */
+    int       keep_empty;
+    int       done;
+    rs_finder f;
+} rs_sv_split_iter;
+
+static inline void rs_sv_split_iter_init(rs_sv_split_iter* it, rs_sv s, rs_sv sep, int keep_empty) {
+    it->s = s;
+    it->i = 0;
+    it->keep_empty = keep_empty;
+    it->done = 0;
+    rs_finder_init(&it->f, sep);
+}
 
-    if (rs_string_reserve_ex(s, v.len, a) != 0) return -1;
-    if (rs__ensure_unique(s, a)                 != 0) return -1;
+static inline bool rs_sv_split_iter_next(rs_sv_split_iter* it, rs_sv* tok) {
+    const size_t npos = (size_t) - 1;
 
-    memcpy(rs_string_is_heap(s) ? s->p : s->sso, v.data, v.len);
+    while (!it->done) {
+        size_t pos = it->f.needle.len ? rs_finder_find(&it->f, it->s, it->i) : npos;
+        rs_sv t = { it->s.data + it->i, (pos == npos ? it->s.len : pos) - it->i };
 
-    if(rs_string_is_heap(s))
-        s->p[v.len] = '\0';
-    else
-        s->sso[v.len]='\0';
+        if (pos == npos) it->done = 1;
+        else             it->i = pos + it->f.needle.len;
 
-    s->len = v.len;
+        if (t.len > 0 || it->keep_empty) {
+            *tok = t;
+            return true;
+        }
+    }
 
-    return 0;
+    return false;
 }
-static inline int rs_string_clear(rs_string* s) { return rs_string_assign(s, (rs_sv){ "", 0 }); }
-
-static inline int rs_string_append(rs_string* s, rs_sv v) {
-    rs_alloc a = rs_default_alloc();
-    size_t need = s->len + v.len;
 
-    if (rs_string_reserve_ex(s, need, a) != 0) return -1;
-    if (rs__ensure_unique(s, a) != 0) return -1;
+static inline void rs_sv_split(rs_sv s, rs_sv sep, int keep_empty, rs_sv_split_cb cb, void* ctx) {
+    rs_sv_split_iter it;
+    rs_sv tok;
 
-    char* p = rs_string_is_heap(s) ? s->p : s->sso;
-    memcpy(p + s->len, v.data, v.len);
-    s->len += v.len;
-    p[s->len] = '\0';
+    if (!cb) return;
 
-    return 0;
+    rs_sv_split_iter_init(&it, s, sep, keep_empty);
+    while (rs_sv_split_iter_next(&it, &tok))
+        cb(tok, ctx);
 }
-static inline int rs_string_push_cstr(rs_string* s, const char* c) {
-    return rs_string_append(s, rs_sv_from_cstr(c));
+
+/* Batch tokenizer on single-byte separators: each byte of `seps` ends a token. Every
+ * rs_sv_tokenize() call fills up to `cap` tokens in one forward pass (16-byte SIMD
+ * blocks for up to four separator bytes, a bitset otherwise) and returns how many it
+ * wrote; 0 means the input is exhausted.
+ *   rs_sv_tokenizer t; rs_sv tok[64]; size_t n;
+ *   rs_sv_tokenizer_init(&t, line, rs_sv_from_cstr(" \t"), 0);
+ *   while ((n = rs_sv_tokenize(&t, tok, 64)) != 0) ... */
+typedef struct {
+    rs_sv         s;
+    size_t        i;          /* start of the next token */
+    int           keep_empty;
+    int           done;
+    int           nsimd;      /* 1..4: bytes[] drives the SIMD kernel, 0: bitset only */
+    unsigned char bytes[4];
+    uint8_t       set[32];    /* separator bitset */
+} rs_sv_tokenizer;
+
+static inline void rs_sv_tokenizer_init(rs_sv_tokenizer* t, rs_sv s, rs_sv seps, int keep_empty) {
+    size_t distinct = 0;
+
+    t->s = s;
+    t->i = 0;
+    t->keep_empty = keep_empty;
+    t->done = 0;
+    memset(t->set, 0, sizeof t->set);
+
+    for (size_t k = 0; k < seps.len; ++k) {
+        unsigned char c = (unsigned char)seps.data[k];
+        if (t->set[c >> 3] & (1u << (c & 7))) continue;
+        t->set[c >> 3] |= (uint8_t)(1u << (c & 7));
+        if (distinct < 4) t->bytes[distinct] = c;
+        ++distinct;
+    }
+
+    t->nsimd = distinct <= 4 ? (int)distinct : 0;
+    for (size_t k = distinct; k < 4; ++k) /* pad with a repeat so unused lanes match nothing new */
+        t->bytes[k] = distinct ? t->bytes[0] : 0;
 }
 
-static inline int rs_string_push_char(rs_string* s, char ch) {
-    char tmp[1] = { ch };
-    return rs_string_append(s, (rs_sv){ tmp, 1 });
+static inline void rs_sv_tokenizer_init_byte(rs_sv_tokenizer* t, rs_sv s, char sep, int keep_empty) {
+    rs_sv_tokenizer_init(t, s, (rs_sv){ &sep, 1 }, keep_empty);
 }
 
-// Insert/Erase
-static inline int rs_string_insert(rs_string* s, size_t pos, rs_sv v) {
-    if (pos > s->len)
-        pos = s->len;
-    rs_alloc a = rs_default_alloc();
+static inline bool rs__tok_is_sep(const rs_sv_tokenizer* t, unsigned char c) {
+    return (t->set[c >> 3] >> (c & 7)) & 1u;
+}
 
-    if (rs_string_reserve_ex(s, s->len + v.len, a) != 0) return -1;
-    if (rs__ensure_unique(s, a)                          != 0) return -1;
+/* separator positions in h[0..16) as a bitmask, RS__TOK_LANE bits per byte */
+#if defined(RS__SSE2)
+  #define RS__TOK_LANE 1
+static inline uint64_t rs__tok_block(const char* h, const rs_sv_tokenizer* t) {
+    __m128i b = _mm_loadu_si128((const __m128i*)h);
+    __m128i m = _mm_cmpeq_epi8(b, _mm_set1_epi8((char)t->bytes[0]));
+
+    if (t->nsimd > 1) {
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(b, _mm_set1_epi8((char)t->bytes[1])));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(b, _mm_set1_epi8((char)t->bytes[2])));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(b, _mm_set1_epi8((char)t->bytes[3])));
+    }
 
-    char* p = rs_string_is_heap(s) ? s->p : s->sso;
-    memmove(p + pos + v.len, p + pos, s->len - pos);
-    memcpy(p + pos, v.data, v.len);
-    s->len += v.len;
-    p[s->len]='\0';
+    return (uint32_t)_mm_movemask_epi8(m);
+}
+#elif defined(RS__NEON)
+  #define RS__TOK_LANE 4
+static inline uint64_t rs__tok_block(const char* h, const rs_sv_tokenizer* t) {
+    uint8x16_t b = vld1q_u8((const uint8_t*)h);
+    uint8x16_t m = vceqq_u8(b, vdupq_n_u8(t->bytes[0]));
+
+    if (t->nsimd > 1) {
+        m = vorrq_u8(m, vceqq_u8(b, vdupq_n_u8(t->bytes[1])));
+        m = vorrq_u8(m, vceqq_u8(b, vdupq_n_u8(t->bytes[2])));
+        m = vorrq_u8(m, vceqq_u8(b, vdupq_n_u8(t->bytes[3])));
+    }
 
-    return 0;
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
 }
-static inline int rs_string_erase(rs_string* s, size_t pos, size_t n) {
-    if (pos > s->len) return 0;
-    if (pos+n > s->len) n = s->len - pos;
+#endif
 
-    rs_alloc a = rs_default_alloc();
+static inline size_t rs_sv_tokenize(rs_sv_tokenizer* t, rs_sv* out, size_t cap) {
+    const char* d = t->s.data;
+    const size_t len = t->s.len;
+    size_t start = t->i, j = t->i, n = 0;
+
+    if (t->done || cap == 0) return 0;
+
+/* ends the token at separator index `e`; returns from the call once `out` is full */
+#define RS__TOK_EMIT(e) do {                                                        \
+        size_t e_ = (e);                                                            \
+        if (e_ > start || t->keep_empty) out[n++] = (rs_sv){ d + start, e_ - start }; \
+        start = e_ + 1;                                                             \
+        if (n == cap) { t->i = start; return n; }                                   \
+    } while (0)
+
+#ifdef RS__TOK_LANE
+    if (t->nsimd) {
+        for (; j + 16 <= len; j += 16) {
+            uint64_t mask = rs__tok_block(d + j, t);
+
+            while (mask) {
+                unsigned bit = rs__ctz64(mask) / RS__TOK_LANE;
+                mask &= ~((((uint64_t)1 << RS__TOK_LANE) - 1) << (bit * RS__TOK_LANE));
+                RS__TOK_EMIT(j + bit);
+            }
+        }
+    }
+#endif
 
-    if (rs__ensure_unique(s, a) != 0) return -1;
+    for (; j < len; ++j)
+        if (rs__tok_is_sep(t, (unsigned char)d[j]))
+            RS__TOK_EMIT(j);
 
-    char* p = rs_string_is_heap(s) ? s->p : s->sso;
-    memmove(p + pos, p + pos + n, s->len - (pos + n) + 1);
-    s->len -= n;
+#undef RS__TOK_EMIT
 
-    return 0;
-}
+    t->done = 1;
+    t->i = len;
+    if (len > start || t->keep_empty) out[n++] = (rs_sv){ d + start, len - start };
 
-// Find (naive)
-static inline size_t rs_string_find(const rs_string* s, rs_sv what, size_t from) {
-    const char* p = rs_string_cstr(s);
+    return n;
+}
 
-    if (what.len == 0)
-        return from <= s->len ? from : (size_t) - 1;
+/* --- trimming views ---
+ * "Space" is every byte <= 0x20 (ASCII controls and ' '), as in rs_string_trim. The
+ * views never write; the scans run 16 bytes at a time where SSE2 / NEON exist. */
 
-    for (size_t i = from; i + what.len <= s->len; ++i) {
-        if (memcmp(p + i, what.data, what.len) == 0)
-            return i;
-    }
+/* bytes of h[0..16) above 0x20 as a bitmask, RS__TOK_LANE bits per byte */
+#if defined(RS__SSE2)
+static inline uint64_t rs__ws_block(const char* h) {
+    __m128i sp = _mm_set1_epi8(0x20);
+    __m128i b  = _mm_loadu_si128((const __m128i*)h);
 
-    return (size_t) - 1;
-}
-static inline int rs_string_starts_with(const rs_string* s, rs_sv pfx) {
-    return s->len >= pfx.len && memcmp(rs_string_cstr(s), pfx.data, pfx.len) == 0;
+    return ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(b, sp), sp)) & 0xFFFFu;
 }
-static inline int rs_string_ends_with(const rs_string* s, rs_sv sfx) {
-    return s->len >= sfx.len && memcmp(rs_string_cstr(s)+s->len-sfx.len, sfx.data, sfx.len) == 0;
+#elif defined(RS__NEON)
+static inline uint64_t rs__ws_block(const char* h) {
+    uint8x16_t m = vcgtq_u8(vld1q_u8((const uint8_t*)h), vdupq_n_u8(0x20));
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
 }
+#endif
 
-// Trim ASCII spaces
-static inline int rs_string_trim_left(rs_string* s) {
-    const char* p = rs_string_cstr(s);
+/* number of leading space bytes */
+static inline size_t rs__ws_lead(const char* p, size_t n) {
     size_t i = 0;
 
-    while (i < s->len && (unsigned char)p[i] <= 0x20) ++i;
-
-    return i == 0 ? 0 : rs_string_erase(s, 0, i);
+    if (n == 0 || (unsigned char)p[0] > 0x20) return 0;   /* the usual case: nothing to trim */
+#ifdef RS__TOK_LANE
+    for (; i + 16 <= n; i += 16) {
+        uint64_t m = rs__ws_block(p + i);
+        if (m) return i + rs__ctz64(m) / RS__TOK_LANE;
+    }
+#endif
+    while (i < n && (unsigned char)p[i] <= 0x20) ++i;
+    return i;
 }
 
-static inline int rs_string_trim_right(rs_string* s) {
-    const char* start;
-    const char* end;
-    size_t size;
+/* length left once the trailing space bytes are dropped */
+static inline size_t rs__ws_trail(const char* p, size_t n) {
+    if (n == 0 || (unsigned char)p[n - 1] > 0x20) return n;
+#ifdef RS__TOK_LANE
+    for (; n >= 16; n -= 16) {
+        uint64_t m = rs__ws_block(p + n - 16);
+        if (m) return n - 16 + (63 - rs__clz64(m)) / RS__TOK_LANE + 1;
+    }
+#endif
+    while (n > 0 && (unsigned char)p[n - 1] <= 0x20) --n;
+    return n;
+}
 
-    if (!s) return -1;
-    if (s->len == 0) return 0;
+static inline rs_sv rs_sv_trim_left(rs_sv s) {
+    size_t i = rs__ws_lead(s.data, s.len);
+    return (rs_sv){ s.data + i, s.len - i };
+}
+static inline rs_sv rs_sv_trim_right(rs_sv s) { return (rs_sv){ s.data, rs__ws_trail(s.data, s.len) }; }
+static inline rs_sv rs_sv_trim(rs_sv s)       { return rs_sv_trim_left(rs_sv_trim_right(s)); }
+
+/* A byte set for trimming an arbitrary alphabet; build it once, trim many strings. */
+typedef struct { uint8_t set[32]; } rs_byteset;
+
+static inline rs_byteset rs_byteset_of(rs_sv bytes) {
+    rs_byteset b;
+    memset(&b, 0, sizeof b);
+    for (size_t k = 0; k < bytes.len; ++k)
+        b.set[(unsigned char)bytes.data[k] >> 3] |= (uint8_t)(1u << ((unsigned char)bytes.data[k] & 7));
+    return b;
+}
+static inline bool rs_byteset_has(const rs_byteset* b, unsigned char c) { return (b->set[c >> 3] >> (c & 7)) & 1u; }
 
-    start = rs_string_cstr(s);
-    end   = start + s->len;
+/* s without the leading and trailing bytes that are in `b` */
+static inline rs_sv rs_sv_trim_set(rs_sv s, const rs_byteset* b) {
+    size_t i = 0, n = s.len;
 
-    while (end > start && (unsigned char)*(end - 1) <= 0x20) --end;
+    while (n > 0 && rs_byteset_has(b, (unsigned char)s.data[n - 1])) --n;
+    while (i < n && rs_byteset_has(b, (unsigned char)s.data[i])) ++i;
+    return (rs_sv){ s.data + i, n - i };
+}
 
-    size = (size_t)(end - start);
+/* the same with a one-off set, e.g. rs_sv_trim_cut(v, rs_sv_from_cstr("\"'")) */
+static inline rs_sv rs_sv_trim_cut(rs_sv s, rs_sv cut) {
+    rs_byteset b = rs_byteset_of(cut);
+    return rs_sv_trim_set(s, &b);
+}
 
-    return size == s->len ? 0 : rs_string_erase(s, size, s->len - size);
+/* --- ASCII case ---
+ * Only 'A'..'Z' / 'a'..'z' change; every other byte (UTF-8 included) compares and copies
+ * as is. Blocks of 16 go through SSE2 / NEON (same RS__TOK_LANE masks as above). */
+static inline unsigned char rs_ascii_lower(unsigned char c) { return (unsigned char)(c + (((unsigned)c - 'A' < 26u) << 5)); }
+static inline unsigned char rs_ascii_upper(unsigned char c) { return (unsigned char)(c - (((unsigned)c - 'a' < 26u) << 5)); }
+
+#if defined(RS__SSE2)
+/* 0xFF in the lanes holding one of the 26 letters starting at `lo` */
+static inline __m128i rs__case_lanes(__m128i b, char lo) {
+    __m128i s = _mm_add_epi8(b, _mm_set1_epi8((char)(0x80 - lo)));   /* letters -> -128..-103 */
+    return _mm_cmplt_epi8(s, _mm_set1_epi8((char)(-128 + 26)));
 }
+static inline __m128i rs__fold16(__m128i b) {
+    return _mm_or_si128(b, _mm_and_si128(rs__case_lanes(b, 'A'), _mm_set1_epi8(0x20)));
+}
+static inline uint64_t rs__case_block(const char* h, char lo) {
+    return (uint32_t)_mm_movemask_epi8(rs__case_lanes(_mm_loadu_si128((const __m128i*)h), lo));
+}
+static inline void rs__case_flip16(char* h, char lo) {
+    __m128i b = _mm_loadu_si128((const __m128i*)h);
+    _mm_storeu_si128((__m128i*)h, _mm_xor_si128(b, _mm_and_si128(rs__case_lanes(b, lo), _mm_set1_epi8(0x20))));
+}
+/* lanes where both blocks fold to the same byte */
+static inline uint64_t rs__ieq_block(const char* a, const char* b) {
+    __m128i x = rs__fold16(_mm_loadu_si128((const __m128i*)a)), y = rs__fold16(_mm_loadu_si128((const __m128i*)b));
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y));
+}
+/* candidate starts j in h[0..16): h[j] folds to f and h[j + m - 1] folds to l */
+static inline uint64_t rs__ifind_block(const char* h, size_t m, unsigned char f, unsigned char l) {
+    __m128i bf = rs__fold16(_mm_loadu_si128((const __m128i*)h));
+    __m128i bl = rs__fold16(_mm_loadu_si128((const __m128i*)(h + m - 1)));
+    return (uint32_t)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(bf, _mm_set1_epi8((char)f)),
+                                                     _mm_cmpeq_epi8(bl, _mm_set1_epi8((char)l))));
+}
+#define RS__LANES_ALL 0xFFFFu
+#elif defined(RS__NEON)
+static inline uint8x16_t rs__case_lanes(uint8x16_t b, char lo) {
+    return vcltq_u8(vsubq_u8(b, vdupq_n_u8((uint8_t)lo)), vdupq_n_u8(26));
+}
+static inline uint8x16_t rs__fold16(uint8x16_t b) {
+    return vorrq_u8(b, vandq_u8(rs__case_lanes(b, 'A'), vdupq_n_u8(0x20)));
+}
+static inline uint64_t rs__lanes4(uint8x16_t m) {
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+}
+static inline uint64_t rs__case_block(const char* h, char lo) { return rs__lanes4(rs__case_lanes(vld1q_u8((const uint8_t*)h), lo)); }
+static inline void rs__case_flip16(char* h, char lo) {
+    uint8x16_t b = vld1q_u8((const uint8_t*)h);
+    vst1q_u8((uint8_t*)h, veorq_u8(b, vandq_u8(rs__case_lanes(b, lo), vdupq_n_u8(0x20))));
+}
+static inline uint64_t rs__ieq_block(const char* a, const char* b) {
+    return rs__lanes4(vceqq_u8(rs__fold16(vld1q_u8((const uint8_t*)a)), rs__fold16(vld1q_u8((const uint8_t*)b))));
+}
+static inline uint64_t rs__ifind_block(const char* h, size_t m, unsigned char f, unsigned char l) {
+    uint8x16_t bf = rs__fold16(vld1q_u8((const uint8_t*)h));
+    uint8x16_t bl = rs__fold16(vld1q_u8((const uint8_t*)(h + m - 1)));
+    return rs__lanes4(vandq_u8(vceqq_u8(bf, vdupq_n_u8(f)), vceqq_u8(bl, vdupq_n_u8(l))));
+}
+#define RS__LANES_ALL UINT64_MAX
+#endif
 
-static inline int rs_string_trim(rs_string* s) {
-    rs_string_trim_right(s);
-    return rs_string_trim_left(s);
+/* index of the first letter of the 26 starting at `lo`, n if none */
+static inline size_t rs__case_scan(const char* p, size_t n, char lo) {
+    size_t i = 0;
+#ifdef RS__TOK_LANE
+    for (; i + 16 <= n; i += 16) {
+        uint64_t m = rs__case_block(p + i, lo);
+        if (m) return i + rs__ctz64(m) / RS__TOK_LANE;
+    }
+#endif
+    while (i < n && (unsigned)(unsigned char)p[i] - (unsigned char)lo >= 26u) ++i;
+    return i;
 }
 
-// Replace
-static inline int rs_string_replace_first(rs_string* s, rs_sv from, rs_sv to) {
-    size_t pos = rs_string_find(s, from, 0);
-    if (pos == (size_t) - 1) return 0;
-    if (from.len >= to.len) {
-        rs_string_erase(s, pos, from.len);
-        return rs_string_insert(s, pos, to);
-    } else { // reserve first then perform
-        rs_alloc a = rs_default_alloc();
+/* swap the case of every letter of the 26 starting at `lo` */
+static inline void rs__case_flip(char* p, size_t n, char lo) {
+    size_t i = 0;
+#ifdef RS__TOK_LANE
+    for (; i + 16 <= n; i += 16) rs__case_flip16(p + i, lo);
+#endif
+    for (; i < n; ++i)
+        if ((unsigned)(unsigned char)p[i] - (unsigned char)lo < 26u) p[i] ^= 0x20;
+}
 
-        if (rs_string_reserve_ex(s, s->len + (to.len-from.len), a) != 0) return -1;
+/* true if no byte has its high bit set */
+static inline bool rs_sv_is_ascii(rs_sv s) {
+    const unsigned char* p = (const unsigned char*)s.data;
+    size_t i = 0;
+    uint64_t acc = 0;
 
-        rs_string_erase(s, pos, from.len);
-        return rs_string_insert(s, pos, to);
+    for (; i + 8 <= s.len; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        acc |= w;
+        if ((i & 63) == 56 && (acc & 0x8080808080808080ull)) return false;   /* bail out early */
     }
+    if (acc & 0x8080808080808080ull) return false;
+    for (; i < s.len; ++i)
+        if (p[i] & 0x80) return false;
+    return true;
 }
-static inline int rs_string_replace_all(rs_string* s, rs_sv from, rs_sv to) {
-    if (from.len == 0) return 0;
 
+/* equal ignoring ASCII case */
+static inline bool rs_sv_ieq_ascii(rs_sv a, rs_sv b) {
     size_t i = 0;
-    int count = 0;
 
-    while(1) {
-        size_t pos = rs_string_find(s, from, i);
-        if (pos == (size_t) - 1)
-            break;
+    if (a.len != b.len) return false;
+#ifdef RS__TOK_LANE
+    for (; i + 16 <= a.len; i += 16)
+        if (rs__ieq_block(a.data + i, b.data + i) != RS__LANES_ALL) return false;
+#endif
+    for (; i < a.len; ++i)
+        if (rs_ascii_lower((unsigned char)a.data[i]) != rs_ascii_lower((unsigned char)b.data[i])) return false;
+    return true;
+}
 
-        rs_string_erase(s, pos, from.len);
-        rs_string_insert(s, pos, to);
-        i = pos + to.len;
-        ++count;
-    }
+/* First position >= from where `needle` occurs ignoring ASCII case, or (size_t)-1. */
+static inline size_t rs_sv_icase_find(rs_sv hay, rs_sv needle, size_t from) {
+    const char* h = hay.data;
+    size_t n = hay.len, m = needle.len, i = from;
 
-    return count;
-}
+    if (from > n || m > n - from) return (size_t) - 1;
+    if (m == 0) return from;
 
-// printf helpers
-static inline int rs_string_vprintf(rs_string* s, const char* fmt, va_list ap) {
+    unsigned char f = rs_ascii_lower((unsigned char)needle.data[0]);
+    unsigned char l = rs_ascii_lower((unsigned char)needle.data[m - 1]);
+#ifdef RS__TOK_LANE
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        uint64_t mask = rs__ifind_block(h + i, m, f, l);
+
+        while (mask) {
+            unsigned bit = rs__ctz64(mask) / RS__TOK_LANE;
+            if (rs_sv_ieq_ascii((rs_sv){ h + i + bit, m }, needle)) return i + bit;
+            mask &= ~((((uint64_t)1 << RS__TOK_LANE) - 1) << (bit * RS__TOK_LANE));
+        }
+    }
+#endif
+    for (; i + m <= n; ++i)
+        if (rs_ascii_lower((unsigned char)h[i]) == f && rs_ascii_lower((unsigned char)h[i + m - 1]) == l &&
+            rs_sv_ieq_ascii((rs_sv){ h + i, m }, needle))
+            return i;
+    return (size_t) - 1;
+}
+
+/* --- Equality and ordering ---
+ * Bytewise (memcmp) order, a proper prefix first; embedded NULs are ordinary bytes. */
+#if defined(RS__SSE2)
+static inline uint64_t rs__eq_block(const char* a, const char* b) {
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)a), _mm_loadu_si128((const __m128i*)b)));
+}
+#elif defined(RS__NEON)
+static inline uint64_t rs__eq_block(const char* a, const char* b) {
+    return rs__lanes4(vceqq_u8(vld1q_u8((const uint8_t*)a), vld1q_u8((const uint8_t*)b)));
+}
+#endif
+
+/* index of the first byte where a and b differ, n if none */
+static inline size_t rs__mismatch(const char* a, const char* b, size_t n) {
+    size_t i = 0;
+#ifdef RS__TOK_LANE
+    for (; i + 16 <= n; i += 16) {
+        uint64_t m = rs__eq_block(a + i, b + i) ^ RS__LANES_ALL;
+        if (m) return i + rs__ctz64(m) / RS__TOK_LANE;
+    }
+#endif
+    for (; i + 8 <= n; i += 8) {
+        uint64_t x, y;
+        memcpy(&x, a + i, 8);
+        memcpy(&y, b + i, 8);
+        if (x != y) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            return i + rs__clz64(x ^ y) / 8;
+#else
+            return i + rs__ctz64(x ^ y) / 8;
+#endif
+        }
+    }
+    while (i < n && a[i] == b[i]) ++i;
+    return i;
+}
+
+/* length of the longest common prefix */
+static inline size_t rs_sv_common_prefix(rs_sv a, rs_sv b) {
+    return rs__mismatch(a.data, b.data, a.len < b.len ? a.len : b.len);
+}
+
+/* lengths first, so strings of different size never touch their bytes */
+static inline bool rs_sv_eq(rs_sv a, rs_sv b) {
+    return a.len == b.len && (a.data == b.data || rs__mismatch(a.data, b.data, a.len) == a.len);
+}
+
+/* <0, 0, >0 as a sorts before, with or after b */
+static inline int rs_sv_cmp(rs_sv a, rs_sv b) {
+    size_t n = a.len < b.len ? a.len : b.len;
+    size_t i = a.data == b.data ? n : rs__mismatch(a.data, b.data, n);
+
+    if (i < n) return (unsigned char)a.data[i] < (unsigned char)b.data[i] ? -1 : 1;
+    return a.len < b.len ? -1 : a.len > b.len;
+}
+
+// Heap header (when not SSO). A pointer to the allocator that created the buffer travels
+// with it, so every later grow / copy / free goes back to the same allocator. `hash` memoizes
+// rs_string_hash (0 = not computed); `flags` holds other cached facts (RS__HDR_*). Both
+// are dropped whenever the buffer is about to be written.
+typedef struct {
+    size_t    cap;
+    rs_rc_t   rc;
+    rs_memo_t hash;
+    rs_memo_t flags;
+    const rs_alloc* a;
+#ifdef RS_ATOMIC_REFCOUNT
+    bool      local;   /* confined to one thread (rs_string_confine): plain refcounting */
+#endif
+} rs__hdr;
+
+#define RS__HDR_UTF8_VALID 1u /* the string's bytes are valid UTF-8 */
+
+// A size_t with a tag byte in the byte that comes last in memory (the high byte on
+// little-endian targets); the value keeps the other bits. The compact layout and the
+// rs_string_variant.h handles keep their tag there.
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  #define RS__W3_ENC(v, tag) (((size_t)(v) << 8) | (tag))
+  #define RS__W3_DEC(w)      ((size_t)(w) >> 8)
+#else
+  #define RS__W3_ENC(v, tag) ((size_t)(v) | ((size_t)(tag) << (8 * (sizeof(size_t) - 1))))
+  #define RS__W3_DEC(w)      ((size_t)(w) & ~((size_t)0xFF << (8 * (sizeof(size_t) - 1))))
+#endif
+
+#if RS_LAYOUT_COMPACT
+// Compact layout: three words. Inline strings keep RS_SSO_CAP - len in the last byte,
+// so a full inline string gets its NUL terminator for free; heap strings set the top
+// bit of that byte, which lives in the high byte of the third word. That word holds the
+// capacity, or for a slice (tag bit 0x40) the offset of `p` into the shared buffer.
+typedef struct {
+    union {
+        struct {
+            char*  p;           /* start of the bytes inside the heap buffer */
+            size_t len;
+            size_t cap;         /* capacity (slice: offset), tag in the last byte */
+        } h;
+        char sso[RS_SSO_CAP + 1];
+    } u;
+} rs_string;
+
+#define RS__CAP_ENC(cap) RS__W3_ENC(cap, 0x80u)
+#define RS__CAP_DEC(w)   RS__W3_DEC(w)
+
+static inline unsigned char rs__tag(const rs_string* s) { return (unsigned char)s->u.sso[RS_SSO_CAP]; }
+
+static inline bool rs_string_is_heap(const rs_string* s) { return (rs__tag(s) & 0x80) != 0; }
+static inline bool rs__is_slice(const rs_string* s)      { return (rs__tag(s) & 0xC0) == 0xC0; }
+static inline size_t rs_string_len(const rs_string* s)   { return rs_string_is_heap(s) ? s->u.h.len : RS_SSO_CAP - rs__tag(s); }
+static inline size_t rs__heap_cap(const rs_string* s) { return RS__CAP_DEC(s->u.h.cap); } /* not for slices */
+
+static inline char* rs__heap_ptr(const rs_string* s) { return s->u.h.p; }
+static inline size_t rs__off(const rs_string* s)     { return rs__is_slice(s) ? RS__W3_DEC(s->u.h.cap) : 0; }
+static inline char* rs__inline(rs_string* s)         { return s->u.sso; }
+static inline const char* rs__cdata(const rs_string* s) { return rs_string_is_heap(s) ? s->u.h.p : s->u.sso; }
+
+static inline void rs__set_len(rs_string* s, size_t n) {
+    if (rs_string_is_heap(s)) s->u.h.len = n;
+    else                      s->u.sso[RS_SSO_CAP] = (char)(RS_SSO_CAP - n);
+}
+static inline void rs__set_heap(rs_string* s, char* p, size_t len, size_t cap) {
+    s->u.h.p = p; s->u.h.len = len; s->u.h.cap = RS__CAP_ENC(cap);
+}
+static inline void rs__set_slice(rs_string* s, char* p, size_t off, size_t len) {
+    s->u.h.p = p; s->u.h.len = len; s->u.h.cap = RS__W3_ENC(off, 0xC0u);
+}
+static inline void rs_string_init(rs_string* s) {
+    s->u.sso[0] = '\0';
+    s->u.sso[RS_SSO_CAP] = (char)RS_SSO_CAP;
+}
+#else
+// rs_string with SSO. A heap string's `p` points at its first byte, `off` bytes past the
+// start of the (possibly shared) buffer; the top bit of `off` marks a slice.
+typedef struct {
+    size_t len;
+    size_t off;                 /* heap only: offset of p into the buffer | RS__SLICE_BIT */
+    char*  p;                   /* heap bytes, NULL while inline (SSO) */
+    size_t cap;                 /* RS_SSO_CAP for SSO */
+    char   sso[RS_SSO_CAP + 1]; /* inline buffer */
+} rs_string;
+
+#define RS__SLICE_BIT ((size_t)1 << (8 * sizeof(size_t) - 1))
+
+// Helpers
+static inline bool rs_string_is_heap(const rs_string* s) { return s->p != NULL;   }
+static inline bool rs__is_slice(const rs_string* s)      { return (s->off & RS__SLICE_BIT) != 0; }
+static inline size_t rs_string_len(const rs_string* s)   { return s->len;         }
+static inline size_t rs__heap_cap(const rs_string* s) { return s->cap; }              /* not for slices */
+
+static inline char* rs__heap_ptr(const rs_string* s) { return s->p;   }
+static inline size_t rs__off(const rs_string* s)     { return s->off & ~RS__SLICE_BIT; }
+static inline char* rs__inline(rs_string* s)         { return s->sso; }
+static inline const char* rs__cdata(const rs_string* s) { return rs_string_is_heap(s) ? s->p : s->sso; }
+
+static inline void rs__set_len(rs_string* s, size_t n) { s->len = n; }
+static inline void rs__set_heap(rs_string* s, char* p, size_t len, size_t cap) {
+    s->p = p; s->len = len; s->cap = cap; s->off = 0;
+}
+static inline void rs__set_slice(rs_string* s, char* p, size_t off, size_t len) {
+    s->p = p; s->len = len; s->cap = len; s->off = off | RS__SLICE_BIT;
+}
+
+// Init/Free
+static inline void rs_string_init(rs_string* s) {
+    s->len = 0;
+    s->off = 0;
+    s->sso[0] = '\0';
+    s->p = NULL;
+    s->cap = RS_SSO_CAP;
+}
+#endif
+
+/* writable bytes of the current representation (callers make it unique first) */
+static inline char* rs__data(rs_string* s) { return rs_string_is_heap(s) ? rs__heap_ptr(s) : rs__inline(s); }
+
+static inline rs__hdr* rs__hdr_from_ptr(char* p) { return (rs__hdr*)( (uint8_t*)p - sizeof(rs__hdr) ); }
+static inline char*    rs__ptr_from_hdr(rs__hdr* h) { return (char*)( (uint8_t*)h + sizeof(rs__hdr) ); }
+static inline rs__hdr* rs__hdr_of(const rs_string* s) { return rs__hdr_from_ptr(rs__heap_ptr(s) - rs__off(s)); }
+
+/* A slice that is the buffer's only holder may write past its end (a left trim keeps
+ * the spare room behind it); a shared one has exactly its own bytes. */
+static inline size_t rs_string_cap(const rs_string* s) {
+    if (!rs_string_is_heap(s)) return RS_SSO_CAP;
+    if (!rs__is_slice(s))      return rs__heap_cap(s);
+
+    rs__hdr* h = rs__hdr_of(s);
+    return rs__rc_get(&h->rc) == 1 ? h->cap - rs__off(s) : rs_string_len(s);
+}
+
+static inline size_t rs_string_avail(const rs_string* s) {
+    size_t cap = rs_string_cap(s);
+    return cap - rs_string_len(s);
+}
+
+// Allocator plumbing: a zeroed rs_alloc means "system allocator"
+static inline rs_alloc rs__alloc_or_default(rs_alloc a) { return a.m ? a : rs_default_alloc(); }
+static inline const rs_alloc* rs__alloc_of(const rs_string* s) {
+    return rs_string_is_heap(s) ? rs__hdr_of(s)->a : rs__sys_alloc();
+}
+static inline void* rs__realloc(const rs_alloc* a, void* p, size_t old_n, size_t n) {
+    if (a->r) return a->r(p, n, a->ctx);
+
+    void* q = a->m(n, a->ctx);
+    if (q && p) {
+        memcpy(q, p, old_n < n ? old_n : n);
+        if (a->f) a->f(p, a->ctx);
+    }
+    return q;
+}
+
+/* Grow `cap` into whatever slack the allocator would hand out anyway (size classes). */
+static inline size_t rs__fit_cap(const rs_alloc* a, size_t cap) {
+    if (!a->round) return cap;
+
+    size_t want  = sizeof(rs__hdr) + cap + 1;
+    size_t total = a->round(want, a->ctx);
+
+    return total > want ? total - sizeof(rs__hdr) - 1 : cap;
+}
+
+// Growth policy: strings grow geometrically by RS_GROW_NUM / RS_GROW_DEN; buffers past
+// RS_GROW_PAGE_MIN grow in whole RS_GROW_PAGE pages (large blocks are mapped by most
+// allocators, so the page tail would be wasted anyway).
+#ifndef RS_GROW_NUM
+#define RS_GROW_NUM 3
+#define RS_GROW_DEN 2
+#endif
+#ifndef RS_GROW_PAGE
+#define RS_GROW_PAGE 4096
+#endif
+#ifndef RS_GROW_PAGE_MIN
+#define RS_GROW_PAGE_MIN (64 * 1024)
+#endif
+
+static inline size_t rs_grow_default(size_t cap, size_t need, void* ctx) {
+    size_t ncap = cap / RS_GROW_DEN * RS_GROW_NUM + cap % RS_GROW_DEN * RS_GROW_NUM / RS_GROW_DEN + 1;
+    (void)ctx;
+
+    if (ncap < need || ncap <= cap) ncap = need;          /* also on overflow */
+    if (ncap >= RS_GROW_PAGE_MIN && ncap < SIZE_MAX - 2 * RS_GROW_PAGE) {
+        /* the whole block (header, bytes, NUL and two words of allocator bookkeeping)
+         * ends on a page boundary */
+        size_t extra = sizeof(rs__hdr) + 1 + 2 * sizeof(size_t);
+        ncap = ((ncap + extra + RS_GROW_PAGE - 1) & ~(size_t)(RS_GROW_PAGE - 1)) - extra;
+    }
+    return ncap;
+}
+
+/* exactly what was asked for: for strings that are sized once */
+static inline size_t rs_grow_exact(size_t cap, size_t need, void* ctx) { (void)cap; (void)ctx; return need; }
+
+/* Capacity for a string of capacity `cap` that needs `need`, by the allocator's policy. */
+static inline size_t rs__grow(const rs_alloc* a, size_t cap, size_t need) {
+    size_t ncap = a->grow ? a->grow(cap, need, a->ctx) : rs_grow_default(cap, need, NULL);
+    return ncap < need ? need : ncap;
+}
+
+/* Claim the slack of a block the allocator rounded up: the capacity it really holds. */
+static inline size_t rs__harvest(const rs_alloc* a, void* block, size_t cap) {
+    if (!a->usable) return cap;
+
+    size_t got = a->usable(block, a->ctx);
+    return got > sizeof(rs__hdr) + cap + 1 ? got - sizeof(rs__hdr) - 1 : cap;
+}
+
+static inline void rs__hdr_init(rs__hdr* h, size_t cap, const rs_alloc* a) {
+    h->cap = cap; h->rc = 1; h->a = a;
+    rs__memo_set(&h->hash, 0);
+    rs__memo_set(&h->flags, 0);
+#ifdef RS_ATOMIC_REFCOUNT
+    h->local = false;
+#endif
+}
+
+/* The header records the capacity the block really has (>= cap). */
+static inline rs__hdr* rs__hdr_new(size_t cap, const rs_alloc* a) {
+    rs__hdr* h = (rs__hdr*)a->m(sizeof(rs__hdr) + cap + 1, a->ctx);
+
+    if (h) rs__hdr_init(h, rs__harvest(a, h, cap), a);
+    return h;
+}
+
+static inline void rs__hdr_free(rs__hdr* h) {
+    const rs_alloc* a = h->a;
+    if (a->f) a->f(h, a->ctx);
+}
+
+static inline bool rs__hdr_is_local(const rs__hdr* h) {
+#ifdef RS_ATOMIC_REFCOUNT
+    return h->local;
+#else
+    (void)h;
+    return false;
+#endif
+}
+
+static inline void rs__hdr_retain(rs__hdr* h) {
+    if (rs__hdr_is_local(h)) rs__rc_inc_local(&h->rc);
+    else                     rs__rc_inc(&h->rc);
+}
+
+/* drop a reference to the buffer, freeing it with the last one */
+static inline void rs__hdr_release(rs__hdr* h) {
+    bool last = rs__rc_get(&h->rc) == 1
+             || (rs__hdr_is_local(h) ? rs__rc_dec_local(&h->rc) : rs__rc_dec(&h->rc)) == 0;
+
+    if (last) rs__hdr_free(h);
+}
+
+static inline rs_string rs_string_from_val_ex(const char* c, rs_alloc a) {
+    rs_string s;
+    rs_string_init(&s);
+
+    if(c && *c) {
+        size_t n = strlen(c);
+        if (n <= RS_SSO_CAP) {
+            memcpy(rs__inline(&s), c, n + 1);
+            rs__set_len(&s, n);
+        } else {
+            const rs_alloc* ha = rs__alloc_intern(a);
+            if (!ha) return s;
+            size_t cap = rs__fit_cap(ha, n);
+            rs__hdr* h = rs__hdr_new(cap, ha);
+            if (!h) return s;
+            RS__STAT(heap_promotions, 1);
+            char* p = rs__ptr_from_hdr(h);
+            memcpy(p, c, n + 1);
+            rs__set_heap(&s, p, n, h->cap);
+        }
+    }
+
+    return s;
+}
+
+static inline rs_string rs_string_from_val(const char* c) {
+    return rs_string_from_val_ex(c, rs_default_alloc());
+}
+
+static inline int rs_string_from_cstr(rs_string* s, const char* c) {
+    *s = rs_string_from_val(c);
+    return 0;
+}
+static inline void rs__free_heap(rs_string* s) {
+    if (rs_string_is_heap(s))
+        rs__hdr_release(rs__hdr_of(s));
+}
+
+static inline void rs_string_free(rs_string* s) {
+    if (!s) return;
+    if (rs_string_is_heap(s))
+        rs__free_heap(s);
+
+    rs_string_init(s);
+}
+
+// COW helpers
+static inline void rs__retain(rs_string* s) {
+    if (rs_string_is_heap(s))
+        rs__hdr_retain(rs__hdr_of(s));
+}
+
+/* dst becomes another handle to src's bytes: one more reference on a heap buffer,
+ * a plain copy of an inline string */
+static inline void rs_string_share(rs_string* dst, const rs_string* src) {
+    if (dst == src) return;
+
+    rs_string_free(dst);
+    *dst = *src;
+    rs__retain(dst);
+}
+
+/* true if another handle holds the same heap buffer (a write would copy it first) */
+static inline bool rs_string_is_shared(const rs_string* s) {
+    return rs_string_is_heap(s) && rs__rc_get(&rs__hdr_of(s)->rc) > 1;
+}
+
+/* For bitwise copies of a handle (rs_string t = s; rs_string_retain(&t);): take the
+ * reference the copy will give back with rs_string_release. Inline strings have nothing
+ * to count. Always 0. */
+static inline int rs_string_retain(rs_string* s) {
+    rs__retain(s);
+    return 0;
+}
+
+/* drop this handle's reference; *s is left empty (the same as rs_string_free) */
+static inline void rs_string_release(rs_string* s) { rs_string_free(s); }
+
+/* Confine a uniquely owned buffer to the calling thread: shares, slices and frees of it
+ * then count references without atomic instructions (RS_ATOMIC_REFCOUNT builds; a no-op
+ * otherwise). Every handle must stay on this thread until rs_string_publish. Returns -1
+ * if the buffer is already shared. Copies made by a later write stay confined. */
+static inline int rs_string_confine(rs_string* s) {
+    if (!rs_string_is_heap(s)) return 0;
+
+    rs__hdr* h = rs__hdr_of(s);
+    if (rs__rc_get(&h->rc) != 1) return -1;
+#ifdef RS_ATOMIC_REFCOUNT
+    h->local = true;
+#endif
+    return 0;
+}
+
+/* Back to atomic refcounting; call on the owning thread before handing any handle of a
+ * confined buffer to another thread (the hand-off itself must synchronize). */
+static inline void rs_string_publish(rs_string* s) {
+#ifdef RS_ATOMIC_REFCOUNT
+    if (rs_string_is_heap(s)) rs__hdr_of(s)->local = false;
+#else
+    (void)s;
+#endif
+}
+
+/* Move the bytes of a heap string into a private buffer of `cap` from the same
+ * allocator, dropping this handle's reference to the old one. */
+static inline int rs__detach(rs_string* s, size_t cap) {
+    rs__hdr* h = rs__hdr_of(s);
+    rs__hdr* nh = rs__hdr_new(cap, h->a);
+
+    if (!nh) return -1;
+
+    RS__STAT(cow_copies, 1);
+#ifdef RS_ATOMIC_REFCOUNT
+    nh->local = h->local;
+#endif
+    size_t len = rs_string_len(s);
+    char* np = rs__ptr_from_hdr(nh);
+    memcpy(np, rs__heap_ptr(s), len);
+    np[len] = '\0';
+    rs__set_heap(s, np, len, nh->cap);
+
+    rs__hdr_release(h);
+
+    return 0;
+}
+
+/* Called before every write: detaches a shared heap buffer (the copy keeps the buffer's
+ * allocator) and forgets whatever was cached about the old contents. A detached slice
+ * only takes its own bytes along. */
+static inline int rs__ensure_unique(rs_string* s) {
+    if (!rs_string_is_heap(s)) return 0;
+
+    rs__hdr* h = rs__hdr_of(s);
+
+    if (rs__rc_get(&h->rc) == 1) {
+        rs__memo_set(&h->hash, 0);
+        rs__memo_set(&h->flags, 0);
+        return 0;
+    }
+
+    return rs__detach(s, rs_string_cap(s));
+}
+
+/* Every string keeps a terminator after its bytes (slices are only made where the
+ * parent's bytes already end, or from a buffer nobody else reads), so this only reads. */
+static inline const char* rs_string_cstr(const rs_string* s) { return rs__cdata(s); }
+
+// Reserve. `a` is only used when the string leaves SSO; a heap string keeps
+// growing with the allocator it was created with.
+static inline int rs__reserve(rs_string* s, size_t need, const rs_alloc* a) {
+    size_t cap = rs_string_cap(s);
+
+    if (need <= cap)                                  return 0;
+    if (!rs__is_slice(s) && rs__ensure_unique(s) != 0) return -1; /* slices move out below */
+
+    if (rs_string_is_heap(s)) {
+        rs__hdr* oh = rs__hdr_of(s);
+        const rs_alloc* ha = oh->a;
+        size_t ncap = rs__fit_cap(ha, rs__grow(ha, cap, need));
+        RS__STAT_REALLOC(ncap);
+
+        if (rs__is_slice(s)) return rs__detach(s, ncap);
+
+        rs__hdr* nh = (rs__hdr*)rs__realloc(ha, oh, sizeof(rs__hdr) + oh->cap + 1, sizeof(rs__hdr) + ncap + 1);
+
+        if (!nh) return -1;
+
+        nh->cap = rs__harvest(ha, nh, ncap);
+        rs__set_heap(s, rs__ptr_from_hdr(nh), rs_string_len(s), nh->cap);
+    } else {
+        size_t ncap = rs__fit_cap(a, rs__grow(a, cap, need));
+        rs__hdr* nh = rs__hdr_new(ncap, a);
+
+        if (!nh) return -1;
+
+        RS__STAT(heap_promotions, 1);
+        RS__STAT_REALLOC(ncap);
+        size_t len = rs_string_len(s);
+        char* np = rs__ptr_from_hdr(nh);
+        memcpy(np, rs__inline(s), len);
+        np[len] = '\0';
+        rs__set_heap(s, np, len, nh->cap);
+    }
+
+    return 0;
+}
+
+static inline int rs_string_reserve_ex(rs_string* s, size_t need, rs_alloc a) {
+    if (need <= rs_string_cap(s) || rs_string_is_heap(s)) return rs__reserve(s, need, rs__alloc_of(s));
+
+    const rs_alloc* ia = rs__alloc_intern(a);
+    return ia ? rs__reserve(s, need, ia) : -1;
+}
+
+static inline int rs_string_reserve(rs_string* s, size_t need) {
+    return rs__reserve(s, need, rs__alloc_of(s));
+}
+
+/* Give back unused capacity. A string that fits RS_SSO_CAP moves back inline; a longer
+ * one is reallocated to its length (plus whatever the allocator rounds up to). A slice
+ * copies its bytes out so it stops pinning the parent's buffer. A buffer other handles
+ * still use is left as it is. Returns -1 only if the smaller copy could not be allocated
+ * (the string is unchanged). */
+static inline int rs_string_shrink_to_fit(rs_string* s) {
+    if (!rs_string_is_heap(s)) return 0;
+
+    rs__hdr* h = rs__hdr_of(s);
+    size_t len = rs_string_len(s);
+    bool slice = rs__is_slice(s);
+
+    if (!slice && rs__rc_get(&h->rc) != 1) return 0;
+
+    if (len <= RS_SSO_CAP) {
+        rs_string t;
+        rs_string_init(&t);
+        memcpy(rs__inline(&t), rs__heap_ptr(s), len);
+        rs__inline(&t)[len] = '\0';
+        rs__set_len(&t, len);
+        rs_string_free(s);
+        *s = t;
+        return 0;
+    }
+
+    const rs_alloc* a = h->a;
+    size_t ncap = rs__fit_cap(a, len);
+
+    if (slice) return rs__detach(s, ncap);
+    if (ncap >= h->cap) return 0;
+
+    /* only the live bytes need to survive a copying reallocation */
+    rs__hdr* nh = (rs__hdr*)rs__realloc(a, h, sizeof(rs__hdr) + len + 1, sizeof(rs__hdr) + ncap + 1);
+
+    if (!nh) return -1;
+
+    nh->cap = rs__harvest(a, nh, ncap);
+    rs__set_heap(s, rs__ptr_from_hdr(nh), len, nh->cap);
+    return 0;
+}
+
+// Bulk write: hand out spare capacity for read()/recv()/encoders to fill in place.
+/* Make room for n more bytes and return where they go (one past the current end), or
+ * NULL on failure. The bytes up to the current capacity are unique and writable;
+ * nothing is visible until rs_string_commit. */
+static inline char* rs_string_prepare(rs_string* s, size_t n) {
+    size_t len = rs_string_len(s);
+
+    if (n > SIZE_MAX - len)                  return NULL;
+    if (rs_string_reserve(s, len + n) != 0) return NULL;
+    if (rs__ensure_unique(s)          != 0) return NULL;
+
+    return rs__data(s) + len;
+}
+
+/* Publish `written` bytes of a prepared region: bump the length and terminate. Fails
+ * (changing nothing) if that runs past the capacity. */
+static inline int rs_string_commit(rs_string* s, size_t written) {
+    if (written > rs_string_avail(s)) return -1;
+
+    size_t len = rs_string_len(s) + written;
+    rs__data(s)[len] = '\0';
+    rs__set_len(s, len);
+
+    return 0;
+}
+
+/* Set the length to n, keeping the first min(len, n) bytes and leaving the rest
+ * uninitialized (the terminator at n is written). Returns the writable data. */
+static inline char* rs_string_resize_uninit(rs_string* s, size_t n) {
+    if (rs_string_reserve(s, n) != 0) return NULL;
+    if (rs__ensure_unique(s)    != 0) return NULL;
+
+    char* p = rs__data(s);
+    p[n] = '\0';
+    rs__set_len(s, n);
+
+    return p;
+}
+
+/* In the spirit of C++23 resize_and_overwrite: `op` gets the data and n writable bytes
+ * (the old contents up to min(len, n) are still there) and returns the length to keep. */
+static inline int rs_string_resize_and_overwrite(rs_string* s, size_t n,
+                                                 size_t (*op)(char* p, size_t n, void* ctx), void* ctx) {
+    char* p = rs_string_resize_uninit(s, n);
+
+    if (!p) return -1;
+
+    size_t r = op(p, n, ctx);
+    if (r > n) r = n;
+
+    p[r] = '\0';
+    rs__set_len(s, r);
+
+    return 0;
+}
+
+// Assign/Append
+static inline int rs_string_assign(rs_string* s, rs_sv v) {
+    if (rs_string_reserve(s, v.len) != 0) return -1;
+    if (rs__ensure_unique(s)        != 0) return -1;
+
+    char* p = rs__data(s);
+    memmove(p, v.data, v.len);
+    p[v.len] = '\0';
+    rs__set_len(s, v.len);
+
+    return 0;
+}
+static inline int rs_string_clear(rs_string* s) { return rs_string_assign(s, (rs_sv){ "", 0 }); }
+
+static inline int rs_string_append(rs_string* s, rs_sv v) {
+    size_t len = rs_string_len(s);
+
+    if (rs_string_reserve(s, len + v.len) != 0) return -1;
+    if (rs__ensure_unique(s)             != 0) return -1;
+
+    char* p = rs__data(s);
+    memcpy(p + len, v.data, v.len);
+    p[len + v.len] = '\0';
+    rs__set_len(s, len + v.len);
+
+    return 0;
+}
+static inline int rs_string_push_cstr(rs_string* s, const char* c) {
+    return rs_string_append(s, rs_sv_from_cstr(c));
+}
+
+static inline int rs_string_push_char(rs_string* s, char ch) {
+    char tmp[1] = { ch };
+    return rs_string_append(s, (rs_sv){ tmp, 1 });
+}
+
+/* Append every part with a single reserve. Parts may point into `s` itself: when they
+ * do and the buffer has to grow, the result is assembled in a fresh buffer so the
+ * views stay valid until the last copy. */
+static inline int rs_string_append_many(rs_string* s, const rs_sv* parts, size_t n) {
+    size_t len = rs_string_len(s), total = len;
+    uintptr_t lo = (uintptr_t)(rs__cdata(s) - (rs_string_is_heap(s) ? rs__off(s) : 0));
+    uintptr_t hi = lo + (rs_string_is_heap(s) ? rs__hdr_of(s)->cap : RS_SSO_CAP) + 1;
+    bool alias = false;
+
+    for (size_t i = 0; i < n; ++i) {
+        uintptr_t d = (uintptr_t)parts[i].data;
+
+        if (parts[i].len > SIZE_MAX - total) return -1;
+        total += parts[i].len;
+        alias |= parts[i].len && d >= lo && d < hi;
+    }
+
+    char* p;
+    if (total <= rs_string_cap(s) || !alias) {
+        if (rs_string_reserve(s, total) != 0) return -1;
+        if (rs__ensure_unique(s)        != 0) return -1;
+        p = rs__data(s);
+    } else {
+        const rs_alloc* a = rs__alloc_of(s);
+        rs_string t;
+        rs_string_init(&t);
+
+        if (rs__reserve(&t, rs__grow(a, rs_string_cap(s), total), a) != 0) return -1;
+
+        p = rs__data(&t);
+        memcpy(p, rs__cdata(s), len);
+        for (size_t i = 0, at = len; i < n; at += parts[i].len, ++i)
+            memcpy(p + at, parts[i].data, parts[i].len);
+
+        rs_string_free(s);
+        *s = t;
+        p = rs__data(s); /* t may be inline (a narrowed slice reports a small capacity) */
+        n = 0; /* already copied */
+        len = total;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        memcpy(p + len, parts[i].data, parts[i].len);
+        len += parts[i].len;
+    }
+    p[total] = '\0';
+    rs__set_len(s, total);
+
+    return 0;
+}
+
+/* rs_concat(&s, a, b, c): append rs_sv values in one go, e.g.
+ *   rs_concat(&s, rs_sv_from_cstr("k="), key, rs_sv_from_cstr("\n")); */
+#define rs_concat(s, ...)                                                             \
+    rs_string_append_many((s), (const rs_sv[]){ __VA_ARGS__ },                        \
+                          sizeof((const rs_sv[]){ __VA_ARGS__ }) / sizeof(rs_sv))
+
+// Insert/Erase
+static inline int rs_string_insert(rs_string* s, size_t pos, rs_sv v) {
+    size_t len = rs_string_len(s);
+
+    if (pos > len)
+        pos = len;
+    if (rs_string_reserve(s, len + v.len) != 0) return -1;
+    if (rs__ensure_unique(s)             != 0) return -1;
+
+    char* p = rs__data(s);
+    memmove(p + pos + v.len, p + pos, len - pos);
+    RS__STAT(moved_bytes, len - pos);
+    memcpy(p + pos, v.data, v.len);
+    p[len + v.len] = '\0';
+    rs__set_len(s, len + v.len);
+
+    return 0;
+}
+static inline int rs_string_erase(rs_string* s, size_t pos, size_t n) {
+    size_t len = rs_string_len(s);
+
+    if (pos > len) return 0;
+    if (n > len - pos) n = len - pos;   /* n may be (size_t)-1: "to the end" */
+
+    if (rs__ensure_unique(s) != 0) return -1;
+
+    char* p = rs__data(s);
+    memmove(p + pos, p + pos + n, len - (pos + n));
+    RS__STAT(moved_bytes, len - (pos + n));
+    p[len - n] = '\0';
+    rs__set_len(s, len - n);
+
+    return 0;
+}
+
+/* view over the whole string */
+static inline rs_sv rs_string_sv(const rs_string* s) { return (rs_sv){ rs__cdata(s), rs_string_len(s) }; }
+
+/* `v` (bytes of `src`) copied into `out`, on src's allocator when it needs the heap */
+static inline int rs__copy_of(rs_string* out, const rs_string* src, rs_sv v) {
+    rs_string_init(out);
+    if (rs__reserve(out, v.len, rs__alloc_of(src)) != 0) return -1;
+    return rs_string_assign(out, v);
+}
+
+/* Keep [i, i + n) of the string. A buffer nobody else holds narrows in place: no bytes
+ * move, the new end gets a terminator, and the room past it stays writable (a left trim
+ * is an offset bump, see rs_string_cap). A shared buffer is narrowed without a copy
+ * only when the kept bytes end where its bytes do (its terminator is theirs); otherwise
+ * they are copied out. Inline strings are short and shift in place. */
+static inline int rs__keep(rs_string* s, size_t i, size_t n) {
+    size_t len = rs_string_len(s);
+
+    if (i == 0 && n == len) return 0;
+
+    if (rs_string_is_heap(s)) {
+        char* p = rs__heap_ptr(s);
+
+        if (rs__rc_get(&rs__hdr_of(s)->rc) == 1) {
+            if (i == 0 && !rs__is_slice(s))
+                return rs_string_erase(s, n, len - n);   /* a plain tail cut, stays writable */
+            rs__ensure_unique(s);                      /* sole owner: only drops the memos */
+            p[i + n] = '\0';
+        } else if (i + n != len) {
+            rs_string t;
+            if (rs__copy_of(&t, s, (rs_sv){ p + i, n }) != 0) return -1;
+            rs_string_free(s);
+            *s = t;
+            return 0;
+        }
+        rs__set_slice(s, p + i, rs__off(s) + i, n);
+        return 0;
+    }
+
+    char* p = rs__inline(s);
+    memmove(p, p + i, n);
+    p[n] = '\0';
+    rs__set_len(s, n);
+    return 0;
+}
+
+/* Owning substring [pos, pos + n) of `src`, clamped like rs_sv_substr. Short results
+ * are copied inline. A longer one that runs to the end of src shares its heap buffer
+ * (one refcount bump, no copy) and only gets its own bytes when written to; one that
+ * ends earlier is narrowed in place when `dst` is `src` and nobody else holds the
+ * buffer, and copied otherwise, so every result stays terminated. */
+static inline int rs_string_slice(rs_string* dst, const rs_string* src, size_t pos, size_t n) {
+    rs_sv v = rs_sv_substr(rs_string_sv(src), pos, n);
+    size_t len = rs_string_len(src);
+    rs_string t;
+    rs_string_init(&t);
+
+    if (!rs_string_is_heap(src) || v.len <= RS_SSO_CAP) {
+        if (rs_string_assign(&t, v) != 0) return -1;
+    } else if (v.len == len) {
+        t = *src;
+        rs__retain(&t);
+    } else if (dst == src && rs__rc_get(&rs__hdr_of(src)->rc) == 1) {
+        return rs__keep(dst, (size_t)(v.data - rs__cdata(src)), v.len);
+    } else if (v.data + v.len == rs__cdata(src) + len) {
+        char* p = rs__heap_ptr(src);
+        rs__set_slice(&t, (char*)v.data, rs__off(src) + (size_t)(v.data - p), v.len);
+        rs__retain(&t);
+    } else if (rs__copy_of(&t, src, v) != 0) {
+        rs_string_free(&t);
+        return -1;
+    }
+
+    rs_string_free(dst);
+    *dst = t;
+
+    return 0;
+}
+
+/* Heap strings memoize their hash in the header, so repeated lookups of a shared key
+ * cost one load; inline strings are short and hashed directly, and so are slices,
+ * whose bytes are not what the header describes. */
+static inline uint64_t rs_string_hash(const rs_string* s) {
+    if (!rs_string_is_heap(s) || rs__is_slice(s)) return rs_sv_hash(rs_string_sv(s));
+
+    rs__hdr* h = rs__hdr_of(s);
+    uint64_t v = rs__memo_get(&h->hash);
+
+    if (v == 0) {
+        v = rs_sv_hash(rs_string_sv(s));
+        rs__memo_set(&h->hash, v);
+    }
+
+    return v;
+}
+
+/* Equal bytes. Strings on one buffer compare by length alone, and two heap strings
+ * whose hashes are already memoized and differ are unequal without reading a byte. */
+static inline bool rs_string_eq(const rs_string* a, const rs_string* b) {
+    rs_sv x = rs_string_sv(a), y = rs_string_sv(b);
+
+    if (x.len != y.len) return false;
+    if (x.data == y.data) return true;
+    if (rs_string_is_heap(a) && rs_string_is_heap(b) && !rs__is_slice(a) && !rs__is_slice(b)) {
+        uint64_t ha = rs__memo_get(&rs__hdr_of(a)->hash), hb = rs__memo_get(&rs__hdr_of(b)->hash);
+        if (ha && hb && ha != hb) return false;
+    }
+    return rs__mismatch(x.data, y.data, x.len) == x.len;
+}
+static inline bool rs_string_eq_sv(const rs_string* s, rs_sv v) { return rs_sv_eq(rs_string_sv(s), v); }
+static inline int rs_string_cmp(const rs_string* a, const rs_string* b) { return rs_sv_cmp(rs_string_sv(a), rs_string_sv(b)); }
+
+// Find
+static inline size_t rs_string_find(const rs_string* s, rs_sv what, size_t from) {
+    RS__STAT(finds, 1);
+    return rs_sv_find(rs_string_sv(s), what, from);
+}
+static inline size_t rs_string_rfind(const rs_string* s, rs_sv what, size_t from) {
+    RS__STAT(finds, 1);
+    return rs_sv_rfind(rs_string_sv(s), what, from);
+}
+static inline int rs_string_starts_with(const rs_string* s, rs_sv pfx) {
+    return rs_string_len(s) >= pfx.len && memcmp(rs__cdata(s), pfx.data, pfx.len) == 0;
+}
+static inline int rs_string_ends_with(const rs_string* s, rs_sv sfx) {
+    size_t len = rs_string_len(s);
+    return len >= sfx.len && memcmp(rs__cdata(s) + len - sfx.len, sfx.data, sfx.len) == 0;
+}
+
+// Trim ASCII spaces
+static inline int rs_string_trim_left(rs_string* s) {
+    rs_sv v = rs_string_sv(s);
+    size_t i = rs__ws_lead(v.data, v.len);
+
+    return rs__keep(s, i, v.len - i);
+}
+
+static inline int rs_string_trim_right(rs_string* s) {
+    if (!s) return -1;
+
+    rs_sv v = rs_string_sv(s);
+    return rs__keep(s, 0, rs__ws_trail(v.data, v.len));
+}
+
+static inline int rs_string_trim(rs_string* s) {
+    rs_sv v = rs_string_sv(s), t = rs_sv_trim(v);
+
+    return rs__keep(s, (size_t)(t.data - v.data), t.len);
+}
+
+/* Trim the bytes of `cut` (any order, duplicates allowed) from both ends. */
+static inline int rs_string_trim_cut(rs_string* s, rs_sv cut) {
+    rs_sv v = rs_string_sv(s), t = rs_sv_trim_cut(v, cut);
+
+    return rs__keep(s, (size_t)(t.data - v.data), t.len);
+}
+
+// ASCII case, in place. A string with nothing to change is never written (so a shared
+// buffer is not copied); otherwise the first changed byte detaches it as usual.
+static inline int rs__case_apply(rs_string* s, char lo) {
+    rs_sv v = rs_string_sv(s);
+    size_t i = rs__case_scan(v.data, v.len, lo);
+
+    if (i == v.len) return 0;
+    if (rs__ensure_unique(s) != 0) return -1;
+
+    rs__case_flip(rs__data(s) + i, v.len - i, lo);
+    return 0;
+}
+
+static inline int rs_string_to_lower_ascii(rs_string* s) { return rs__case_apply(s, 'A'); }
+static inline int rs_string_to_upper_ascii(rs_string* s) { return rs__case_apply(s, 'a'); }
+
+// Replace
+static inline int rs_string_replace_first(rs_string* s, rs_sv from, rs_sv to) {
+    RS__STAT(replaces, 1);
+    size_t pos = rs_sv_find(rs_string_sv(s), from, 0);
+    if (pos == (size_t) - 1) return 0;
+    if (to.len > from.len && rs_string_reserve(s, rs_string_len(s) + (to.len-from.len)) != 0) return -1;
+    if (rs__ensure_unique(s) != 0) return -1;
+
+    // unique and big enough: neither step can fail, so the string is never half-edited
+    rs_string_erase(s, pos, from.len);
+    return rs_string_insert(s, pos, to);
+}
+/* replace_all: one counting pass, one exact-size allocation, one forward copy.
+ * Matches are non-overlapping, left to right. Shrinking/equal replacements are
+ * compacted in place; growing ones are built into a fresh buffer of final size.
+ * Returns the number of replacements, or -1 on allocation failure or if the result
+ * would not fit in a size_t. */
+static inline int rs_string_replace_all(rs_string* s, rs_sv from, rs_sv to) {
+    RS__STAT(replaces, 1);
+    if (from.len == 0) return 0;
+
+    const size_t npos = (size_t) - 1;
+    const size_t len = rs_string_len(s);
+    size_t count = 0;
+    rs_finder f;
+    rs_finder_init(&f, from); /* one table for all three passes */
+
+    rs_sv all = rs_string_sv(s);
+    for (size_t pos = rs_finder_find(&f, all, 0); pos != npos; pos = rs_finder_find(&f, all, pos + from.len))
+        ++count;
+
+    if (count == 0) return 0;
+
+    if (to.len <= from.len) {
+        if (rs__ensure_unique(s) != 0) return -1;
+
+        char* p = rs__data(s);
+        rs_sv hay = { p, len };
+        size_t r = 0, w = 0;
+
+        for (size_t pos = rs_finder_find(&f, hay, 0); pos != npos; pos = rs_finder_find(&f, hay, r)) {
+            if (w != r) memmove(p + w, p + r, pos - r);
+            w += pos - r;
+            memcpy(p + w, to.data, to.len);
+            w += to.len;
+            r = pos + from.len;
+        }
+
+        memmove(p + w, p + r, len - r);
+        w += len - r;
+        p[w] = '\0';
+        rs__set_len(s, w);
+    } else {
+        if (count > (SIZE_MAX - len) / (to.len - from.len)) return -1;
+
+        size_t nlen = len + count * (to.len - from.len);
+        rs_string out;
+        rs_string_init(&out);
+
+        if (rs__reserve(&out, nlen, rs__alloc_of(s)) != 0) return -1;
+
+        const char* src = rs__cdata(s);
+        char* dst = rs__data(&out);
+        size_t r = 0, w = 0;
+
+        for (size_t pos = rs_finder_find(&f, all, 0); pos != npos; pos = rs_finder_find(&f, all, r)) {
+            memcpy(dst + w, src + r, pos - r);
+            w += pos - r;
+            memcpy(dst + w, to.data, to.len);
+            w += to.len;
+            r = pos + from.len;
+        }
+
+        memcpy(dst + w, src + r, len - r);
+        w += len - r;
+        dst[w] = '\0';
+        rs__set_len(&out, w);
+
+        rs_string_free(s);
+        *s = out;
+    }
+
+    return (int)count;
+}
+
+// printf helpers
+/* Append formatted text. The first vsnprintf goes straight into the spare capacity
+ * (one byte past the terminator, which stays in place for arguments that point into
+ * `s`); only if it does not fit is the format run a second time, into a fresh buffer
+ * of the final size. */
+static inline int rs_string_vappendf(rs_string* s, const char* fmt, va_list ap) {
+    size_t len = rs_string_len(s);
     va_list ap2;
+
+    if (rs__ensure_unique(s) != 0) return -1;
+
     va_copy(ap2, ap);
-    int need = vsnprintf(NULL, 0, fmt, ap2);
+    size_t room = rs_string_avail(s);
+    int need = vsnprintf(rs__data(s) + len + 1, room, fmt, ap);
+    rs__set_len(s, len); /* a compact inline tag may have been overwritten */
+
+    if (need >= 0 && (size_t)need < room) {
+        char* p = rs__data(s);
+        memmove(p + len, p + len + 1, (size_t)need);
+        p[len + (size_t)need] = '\0'; /* the copied NUL may have been the compact tag */
+    } else if (need >= 0) {
+        const rs_alloc* a = rs__alloc_of(s);
+        rs_string t;
+        rs_string_init(&t);
+
+        if (rs__reserve(&t, rs__grow(a, rs_string_cap(s), len + (size_t)need), a) != 0) {
+            need = -1;
+        } else {
+            char* q = rs__data(&t);
+            memcpy(q, rs__cdata(s), len);
+            vsnprintf(q + len, (size_t)need + 1, fmt, ap2);
+            rs_string_free(s);
+            *s = t;
+        }
+    }
     va_end(ap2);
 
     if (need < 0) return -1;
 
-    rs_alloc a = rs_default_alloc();
+    rs__set_len(s, len + (size_t)need);
+    return need;
+}
+
+static inline int rs_string_appendf(rs_string* s, const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int r = rs_string_vappendf(s, fmt, ap);
+    va_end(ap);
+    return r;
+}
+
+/* Replace the contents with formatted text: formatted behind the old bytes (so they
+ * can still be arguments), then moved down. */
+static inline int rs_string_vprintf(rs_string* s, const char* fmt, va_list ap) {
+    size_t len = rs_string_len(s);
+    int wrote = rs_string_vappendf(s, fmt, ap);
 
-    if (rs_string_reserve_ex(s, (size_t)need, a) != 0) return -1;
-    if (rs__ensure_unique(s, a) != 0) return -1;
+    if (wrote < 0) return -1;
 
-    char* p = rs_string_is_heap(s) ? s->p : s->sso;
+    char* p = rs__data(s);
+    memmove(p, p + len, (size_t)wrote + 1);
+    rs__set_len(s, (size_t)wrote);
 
-    int wrote = vsnprintf(p, (size_t)need + 1, fmt, ap);
-    if (wrote >= 0)
-        s->len = (size_t)wrote;
     return wrote;
 }
 
@@ -493,119 +2127,664 @@ static inline int rs_string_printf(rs_string* s, const char* fmt, ...) {
     return r;
 }
 
-/* UTF helpers (minimal stubs for now, real implementations can be plugged later) */
-/* ASCII <-> UTF-16 helpers */
-static inline int rs_utf16_from_ascii_bytes(rs_sv ascii, int little_endian, int write_bom, rs_alloc a,
-                                            unsigned char** out_bytes, size_t* out_len) {
-    (void)a;
-    size_t bom = write_bom ? 2 : 0;
-    size_t units = ascii.len + 1;
-    size_t total = bom + units * 2;
-    unsigned char* buf = (unsigned char*)malloc(total);
-    size_t i = 0, o = 0;
+/* Empty `s` and make room for n bytes that the caller writes itself (then terminates
+ * and sets the length). A shared buffer is dropped instead of copied; the allocator
+ * is kept. Returns NULL on allocation failure. */
+static inline char* rs__overwrite(rs_string* s, size_t n) {
+    const rs_alloc* a = rs__alloc_of(s);
 
-    if(!buf) return -1;
+    if (rs_string_is_heap(s) && (rs__is_slice(s) || rs__rc_get(&rs__hdr_of(s)->rc) != 1))
+        rs_string_free(s);
 
-    if (write_bom) {
-        if (little_endian) {
-            buf[o++] = 0xFF;
-            buf[o++] = 0xFE;
-        } else {
-            buf[o++] = 0xFE;
-            buf[o++] = 0xFF;
+    rs__set_len(s, 0);
+    if (rs__reserve(s, n, a) != 0) return NULL;
+    if (rs__ensure_unique(s)          != 0) return NULL;
+
+    return rs__data(s);
+}
+
+/* Record a cached fact about a whole heap buffer (slices only see part of it). */
+static inline void rs__hdr_mark(const rs_string* s, uint64_t flag) {
+    if (rs_string_is_heap(s) && !rs__is_slice(s))
+        rs__memo_or(&rs__hdr_of(s)->flags, flag);
+}
+
+/* --- UTF transcoding ---
+ * UTF-16/32 travel as byte buffers in either byte order. Decoders honour a leading BOM
+ * (falling back to default_little_endian), stop at a U+0000 unit and reject unpaired
+ * surrogates / out-of-range code points; encoders reject invalid UTF-8, optionally
+ * write a BOM and always append a U+0000 unit. Every converter measures first and
+ * allocates the exact output once; runs of ASCII move 16 characters per step. */
+
+/* masked bits of an 8*k byte block, mask given in memory byte order */
+static inline bool rs__block_clear(const unsigned char* p, size_t n, const unsigned char m8[8]) {
+    uint64_t m, w, acc = 0;
+    memcpy(&m, m8, 8);
+    for (size_t k = 0; k < n; k += 8) {
+        memcpy(&w, p + k, 8);
+        acc |= w;
+    }
+    return (acc & m) == 0;
+}
+
+static const unsigned char rs__ascii8_mask[8]   = { 0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x80 };
+static const unsigned char rs__ascii16_mask[2][8] = { { 0xFF,0x80,0xFF,0x80,0xFF,0x80,0xFF,0x80 },   /* BE */
+                                                      { 0x80,0xFF,0x80,0xFF,0x80,0xFF,0x80,0xFF } }; /* LE */
+static const unsigned char rs__ascii32_mask[2][8] = { { 0xFF,0xFF,0xFF,0x80,0xFF,0xFF,0xFF,0x80 },
+                                                      { 0x80,0xFF,0xFF,0xFF,0x80,0xFF,0xFF,0xFF } };
+
+static inline uint32_t rs__rd16(const unsigned char* p, int le) { return le ? (uint32_t)(p[0] | (p[1] << 8)) : (uint32_t)((p[0] << 8) | p[1]); }
+static inline uint32_t rs__rd32(const unsigned char* p, int le) {
+    return le ? (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24)
+              : ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+static inline unsigned char* rs__put16(unsigned char* o, uint32_t u, int le) {
+    o[le ? 0 : 1] = (unsigned char)u;
+    o[le ? 1 : 0] = (unsigned char)(u >> 8);
+    return o + 2;
+}
+static inline unsigned char* rs__put32(unsigned char* o, uint32_t u, int le) {
+    for (int k = 0; k < 4; ++k) o[le ? k : 3 - k] = (unsigned char)(u >> (8 * k));
+    return o + 4;
+}
+
+/* 16 ASCII bytes <-> 16 UTF-16 / UTF-32 units */
+static inline void rs__widen16(const unsigned char* p, unsigned char* o, int le) {
+#if defined(RS__SSE2)
+    __m128i v = _mm_loadu_si128((const __m128i*)p), z = _mm_setzero_si128();
+    _mm_storeu_si128((__m128i*)o,        le ? _mm_unpacklo_epi8(v, z) : _mm_unpacklo_epi8(z, v));
+    _mm_storeu_si128((__m128i*)(o + 16), le ? _mm_unpackhi_epi8(v, z) : _mm_unpackhi_epi8(z, v));
+#elif defined(RS__NEON)
+    uint8x16x2_t w;
+    w.val[le ? 0 : 1] = vld1q_u8(p);
+    w.val[le ? 1 : 0] = vdupq_n_u8(0);
+    vst2q_u8(o, w);
+#else
+    for (int k = 0; k < 16; ++k) rs__put16(o + 2 * k, p[k], le);
+#endif
+}
+static inline void rs__widen32(const unsigned char* p, unsigned char* o, int le) {
+#if defined(RS__SSE2)
+    __m128i v = _mm_loadu_si128((const __m128i*)p), z = _mm_setzero_si128();
+    __m128i lo = le ? _mm_unpacklo_epi8(v, z) : _mm_unpacklo_epi8(z, v);
+    __m128i hi = le ? _mm_unpackhi_epi8(v, z) : _mm_unpackhi_epi8(z, v);
+    _mm_storeu_si128((__m128i*)o,        le ? _mm_unpacklo_epi16(lo, z) : _mm_unpacklo_epi16(z, lo));
+    _mm_storeu_si128((__m128i*)(o + 16), le ? _mm_unpackhi_epi16(lo, z) : _mm_unpackhi_epi16(z, lo));
+    _mm_storeu_si128((__m128i*)(o + 32), le ? _mm_unpacklo_epi16(hi, z) : _mm_unpacklo_epi16(z, hi));
+    _mm_storeu_si128((__m128i*)(o + 48), le ? _mm_unpackhi_epi16(hi, z) : _mm_unpackhi_epi16(z, hi));
+#elif defined(RS__NEON)
+    uint8x16x4_t w;
+    w.val[0] = w.val[1] = w.val[2] = w.val[3] = vdupq_n_u8(0);
+    w.val[le ? 0 : 3] = vld1q_u8(p);
+    vst4q_u8(o, w);
+#else
+    for (int k = 0; k < 16; ++k) rs__put32(o + 4 * k, p[k], le);
+#endif
+}
+static inline void rs__narrow16(const unsigned char* p, unsigned char* o, int le) {
+#if defined(RS__SSE2)
+    __m128i a = _mm_loadu_si128((const __m128i*)p), b = _mm_loadu_si128((const __m128i*)(p + 16));
+    if (!le) { a = _mm_srli_epi16(a, 8); b = _mm_srli_epi16(b, 8); }
+    _mm_storeu_si128((__m128i*)o, _mm_packus_epi16(a, b));
+#elif defined(RS__NEON)
+    uint8x16x2_t d = vld2q_u8(p);
+    vst1q_u8(o, d.val[le ? 0 : 1]);
+#else
+    for (int k = 0; k < 16; ++k) o[k] = p[2 * k + (le ? 0 : 1)];
+#endif
+}
+static inline void rs__narrow32(const unsigned char* p, unsigned char* o, int le) {
+#if defined(RS__SSE2)
+    __m128i v[4];
+    for (int k = 0; k < 4; ++k) {
+        v[k] = _mm_loadu_si128((const __m128i*)(p + 16 * k));
+        if (!le) v[k] = _mm_srli_epi32(v[k], 24);
+    }
+    _mm_storeu_si128((__m128i*)o, _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3])));
+#elif defined(RS__NEON)
+    uint8x16x4_t d = vld4q_u8(p);
+    vst1q_u8(o, d.val[le ? 0 : 3]);
+#else
+    for (int k = 0; k < 16; ++k) o[k] = p[4 * k + (le ? 0 : 3)];
+#endif
+}
+
+/* one UTF-8 sequence at p (n bytes available): its length, or 0 if malformed */
+static inline size_t rs__utf8_decode(const unsigned char* p, size_t n, uint32_t* cp) {
+    uint32_t c = p[0];
+
+    if (c < 0x80) { *cp = c; return 1; }
+    if (c < 0xC2) return 0;
+    if (c < 0xE0) {
+        if (n < 2 || (p[1] & 0xC0) != 0x80) return 0;
+        *cp = ((c & 0x1F) << 6) | (p[1] & 0x3F);
+        return 2;
+    }
+    if (c < 0xF0) {
+        unsigned lo = c == 0xE0 ? 0xA0 : 0x80, hi = c == 0xED ? 0x9F : 0xBF;
+        if (n < 3 || p[1] < lo || p[1] > hi || (p[2] & 0xC0) != 0x80) return 0;
+        *cp = ((c & 0x0F) << 12) | ((uint32_t)(p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+        return 3;
+    }
+    if (c < 0xF5) {
+        unsigned lo = c == 0xF0 ? 0x90 : 0x80, hi = c == 0xF4 ? 0x8F : 0xBF;
+        if (n < 4 || p[1] < lo || p[1] > hi || (p[2] & 0xC0) != 0x80 || (p[3] & 0xC0) != 0x80) return 0;
+        *cp = ((c & 0x07) << 18) | ((uint32_t)(p[1] & 0x3F) << 12) | ((uint32_t)(p[2] & 0x3F) << 6) | (p[3] & 0x3F);
+        return 4;
+    }
+    return 0;
+}
+
+static inline char* rs__utf8_encode(char* o, uint32_t cp) {
+    if (cp < 0x80) {
+        *o++ = (char)cp;
+    } else if (cp < 0x800) {
+        *o++ = (char)(0xC0 | (cp >> 6));
+        *o++ = (char)(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        *o++ = (char)(0xE0 | (cp >> 12));
+        *o++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+        *o++ = (char)(0x80 | (cp & 0x3F));
+    } else {
+        *o++ = (char)(0xF0 | (cp >> 18));
+        *o++ = (char)(0x80 | ((cp >> 12) & 0x3F));
+        *o++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+        *o++ = (char)(0x80 | (cp & 0x3F));
+    }
+    return o;
+}
+
+/* validating pass: code points and how many of them need 4 bytes / a surrogate pair */
+static inline int rs__utf8_measure(rs_sv s, size_t* cps, size_t* astral) {
+    const unsigned char* p = (const unsigned char*)s.data;
+    size_t i = 0, n = s.len, c = 0, a4 = 0;
+
+    while (i < n) {
+        if (p[i] < 0x80) {
+            size_t step = n - i >= 16 && rs__block_clear(p + i, 16, rs__ascii8_mask) ? 16 : 1;
+            i += step; c += step;
+            continue;
         }
+
+        uint32_t cp = 0;
+        size_t k = rs__utf8_decode(p + i, n - i, &cp);
+        if (!k) return -1;
+        i += k; ++c; a4 += k == 4;
     }
 
-    for (i = 0; i < ascii.len; ++i) {
-        unsigned char ch = (unsigned char)ascii.data[i];
-        if (little_endian) {
-            buf[o++] = ch;
-            buf[o++] = 0x00;
-        } else {
-            buf[o++] = 0x00;
-            buf[o++] = ch;
+    *cps = c;
+    if (astral) *astral = a4;
+    return 0;
+}
+
+/* BOM sniffing: strips it from *in and returns the byte order to use */
+static inline int rs__utf16_order(rs_sv* in, int default_le) {
+    if (in->len >= 2) {
+        unsigned char b0 = (unsigned char)in->data[0], b1 = (unsigned char)in->data[1];
+        if ((b0 == 0xFF && b1 == 0xFE) || (b0 == 0xFE && b1 == 0xFF)) {
+            in->data += 2; in->len -= 2;
+            return b0 == 0xFF;
+        }
+    }
+    return default_le != 0;
+}
+static inline int rs__utf32_order(rs_sv* in, int default_le) {
+    if (in->len >= 4) {
+        uint32_t le = rs__rd32((const unsigned char*)in->data, 1);
+        if (le == 0xFEFFu || le == 0xFFFE0000u) {
+            in->data += 4; in->len -= 4;
+            return le == 0xFEFFu;
         }
     }
-    buf[o++] = 0x00;
-    buf[o++] = 0x00;
+    return default_le != 0;
+}
+
+static inline unsigned char* rs__put_bom(unsigned char* o, size_t unit, int le, int write_bom) {
+    if (!write_bom) return o;
+    return unit == 2 ? rs__put16(o, 0xFEFF, le) : rs__put32(o, 0xFEFF, le);
+}
+
+/* ASCII <-> UTF-16 helpers (bytes above 0x7F are widened as Latin-1) */
+static inline int rs_utf16_from_ascii_bytes(rs_sv ascii, int little_endian, int write_bom, rs_alloc a,
+                                            unsigned char** out_bytes, size_t* out_len) {
+    a = rs__alloc_or_default(a);
+    size_t total = (write_bom ? 2 : 0) + (ascii.len + 1) * 2;
+    unsigned char* buf = (unsigned char*)a.m(total, a.ctx);
+    const unsigned char* p = (const unsigned char*)ascii.data;
+    size_t i = 0;
+
+    if(!buf) return -1;
+
+    unsigned char* o = rs__put_bom(buf, 2, little_endian, write_bom);
+
+    for (; i + 16 <= ascii.len; i += 16, o += 32) rs__widen16(p + i, o, little_endian);
+    for (; i < ascii.len; ++i) o = rs__put16(o, p[i], little_endian);
+    rs__put16(o, 0, little_endian);
+
     *out_bytes = buf;
     if (out_len)
         *out_len = total;
     return 0;
 }
-static inline int rs_ascii_from_utf16_bytes(rs_string* out, rs_sv u16, int default_little_endian, char replace) {
-    int little = default_little_endian;
-    size_t i = 0;
-    if (u16.len >= 2) {
-        unsigned char b0 = (unsigned char)u16.data[0];
-        unsigned char b1 = (unsigned char)u16.data[1];
-        if (b0 == 0xFF && b1 == 0xFE) {
-            little = 1;
-            i = 2;
-        } else if (b0 == 0xFE && b1 == 0xFF) {
-            little = 0;
-            i = 2;
-        }
-    }
 
-    rs_string_clear(out);
+/* non-ASCII units become `replace` (one per unit, so a surrogate pair gives two) */
+static inline int rs_ascii_from_utf16_bytes(rs_string* out, rs_sv u16, int default_little_endian, char replace) {
+    int le = rs__utf16_order(&u16, default_little_endian);
+    const unsigned char* p = (const unsigned char*)u16.data;
+    size_t units = u16.len / 2, end = 0;
 
-    for (; i + 1 < u16.len; i += 2) {
-        unsigned char b0 = (unsigned char)u16.data[i + 0];
-        unsigned char b1 = (unsigned char)u16.data[i + 1];
-        unsigned int code = little ? (unsigned int)(b0 | (b1 << 8)) : (unsigned int)((b0 << 8) | b1);
+    while (end < units && rs__rd16(p + 2 * end, le) != 0) ++end;
 
-        if (code == 0x0000) break;
+    char* o = rs__overwrite(out, end);
+    if (!o) return -1;
 
-        uint8_t out_u8 = (code <= 0x7F) ? (uint8_t)code : (uint8_t)replace;
-        rs_string_push_char(out, (char)out_u8);
+    for (size_t i = 0; i < end; ) {
+        if (end - i >= 16 && rs__block_clear(p + 2 * i, 32, rs__ascii16_mask[le])) {
+            rs__narrow16(p + 2 * i, (unsigned char*)o + i, le);
+            i += 16;
+            continue;
+        }
+        uint32_t u = rs__rd16(p + 2 * i, le);
+        o[i++] = u <= 0x7F ? (char)u : replace;
     }
 
+    o[end] = '\0';
+    rs__set_len(out, end);
     return 0;
 }
 
 static inline int rs_utf8_from_utf16_bytes(rs_string* out, rs_sv utf16_bytes, int default_little_endian) {
-    (void)default_little_endian; // Stub: just clear and copy raw as bytes (NOT real convert). Replace with real logic if needed.
-    return rs_string_assign(out, utf16_bytes);
+    int le = rs__utf16_order(&utf16_bytes, default_little_endian);
+    const unsigned char* p = (const unsigned char*)utf16_bytes.data;
+    size_t units = utf16_bytes.len / 2, end = 0, bytes = 0;
+
+    for (; end < units; ++end) {
+        uint32_t u = rs__rd16(p + 2 * end, le);
+
+        if (u == 0) break;
+        if (u < 0x80)       bytes += 1;
+        else if (u < 0x800) bytes += 2;
+        else if (u - 0xD800 >= 0x800) bytes += 3;
+        else if (u < 0xDC00 && end + 1 < units && rs__rd16(p + 2 * end + 2, le) - 0xDC00 < 0x400) { bytes += 4; ++end; }
+        else return -1; /* unpaired surrogate */
+    }
+
+    char* base = rs__overwrite(out, bytes);
+    if (!base) return -1;
+    char* o = base;
+
+    for (size_t i = 0; i < end; ) {
+        if (end - i >= 16 && rs__block_clear(p + 2 * i, 32, rs__ascii16_mask[le])) {
+            rs__narrow16(p + 2 * i, (unsigned char*)o, le);
+            i += 16; o += 16;
+            continue;
+        }
+        uint32_t u = rs__rd16(p + 2 * i++, le);
+        if (u - 0xD800 < 0x400)
+            u = 0x10000 + ((u - 0xD800) << 10) + (rs__rd16(p + 2 * i++, le) - 0xDC00);
+        o = rs__utf8_encode(o, u);
+    }
+
+    *o = '\0';
+    rs__set_len(out, bytes);
+    rs__hdr_mark(out, RS__HDR_UTF8_VALID);
+    return 0;
 }
 
 static inline int rs_utf16_from_utf8_bytes(rs_sv utf8, int little_endian, int write_bom, rs_alloc a,
                                            unsigned char** out_bytes, size_t* out_len) {
-    (void)little_endian;
-    (void)write_bom;
-    (void)a;
-    *out_bytes = (unsigned char*)malloc(utf8.len + 2);
+    size_t cps, astral;
+
+    if (rs__utf8_measure(utf8, &cps, &astral) != 0) return -1;
+
+    a = rs__alloc_or_default(a);
+    size_t total = (write_bom ? 2 : 0) + (cps + astral + 1) * 2;
+    unsigned char* buf = (unsigned char*)a.m(total, a.ctx);
+
+    if (!buf) return -1;
 
-    if (!*out_bytes) return -1;
+    const unsigned char* p = (const unsigned char*)utf8.data;
+    unsigned char* o = rs__put_bom(buf, 2, little_endian, write_bom);
 
-    memcpy(*out_bytes, utf8.data, utf8.len);
-    (*out_bytes)[utf8.len] = 0;
-    (*out_bytes)[utf8.len + 1] = 0;
-    *out_len = utf8.len + 2;
+    for (size_t i = 0, n = utf8.len; i < n; ) {
+        if (p[i] < 0x80) {
+            if (n - i >= 16 && rs__block_clear(p + i, 16, rs__ascii8_mask)) {
+                rs__widen16(p + i, o, little_endian);
+                i += 16; o += 32;
+            } else {
+                o = rs__put16(o, p[i++], little_endian);
+            }
+            continue;
+        }
+
+        uint32_t cp = 0;
+        i += rs__utf8_decode(p + i, n - i, &cp);
+        if (cp >= 0x10000) {
+            cp -= 0x10000;
+            o = rs__put16(o, 0xD800 + (cp >> 10), little_endian);
+            cp = 0xDC00 + (cp & 0x3FF);
+        }
+        o = rs__put16(o, cp, little_endian);
+    }
+    rs__put16(o, 0, little_endian);
+
+    *out_bytes = buf;
+    *out_len = total;
 
     return 0;
 }
+
 static inline int rs_utf8_from_utf32_bytes(rs_string* out, rs_sv utf32_bytes, int default_little_endian) {
-    (void)default_little_endian;
-    return rs_string_assign(out, utf32_bytes);
+    int le = rs__utf32_order(&utf32_bytes, default_little_endian);
+    const unsigned char* p = (const unsigned char*)utf32_bytes.data;
+    size_t units = utf32_bytes.len / 4, end = 0, bytes = 0;
+
+    for (; end < units; ++end) {
+        uint32_t u = rs__rd32(p + 4 * end, le);
+
+        if (u == 0) break;
+        if (u > 0x10FFFF || u - 0xD800 < 0x800) return -1;
+        bytes += 1 + (u >= 0x80) + (u >= 0x800) + (u >= 0x10000);
+    }
+
+    char* base = rs__overwrite(out, bytes);
+    if (!base) return -1;
+    char* o = base;
+
+    for (size_t i = 0; i < end; ) {
+        if (end - i >= 16 && rs__block_clear(p + 4 * i, 64, rs__ascii32_mask[le])) {
+            rs__narrow32(p + 4 * i, (unsigned char*)o, le);
+            i += 16; o += 16;
+            continue;
+        }
+        o = rs__utf8_encode(o, rs__rd32(p + 4 * i++, le));
+    }
+
+    *o = '\0';
+    rs__set_len(out, bytes);
+    rs__hdr_mark(out, RS__HDR_UTF8_VALID);
+    return 0;
 }
 
 static inline int rs_utf32_from_utf8_bytes(rs_sv utf8, int little_endian, int write_bom, rs_alloc a,
                                            unsigned char** out_bytes, size_t* out_len) {
-    (void)little_endian;
-    (void)write_bom;
-    (void)a;
-    *out_bytes = (unsigned char*)malloc(utf8.len + 4);
+    size_t cps;
+
+    if (rs__utf8_measure(utf8, &cps, NULL) != 0) return -1;
+
+    a = rs__alloc_or_default(a);
+    size_t total = (write_bom ? 4 : 0) + (cps + 1) * 4;
+    unsigned char* buf = (unsigned char*)a.m(total, a.ctx);
+
+    if (!buf) return -1;
+
+    const unsigned char* p = (const unsigned char*)utf8.data;
+    unsigned char* o = rs__put_bom(buf, 4, little_endian, write_bom);
+
+    for (size_t i = 0, n = utf8.len; i < n; ) {
+        if (p[i] < 0x80) {
+            if (n - i >= 16 && rs__block_clear(p + i, 16, rs__ascii8_mask)) {
+                rs__widen32(p + i, o, little_endian);
+                i += 16; o += 64;
+            } else {
+                o = rs__put32(o, p[i++], little_endian);
+            }
+            continue;
+        }
 
-    if (!*out_bytes) return -1;
+        uint32_t cp = 0;
+        i += rs__utf8_decode(p + i, n - i, &cp);
+        o = rs__put32(o, cp, little_endian);
+    }
+    rs__put32(o, 0, little_endian);
 
-    memcpy(*out_bytes, utf8.data, utf8.len);
-    (*out_bytes)[utf8.len] = 0;
-    (*out_bytes)[utf8.len + 1] = 0;
-    (*out_bytes)[utf8.len + 2] = 0;
-    (*out_bytes)[utf8.len + 3] = 0;
-    *out_len = utf8.len + 4;
+    *out_bytes = buf;
+    *out_len = total;
 
     return 0;
 }
 
+/* --- UTF-8 validation / counting ---
+ * The vector validator is the lookup-table algorithm of Keiser & Lemire ("Validating
+ * UTF-8 in less than one instruction per byte"): three 16-entry nibble tables classify
+ * every (previous byte, byte) pair, a saturating-subtract test catches missing 3rd/4th
+ * continuation bytes, and all-ASCII blocks are skipped with one movemask. AVX2 is
+ * picked at runtime, SSSE3 / AArch64 NEON at compile time, scalar otherwise. */
+static const uint8_t rs__utf8_t1h[16] = { /* prev byte, high nibble */
+      2,   2,   2,   2,   2,   2,   2,   2, 128, 128, 128, 128,  33,   1,  21,  73 };
+static const uint8_t rs__utf8_t1l[16] = { /* prev byte, low nibble */
+    231, 163, 131, 131, 139, 203, 203, 203, 203, 203, 203, 203, 203, 219, 203, 203 };
+static const uint8_t rs__utf8_t2h[16] = { /* this byte, high nibble */
+      1,   1,   1,   1,   1,   1,   1,   1, 230, 174, 186, 186,   1,   1,   1,   1 };
+
+#ifdef RS__AVX2_DISPATCH
+__attribute__((target("avx2")))
+static inline __m256i rs__utf8_check_avx2(__m256i in, __m256i prev, __m256i t1h, __m256i t1l, __m256i t2h) {
+    const __m256i lo4 = _mm256_set1_epi8(0x0F);
+    __m256i cross = _mm256_permute2x128_si256(prev, in, 0x21);
+    __m256i p1 = _mm256_alignr_epi8(in, cross, 15);
+    __m256i p2 = _mm256_alignr_epi8(in, cross, 14);
+    __m256i p3 = _mm256_alignr_epi8(in, cross, 13);
+    __m256i sc = _mm256_and_si256(_mm256_and_si256(
+                     _mm256_shuffle_epi8(t1h, _mm256_and_si256(_mm256_srli_epi16(p1, 4), lo4)),
+                     _mm256_shuffle_epi8(t1l, _mm256_and_si256(p1, lo4))),
+                     _mm256_shuffle_epi8(t2h, _mm256_and_si256(_mm256_srli_epi16(in, 4), lo4)));
+    __m256i must23 = _mm256_or_si256(_mm256_subs_epu8(p2, _mm256_set1_epi8((char)(0xE0 - 0x80))),
+                                     _mm256_subs_epu8(p3, _mm256_set1_epi8((char)(0xF0 - 0x80))));
+    return _mm256_xor_si256(_mm256_and_si256(must23, _mm256_set1_epi8((char)0x80)), sc);
+}
+
+__attribute__((target("avx2")))
+static inline bool rs__utf8_valid_avx2(const unsigned char* p, size_t n) {
+    const __m256i t1h = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)rs__utf8_t1h));
+    const __m256i t1l = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)rs__utf8_t1l));
+    const __m256i t2h = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)rs__utf8_t2h));
+    const __m256i max = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                         -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                         (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+    __m256i err = _mm256_setzero_si256(), prev = err, pending = err;
+    unsigned char tail[32];
+    size_t i = 0;
+
+    for (;; i += 32) {
+        __m256i in;
+        if (i + 32 <= n) {
+            in = _mm256_loadu_si256((const __m256i*)(p + i));
+        } else if (i < n) { /* zero padding: a cut sequence shows up as too short */
+            memset(tail, 0, sizeof tail);
+            memcpy(tail, p + i, n - i);
+            in = _mm256_loadu_si256((const __m256i*)tail);
+        } else {
+            break;
+        }
+
+        if (_mm256_movemask_epi8(in) == 0) {
+            err = _mm256_or_si256(err, pending);
+            pending = _mm256_setzero_si256();
+        } else {
+            err = _mm256_or_si256(err, rs__utf8_check_avx2(in, prev, t1h, t1l, t2h));
+            pending = _mm256_subs_epu8(in, max);
+        }
+        prev = in;
+    }
+
+    err = _mm256_or_si256(err, pending);
+    return _mm256_testz_si256(err, err) != 0;
+}
+#endif
+
+#ifdef RS__SSSE3
+static inline __m128i rs__utf8_check_ssse3(__m128i in, __m128i prev, __m128i t1h, __m128i t1l, __m128i t2h) {
+    const __m128i lo4 = _mm_set1_epi8(0x0F);
+    __m128i p1 = _mm_alignr_epi8(in, prev, 15);
+    __m128i p2 = _mm_alignr_epi8(in, prev, 14);
+    __m128i p3 = _mm_alignr_epi8(in, prev, 13);
+    __m128i sc = _mm_and_si128(_mm_and_si128(
+                     _mm_shuffle_epi8(t1h, _mm_and_si128(_mm_srli_epi16(p1, 4), lo4)),
+                     _mm_shuffle_epi8(t1l, _mm_and_si128(p1, lo4))),
+                     _mm_shuffle_epi8(t2h, _mm_and_si128(_mm_srli_epi16(in, 4), lo4)));
+    __m128i must23 = _mm_or_si128(_mm_subs_epu8(p2, _mm_set1_epi8((char)(0xE0 - 0x80))),
+                                  _mm_subs_epu8(p3, _mm_set1_epi8((char)(0xF0 - 0x80))));
+    return _mm_xor_si128(_mm_and_si128(must23, _mm_set1_epi8((char)0x80)), sc);
+}
+
+static inline bool rs__utf8_valid_ssse3(const unsigned char* p, size_t n) {
+    const __m128i t1h = _mm_loadu_si128((const __m128i*)rs__utf8_t1h);
+    const __m128i t1l = _mm_loadu_si128((const __m128i*)rs__utf8_t1l);
+    const __m128i t2h = _mm_loadu_si128((const __m128i*)rs__utf8_t2h);
+    const __m128i max = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                      (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+    __m128i err = _mm_setzero_si128(), prev = err, pending = err;
+    unsigned char tail[16];
+    size_t i = 0;
+
+    for (;; i += 16) {
+        __m128i in;
+        if (i + 16 <= n) {
+            in = _mm_loadu_si128((const __m128i*)(p + i));
+        } else if (i < n) {
+            memset(tail, 0, sizeof tail);
+            memcpy(tail, p + i, n - i);
+            in = _mm_loadu_si128((const __m128i*)tail);
+        } else {
+            break;
+        }
+
+        if (_mm_movemask_epi8(in) == 0) {
+            err = _mm_or_si128(err, pending);
+            pending = _mm_setzero_si128();
+        } else {
+            err = _mm_or_si128(err, rs__utf8_check_ssse3(in, prev, t1h, t1l, t2h));
+            pending = _mm_subs_epu8(in, max);
+        }
+        prev = in;
+    }
+
+    err = _mm_or_si128(err, pending);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(err, _mm_setzero_si128())) == 0xFFFF;
+}
+#endif
+
+#ifdef RS__NEON64
+static inline bool rs__utf8_valid_neon(const unsigned char* p, size_t n) {
+    const uint8x16_t t1h = vld1q_u8(rs__utf8_t1h), t1l = vld1q_u8(rs__utf8_t1l), t2h = vld1q_u8(rs__utf8_t2h);
+    static const uint8_t maxb[16] = { 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+                                      0xF0 - 1, 0xE0 - 1, 0xC0 - 1 };
+    const uint8x16_t max = vld1q_u8(maxb), lo4 = vdupq_n_u8(0x0F);
+    uint8x16_t err = vdupq_n_u8(0), prev = err, pending = err;
+    unsigned char tail[16];
+    size_t i = 0;
+
+    for (;; i += 16) {
+        uint8x16_t in;
+        if (i + 16 <= n) {
+            in = vld1q_u8(p + i);
+        } else if (i < n) {
+            memset(tail, 0, sizeof tail);
+            memcpy(tail, p + i, n - i);
+            in = vld1q_u8(tail);
+        } else {
+            break;
+        }
+
+        if (vmaxvq_u8(in) < 0x80) {
+            err = vorrq_u8(err, pending);
+            pending = vdupq_n_u8(0);
+        } else {
+            uint8x16_t p1 = vextq_u8(prev, in, 15), p2 = vextq_u8(prev, in, 14), p3 = vextq_u8(prev, in, 13);
+            uint8x16_t sc = vandq_u8(vandq_u8(vqtbl1q_u8(t1h, vshrq_n_u8(p1, 4)), vqtbl1q_u8(t1l, vandq_u8(p1, lo4))),
+                                     vqtbl1q_u8(t2h, vshrq_n_u8(in, 4)));
+            uint8x16_t must23 = vorrq_u8(vqsubq_u8(p2, vdupq_n_u8(0xE0 - 0x80)), vqsubq_u8(p3, vdupq_n_u8(0xF0 - 0x80)));
+            err = vorrq_u8(err, veorq_u8(vandq_u8(must23, vdupq_n_u8(0x80)), sc));
+            pending = vqsubq_u8(in, max);
+        }
+        prev = in;
+    }
+
+    return vmaxvq_u8(vorrq_u8(err, pending)) == 0;
+}
+#endif
+
+static inline bool rs_utf8_validate(rs_sv s) {
+    const unsigned char* p = (const unsigned char*)s.data;
+#ifdef RS__AVX2_DISPATCH
+    if (rs__cpu_has_avx2()) return rs__utf8_valid_avx2(p, s.len);
+#endif
+#if defined(RS__SSSE3)
+    return rs__utf8_valid_ssse3(p, s.len);
+#elif defined(RS__NEON64)
+    return rs__utf8_valid_neon(p, s.len);
+#else
+    size_t cps;
+    (void)p;
+    return rs__utf8_measure(s, &cps, NULL) == 0;
+#endif
+}
+
+/* code points in p[0..16): bytes that are not continuation bytes (signed > -65) */
+static inline size_t rs__utf8_count16(const unsigned char* p) {
+#if defined(RS__SSE2)
+    __m128i lead = _mm_cmpgt_epi8(_mm_loadu_si128((const __m128i*)p), _mm_set1_epi8(-65));
+    return rs__popcnt32((uint32_t)_mm_movemask_epi8(lead));
+#elif defined(RS__NEON64)
+    uint8x16_t lead = vcgtq_s8(vreinterpretq_s8_u8(vld1q_u8(p)), vdupq_n_s8(-65));
+    return vaddvq_u8(vshrq_n_u8(lead, 7));
+#else
+    size_t c = 0;
+    for (int k = 0; k < 16; ++k) c += (signed char)p[k] > -65;
+    return c;
+#endif
+}
+
+/* Number of code points; for valid UTF-8 only (counts lead bytes, no checking). */
+static inline size_t rs_utf8_count(rs_sv s) {
+    const unsigned char* p = (const unsigned char*)s.data;
+    size_t i = 0, c = 0;
+
+    for (; i + 16 <= s.len; i += 16) c += rs__utf8_count16(p + i);
+    for (; i < s.len; ++i) c += (signed char)p[i] > -65;
+
+    return c;
+}
+
+/* byte offset where code point `n` starts (s.len if there are not that many) */
+static inline size_t rs__utf8_skip(rs_sv s, size_t n) {
+    const unsigned char* p = (const unsigned char*)s.data;
+    size_t i = 0;
+
+    for (size_t c; i + 16 <= s.len && (c = rs__utf8_count16(p + i)) <= n; i += 16) n -= c;
+
+    for (; i < s.len; ++i) {
+        if ((signed char)p[i] > -65) {
+            if (n == 0) return i;
+            --n;
+        }
+    }
+
+    return s.len;
+}
+
+/* Whole-string validation; a heap string remembers a positive answer in its header,
+ * so checking a shared buffer again is one load (any write forgets it). */
+static inline bool rs_string_utf8_valid(const rs_string* s) {
+    if (rs_string_is_heap(s) && !rs__is_slice(s) && (rs__memo_get(&rs__hdr_of(s)->flags) & RS__HDR_UTF8_VALID))
+        return true;
+    if (!rs_utf8_validate(rs_string_sv(s)))
+        return false;
+
+    rs__hdr_mark(s, RS__HDR_UTF8_VALID);
+    return true;
+}
+
+/* Keep at most `max_cps` code points (the string should be valid UTF-8). A shared buffer
+ * is left to the other holders: the kept bytes are copied out (see rs_string_slice). */
+static inline int rs_utf8_truncate(rs_string* s, size_t max_cps) {
+    size_t len = rs_string_len(s);
+    size_t cut = rs__utf8_skip(rs_string_sv(s), max_cps);
+
+    if (cut == len) return 0;
+    if (rs_string_is_heap(s) && (rs__is_slice(s) || rs__rc_get(&rs__hdr_of(s)->rc) != 1))
+        return rs_string_slice(s, s, 0, cut);
+
+    return rs_string_erase(s, cut, len - cut);
+}
@@ -30,7 +30,8 @@
 
 
 // rs_string_api.h — interface-style API for rs_string (header-only)
-// Usage: rs()->append(&s, ...); rs()->trim(&s);
+// Usage: rs(append)(&s, ...); rs(trim)(&s);   (direct calls, resolved by the preprocessor)
+//        const rs_api* api = rs();             (the table, for passing the interface around)
 #pragma once
 #include "rs_string.h"
 
@@ -53,18 +54,28 @@ typedef struct rs_api {
     int (*assign)(rs_string*, rs_sv);
     int (*from_cstr)(rs_string*, const char*);
     int (*append)(rs_string*, rs_sv);
+    int (*append_many)(rs_string*, const rs_sv* parts, size_t n);
     int (*push_cstr)(rs_string*, const char*);
     int (*push_char)(rs_string*, char);
     int (*insert)(rs_string*, size_t pos, rs_sv);
     int (*erase)(rs_string*, size_t pos, size_t n);
+    char* (*prepare)(rs_string*, size_t n);
+    int   (*commit)(rs_string*, size_t written);
+    char* (*resize_uninit)(rs_string*, size_t n);
+    int   (*shrink_to_fit)(rs_string*);
 
     /* find */
     size_t (*find)(const rs_string*, rs_sv what, size_t from);
+    size_t (*rfind)(const rs_string*, rs_sv what, size_t from);
     int    (*starts_with)(const rs_string*, rs_sv);
     int    (*ends_with)(const rs_string*, rs_sv);
+    uint64_t (*hash)(const rs_string*);
+    bool   (*eq)(const rs_string*, const rs_string*);
+    int    (*cmp)(const rs_string*, const rs_string*);
 
     /* printf */
     int (*printf_)(rs_string*, const char* fmt, ...);
+    int (*appendf)(rs_string*, const char* fmt, ...);
 
     /* replace */
     int (*replace_first)(rs_string*, rs_sv from, rs_sv to);
@@ -76,8 +87,13 @@ typedef struct rs_api {
     int (*trim_right)(rs_string*);
     int (*trim_cut)(rs_string*, rs_sv cut);
 
+    /* ascii case */
+    int (*to_lower_ascii)(rs_string*);
+    int (*to_upper_ascii)(rs_string*);
+
     /* share/cow */
     void (*share)(rs_string* dst, const rs_string* src);
+    int  (*slice)(rs_string* dst, const rs_string* src, size_t pos, size_t n);
     int  (*retain)(rs_string*);
     void (*release)(rs_string*);
 
@@ -88,10 +104,13 @@ typedef struct rs_api {
     int  (*utf32_from_utf8_bytes)(rs_sv utf8, int little_endian, int write_bom, rs_alloc a, unsigned char** out_bytes, size_t* out_len_bytes);
 } rs_api;
 
-/* singleton accessor */
-static inline const rs_api* rs(void){
+/* The interface as a value: a constant table for code that wants to pass it
+ * around. Calls through it are indirect unless the optimizer folds the table,
+ * so spell plain calls rs(f)(...) instead. */
+static inline const rs_api* rs_api_table(void){
     /* forward variadic */
     int rs_string_printf(rs_string*, const char*, ...);
+    int rs_string_appendf(rs_string*, const char*, ...);
 
     static const rs_api api = {
             /* lifecycle/info */
@@ -101,25 +120,35 @@ static inline const rs_api* rs(void){
             .cap         = rs_string_cap,
             .avail       = rs_string_avail,
             .is_heap     = rs_string_is_heap,
-//            .is_shared   = rs_string_is_shared,
+            .is_shared   = rs_string_is_shared,
 
             /* edit */
             .clear       = rs_string_clear,
             .assign      = rs_string_assign,
             .from_cstr   = rs_string_from_cstr,
             .append      = rs_string_append,
+            .append_many = rs_string_append_many,
             .push_cstr   = rs_string_push_cstr,
             .push_char   = rs_string_push_char,
             .insert      = rs_string_insert,
             .erase       = rs_string_erase,
+            .prepare     = rs_string_prepare,
+            .commit      = rs_string_commit,
+            .resize_uninit = rs_string_resize_uninit,
+            .shrink_to_fit = rs_string_shrink_to_fit,
 
             /* find */
             .find        = rs_string_find,
+            .rfind       = rs_string_rfind,
             .starts_with = rs_string_starts_with,
             .ends_with   = rs_string_ends_with,
+            .hash        = rs_string_hash,
+            .eq          = rs_string_eq,
+            .cmp         = rs_string_cmp,
 
             /* printf */
             .printf_     = rs_string_printf,
+            .appendf     = rs_string_appendf,
 
             /* replace */
             .replace_first = rs_string_replace_first,
@@ -129,12 +158,17 @@ static inline const rs_api* rs(void){
             .trim       = rs_string_trim,
             .trim_left  = rs_string_trim_left,
             .trim_right = rs_string_trim_right,
-//            .trim_cut   = rs_string_trim_cut,
+            .trim_cut   = rs_string_trim_cut,
+
+            /* ascii case */
+            .to_lower_ascii = rs_string_to_lower_ascii,
+            .to_upper_ascii = rs_string_to_upper_ascii,
 
             /* share/cow */
             .share      = rs_string_share,
-//            .retain     = rs_string_retain,
-//            .release    = rs_string_release,
+            .slice      = rs_string_slice,
+            .retain     = rs_string_retain,
+            .release    = rs_string_release,
 
             /* unicode helpers */
             .utf8_from_utf16_bytes = rs_utf8_from_utf16_bytes,
@@ -145,6 +179,57 @@ static inline const rs_api* rs(void){
     return &api;
 }
 
+/* rs(f) names the function behind slot f at preprocessing time, so
+ * rs(append)(&s, v) is exactly rs_string_append(&s, v) at every -O level and on
+ * every compiler; rs() (no slot) is the table. An unknown slot fails to compile. */
+#define rs(...) RS__API_ ## __VA_ARGS__
+#define RS__API_ rs_api_table()
+#define RS__API_free_                 rs_string_free
+#define RS__API_cstr                  rs_string_cstr
+#define RS__API_len                   rs_string_len
+#define RS__API_cap                   rs_string_cap
+#define RS__API_avail                 rs_string_avail
+#define RS__API_is_heap               rs_string_is_heap
+#define RS__API_is_shared             rs_string_is_shared
+#define RS__API_clear                 rs_string_clear
+#define RS__API_assign                rs_string_assign
+#define RS__API_from_cstr             rs_string_from_cstr
+#define RS__API_append                rs_string_append
+#define RS__API_append_many           rs_string_append_many
+#define RS__API_push_cstr             rs_string_push_cstr
+#define RS__API_push_char             rs_string_push_char
+#define RS__API_insert                rs_string_insert
+#define RS__API_erase                 rs_string_erase
+#define RS__API_prepare               rs_string_prepare
+#define RS__API_commit                rs_string_commit
+#define RS__API_resize_uninit         rs_string_resize_uninit
+#define RS__API_shrink_to_fit         rs_string_shrink_to_fit
+#define RS__API_find                  rs_string_find
+#define RS__API_rfind                 rs_string_rfind
+#define RS__API_starts_with           rs_string_starts_with
+#define RS__API_ends_with             rs_string_ends_with
+#define RS__API_hash                  rs_string_hash
+#define RS__API_eq                    rs_string_eq
+#define RS__API_cmp                   rs_string_cmp
+#define RS__API_printf_               rs_string_printf
+#define RS__API_appendf               rs_string_appendf
+#define RS__API_replace_first         rs_string_replace_first
+#define RS__API_replace_all           rs_string_replace_all
+#define RS__API_trim                  rs_string_trim
+#define RS__API_trim_left             rs_string_trim_left
+#define RS__API_trim_right            rs_string_trim_right
+#define RS__API_trim_cut              rs_string_trim_cut
+#define RS__API_to_lower_ascii        rs_string_to_lower_ascii
+#define RS__API_to_upper_ascii        rs_string_to_upper_ascii
+#define RS__API_share                 rs_string_share
+#define RS__API_slice                 rs_string_slice
+#define RS__API_retain                rs_string_retain
+#define RS__API_release               rs_string_release
+#define RS__API_utf8_from_utf16_bytes rs_utf8_from_utf16_bytes
+#define RS__API_utf16_from_utf8_bytes rs_utf16_from_utf8_bytes
+#define RS__API_utf8_from_utf32_bytes rs_utf8_from_utf32_bytes
+#define RS__API_utf32_from_utf8_bytes rs_utf32_from_utf8_bytes
+
 #ifdef __cplusplus
 }
 #endif
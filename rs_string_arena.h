@@ -0,0 +1,151 @@
+// MIT License
+//
+// Copyright (c) 2025 Raman Sharkovich
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// rs_string_arena.h — bump allocator for rs_string (header-only)
+// Usage: rs_arena ar; rs_arena_init(&ar, 64 * 1024);
+//        rs_string s = rs_string_from_val_ex("...", rs_arena_alloc(&ar));
+//        ... rs_arena_reset(&ar);   /* drops every string at once, O(1) */
+// Strings that live in an arena must not be used (or freed) after a reset.
+#pragma once
+#include "rs_string.h"
+
+#ifndef RS_ARENA_DEFAULT_BLOCK
+#define RS_ARENA_DEFAULT_BLOCK (64 * 1024)
+#endif
+
+#define RS__ARENA_ALIGN 16
+#define RS__ARENA_ROUND(n) (((n) + (RS__ARENA_ALIGN - 1)) & ~(size_t)(RS__ARENA_ALIGN - 1))
+
+typedef struct rs_arena_block {
+    struct rs_arena_block* next;
+    size_t cap;
+    size_t used;
+} rs_arena_block;
+
+typedef struct {
+    rs_arena_block* head;  /* every block ever allocated, reused after reset */
+    rs_arena_block* cur;   /* block currently bumped */
+    size_t block_size;
+} rs_arena;
+
+/* block payload starts aligned; every allocation carries its rounded size in a prefix */
+#define RS__ARENA_BLOCK_HDR RS__ARENA_ROUND(sizeof(rs_arena_block))
+#define RS__ARENA_PREFIX    RS__ARENA_ALIGN
+
+static inline char*   rs__arena_base(rs_arena_block* b) { return (char*)b + RS__ARENA_BLOCK_HDR; }
+static inline size_t* rs__arena_size(void* p)           { return (size_t*)((char*)p - RS__ARENA_PREFIX); }
+
+static inline void rs_arena_init(rs_arena* ar, size_t block_size) {
+    ar->head = ar->cur = NULL;
+    ar->block_size = block_size ? block_size : RS_ARENA_DEFAULT_BLOCK;
+}
+
+/* O(1): rewind to the first block; later blocks are rewound lazily as they are reached */
+static inline void rs_arena_reset(rs_arena* ar) {
+    ar->cur = ar->head;
+    if (ar->cur) ar->cur->used = 0;
+}
+
+static inline void rs_arena_free(rs_arena* ar) {
+    rs_arena_block* b = ar->head;
+
+    while (b) {
+        rs_arena_block* nx = b->next;
+        free(b);
+        b = nx;
+    }
+
+    ar->head = ar->cur = NULL;
+}
+
+static inline void* rs__arena_m(size_t n, void* ctx) {
+    rs_arena* ar = (rs_arena*)ctx;
+    size_t need = RS__ARENA_PREFIX + RS__ARENA_ROUND(n);
+    rs_arena_block* b = ar->cur;
+
+    if (!b || b->cap - b->used < need) {
+        rs_arena_block* nx = b ? b->next : ar->head;
+
+        if (nx && nx->cap >= need) {
+            nx->used = 0;
+            b = nx;
+        } else {
+            size_t cap = need > ar->block_size ? need : ar->block_size;
+            rs_arena_block* nb = (rs_arena_block*)malloc(RS__ARENA_BLOCK_HDR + cap);
+
+            if (!nb) return NULL;
+
+            nb->cap = cap; nb->used = 0; nb->next = nx;
+            if (b) b->next = nb; else ar->head = nb;
+            b = nb;
+        }
+        ar->cur = b;
+    }
+
+    char* p = rs__arena_base(b) + b->used + RS__ARENA_PREFIX;
+    b->used += need;
+    *rs__arena_size(p) = need - RS__ARENA_PREFIX;
+
+    return p;
+}
+
+/* true when p is the most recent allocation of the current block */
+static inline bool rs__arena_is_top(rs_arena* ar, void* p) {
+    rs_arena_block* b = ar->cur;
+    return b && (char*)p + *rs__arena_size(p) == rs__arena_base(b) + b->used;
+}
+
+static inline void* rs__arena_r(void* p, size_t n, void* ctx) {
+    rs_arena* ar = (rs_arena*)ctx;
+
+    if (!p) return rs__arena_m(n, ctx);
+
+    size_t old = *rs__arena_size(p);
+    size_t rn  = RS__ARENA_ROUND(n);
+
+    if (rn <= old) return p;
+
+    /* a growing string is usually the last thing allocated: extend it in place */
+    if (rs__arena_is_top(ar, p) && ar->cur->cap - ar->cur->used >= rn - old) {
+        ar->cur->used += rn - old;
+        *rs__arena_size(p) = rn;
+        return p;
+    }
+
+    void* q = rs__arena_m(n, ctx);
+    if (q) memcpy(q, p, old);
+
+    return q;
+}
+
+static inline void rs__arena_f(void* p, void* ctx) {
+    rs_arena* ar = (rs_arena*)ctx;
+
+    /* individual frees are no-ops, except that the top allocation is handed back */
+    if (p && rs__arena_is_top(ar, p))
+        ar->cur->used -= RS__ARENA_PREFIX + *rs__arena_size(p);
+}
+
+static inline rs_alloc rs_arena_alloc(rs_arena* ar) {
+    return (rs_alloc){ &rs__arena_m, &rs__arena_r, &rs__arena_f, ar, NULL, NULL, NULL };
+}
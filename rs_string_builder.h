@@ -0,0 +1,107 @@
+// MIT License
+//
+// Copyright (c) 2025 Raman Sharkovich
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// rs_string_builder.h — lazy concatenation for rs_string (header-only)
+// Usage: rs_builder b; rs_builder_init(&b);
+//        rs_builder_add(&b, head); rs_builder_add_cstr(&b, "\r\n"); rs_builder_add(&b, body);
+//        rs_builder_build(&b, &out);   /* one reserve, then straight memcpys */
+//        rs_builder_free(&b);
+// The builder stores views only: every added byte range must stay alive and unchanged
+// until rs_builder_build.
+#pragma once
+#include "rs_string.h"
+
+#ifndef RS_BUILDER_INLINE
+#define RS_BUILDER_INLINE 16
+#endif
+
+typedef struct {
+    rs_sv*   parts;                   /* heap array, NULL while the inline one is used */
+    size_t   n, cap;
+    size_t   len;                     /* total bytes over all parts */
+    rs_alloc a;                       /* for `parts` only */
+    rs_sv    inl[RS_BUILDER_INLINE];
+} rs_builder;
+
+static inline void rs_builder_init_ex(rs_builder* b, rs_alloc a) {
+    b->parts = NULL;
+    b->n = b->len = 0;
+    b->cap = RS_BUILDER_INLINE;
+    b->a = rs__alloc_or_default(a);
+}
+static inline void rs_builder_init(rs_builder* b) { rs_builder_init_ex(b, rs_default_alloc()); }
+
+static inline rs_sv* rs__builder_parts(rs_builder* b) { return b->parts ? b->parts : b->inl; }
+
+static inline size_t rs_builder_len(const rs_builder* b)   { return b->len; }
+static inline size_t rs_builder_count(const rs_builder* b) { return b->n; }
+
+/* Drop the parts, keep the array for the next message. */
+static inline void rs_builder_reset(rs_builder* b) { b->n = b->len = 0; }
+
+static inline void rs_builder_free(rs_builder* b) {
+    if (b->parts && b->a.f) b->a.f(b->parts, b->a.ctx);
+    rs_builder_init_ex(b, b->a);
+}
+
+static inline int rs_builder_add(rs_builder* b, rs_sv v) {
+    if (v.len == 0) return 0;
+    if (v.len > SIZE_MAX - b->len) return -1;
+
+    rs_sv* parts = rs__builder_parts(b);
+
+    /* a view that continues the previous one (e.g. consecutive tokens) just extends it */
+    if (b->n && parts[b->n - 1].data + parts[b->n - 1].len == v.data) {
+        parts[b->n - 1].len += v.len;
+        b->len += v.len;
+        return 0;
+    }
+
+    if (b->n == b->cap) {
+        size_t ncap = b->cap * 2;
+        rs_sv* np = b->parts ? (rs_sv*)rs__realloc(&b->a, b->parts, b->cap * sizeof(rs_sv), ncap * sizeof(rs_sv))
+                             : (rs_sv*)b->a.m(ncap * sizeof(rs_sv), b->a.ctx);
+
+        if (!np) return -1;
+        if (!b->parts) memcpy(np, b->inl, b->n * sizeof(rs_sv));
+
+        b->parts = parts = np;
+        b->cap = ncap;
+    }
+
+    parts[b->n++] = v;
+    b->len += v.len;
+    return 0;
+}
+
+static inline int rs_builder_add_cstr(rs_builder* b, const char* c) { return rs_builder_add(b, rs_sv_from_cstr(c)); }
+
+/* The string's bytes are viewed, not copied: `s` must not change before the build. */
+static inline int rs_builder_add_string(rs_builder* b, const rs_string* s) {
+    return rs_builder_add(b, (rs_sv){ rs__cdata(s), rs_string_len(s) });
+}
+
+/* Append everything collected so far to `out` (sized once). The parts are kept. */
+static inline int rs_builder_build(rs_builder* b, rs_string* out) {
+    return rs_string_append_many(out, rs__builder_parts(b), b->n);
+}
@@ -28,6 +28,17 @@
 // Created by Raman Sharkovich on 24.09.25.
 //
 
+
+// rs_string_fluent.h — chained edits on one string (header-only)
+// Usage: int err = RS(&s, trim(), append(rs_sv_from_cstr(" world!")), printf_("[%s]", name));
+//        rsf c = { &s, 0 }; rsf_append(rsf_trim(&c), v); if (c.err) ...
+// The chain value `rsf` carries its target and the first error; there is no hidden or
+// thread-local state, so chains nest and run on any thread. RS(target, steps...)
+// evaluates `target` once and runs the steps left to right. It stops at the first step
+// that fails and yields 0 or -1. Steps are static inline forwarders to rs_string_*,
+// so a chain compiles to the direct calls (up to RSF_MAX_STEPS steps per RS()).
+// Steps nest as calls, so their arguments may be evaluated before earlier steps
+// run: don't pass values read from the target (its length, its cstr) to a step.
 #pragma once
 #ifndef RS_ENABLE_FLUENT
 #define RS_ENABLE_FLUENT 0
@@ -37,43 +48,99 @@
 #include "rs_string.h"
 #include <stdarg.h>
 
-#ifndef RSF_USE_THREAD_LOCAL
-#define RSF_USE_THREAD_LOCAL 1
-#endif
+typedef struct rsf {
+    rs_string* s;       /* the target */
+    int        err;     /* -1 once a step failed (later steps are skipped) */
+} rsf;
 
-#if RSF_USE_THREAD_LOCAL
-#  ifdef _MSC_VER
-#    define RSF_THREAD_LOCAL __declspec(thread)
-#  else
-#    define RSF_THREAD_LOCAL _Thread_local
-#  endif
-#else
-#  define RSF_THREAD_LOCAL
-#endif
+static inline rsf* rsf__done(rsf* c, int r) { if (r < 0) c->err = -1; return c; }
+
+static inline rsf* rsf_trim(rsf* c)             { return c->err ? c : rsf__done(c, rs_string_trim(c->s)); }
+static inline rsf* rsf_trim_left(rsf* c)        { return c->err ? c : rsf__done(c, rs_string_trim_left(c->s)); }
+static inline rsf* rsf_trim_right(rsf* c)       { return c->err ? c : rsf__done(c, rs_string_trim_right(c->s)); }
+static inline rsf* rsf_trim_cut(rsf* c, rs_sv cut) { return c->err ? c : rsf__done(c, rs_string_trim_cut(c->s, cut)); }
+static inline rsf* rsf_clear(rsf* c)            { return c->err ? c : rsf__done(c, rs_string_clear(c->s)); }
+static inline rsf* rsf_assign(rsf* c, rs_sv v)  { return c->err ? c : rsf__done(c, rs_string_assign(c->s, v)); }
+static inline rsf* rsf_append(rsf* c, rs_sv v)  { return c->err ? c : rsf__done(c, rs_string_append(c->s, v)); }
+static inline rsf* rsf_push_cstr(rsf* c, const char* z) { return c->err ? c : rsf__done(c, rs_string_push_cstr(c->s, z)); }
+static inline rsf* rsf_push_char(rsf* c, char ch) { return c->err ? c : rsf__done(c, rs_string_push_char(c->s, ch)); }
+static inline rsf* rsf_insert(rsf* c, size_t pos, rs_sv v) { return c->err ? c : rsf__done(c, rs_string_insert(c->s, pos, v)); }
+static inline rsf* rsf_erase(rsf* c, size_t pos, size_t n) { return c->err ? c : rsf__done(c, rs_string_erase(c->s, pos, n)); }
+static inline rsf* rsf_replace_first(rsf* c, rs_sv a, rs_sv b) { return c->err ? c : rsf__done(c, rs_string_replace_first(c->s, a, b)); }
+static inline rsf* rsf_replace_all(rsf* c, rs_sv a, rs_sv b)   { return c->err ? c : rsf__done(c, rs_string_replace_all(c->s, a, b)); }
+static inline rsf* rsf_to_lower_ascii(rsf* c)   { return c->err ? c : rsf__done(c, rs_string_to_lower_ascii(c->s)); }
+static inline rsf* rsf_to_upper_ascii(rsf* c)   { return c->err ? c : rsf__done(c, rs_string_to_upper_ascii(c->s)); }
+static inline rsf* rsf_free_(rsf* c)            { rs_string_free(c->s); return c; }
+
+static inline rsf* rsf_printf_(rsf* c, const char* fmt, ...) {
+    if (c->err) return c;
+
+    va_list ap;
+    va_start(ap, fmt);
+    int r = rs_string_vprintf(c->s, fmt, ap);
+    va_end(ap);
+    return rsf__done(c, r);
+}
+static inline rsf* rsf_appendf(rsf* c, const char* fmt, ...) {
+    if (c->err) return c;
 
-typedef struct rsf_iface {
-    struct rsf_iface* (*trim)(void);
-    struct rsf_iface* (*append)(rs_sv);
-    struct rsf_iface* (*replace_all)(rs_sv, rs_sv);
-    struct rsf_iface* (*printf_)(const char*, ...);
-    const char* (*cstr)(void);
-    void (*free_)(void);
-} rsf_iface;
-
-static RSF_THREAD_LOCAL rs_string* rsf_cur = NULL;
-static inline rsf_iface* rsf__ret(void) { static rsf_iface x; (void)x; return &x; }
-
-static inline rsf_iface* rsf_trim(void) { rs_string_trim(rsf_cur); return rsf__ret(); }
-static inline rsf_iface* rsf_append(rs_sv v) { rs_string_append(rsf_cur, v); return rsf__ret(); }
-static inline rsf_iface* rsf_replace_all(rs_sv a, rs_sv b) { rs_string_replace_all(rsf_cur,a,b); return rsf__ret(); }
-static inline rsf_iface* rsf_printf_(const char* fmt, ...) { va_list ap; va_start(ap,fmt); rs_string_vprintf(rsf_cur,fmt,ap); va_end(ap); return rsf__ret(); }
-static inline const char* rsf_cstr(void) { return rs_string_cstr(rsf_cur); }
-static inline void rsf_free_(void) { rs_string_free(rsf_cur); }
-
-static inline rsf_iface* rsf_table(void) {
-    static rsf_iface api = { rsf_trim, rsf_append, rsf_replace_all, rsf_printf_, rsf_cstr, rsf_free_ };
-    return &api;
+    va_list ap;
+    va_start(ap, fmt);
+    int r = rs_string_vappendf(c->s, fmt, ap);
+    va_end(ap);
+    return rsf__done(c, r);
 }
-static inline rsf_iface* RS(rs_string* s){ rsf_cur = s; return rsf_table(); }
+
+// RS(target, steps...): each step `name(args)` becomes rsf_name(chain, args). The
+// step's arity picks RSF__A0 (no arguments) or RSF__AN so no trailing comma is formed.
+#define RSF__S_trim()              RSF__A0, rsf_trim
+#define RSF__S_trim_left()         RSF__A0, rsf_trim_left
+#define RSF__S_trim_right()        RSF__A0, rsf_trim_right
+#define RSF__S_trim_cut(...)       RSF__AN, rsf_trim_cut, __VA_ARGS__
+#define RSF__S_clear()             RSF__A0, rsf_clear
+#define RSF__S_assign(...)         RSF__AN, rsf_assign, __VA_ARGS__
+#define RSF__S_append(...)         RSF__AN, rsf_append, __VA_ARGS__
+#define RSF__S_push_cstr(...)      RSF__AN, rsf_push_cstr, __VA_ARGS__
+#define RSF__S_push_char(...)      RSF__AN, rsf_push_char, __VA_ARGS__
+#define RSF__S_insert(...)         RSF__AN, rsf_insert, __VA_ARGS__
+#define RSF__S_erase(...)          RSF__AN, rsf_erase, __VA_ARGS__
+#define RSF__S_replace_first(...)  RSF__AN, rsf_replace_first, __VA_ARGS__
+#define RSF__S_replace_all(...)    RSF__AN, rsf_replace_all, __VA_ARGS__
+#define RSF__S_to_lower_ascii()    RSF__A0, rsf_to_lower_ascii
+#define RSF__S_to_upper_ascii()    RSF__A0, rsf_to_upper_ascii
+#define RSF__S_printf_(...)        RSF__AN, rsf_printf_, __VA_ARGS__
+#define RSF__S_appendf(...)        RSF__AN, rsf_appendf, __VA_ARGS__
+#define RSF__S_free_()             RSF__A0, rsf_free_
+
+#define RSF__A0(c, f)              f(c)
+#define RSF__AN(c, f, ...)         f(c, __VA_ARGS__)
+#define RSF__APPLY_(c, kind, ...)  kind(c, __VA_ARGS__)
+#define RSF__APPLY(c, step)        RSF__APPLY_(c, step)
+#define RSF__STEP(c, step)         RSF__APPLY(c, RSF__S_##step)
+
+#define RSF_MAX_STEPS 12
+#define RSF__F1(c, s)       RSF__STEP(c, s)
+#define RSF__F2(c, s, ...)  RSF__F1(RSF__STEP(c, s), __VA_ARGS__)
+#define RSF__F3(c, s, ...)  RSF__F2(RSF__STEP(c, s), __VA_ARGS__)
+#define RSF__F4(c, s, ...)  RSF__F3(RSF__STEP(c, s), __VA_ARGS__)
+#define RSF__F5(c, s, ...)  RSF__F4(RSF__STEP(c, s), __VA_ARGS__)
+#define RSF__F6(c, s, ...)  RSF__F5(RSF__STEP(c, s), __VA_ARGS__)
+#define RSF__F7(c, s, ...)  RSF__F6(RSF__STEP(c, s), __VA_ARGS__)
+#define RSF__F8(c, s, ...)  RSF__F7(RSF__STEP(c, s), __VA_ARGS__)
+#define RSF__F9(c, s, ...)  RSF__F8(RSF__STEP(c, s), __VA_ARGS__)
+#define RSF__F10(c, s, ...) RSF__F9(RSF__STEP(c, s), __VA_ARGS__)
+#define RSF__F11(c, s, ...) RSF__F10(RSF__STEP(c, s), __VA_ARGS__)
+#define RSF__F12(c, s, ...) RSF__F11(RSF__STEP(c, s), __VA_ARGS__)
+#define RSF__NTH(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, n, ...) n
+#define RSF__NARG(...) RSF__NTH(__VA_ARGS__, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define RSF__CAT_(a, b) a##b
+#define RSF__CAT(a, b)  RSF__CAT_(a, b)
+
+/* the result goes through a function so RS(...); as a statement does not warn */
+static inline int rsf__result(const rsf* c) { return c->err; }
+
+/* the chain lives in a compound literal of the enclosing block: one per RS() */
+#define RS(target, ...) \
+    rsf__result(RSF__CAT(RSF__F, RSF__NARG(__VA_ARGS__))((&(rsf){ (target), 0 }), __VA_ARGS__))
 
 #endif /* RS_ENABLE_FLUENT */
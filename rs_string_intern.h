@@ -0,0 +1,209 @@
+// MIT License
+//
+// Copyright (c) 2025 Raman Sharkovich
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// rs_string_intern.h — interned (deduplicated) strings on top of the COW header (header-only)
+// Usage: rs_intern t; rs_intern_init(&t);
+//        rs_string a, b; rs_string_init(&a); rs_string_init(&b);
+//        rs_intern_get(&t, rs_sv_from_cstr("host"), &a);
+//        rs_intern_get(&t, rs_sv_from_cstr("host"), &b);   /* same buffer, rc bumped */
+//        rs_intern_same(&a, &b) == true
+// Every interned string is a heap buffer owned by the table, so handles compare by pointer.
+// Handles are ordinary rs_strings: free them as usual, and writing to one detaches it (COW).
+// With RS_ATOMIC_REFCOUNT the sharded rs_intern_mt variant can be used across threads.
+#pragma once
+#include "rs_string.h"
+
+typedef struct {
+    uint64_t hash;
+    size_t   len;
+    char*    p;     /* heap data, NULL = empty slot */
+} rs__intern_slot;
+
+typedef struct {
+    rs__intern_slot* slots;
+    size_t           cap;    /* power of two */
+    size_t           count;
+    rs_alloc         a;      /* table storage and interned buffers */
+} rs_intern;
+
+static inline void rs_intern_init_ex(rs_intern* t, rs_alloc a) {
+    t->slots = NULL; t->cap = 0; t->count = 0;
+    t->a = rs__alloc_or_default(a);
+}
+static inline void rs_intern_init(rs_intern* t) { rs_intern_init_ex(t, rs_default_alloc()); }
+
+static inline size_t rs_intern_count(const rs_intern* t) { return t->count; }
+
+/* drops the table's references; outstanding handles stay valid */
+static inline void rs_intern_free(rs_intern* t) {
+    for (size_t i = 0; i < t->cap; ++i) {
+        if (!t->slots[i].p) continue;
+        rs__hdr_release(rs__hdr_from_ptr(t->slots[i].p));
+    }
+    if (t->slots && t->a.f) t->a.f(t->slots, t->a.ctx);
+    rs_intern_init_ex(t, t->a);
+}
+
+static inline int rs__intern_grow(rs_intern* t) {
+    size_t ncap = t->cap ? t->cap * 2 : 64;
+    rs__intern_slot* ns = (rs__intern_slot*)t->a.m(ncap * sizeof *ns, t->a.ctx);
+
+    if (!ns) return -1;
+
+    memset(ns, 0, ncap * sizeof *ns);
+    for (size_t i = 0; i < t->cap; ++i) {
+        if (!t->slots[i].p) continue;
+        size_t j = (size_t)t->slots[i].hash & (ncap - 1);
+        while (ns[j].p) j = (j + 1) & (ncap - 1);
+        ns[j] = t->slots[i];
+    }
+
+    if (t->slots && t->a.f) t->a.f(t->slots, t->a.ctx);
+    t->slots = ns;
+    t->cap = ncap;
+
+    return 0;
+}
+
+/* turn a table buffer into a handle: one more reference on the shared header */
+static inline void rs__intern_handle(rs_string* out, char* p, size_t len) {
+    rs__hdr* h = rs__hdr_from_ptr(p);
+
+    rs_string_free(out);
+    rs__set_heap(out, p, len, h->cap);
+    rs__retain(out);
+}
+
+/* slot holding `key`, or the empty slot that ends its probe run (cap must be > 0) */
+static inline size_t rs__intern_probe(const rs_intern* t, rs_sv key, uint64_t hash) {
+    size_t mask = t->cap - 1;
+    size_t i = (size_t)hash & mask;
+
+    for (;; i = (i + 1) & mask) {
+        const rs__intern_slot* sl = &t->slots[i];
+
+        if (!sl->p || (sl->hash == hash && sl->len == key.len && memcmp(sl->p, key.data, key.len) == 0))
+            return i;
+    }
+}
+
+/* Hits never touch the table's size, so looking up an interned key cannot fail; only an
+ * insert grows it (and then probes the new table for its slot). */
+static inline int rs__intern_get_hashed(rs_intern* t, rs_sv key, uint64_t hash, rs_string* out) {
+    size_t i = 0;
+
+    if (t->cap) {
+        i = rs__intern_probe(t, key, hash);
+        if (t->slots[i].p) {
+            rs__intern_handle(out, t->slots[i].p, t->slots[i].len);
+            return 0;
+        }
+    }
+    if ((t->count + 1) * 4 > t->cap * 3) {
+        if (rs__intern_grow(t) != 0) return -1;
+        i = rs__intern_probe(t, key, hash);
+    }
+
+    /* new entry: always a heap buffer, even for short keys, so handles share it */
+    const rs_alloc* ha = rs__alloc_intern(t->a);
+    rs__hdr* h = ha ? rs__hdr_new(key.len, ha) : NULL;
+
+    if (!h) return -1;
+
+    char* p = rs__ptr_from_hdr(h);
+    memcpy(p, key.data, key.len);
+    p[key.len] = '\0';
+    rs__memo_set(&h->hash, hash); /* rs_string_hash on a handle is free */
+
+    t->slots[i] = (rs__intern_slot){ hash, key.len, p };
+    t->count++;
+    rs__intern_handle(out, p, key.len);
+
+    return 0;
+}
+
+/* `out` is released first and then receives a shared handle to the canonical copy */
+static inline int rs_intern_get(rs_intern* t, rs_sv key, rs_string* out) {
+    return rs__intern_get_hashed(t, key, rs_sv_hash(key), out);
+}
+
+/* pointer equality; only meaningful for handles from the same table */
+static inline bool rs_intern_same(const rs_string* a, const rs_string* b) {
+    return rs__cdata(a) == rs__cdata(b);
+}
+
+#ifdef RS_ATOMIC_REFCOUNT
+#include <threads.h>
+
+#ifndef RS_INTERN_SHARDS
+#define RS_INTERN_SHARDS 16   /* power of two */
+#endif
+
+typedef struct {
+    mtx_t     m;
+    rs_intern t;
+    char      pad[64];        /* keep neighbouring shard locks off one cache line */
+} rs__intern_shard;
+
+/* Concurrent table: shards picked by the high hash bits, each behind its own lock. */
+typedef struct { rs__intern_shard shard[RS_INTERN_SHARDS]; } rs_intern_mt;
+
+static inline int rs_intern_mt_init(rs_intern_mt* t) {
+    for (int i = 0; i < RS_INTERN_SHARDS; ++i) {
+        rs_intern_init(&t->shard[i].t);
+        if (mtx_init(&t->shard[i].m, mtx_plain) != thrd_success) {
+            while (i--) mtx_destroy(&t->shard[i].m); /* the tables are still empty */
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static inline int rs_intern_mt_get(rs_intern_mt* t, rs_sv key, rs_string* out) {
+    uint64_t hash = rs_sv_hash(key);
+    rs__intern_shard* sh = &t->shard[(hash >> 56) & (RS_INTERN_SHARDS - 1)];
+
+    mtx_lock(&sh->m);
+    int r = rs__intern_get_hashed(&sh->t, key, hash, out);
+    mtx_unlock(&sh->m);
+
+    return r;
+}
+
+static inline size_t rs_intern_mt_count(rs_intern_mt* t) {
+    size_t n = 0;
+    for (int i = 0; i < RS_INTERN_SHARDS; ++i) {
+        mtx_lock(&t->shard[i].m);
+        n += t->shard[i].t.count;
+        mtx_unlock(&t->shard[i].m);
+    }
+    return n;
+}
+
+static inline void rs_intern_mt_free(rs_intern_mt* t) {
+    for (int i = 0; i < RS_INTERN_SHARDS; ++i) {
+        rs_intern_free(&t->shard[i].t);
+        mtx_destroy(&t->shard[i].m);
+    }
+}
+#endif /* RS_ATOMIC_REFCOUNT */
@@ -0,0 +1,335 @@
+// MIT License
+//
+// Copyright (c) 2025 Raman Sharkovich
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// rs_string_io.h — file loading for rs_string (header-only)
+// Usage: rs_string m; rs_string_init(&m);
+//        rs_string_map_file(&m, "dict.txt");        /* zero-copy where mmap exists */
+//        rs_sv all = rs_string_sv(&m);  ...  rs_string_free(&m);
+//
+//        rs_line_reader lr; rs_line_reader_open(&lr, "log.txt");
+//        rs_sv line; while (rs_line_reader_next(&lr, &line)) { ... }
+//        rs_line_reader_close(&lr);
+// Both sit on the same small file layer (POSIX fds, or stdio elsewhere / with RS_NO_MMAP).
+// A mapped file must not be truncated while mapped (reads past the new end fault).
+#pragma once
+#include "rs_string.h"
+#include <stdio.h>
+
+#if !defined(RS_NO_MMAP) && (defined(__unix__) || defined(__APPLE__))
+  #define RS__HAVE_MMAP 1
+  #include <sys/types.h>
+  #include <sys/stat.h>
+  #include <sys/mman.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <errno.h>
+#endif
+
+/* files smaller than this are read instead of mapped (a mapping costs a few syscalls
+ * and at least two pages) */
+#ifndef RS_MAP_MIN_BYTES
+#define RS_MAP_MIN_BYTES (64 * 1024)
+#endif
+
+/* read granularity of rs_line_reader */
+#ifndef RS_LINE_CHUNK
+#define RS_LINE_CHUNK (64 * 1024)
+#endif
+
+// File layer
+#if RS__HAVE_MMAP
+typedef struct { int fd; } rs__file;
+
+static inline int rs__file_open(rs__file* f, const char* path) {
+    do f->fd = open(path, O_RDONLY); while (f->fd < 0 && errno == EINTR);
+    return f->fd < 0 ? -1 : 0;
+}
+static inline void rs__file_close(rs__file* f) { if (f->fd >= 0) close(f->fd); f->fd = -1; }
+
+/* size of a regular file; 0 for anything that has to be read to the end (pipes, /proc) */
+static inline size_t rs__file_size(rs__file* f) {
+    struct stat st;
+    if (fstat(f->fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) return 0;
+    return (uint64_t)st.st_size > SIZE_MAX - 1 ? 0 : (size_t)st.st_size;
+}
+
+/* bytes read, 0 at end of file, -1 on error */
+static inline ptrdiff_t rs__file_read(rs__file* f, char* buf, size_t n) {
+    ssize_t r;
+    do r = read(f->fd, buf, n); while (r < 0 && errno == EINTR);
+    return (ptrdiff_t)r;
+}
+#else
+typedef struct { FILE* fp; } rs__file;
+
+static inline int rs__file_open(rs__file* f, const char* path) {
+    f->fp = fopen(path, "rb");
+    return f->fp ? 0 : -1;
+}
+static inline void rs__file_close(rs__file* f) { if (f->fp) fclose(f->fp); f->fp = NULL; }
+
+static inline size_t rs__file_size(rs__file* f) {
+    long n = -1;
+    if (fseek(f->fp, 0, SEEK_END) == 0) n = ftell(f->fp);
+    if (fseek(f->fp, 0, SEEK_SET) != 0) return 0;
+    return n > 0 ? (size_t)n : 0;
+}
+
+static inline ptrdiff_t rs__file_read(rs__file* f, char* buf, size_t n) {
+    size_t r = fread(buf, 1, n, f->fp);
+    return r == 0 && ferror(f->fp) ? -1 : (ptrdiff_t)r;
+}
+#endif
+
+/* Append the rest of the file to `out`, reading straight into its spare capacity. */
+static inline int rs__file_read_all(rs__file* f, rs_string* out, size_t size_hint) {
+    size_t want = size_hint ? size_hint + 1 : RS_LINE_CHUNK; /* +1 sees EOF without a regrow */
+
+    for (;;) {
+        char* w = rs_string_prepare(out, want);
+        if (!w) return -1;
+
+        ptrdiff_t got = rs__file_read(f, w, rs_string_avail(out));
+        if (got < 0) return -1;
+        if (got == 0) return 0;
+
+        rs_string_commit(out, (size_t)got);
+        want = RS_LINE_CHUNK;
+    }
+}
+
+// Mapped files
+#if RS__HAVE_MMAP
+/* A mapping is a heap string whose header sits at the end of a private page placed
+ * right before the file's pages, followed by at least one zero byte (the terminator):
+ *
+ *   [ page: tag | rs__hdr ][ file bytes ... ][ 0 ... ]
+ *
+ * It is handed out as a slice of that buffer, so the usual COW rules apply: share and
+ * slice are free, the first write or growth copies the bytes out. The copies come from
+ * this same allocator (malloc with a 16-byte tag); `f` tells the two apart by the tag. */
+#define RS__MAP_TAG 16
+
+static inline void* rs__map_m(size_t n, void* ctx) {
+    (void)ctx;
+    char* b = (char*)malloc(n + RS__MAP_TAG);
+    if (!b) return NULL;
+    ((size_t*)b)[0] = 0;
+    return b + RS__MAP_TAG;
+}
+static inline void* rs__map_r(void* p, size_t n, void* ctx) {
+    (void)ctx; /* only ever called on malloc'ed copies: the mapping itself is a slice */
+    char* b = (char*)realloc((char*)p - RS__MAP_TAG, n + RS__MAP_TAG);
+    return b ? b + RS__MAP_TAG : NULL;
+}
+static inline void rs__map_f(void* p, void* ctx) {
+    (void)ctx;
+    size_t* t = (size_t*)((char*)p - RS__MAP_TAG);
+
+    if (t[0]) munmap((char*)p + sizeof(rs__hdr) - t[0], t[1]); /* t[0] = page, t[1] = length */
+    else      free(t);
+}
+static inline const rs_alloc* rs__map_alloc(void) {
+    static const rs_alloc a = { &rs__map_m, &rs__map_r, &rs__map_f, NULL, NULL, NULL, NULL };
+    return &a;
+}
+
+static inline int rs__map_fd(rs_string* out, int fd, size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t body = (size + 1 + page - 1) / page * page;   /* file bytes + a zero byte */
+    size_t total = page + body;
+    int zfd = -1, flags = MAP_PRIVATE;
+
+    if (size > SIZE_MAX - 2 * page) return -1;
+#if defined(MAP_ANONYMOUS)
+    flags |= MAP_ANONYMOUS;
+#elif defined(MAP_ANON)
+    flags |= MAP_ANON;
+#else
+    if ((zfd = open("/dev/zero", O_RDWR)) < 0) return -1;
+#endif
+
+    /* reserve header page + body as zero pages, then lay the file over the body */
+    char* base = (char*)mmap(NULL, total, PROT_READ | PROT_WRITE, flags, zfd, 0);
+    if (zfd >= 0) close(zfd);
+    if (base == (char*)MAP_FAILED) return -1;
+
+    /* writable private pages: a write through an unshared slice (erase, trim) copies the
+     * touched page in the kernel, never the file */
+    if (mmap(base + page, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, total);
+        return -1;
+    }
+
+    char* p = base + page;
+    rs__hdr* h = rs__hdr_from_ptr(p);
+    size_t* t = (size_t*)((char*)h - RS__MAP_TAG);
+    t[0] = page; t[1] = total;
+
+    rs__hdr_init(h, size, rs__map_alloc());
+
+    rs__set_slice(out, p, 0, size);
+    return 0;
+}
+#endif
+
+/* Replace `out` with the contents of `path`. Large regular files are memory-mapped and
+ * never copied (unless written to); everything else is read in one pass. Returns 0, or
+ * -1 with `out` left empty. */
+static inline int rs_string_map_file(rs_string* out, const char* path) {
+    rs__file f;
+    rs_string_free(out);
+
+    if (rs__file_open(&f, path) != 0) return -1;
+
+    size_t size = rs__file_size(&f);
+    int r = -1;
+
+#if RS__HAVE_MMAP
+    if (size >= RS_MAP_MIN_BYTES)
+        r = rs__map_fd(out, f.fd, size);
+#endif
+    if (r != 0)
+        r = rs__file_read_all(&f, out, size);
+
+    rs__file_close(&f);
+    if (r != 0) rs_string_free(out);
+
+    return r;
+}
+
+/* true if `s` still views a file mapping (no copy has been made) */
+static inline bool rs_string_is_mapped(const rs_string* s) {
+#if RS__HAVE_MMAP
+    return rs_string_is_heap(s) && rs__hdr_of(s)->a->f == &rs__map_f
+           && ((size_t*)((char*)rs__hdr_of(s) - RS__MAP_TAG))[0] != 0;
+#else
+    (void)s;
+    return false;
+#endif
+}
+
+// Line reader
+/* Yields lines without their "\n" (or "\r\n"); a last line without a newline is still
+ * returned. A line view stays valid until the next call. Streaming readers refill one
+ * growable rs_string buffer through rs_string_prepare, so only the partial line at the
+ * end of a chunk is ever moved; rs_line_reader_init_sv walks memory (e.g. a mapping)
+ * without any copy. */
+typedef struct {
+    rs__file    f;
+    bool        open;      /* reading from `f` */
+    bool        eof;
+    bool        err;
+    rs_string   buf;       /* streaming: bytes read but not yet returned start at `pos` */
+    size_t      pos;
+    size_t      scan;      /* no '\n' in [pos, scan) */
+    rs_sv       mem;       /* in-memory source */
+} rs_line_reader;
+
+static inline void rs__line_reader_init(rs_line_reader* r) {
+    r->open = r->eof = r->err = false;
+    rs_string_init(&r->buf);
+    r->pos = r->scan = 0;
+    r->mem = (rs_sv){ "", 0 };
+}
+
+static inline int rs_line_reader_open(rs_line_reader* r, const char* path) {
+    rs__line_reader_init(r);
+    if (rs__file_open(&r->f, path) != 0) return -1;
+    r->open = true;
+    return 0;
+}
+
+static inline void rs_line_reader_init_sv(rs_line_reader* r, rs_sv text) {
+    rs__line_reader_init(r);
+    r->mem = text;
+    r->eof = true;
+}
+
+static inline void rs_line_reader_close(rs_line_reader* r) {
+    if (r->open) rs__file_close(&r->f);
+    rs_string_free(&r->buf);
+    rs__line_reader_init(r);
+}
+
+/* true if reading stopped because of an I/O or allocation error rather than EOF */
+static inline bool rs_line_reader_error(const rs_line_reader* r) { return r->err; }
+
+static inline rs_sv rs__line_cut(const char* d, size_t from, size_t to) {
+    if (to > from && d[to - 1] == '\r') --to;
+    return (rs_sv){ d + from, to - from };
+}
+
+static inline bool rs_line_reader_next(rs_line_reader* r, rs_sv* line) {
+    if (!r->open) {
+        const char* d = r->mem.data;
+        size_t n = r->mem.len;
+
+        if (r->pos >= n) return false;
+
+        size_t k = rs__find_byte(d + r->pos, n - r->pos, '\n');
+        size_t end = k == (size_t) - 1 ? n : r->pos + k;
+
+        *line = rs__line_cut(d, r->pos, end);
+        r->pos = end + 1;
+        return true;
+    }
+
+    for (;;) {
+        const char* d = rs__cdata(&r->buf);
+        size_t len = rs_string_len(&r->buf);
+        size_t k = rs__find_byte(d + r->scan, len - r->scan, '\n');
+
+        if (k != (size_t) - 1) {
+            size_t end = r->scan + k;
+            *line = rs__line_cut(d, r->pos, end);
+            r->pos = r->scan = end + 1;
+            return true;
+        }
+        r->scan = len;
+
+        if (r->eof) {
+            if (r->pos >= len) return false;
+            *line = rs__line_cut(d, r->pos, len);
+            r->pos = len;
+            return true;
+        }
+
+        /* keep only the partial line, then read behind it */
+        if (r->pos) {
+            rs_string_erase(&r->buf, 0, r->pos);
+            r->scan -= r->pos;
+            r->pos = 0;
+        }
+
+        char* w = rs_string_prepare(&r->buf, RS_LINE_CHUNK);
+        ptrdiff_t got = w ? rs__file_read(&r->f, w, rs_string_avail(&r->buf)) : -1;
+
+        if (got <= 0) {
+            r->eof = true;
+            r->err = got < 0;
+        } else {
+            rs_string_commit(&r->buf, (size_t)got);
+        }
+    }
+}
@@ -0,0 +1,222 @@
+// MIT License
+//
+// Copyright (c) 2025 Raman Sharkovich
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// rs_string_iov.h — scatter-gather output queue over rs_string buffers (header-only)
+// Usage: rs_string_iov q; rs_string_iov_init(&q);
+//        rs_string_iov_add_sv(&q, rs_sv_from_cstr("HTTP/1.1 200 OK\r\n"));  /* borrowed */
+//        rs_string_iov_add(&q, &headers);       /* pins the buffer: one more reference */
+//        rs_string_iov_add_rope(&q, &body);     /* every rope piece, no flattening */
+//        while (rs_string_iov_len(&q)) if (rs_string_iov_writev(&q, fd) < 0) ...;
+//        rs_string_iov_free(&q);
+// Heap strings (and rope chunks) are pinned by sharing, so the caller may free or
+// overwrite its own handle right away: a later write copies, as for any shared buffer.
+// Inline strings are small and are copied into the queue. rs_sv segments are borrowed
+// and must outlive their drain. Written bytes are consumed from the front, so a partial
+// write resumes mid-segment. A fully drained segment drops its reference at once. The
+// iovec array is rebuilt per call from the pending segments (at most RS_IOV_BATCH per
+// system call), so the queue can grow while entries are pending. writev / sendmsg exist
+// on POSIX systems; elsewhere rs_string_iov_fill and _consume drive any gather API.
+#pragma once
+#include "rs_string.h"
+#include "rs_string_rope.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+  #define RS__HAVE_WRITEV 1
+  #include <sys/types.h>
+  #include <sys/uio.h>
+  #include <sys/socket.h>
+  #include <errno.h>
+  typedef struct iovec rs_iovec;
+#else
+  typedef struct { void* iov_base; size_t iov_len; } rs_iovec;
+#endif
+
+/* iovec entries per system call (also capped by IOV_MAX where it is defined) */
+#ifndef RS_IOV_BATCH
+#define RS_IOV_BATCH 64
+#endif
+
+typedef struct {
+    rs_string   pin;        /* holds the bytes (a shared heap buffer or an inline copy) */
+    const char* ext;        /* borrowed bytes instead of pin's, or NULL */
+    size_t      off, len;   /* pending range */
+} rs__iov_seg;
+
+typedef struct {
+    rs__iov_seg* seg;
+    size_t head, n, cap;    /* pending segments are seg[head, n) */
+    size_t bytes;           /* pending bytes */
+} rs_string_iov;
+
+static inline void   rs_string_iov_init(rs_string_iov* q)        { q->seg = NULL; q->head = q->n = q->cap = 0; q->bytes = 0; }
+static inline size_t rs_string_iov_len(const rs_string_iov* q)   { return q->bytes; }
+static inline size_t rs_string_iov_count(const rs_string_iov* q) { return q->n - q->head; }
+
+static inline void rs_string_iov_free(rs_string_iov* q) {
+    for (size_t i = q->head; i < q->n; ++i) rs_string_free(&q->seg[i].pin);
+    free(q->seg);
+    rs_string_iov_init(q);
+}
+
+/* room for one more segment: reuse the drained front before growing */
+static inline rs__iov_seg* rs__iov_push(rs_string_iov* q) {
+    if (q->n == q->cap && q->head) {
+        memmove(q->seg, q->seg + q->head, (q->n - q->head) * sizeof *q->seg);
+        q->n -= q->head;
+        q->head = 0;
+    }
+    if (q->n == q->cap) {
+        size_t ncap = q->cap ? q->cap * 2 : 16;
+        rs__iov_seg* ns = ncap < SIZE_MAX / sizeof *ns ? (rs__iov_seg*)realloc(q->seg, ncap * sizeof *ns) : NULL;
+
+        if (!ns) return NULL;
+        q->seg = ns;
+        q->cap = ncap;
+    }
+    return &q->seg[q->n];
+}
+
+static inline int rs__iov_add_range(rs_string_iov* q, const rs_string* s, size_t off, size_t len) {
+    if (len == 0) return 0;
+
+    rs__iov_seg* g = rs__iov_push(q);
+    if (!g) return -1;
+
+    rs_string_init(&g->pin);
+    rs_string_share(&g->pin, s);
+    g->ext = NULL;
+    g->off = off;
+    g->len = len;
+    q->n++;
+    q->bytes += len;
+    return 0;
+}
+
+/* queue s's bytes; a heap buffer is pinned, an inline string copied */
+static inline int rs_string_iov_add(rs_string_iov* q, const rs_string* s) {
+    return rs__iov_add_range(q, s, 0, rs_string_len(s));
+}
+
+/* queue borrowed bytes: they must stay valid and unchanged until drained */
+static inline int rs_string_iov_add_sv(rs_string_iov* q, rs_sv v) {
+    if (v.len == 0) return 0;
+
+    rs__iov_seg* g = rs__iov_push(q);
+    if (!g) return -1;
+
+    rs_string_init(&g->pin);
+    g->ext = v.data;
+    g->off = 0;
+    g->len = v.len;
+    q->n++;
+    q->bytes += v.len;
+    return 0;
+}
+
+static inline int rs__iov_add_node(rs_string_iov* q, const rs__rope_node* n) {
+    for (; n; n = n->r) {
+        if (rs__iov_add_node(q, n->l) != 0 || rs__iov_add_range(q, &n->chunk, n->off, n->len) != 0) return -1;
+    }
+    return 0;
+}
+
+/* queue every piece of r in order, each pinning its chunk (the rope may change after);
+ * on failure the pieces queued so far stay queued */
+static inline int rs_string_iov_add_rope(rs_string_iov* q, const rs_rope* r) {
+    return rs__iov_add_node(q, r->root);
+}
+
+/* the first pending segments as iovec entries, at most `max`; returns how many */
+static inline size_t rs_string_iov_fill(const rs_string_iov* q, rs_iovec* out, size_t max) {
+    size_t k = 0;
+
+    for (size_t i = q->head; i < q->n && k < max; ++i, ++k) {
+        const rs__iov_seg* g = &q->seg[i];
+        out[k].iov_base = (void*)((g->ext ? g->ext : rs__cdata(&g->pin)) + g->off);
+        out[k].iov_len = g->len;
+    }
+    return k;
+}
+
+/* drop `n` written bytes from the front, releasing segments as they drain */
+static inline void rs_string_iov_consume(rs_string_iov* q, size_t n) {
+    if (n > q->bytes) n = q->bytes;
+    q->bytes -= n;
+
+    while (n) {
+        rs__iov_seg* g = &q->seg[q->head];
+
+        if (n < g->len) {
+            g->off += n;
+            g->len -= n;
+            return;
+        }
+        n -= g->len;
+        rs_string_free(&g->pin);
+        q->head++;
+    }
+    if (q->head == q->n) q->head = q->n = 0;
+}
+
+#if RS__HAVE_WRITEV
+#if defined(IOV_MAX) && IOV_MAX < RS_IOV_BATCH
+  #define RS__IOV_CALL IOV_MAX
+#else
+  #define RS__IOV_CALL RS_IOV_BATCH
+#endif
+
+/* One writev (retried on EINTR) of the pending bytes. Bytes written (consumed from
+ * the queue), 0 if nothing is pending, -1 with errno set (e.g. EAGAIN) otherwise. */
+static inline ptrdiff_t rs_string_iov_writev(rs_string_iov* q, int fd) {
+    rs_iovec iov[RS__IOV_CALL];
+    size_t k = rs_string_iov_fill(q, iov, RS__IOV_CALL);
+    ssize_t r;
+
+    if (k == 0) return 0;
+    do r = writev(fd, iov, (int)k); while (r < 0 && errno == EINTR);
+    if (r > 0) rs_string_iov_consume(q, (size_t)r);
+    return (ptrdiff_t)r;
+}
+
+/* the same through sendmsg, for sockets (flags e.g. MSG_NOSIGNAL) */
+static inline ptrdiff_t rs_string_iov_sendmsg(rs_string_iov* q, int fd, int flags) {
+    rs_iovec iov[RS__IOV_CALL];
+    struct msghdr m;
+    ssize_t r;
+
+    memset(&m, 0, sizeof m);
+    m.msg_iov = iov;
+    m.msg_iovlen = rs_string_iov_fill(q, iov, RS__IOV_CALL);
+    if (m.msg_iovlen == 0) return 0;
+    do r = sendmsg(fd, &m, flags); while (r < 0 && errno == EINTR);
+    if (r > 0) rs_string_iov_consume(q, (size_t)r);
+    return (ptrdiff_t)r;
+}
+
+/* writev until the queue is empty: 0, or -1 with errno set and the rest still queued */
+static inline int rs_string_iov_flush(rs_string_iov* q, int fd) {
+    while (q->bytes)
+        if (rs_string_iov_writev(q, fd) < 0) return -1;
+    return 0;
+}
+#endif
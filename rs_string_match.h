@@ -0,0 +1,397 @@
+// MIT License
+//
+// Copyright (c) 2025 Raman Sharkovich
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// rs_string_match.h — multi-pattern search and replace (header-only)
+// Usage: rs_sv pats[] = { rs_sv_from_cstr("password="), rs_sv_from_cstr("token=") };
+//        rs_matcher m; rs_matcher_init(&m, pats, 2);
+//        size_t id, at = rs_string_find_any(&s, &m, 0, &id);
+//        rs_sv repl[] = { rs_sv_from_cstr("password=***"), rs_sv_from_cstr("token=***") };
+//        rs_string_replace_many(&s, &m, repl);   /* one pass for the whole set */
+//        rs_matcher_free(&m);
+// Matches are leftmost-longest (ties: the earlier pattern), non-overlapping for
+// replace_many. Up to RS_MATCH_TEDDY_MAX patterns are found with a Teddy-style nibble
+// prefilter (AVX2 at runtime, SSSE3 / AArch64 NEON at compile time, a byte table
+// otherwise) plus direct verification; larger sets compile to an Aho-Corasick DFA over
+// byte classes. A compiled matcher is never written again, so one can be shared by
+// any number of threads. Empty patterns never match.
+#pragma once
+#include "rs_string.h"
+
+#define RS_MATCH_TEDDY_MAX 8   /* one fingerprint bucket per pattern */
+
+enum { RS__MATCH_NONE, RS__MATCH_TEDDY, RS__MATCH_AC };
+
+typedef struct { size_t pos, len, id; } rs_match;
+
+typedef struct {
+    size_t    n;            /* patterns, ids 0 .. n-1 */
+    rs_sv*    pat;          /* owned copies, in one block with the bytes */
+    int       kind;
+
+    /* Teddy: bit k = pattern k fits the fingerprint at this position */
+    int       fp;           /* fingerprint bytes: 2 if every pattern has two, else 1 */
+    uint8_t   lo[2][16], hi[2][16];   /* nibble tables for each fingerprint byte */
+    uint8_t   tab[2][256];            /* the same as whole-byte tables (scalar path) */
+
+    /* Aho-Corasick over byte classes: every state has a full transition row */
+    uint8_t   cls[256];
+    uint32_t  ncls, nstates;
+    uint32_t* delta;        /* nstates * ncls */
+    uint32_t* depth;        /* length of the state's trie string */
+    uint32_t* blen;         /* longest pattern that is a suffix of it (0: none) */
+    uint32_t* bid;
+} rs_matcher;
+
+static inline void rs_matcher_free(rs_matcher* m) {
+    free(m->pat);
+    free(m->delta);
+    free(m->depth);
+    free(m->blen);
+    free(m->bid);
+    memset(m, 0, sizeof *m);
+}
+
+static inline rs_sv rs_matcher_pattern(const rs_matcher* m, size_t id) { return m->pat[id]; }
+
+static inline void rs__teddy_build(rs_matcher* m) {
+    m->fp = 2;
+    for (size_t k = 0; k < m->n; ++k)
+        if (m->pat[k].len == 1) m->fp = 1;
+
+    for (size_t k = 0; k < m->n; ++k) {
+        if (!m->pat[k].len) continue;
+        for (int j = 0; j < m->fp; ++j) {
+            uint8_t b = (uint8_t)m->pat[k].data[j], bit = (uint8_t)(1u << k);
+            m->lo[j][b & 15] |= bit;
+            m->hi[j][b >> 4] |= bit;
+        }
+    }
+    /* whole-byte tables, as the nibble tables see them (a superset of the exact pairs) */
+    for (int j = 0; j < m->fp; ++j)
+        for (int b = 0; b < 256; ++b)
+            m->tab[j][b] = m->lo[j][b & 15] & m->hi[j][b >> 4];
+}
+
+static inline int rs__ac_build(rs_matcher* m) {
+    size_t total = 1;
+    uint32_t ncls = 1;
+    bool seen[256] = { false };
+
+    /* class 0 is every byte no pattern uses; once 255 classes are taken no such byte is
+     * left, so the last one to appear gets class 0 to itself and ncls stops at 256 */
+    memset(m->cls, 0, sizeof m->cls);
+    for (size_t k = 0; k < m->n; ++k) {
+        total += m->pat[k].len;
+        for (size_t j = 0; j < m->pat[k].len; ++j) {
+            uint8_t b = (uint8_t)m->pat[k].data[j];
+            if (seen[b]) continue;
+            seen[b] = true;
+            if (ncls < 256) m->cls[b] = (uint8_t)ncls++;
+        }
+    }
+    if (total > UINT32_MAX / ncls) return -1;
+
+    m->ncls = ncls;
+    m->delta = (uint32_t*)malloc(total * ncls * sizeof(uint32_t));
+    m->depth = (uint32_t*)calloc(total, sizeof(uint32_t));
+    m->blen  = (uint32_t*)calloc(total, sizeof(uint32_t));
+    m->bid   = (uint32_t*)calloc(total, sizeof(uint32_t));
+    uint32_t* fail = (uint32_t*)calloc(total, sizeof(uint32_t));
+    if (!m->delta || !m->depth || !m->blen || !m->bid || !fail) { free(fail); return -1; }
+
+    const uint32_t none = UINT32_MAX;
+    for (size_t i = 0; i < total * ncls; ++i) m->delta[i] = none;
+
+    /* trie */
+    uint32_t ns = 1;
+    for (size_t k = 0; k < m->n; ++k) {
+        uint32_t s = 0;
+        for (size_t j = 0; j < m->pat[k].len; ++j) {
+            uint32_t* t = &m->delta[(size_t)s * ncls + m->cls[(uint8_t)m->pat[k].data[j]]];
+            if (*t == none) { m->depth[ns] = m->depth[s] + 1; *t = ns++; }
+            s = *t;
+        }
+        if (m->pat[k].len && !m->blen[s]) { m->blen[s] = (uint32_t)m->pat[k].len; m->bid[s] = (uint32_t)k; }
+    }
+
+    /* BFS: failure links fill in the missing transitions; outputs inherit along them */
+    uint32_t* queue = (uint32_t*)malloc(ns * sizeof(uint32_t));
+    if (!queue) { free(fail); return -1; }
+
+    size_t qh = 0, qt = 0;
+    for (uint32_t c = 0; c < ncls; ++c) {
+        uint32_t* t = &m->delta[c];
+        if (*t == none) *t = 0;
+        else { fail[*t] = 0; queue[qt++] = *t; }
+    }
+    while (qh < qt) {
+        uint32_t s = queue[qh++];
+        if (!m->blen[s]) { m->blen[s] = m->blen[fail[s]]; m->bid[s] = m->bid[fail[s]]; }
+
+        for (uint32_t c = 0; c < ncls; ++c) {
+            uint32_t* t = &m->delta[(size_t)s * ncls + c];
+            uint32_t f = m->delta[(size_t)fail[s] * ncls + c];
+            if (*t == none) *t = f;
+            else { fail[*t] = f; queue[qt++] = *t; }
+        }
+    }
+    free(queue);
+    free(fail);
+
+    m->nstates = ns;
+    uint32_t* d = (uint32_t*)realloc(m->delta, (size_t)ns * ncls * sizeof(uint32_t));
+    if (d) m->delta = d;
+    return 0;
+}
+
+/* Compile `n` patterns (copied; the inputs need not outlive the matcher). */
+static inline int rs_matcher_init(rs_matcher* m, const rs_sv* pats, size_t n) {
+    size_t bytes = 0;
+    memset(m, 0, sizeof *m);
+
+    for (size_t k = 0; k < n; ++k) {
+        if (pats[k].len > SIZE_MAX - bytes) return -1;
+        bytes += pats[k].len;
+    }
+    if (n > (SIZE_MAX - bytes) / sizeof(rs_sv)) return -1;
+
+    char* blk = (char*)malloc(n * sizeof(rs_sv) + bytes + 1);
+    if (!blk) return -1;
+
+    m->n = n;
+    m->pat = (rs_sv*)(void*)blk;
+    char* w = blk + n * sizeof(rs_sv);
+    bool any = false;
+    for (size_t k = 0; k < n; ++k) {
+        memcpy(w, pats[k].data, pats[k].len);
+        m->pat[k] = (rs_sv){ w, pats[k].len };
+        w += pats[k].len;
+        any |= pats[k].len != 0;
+    }
+
+    if (!any) {
+        m->kind = RS__MATCH_NONE;
+    } else if (n <= RS_MATCH_TEDDY_MAX) {
+        m->kind = RS__MATCH_TEDDY;
+        rs__teddy_build(m);
+    } else {
+        m->kind = RS__MATCH_AC;
+        if (rs__ac_build(m) != 0) { rs_matcher_free(m); return -1; }
+    }
+    return 0;
+}
+
+/* Longest pattern of `bits` that starts at h[p]; false if none verifies. */
+static inline bool rs__teddy_verify(const rs_matcher* m, const char* h, size_t n, size_t p, unsigned bits, rs_match* out) {
+    bool hit = false;
+
+    for (; bits; bits &= bits - 1) {
+        size_t k = rs__ctz32(bits);
+        rs_sv pt = m->pat[k];
+
+        if (pt.len <= n - p && (!hit || pt.len > out->len) && memcmp(h + p, pt.data, pt.len) == 0) {
+            *out = (rs_match){ p, pt.len, k };
+            hit = true;
+        }
+    }
+    return hit;
+}
+
+/* every candidate in the 16 lanes of `c` (nonzero = pattern bits), in order */
+static inline bool rs__teddy_lanes(const rs_matcher* m, const char* h, size_t n, size_t p, const uint8_t* c, uint32_t live, rs_match* out) {
+    for (; live; live &= live - 1) {
+        unsigned j = rs__ctz32(live);
+        if (rs__teddy_verify(m, h, n, p + j, c[j], out)) return true;
+    }
+    return false;
+}
+
+#ifdef RS__AVX2_DISPATCH
+__attribute__((target("avx2")))
+static inline size_t rs__teddy_avx2(const rs_matcher* m, const char* h, size_t n, size_t i, rs_match* out) {
+    const __m256i lo4 = _mm256_set1_epi8(0x0F);
+    const __m256i lo0 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)m->lo[0]));
+    const __m256i hi0 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)m->hi[0]));
+    const __m256i lo1 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)m->lo[1]));
+    const __m256i hi1 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)m->hi[1]));
+    uint8_t c[32];
+
+    for (; i + 33 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(h + i));
+        __m256i t = _mm256_and_si256(_mm256_shuffle_epi8(lo0, _mm256_and_si256(v, lo4)),
+                                     _mm256_shuffle_epi8(hi0, _mm256_and_si256(_mm256_srli_epi16(v, 4), lo4)));
+        if (m->fp == 2) {
+            __m256i w = _mm256_loadu_si256((const __m256i*)(h + i + 1));
+            t = _mm256_and_si256(t, _mm256_and_si256(_mm256_shuffle_epi8(lo1, _mm256_and_si256(w, lo4)),
+                                     _mm256_shuffle_epi8(hi1, _mm256_and_si256(_mm256_srli_epi16(w, 4), lo4))));
+        }
+        uint32_t live = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(t, _mm256_setzero_si256()));
+        if (live) {
+            _mm256_storeu_si256((__m256i*)c, t);
+            if (rs__teddy_lanes(m, h, n, i, c, live, out)) return (size_t) - 2;
+        }
+    }
+    return i;
+}
+#endif
+
+#if defined(RS__SSSE3)
+static inline size_t rs__teddy_simd(const rs_matcher* m, const char* h, size_t n, size_t i, rs_match* out) {
+    const __m128i lo4 = _mm_set1_epi8(0x0F);
+    const __m128i lo0 = _mm_loadu_si128((const __m128i*)m->lo[0]), hi0 = _mm_loadu_si128((const __m128i*)m->hi[0]);
+    const __m128i lo1 = _mm_loadu_si128((const __m128i*)m->lo[1]), hi1 = _mm_loadu_si128((const __m128i*)m->hi[1]);
+    uint8_t c[16];
+
+    for (; i + 17 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(h + i));
+        __m128i t = _mm_and_si128(_mm_shuffle_epi8(lo0, _mm_and_si128(v, lo4)),
+                                  _mm_shuffle_epi8(hi0, _mm_and_si128(_mm_srli_epi16(v, 4), lo4)));
+        if (m->fp == 2) {
+            __m128i w = _mm_loadu_si128((const __m128i*)(h + i + 1));
+            t = _mm_and_si128(t, _mm_and_si128(_mm_shuffle_epi8(lo1, _mm_and_si128(w, lo4)),
+                                  _mm_shuffle_epi8(hi1, _mm_and_si128(_mm_srli_epi16(w, 4), lo4))));
+        }
+        uint32_t live = ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(t, _mm_setzero_si128())) & 0xFFFFu;
+        if (live) {
+            _mm_storeu_si128((__m128i*)c, t);
+            if (rs__teddy_lanes(m, h, n, i, c, live, out)) return (size_t) - 2;
+        }
+    }
+    return i;
+}
+#elif defined(RS__NEON64)
+static inline size_t rs__teddy_simd(const rs_matcher* m, const char* h, size_t n, size_t i, rs_match* out) {
+    const uint8x16_t lo4 = vdupq_n_u8(0x0F);
+    const uint8x16_t lo0 = vld1q_u8(m->lo[0]), hi0 = vld1q_u8(m->hi[0]);
+    const uint8x16_t lo1 = vld1q_u8(m->lo[1]), hi1 = vld1q_u8(m->hi[1]);
+    uint8_t c[16];
+
+    for (; i + 17 <= n; i += 16) {
+        uint8x16_t v = vld1q_u8((const uint8_t*)h + i);
+        uint8x16_t t = vandq_u8(vqtbl1q_u8(lo0, vandq_u8(v, lo4)), vqtbl1q_u8(hi0, vshrq_n_u8(v, 4)));
+        if (m->fp == 2) {
+            uint8x16_t w = vld1q_u8((const uint8_t*)h + i + 1);
+            t = vandq_u8(t, vandq_u8(vqtbl1q_u8(lo1, vandq_u8(w, lo4)), vqtbl1q_u8(hi1, vshrq_n_u8(w, 4))));
+        }
+        if (vmaxvq_u8(t)) {
+            uint32_t live = 0;
+            vst1q_u8(c, t);
+            for (unsigned j = 0; j < 16; ++j) live |= (uint32_t)(c[j] != 0) << j;
+            if (rs__teddy_lanes(m, h, n, i, c, live, out)) return (size_t) - 2;
+        }
+    }
+    return i;
+}
+#endif
+
+static inline bool rs__teddy_find(const rs_matcher* m, rs_sv hay, size_t i, rs_match* out) {
+    const char* h = hay.data;
+    size_t n = hay.len;
+
+#ifdef RS__AVX2_DISPATCH
+    if (rs__cpu_has_avx2() && (i = rs__teddy_avx2(m, h, n, i, out)) == (size_t) - 2) return true;
+#endif
+#if defined(RS__SSSE3) || defined(RS__NEON64)
+    if ((i = rs__teddy_simd(m, h, n, i, out)) == (size_t) - 2) return true;
+#endif
+
+    for (; i < n; ++i) {
+        unsigned bits = m->tab[0][(uint8_t)h[i]];
+        if (bits && m->fp == 2) bits = i + 1 < n ? bits & m->tab[1][(uint8_t)h[i + 1]] : 0;
+        if (bits && rs__teddy_verify(m, h, n, i, bits, out)) return true;
+    }
+    return false;
+}
+
+static inline bool rs__ac_find(const rs_matcher* m, rs_sv hay, size_t i, rs_match* out) {
+    const uint8_t* h = (const uint8_t*)hay.data;
+    const size_t npos = (size_t) - 1;
+    size_t best = npos, blen = 0, bid = 0;
+    uint32_t s = 0;
+
+    for (; i < hay.len; ++i) {
+        s = m->delta[(size_t)s * m->ncls + m->cls[h[i]]];
+
+        if (m->blen[s]) {
+            size_t st = i + 1 - m->blen[s];
+            if (st < best || (st == best && m->blen[s] > blen)) { best = st; blen = m->blen[s]; bid = m->bid[s]; }
+        }
+        /* nothing still alive can start at or before the best match: it is final */
+        if (best != npos && i + 1 - m->depth[s] > best) break;
+    }
+
+    if (best == npos) return false;
+    *out = (rs_match){ best, blen, bid };
+    return true;
+}
+
+/* Leftmost-longest match starting at or after `from`. */
+static inline bool rs_matcher_find(const rs_matcher* m, rs_sv hay, size_t from, rs_match* out) {
+    if (from >= hay.len) return false;
+
+    switch (m->kind) {
+    case RS__MATCH_TEDDY: return rs__teddy_find(m, hay, from, out);
+    case RS__MATCH_AC:    return rs__ac_find(m, hay, from, out);
+    default:              return false;
+    }
+}
+
+/* Position of the first match at or after `from` ((size_t)-1 if none); its pattern id
+ * goes to *id if non-NULL. */
+static inline size_t rs_string_find_any(const rs_string* s, const rs_matcher* m, size_t from, size_t* id) {
+    rs_match mt;
+
+    RS__STAT(finds, 1);
+    if (!rs_matcher_find(m, rs_string_sv(s), from, &mt)) return (size_t) - 1;
+    if (id) *id = mt.id;
+    return mt.pos;
+}
+
+/* Replace every match of pattern k with repl[k], in a single pass over the text.
+ * Returns the number of replacements, or -1 on allocation failure. */
+static inline int rs_string_replace_many(rs_string* s, const rs_matcher* m, const rs_sv* repl) {
+    rs_sv hay = rs_string_sv(s);
+    rs_match mt;
+    size_t r = 0;
+    int count = 0;
+
+    RS__STAT(replaces, 1);
+    if (!rs_matcher_find(m, hay, 0, &mt)) return 0;
+
+    rs_string out;
+    rs_string_init(&out);
+    if (rs__reserve(&out, hay.len, rs__alloc_of(s)) != 0) return -1;
+
+    do {
+        rs_sv parts[2] = { { hay.data + r, mt.pos - r }, repl[mt.id] };
+        if (rs_string_append_many(&out, parts, 2) != 0) { rs_string_free(&out); return -1; }
+        r = mt.pos + mt.len;
+        ++count;
+    } while (rs_matcher_find(m, hay, r, &mt));
+
+    if (rs_string_append(&out, (rs_sv){ hay.data + r, hay.len - r }) != 0) { rs_string_free(&out); return -1; }
+
+    rs_string_free(s);
+    *s = out;
+    return count;
+}
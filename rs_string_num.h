@@ -0,0 +1,369 @@
+// MIT License
+//
+// Copyright (c) 2025 Raman Sharkovich
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// rs_string_num.h — locale-free integer / double formatting for rs_string (header-only)
+// Usage: rs_string_append_i64(&s, -42); rs_string_append_f64(&s, 0.1);   /* "-420.1" */
+// Doubles come out as the shortest digits that parse back to the same value (Ryu,
+// Ulf Adams, PLDI 2018, small-table variant), laid out like JavaScript's
+// Number.prototype.toString: 1e+21, 123.5, 0.000001, 1e-7; plus "nan", "inf", "-0".
+#pragma once
+#include "rs_string.h"
+
+#define RS_NUM_BUF 32 /* rs_fmt_* output buffers: enough for any u64 / i64 / f64 */
+
+static const char rs__digits2[200] = {
+    '0','0','0','1','0','2','0','3','0','4','0','5','0','6','0','7','0','8','0','9',
+    '1','0','1','1','1','2','1','3','1','4','1','5','1','6','1','7','1','8','1','9',
+    '2','0','2','1','2','2','2','3','2','4','2','5','2','6','2','7','2','8','2','9',
+    '3','0','3','1','3','2','3','3','3','4','3','5','3','6','3','7','3','8','3','9',
+    '4','0','4','1','4','2','4','3','4','4','4','5','4','6','4','7','4','8','4','9',
+    '5','0','5','1','5','2','5','3','5','4','5','5','5','6','5','7','5','8','5','9',
+    '6','0','6','1','6','2','6','3','6','4','6','5','6','6','6','7','6','8','6','9',
+    '7','0','7','1','7','2','7','3','7','4','7','5','7','6','7','7','7','8','7','9',
+    '8','0','8','1','8','2','8','3','8','4','8','5','8','6','8','7','8','8','8','9',
+    '9','0','9','1','9','2','9','3','9','4','9','5','9','6','9','7','9','8','9','9'
+};
+
+/* writes v backwards ending at `end`, two digits per step; returns the first digit */
+static inline char* rs__fmt_u64_rev(uint64_t v, char* end) {
+    while (v >= 100) {
+        unsigned d = (unsigned)(v % 100);
+        v /= 100;
+        end -= 2;
+        memcpy(end, rs__digits2 + 2 * d, 2);
+    }
+    if (v >= 10) {
+        end -= 2;
+        memcpy(end, rs__digits2 + 2 * v, 2);
+    } else {
+        *--end = (char)('0' + v);
+    }
+    return end;
+}
+
+static inline size_t rs_fmt_u64(uint64_t v, char* buf) {
+    char tmp[RS_NUM_BUF];
+    char* p = rs__fmt_u64_rev(v, tmp + sizeof tmp);
+    size_t n = (size_t)(tmp + sizeof tmp - p);
+    memcpy(buf, p, n);
+    return n;
+}
+
+static inline size_t rs_fmt_i64(int64_t v, char* buf) {
+    if (v >= 0) return rs_fmt_u64((uint64_t)v, buf);
+    buf[0] = '-';
+    return 1 + rs_fmt_u64(0 - (uint64_t)v, buf + 1);
+}
+
+/* --- Ryu: binary64 -> shortest (mantissa, exponent) --- */
+typedef struct { uint64_t lo, hi; } rs__u128;
+
+static inline rs__u128 rs__mul128(uint64_t a, uint64_t b) { rs__mum(&a, &b); return (rs__u128){ a, b }; }
+static inline rs__u128 rs__add128(rs__u128 a, rs__u128 b) {
+    rs__u128 r = { a.lo + b.lo, a.hi + b.hi };
+    r.hi += r.lo < a.lo;
+    return r;
+}
+static inline rs__u128 rs__shr128(rs__u128 a, unsigned d) { /* 0 < d < 64 */
+    return (rs__u128){ (a.lo >> d) | (a.hi << (64 - d)), a.hi >> d };
+}
+static inline rs__u128 rs__shl128(rs__u128 a, unsigned d) { /* 0 < d < 64 */
+    return (rs__u128){ a.lo << d, (a.hi << d) | (a.lo >> (64 - d)) };
+}
+
+static const uint64_t rs__ryu_pow5_table[26] = {
+    1ull, 5ull, 25ull, 125ull,
+    625ull, 3125ull, 15625ull, 78125ull,
+    390625ull, 1953125ull, 9765625ull, 48828125ull,
+    244140625ull, 1220703125ull, 6103515625ull, 30517578125ull,
+    152587890625ull, 762939453125ull, 3814697265625ull, 19073486328125ull,
+    95367431640625ull, 476837158203125ull, 2384185791015625ull, 11920928955078125ull,
+    59604644775390625ull, 298023223876953125ull
+};
+static const uint64_t rs__ryu_pow5_split2[13][2] = {
+    { 0x0000000000000000ull, 0x1000000000000000ull },
+    { 0x0000000000000000ull, 0x14adf4b7320334b9ull },
+    { 0x0e549208b31adb10ull, 0x1aba4714957d300dull },
+    { 0x6dc6ad264d8f0866ull, 0x1145b7e285bf98f5ull },
+    { 0xeb1dbd923d8596caull, 0x1652efdc6018a1fcull },
+    { 0xb4c1b80b22ae923cull, 0x1cda62055b2d9d83ull },
+    { 0x5bb28b4e8f7e4c30ull, 0x12a5568b9f52f416ull },
+    { 0xf08aed437682d4fbull, 0x1819651531f9e78full },
+    { 0xb4ee134ad99bf150ull, 0x1f25c186a6f04c28ull },
+    { 0x16499ecb70c25f03ull, 0x1420eb449c8842e6ull },
+    { 0x85a56ead360865b0ull, 0x1a03fde214caf085ull },
+    { 0x093db1d57999890bull, 0x10cfeb353a97dad8ull },
+    { 0xcf38bb735e3f36acull, 0x15baaf44fa52673eull }
+};
+static const uint32_t rs__ryu_pow5_offsets[21] = {
+    0x00000000u, 0x00000000u, 0x00000000u, 0x00000000u, 0x40000000u, 0x59695995u,
+    0x55545555u, 0x56555515u, 0x41150504u, 0x40555410u, 0x44555145u, 0x44504540u,
+    0x45555550u, 0x40004000u, 0x96440440u, 0x55565565u, 0x54454045u, 0x40154151u,
+    0x55559155u, 0x51405555u, 0x00000105u
+};
+static const uint64_t rs__ryu_pow5_inv_split2[15][2] = {
+    { 0x0000000000000001ull, 0x2000000000000000ull },
+    { 0x52a6c95fc0655034ull, 0x18c240c4aecb13bbull },
+    { 0x7ca8d50071dfc806ull, 0x1327fc58da0f6ff5ull },
+    { 0x6520247d3556476eull, 0x1da48ce468e7c702ull },
+    { 0x6139cdd76802e6e9ull, 0x16ef5b40c2fc7779ull },
+    { 0xf951a7ff43de8c79ull, 0x11bebdf578b2f391ull },
+    { 0x7be8bee8d6e957e8ull, 0x1b758d848fac54b0ull },
+    { 0x8bd3f9e999a423eaull, 0x153eda614071a3b7ull },
+    { 0x0848f973cb3ee3ceull, 0x10701bd527b4978cull },
+    { 0x153285ebb9efbfa2ull, 0x196fbb9bb44db44dull },
+    { 0xadeee7f86c07b696ull, 0x13ae3591f5b4d936ull },
+    { 0x4d686a4eaf182222ull, 0x1e74404f3daada91ull },
+    { 0x98c0a106e09ebd9full, 0x17900ea4fda7c257ull },
+    { 0x8f20e37371497d0eull, 0x123b140576d820b2ull },
+    { 0xb043138134743d85ull, 0x1c35f4275f7a29adull }
+};
+static const uint32_t rs__ryu_pow5_inv_offsets[22] = {
+    0x54544554u, 0x04055545u, 0x10041000u, 0x00400414u, 0x40010000u, 0x41155555u,
+    0x00000454u, 0x00010044u, 0x40000000u, 0x44000041u, 0x50454450u, 0x55550054u,
+    0x51655554u, 0x40004000u, 0x01000001u, 0x00010500u, 0x51515411u, 0x05555554u,
+    0x50411500u, 0x40040000u, 0x05040110u, 0x00000000u
+};
+
+static inline uint32_t rs__pow5bits(int32_t e)  { return (uint32_t)(((uint32_t)e * 1217359) >> 19) + 1; }
+static inline uint32_t rs__log10pow2(int32_t e) { return ((uint32_t)e * 78913) >> 18; }
+static inline uint32_t rs__log10pow5(int32_t e) { return ((uint32_t)e * 732923) >> 20; }
+
+/* 5^i and 2^k / 5^i as 125-bit fixed point, rebuilt from every 26th power plus a
+ * 2-bit correction (the full tables would be 10 KiB) */
+static inline rs__u128 rs__ryu_pow5(uint32_t i) {
+    uint32_t base = i / 26, base2 = base * 26, off = i - base2;
+    const uint64_t* mul = rs__ryu_pow5_split2[base];
+
+    if (off == 0) return (rs__u128){ mul[0], mul[1] };
+
+    uint64_t m = rs__ryu_pow5_table[off];
+    unsigned d = rs__pow5bits((int32_t)i) - rs__pow5bits((int32_t)base2);
+    rs__u128 b0 = rs__mul128(m, mul[0]), b2 = rs__mul128(m, mul[1]);
+    rs__u128 r = rs__add128(rs__shr128(b0, d), rs__shl128(b2, 64 - d));
+
+    return rs__add128(r, (rs__u128){ (rs__ryu_pow5_offsets[i / 16] >> ((i % 16) << 1)) & 3, 0 });
+}
+
+static inline rs__u128 rs__ryu_inv_pow5(uint32_t i) {
+    uint32_t base = (i + 25) / 26, base2 = base * 26, off = base2 - i;
+    const uint64_t* mul = rs__ryu_pow5_inv_split2[base];
+
+    if (off == 0) return (rs__u128){ mul[0], mul[1] };
+
+    uint64_t m = rs__ryu_pow5_table[off];
+    unsigned d = rs__pow5bits((int32_t)base2) - rs__pow5bits((int32_t)i);
+    rs__u128 b0 = rs__mul128(m, mul[0] - 1), b2 = rs__mul128(m, mul[1]);
+    rs__u128 r = rs__add128(rs__shr128(b0, d), rs__shl128(b2, 64 - d));
+
+    return rs__add128(r, (rs__u128){ 1 + ((rs__ryu_pow5_inv_offsets[i / 16] >> ((i % 16) << 1)) & 3), 0 });
+}
+
+/* (m * mul) >> j, with 64 <= j < 128 */
+static inline uint64_t rs__ryu_mulshift(uint64_t m, rs__u128 mul, int32_t j) {
+    rs__u128 b0 = rs__mul128(m, mul.lo), b2 = rs__mul128(m, mul.hi);
+    rs__u128 s = rs__add128(b2, (rs__u128){ b0.hi, 0 });
+    unsigned d = (unsigned)(j - 64);
+    return d ? rs__shr128(s, d).lo : s.lo;
+}
+
+static inline uint32_t rs__pow5_factor(uint64_t v) {
+    uint32_t n = 0;
+    while (v % 5 == 0) { v /= 5; ++n; }
+    return n;
+}
+
+static inline void rs__ryu_d2d(uint64_t ieee_m, uint32_t ieee_e, uint64_t* out_m, int32_t* out_e) {
+    int32_t e2;
+    uint64_t m2;
+
+    if (ieee_e == 0) {
+        e2 = 1 - 1023 - 52 - 2;
+        m2 = ieee_m;
+    } else {
+        e2 = (int32_t)ieee_e - 1023 - 52 - 2;
+        m2 = ((uint64_t)1 << 52) | ieee_m;
+    }
+
+    const bool accept_bounds = (m2 & 1) == 0;
+    const uint64_t mv = 4 * m2;
+    const uint32_t mm_shift = ieee_m != 0 || ieee_e <= 1;
+    uint64_t vr, vp, vm;
+    int32_t e10;
+    bool vm_zeros = false, vr_zeros = false;
+
+    /* the shortest interval [vm, vp] around vr, scaled to a power of ten */
+    if (e2 >= 0) {
+        const uint32_t q = rs__log10pow2(e2) - (e2 > 3);
+        const int32_t k = 125 + (int32_t)rs__pow5bits((int32_t)q) - 1;
+        const int32_t i = -e2 + (int32_t)q + k;
+        rs__u128 mul = rs__ryu_inv_pow5(q);
+
+        e10 = (int32_t)q;
+        vr = rs__ryu_mulshift(4 * m2, mul, i);
+        vp = rs__ryu_mulshift(4 * m2 + 2, mul, i);
+        vm = rs__ryu_mulshift(4 * m2 - 1 - mm_shift, mul, i);
+
+        if (q <= 21) {
+            if (mv % 5 == 0)        vr_zeros = rs__pow5_factor(mv) >= q;
+            else if (accept_bounds) vm_zeros = rs__pow5_factor(mv - 1 - mm_shift) >= q;
+            else                    vp -= rs__pow5_factor(mv + 2) >= q;
+        }
+    } else {
+        const uint32_t q = rs__log10pow5(-e2) - (-e2 > 1);
+        const int32_t i = -e2 - (int32_t)q;
+        const int32_t k = (int32_t)rs__pow5bits(i) - 125;
+        const int32_t j = (int32_t)q - k;
+        rs__u128 mul = rs__ryu_pow5((uint32_t)i);
+
+        e10 = (int32_t)q + e2;
+        vr = rs__ryu_mulshift(4 * m2, mul, j);
+        vp = rs__ryu_mulshift(4 * m2 + 2, mul, j);
+        vm = rs__ryu_mulshift(4 * m2 - 1 - mm_shift, mul, j);
+
+        if (q <= 1) {
+            vr_zeros = true;
+            if (accept_bounds) vm_zeros = mm_shift == 1;
+            else               --vp;
+        } else if (q < 63) {
+            vr_zeros = (mv & (((uint64_t)1 << q) - 1)) == 0;
+        }
+    }
+
+    /* drop digits while the interval still holds a shorter number */
+    int32_t removed = 0;
+    uint64_t output;
+
+    if (vm_zeros || vr_zeros) {
+        unsigned last = 0;
+
+        while (vp / 10 > vm / 10) {
+            vm_zeros &= vm % 10 == 0;
+            vr_zeros &= last == 0;
+            last = (unsigned)(vr % 10);
+            vr /= 10; vp /= 10; vm /= 10;
+            ++removed;
+        }
+        if (vm_zeros) {
+            while (vm % 10 == 0) {
+                vr_zeros &= last == 0;
+                last = (unsigned)(vr % 10);
+                vr /= 10; vp /= 10; vm /= 10;
+                ++removed;
+            }
+        }
+        if (vr_zeros && last == 5 && vr % 2 == 0)
+            last = 4; /* exactly halfway: round to even */
+
+        output = vr + ((vr == vm && (!accept_bounds || !vm_zeros)) || last >= 5);
+    } else {
+        bool round_up = false;
+
+        if (vp / 100 > vm / 100) {
+            round_up = vr % 100 >= 50;
+            vr /= 100; vp /= 100; vm /= 100;
+            removed += 2;
+        }
+        while (vp / 10 > vm / 10) {
+            round_up = vr % 10 >= 5;
+            vr /= 10; vp /= 10; vm /= 10;
+            ++removed;
+        }
+
+        output = vr + (vr == vm || round_up);
+    }
+
+    *out_m = output;
+    *out_e = e10 + removed;
+}
+
+static inline size_t rs_fmt_f64(double v, char* buf) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof bits);
+
+    const bool sign = (bits >> 63) != 0;
+    const uint64_t ieee_m = bits & (((uint64_t)1 << 52) - 1);
+    const uint32_t ieee_e = (uint32_t)((bits >> 52) & 0x7FF);
+    char* o = buf;
+
+    if (ieee_e == 0x7FF) {
+        if (ieee_m) { memcpy(buf, "nan", 3); return 3; }
+        if (sign) *o++ = '-';
+        memcpy(o, "inf", 3);
+        return (size_t)(o - buf) + 3;
+    }
+
+    if (sign) *o++ = '-';
+    if (ieee_e == 0 && ieee_m == 0) {
+        *o++ = '0';
+        return (size_t)(o - buf);
+    }
+
+    uint64_t m;
+    int32_t e;
+    char digits[RS_NUM_BUF];
+    rs__ryu_d2d(ieee_m, ieee_e, &m, &e);
+
+    char* d = rs__fmt_u64_rev(m, digits + sizeof digits);
+    int32_t k = (int32_t)(digits + sizeof digits - d);
+    int32_t n = k + e; /* value = 0.d1..dk * 10^n */
+
+    if (k <= n && n <= 21) {            /* integer */
+        memcpy(o, d, (size_t)k); o += k;
+        memset(o, '0', (size_t)(n - k)); o += n - k;
+    } else if (0 < n && n <= 21) {      /* 123.45 */
+        memcpy(o, d, (size_t)n); o += n;
+        *o++ = '.';
+        memcpy(o, d + n, (size_t)(k - n)); o += k - n;
+    } else if (-6 < n && n <= 0) {      /* 0.00012 */
+        *o++ = '0'; *o++ = '.';
+        memset(o, '0', (size_t)-n); o += -n;
+        memcpy(o, d, (size_t)k); o += k;
+    } else {                            /* 1.2e+34 */
+        int32_t x = n - 1;
+        *o++ = d[0];
+        if (k > 1) {
+            *o++ = '.';
+            memcpy(o, d + 1, (size_t)(k - 1)); o += k - 1;
+        }
+        *o++ = 'e';
+        *o++ = x < 0 ? '-' : '+';
+        o += rs_fmt_u64((uint64_t)(x < 0 ? -x : x), o);
+    }
+
+    return (size_t)(o - buf);
+}
+
+// Append
+static inline int rs_string_append_u64(rs_string* s, uint64_t v) {
+    char buf[RS_NUM_BUF];
+    return rs_string_append(s, (rs_sv){ buf, rs_fmt_u64(v, buf) });
+}
+static inline int rs_string_append_i64(rs_string* s, int64_t v) {
+    char buf[RS_NUM_BUF];
+    return rs_string_append(s, (rs_sv){ buf, rs_fmt_i64(v, buf) });
+}
+static inline int rs_string_append_f64(rs_string* s, double v) {
+    char buf[RS_NUM_BUF];
+    return rs_string_append(s, (rs_sv){ buf, rs_fmt_f64(v, buf) });
+}
@@ -0,0 +1,364 @@
+// MIT License
+//
+// Copyright (c) 2025 Raman Sharkovich
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// rs_string_par.h — multi-threaded bulk search / replace for large strings (header-only)
+// Usage: size_t* at; size_t n;
+//        rs_string_find_all(&blob, rs_sv_from_cstr("ERROR"), (rs_alloc){0}, &at, &n);
+//        size_t k = rs_string_count(&blob, needle);
+//        rs_string_replace_all_par(&blob, from, to);
+// Inputs below RS_PAR_THRESHOLD take the serial path. Larger ones are cut into chunks
+// (each scanned a needle length past its end), searched on a small pool of worker
+// threads, and stitched back into the exact left-to-right, non-overlapping match
+// sequence of the serial functions. Every translation unit that includes this header
+// gets its own pool, started on first use.
+#pragma once
+#include <threads.h>
+#include <stdatomic.h>
+#include "rs_string.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <unistd.h>
+#endif
+
+#ifndef RS_PAR_THRESHOLD
+#define RS_PAR_THRESHOLD (1u << 20)     /* bytes */
+#endif
+#ifndef RS_PAR_CHUNK_MIN
+#define RS_PAR_CHUNK_MIN (256u * 1024)
+#endif
+#ifndef RS_PAR_THREADS
+#define RS_PAR_THREADS 0                /* 0: one per online CPU */
+#endif
+#define RS__PAR_MAX_THREADS 64
+
+// Thread pool
+typedef struct {
+    void (*fn)(void* arg, size_t i);
+    void*          arg;
+    size_t         n;
+    _Atomic size_t next;
+} rs__par_job;
+
+typedef struct {
+    mtx_t         m;
+    mtx_t         run;       /* one job at a time; a busy pool makes callers go serial */
+    cnd_t         go, done;
+    unsigned      nthreads;  /* workers; the caller always helps */
+    unsigned long gen;
+    unsigned      active;    /* workers inside the current job */
+    rs__par_job*  job;
+} rs__par_pool;
+
+static rs__par_pool rs__par_g;
+static once_flag    rs__par_once = ONCE_FLAG_INIT;
+
+static inline void rs__par_drain(rs__par_job* j) {
+    for (size_t i; (i = atomic_fetch_add_explicit(&j->next, 1, memory_order_relaxed)) < j->n; )
+        j->fn(j->arg, i);
+}
+
+static inline int rs__par_worker(void* unused) {
+    (void)unused;
+    rs__par_pool* g = &rs__par_g;
+    unsigned long seen = 0;
+
+    mtx_lock(&g->m);
+    for (;;) {
+        while (g->gen == seen) cnd_wait(&g->go, &g->m);
+        seen = g->gen;
+
+        rs__par_job* j = g->job;
+        if (!j) continue;  /* woke up after the job was over */
+
+        ++g->active;
+        mtx_unlock(&g->m);
+        rs__par_drain(j);
+        mtx_lock(&g->m);
+        if (--g->active == 0) cnd_signal(&g->done);
+    }
+    return 0;
+}
+
+static inline unsigned rs__par_cpus(void) {
+#if RS_PAR_THREADS > 0
+    return RS_PAR_THREADS;
+#elif defined(_SC_NPROCESSORS_ONLN)
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (unsigned)n : 1;
+#else
+    return 4;
+#endif
+}
+
+static inline void rs__par_start(void) {
+    rs__par_pool* g = &rs__par_g;
+    unsigned want = rs__par_cpus() - 1;
+
+    if (want > RS__PAR_MAX_THREADS - 1) want = RS__PAR_MAX_THREADS - 1;
+    g->nthreads = 0;
+    if (mtx_init(&g->m, mtx_plain) != thrd_success || mtx_init(&g->run, mtx_plain) != thrd_success
+        || cnd_init(&g->go) != thrd_success || cnd_init(&g->done) != thrd_success)
+        return;
+
+    for (unsigned i = 0; i < want; ++i) {
+        thrd_t t;
+        if (thrd_create(&t, rs__par_worker, NULL) != thrd_success) break;
+        thrd_detach(t);
+        ++g->nthreads;
+    }
+}
+
+/* number of threads a job can run on (the caller included) */
+static inline unsigned rs__par_width(void) {
+    call_once(&rs__par_once, rs__par_start);
+    return rs__par_g.nthreads + 1;
+}
+
+/* fn(arg, i) for every i < n, spread over the pool; returns when all are done */
+static inline void rs__par_for(size_t n, void (*fn)(void*, size_t), void* arg) {
+    rs__par_pool* g = &rs__par_g;
+    rs__par_job j = { fn, arg, n, 0 };
+
+    if (n < 2 || rs__par_width() == 1 || mtx_trylock(&g->run) != thrd_success) {
+        for (size_t i = 0; i < n; ++i) fn(arg, i);
+        return;
+    }
+
+    mtx_lock(&g->m);
+    g->job = &j;
+    ++g->gen;
+    cnd_broadcast(&g->go);
+    mtx_unlock(&g->m);
+
+    rs__par_drain(&j);
+
+    mtx_lock(&g->m);
+    while (g->active) cnd_wait(&g->done, &g->m);
+    g->job = NULL;
+    mtx_unlock(&g->m);
+    mtx_unlock(&g->run);
+}
+
+// Chunked search
+typedef struct { size_t* pos; size_t n, cap; } rs__par_hits;
+
+static inline int rs__par_push(rs__par_hits* h, size_t p, rs_alloc a) {
+    if (h->n == h->cap) {
+        size_t ncap = h->cap ? h->cap * 2 : 64;
+        size_t* np = h->pos ? (size_t*)rs__realloc(&a, h->pos, h->cap * sizeof(size_t), ncap * sizeof(size_t))
+                            : (size_t*)a.m(ncap * sizeof(size_t), a.ctx);
+        if (!np) return -1;
+        h->pos = np; h->cap = ncap;
+    }
+    h->pos[h->n++] = p;
+    return 0;
+}
+
+static inline void rs__par_hits_free(rs__par_hits* h, rs_alloc a) {
+    if (h->pos && a.f) a.f(h->pos, a.ctx);
+    h->pos = NULL; h->n = h->cap = 0;
+}
+
+typedef struct {
+    rs_finder     f;
+    rs_sv         hay;
+    size_t        chunk, nchunks;
+    rs__par_hits* hits;      /* nchunks lists */
+    _Atomic bool  failed;
+} rs__par_scan;
+
+static inline size_t rs__par_lo(const rs__par_scan* sc, size_t i) { return i * sc->chunk; }
+static inline size_t rs__par_hi(const rs__par_scan* sc, size_t i) {
+    return i + 1 == sc->nchunks ? sc->hay.len : (i + 1) * sc->chunk;
+}
+
+/* greedy matches starting in chunk i, as if the scan had started at its first byte */
+static inline void rs__par_scan_chunk(void* arg, size_t i) {
+    rs__par_scan* sc = (rs__par_scan*)arg;
+    size_t m = sc->f.needle.len, lo = rs__par_lo(sc, i), hi = rs__par_hi(sc, i);
+    size_t end = hi + m - 1 < sc->hay.len ? hi + m - 1 : sc->hay.len;
+    rs_sv win = { sc->hay.data, end };
+
+    for (size_t p = rs_finder_find(&sc->f, win, lo); p != (size_t) - 1 && p < hi; p = rs_finder_find(&sc->f, win, p + m))
+        if (rs__par_push(&sc->hits[i], p, rs_default_alloc()) != 0) {
+            atomic_store_explicit(&sc->failed, true, memory_order_relaxed);
+            return;
+        }
+}
+
+/* All match offsets, in order, stitched from the chunk lists. A chunk's own sequence is
+ * only wrong where the previous accepted match runs into it: rescan from that match's
+ * end until the rescan lands on one of the chunk's matches, from where both agree. */
+static inline int rs__par_find(rs_sv hay, rs_sv needle, rs_alloc a, rs__par_hits* out) {
+    rs__par_scan sc;
+    size_t width = hay.len < RS_PAR_THRESHOLD ? 1 : rs__par_width();
+    size_t n = width == 1 ? 1 : hay.len / RS_PAR_CHUNK_MIN;
+    int r = 0;
+
+    if (n > width * 4) n = width * 4;
+    if (n == 0) n = 1;
+
+    rs_finder_init(&sc.f, needle);
+    sc.hay = hay;
+    sc.nchunks = n;
+    sc.chunk = hay.len / n;
+    atomic_init(&sc.failed, false);
+    *out = (rs__par_hits){ NULL, 0, 0 };
+
+    if (needle.len == 0) return 0;
+    if (!(sc.hits = (rs__par_hits*)calloc(n, sizeof(rs__par_hits)))) return -1;
+
+    rs__par_for(n, rs__par_scan_chunk, &sc);
+    if (atomic_load(&sc.failed)) r = -1;
+
+    size_t m = needle.len, prev_end = 0;
+    for (size_t i = 0; i < n && r == 0; ++i) {
+        rs__par_hits* h = &sc.hits[i];
+        size_t lo = rs__par_lo(&sc, i), hi = rs__par_hi(&sc, i), k = 0;
+
+        if (prev_end > lo) {
+            size_t p = rs_finder_find(&sc.f, hay, prev_end);
+            for (; p != (size_t) - 1 && p < hi; p = rs_finder_find(&sc.f, hay, prev_end)) {
+                while (k < h->n && h->pos[k] < p) ++k;
+                if (k < h->n && h->pos[k] == p) break;
+                if (rs__par_push(out, p, a) != 0) { r = -1; break; }
+                prev_end = p + m;
+            }
+            if (p == (size_t) - 1 || p >= hi) k = h->n;
+        }
+
+        for (; k < h->n && r == 0; ++k) {
+            if (rs__par_push(out, h->pos[k], a) != 0) r = -1;
+            prev_end = h->pos[k] + m;
+        }
+    }
+
+    for (size_t i = 0; i < n; ++i) rs__par_hits_free(&sc.hits[i], rs_default_alloc());
+    free(sc.hits);
+    if (r != 0) rs__par_hits_free(out, a);
+
+    return r;
+}
+
+/* Offsets of every non-overlapping match, left to right, in an array from `a` (zeroed:
+ * malloc) that the caller frees. *n = 0 and *out = NULL when there are none. */
+static inline int rs_string_find_all(const rs_string* s, rs_sv needle, rs_alloc a, size_t** out, size_t* n) {
+    rs__par_hits h;
+    RS__STAT(finds, 1);
+    a = rs__alloc_or_default(a);
+
+    if (rs__par_find(rs_string_sv(s), needle, a, &h) != 0) return -1;
+
+    *out = h.pos;
+    *n = h.n;
+    return 0;
+}
+
+/* Number of non-overlapping matches, (size_t)-1 on allocation failure. */
+static inline size_t rs_string_count(const rs_string* s, rs_sv needle) {
+    rs__par_hits h;
+    RS__STAT(finds, 1);
+    rs_alloc a = rs_default_alloc();
+
+    if (rs__par_find(rs_string_sv(s), needle, a, &h) != 0) return (size_t) - 1;
+
+    size_t n = h.n;
+    rs__par_hits_free(&h, a);
+    return n;
+}
+
+// Parallel replace
+typedef struct {
+    const rs__par_hits* m;
+    const char*         src;
+    char*               dst;
+    rs_sv               from, to;
+    size_t              len, chunk, nchunks;
+} rs__par_scatter;
+
+/* Copy input bytes [lo, hi) to their final place: output offset = input offset plus
+ * (to - from) for every match before it, so chunks never need to talk to each other. */
+static inline void rs__par_scatter_chunk(void* arg, size_t i) {
+    rs__par_scatter* sc = (rs__par_scatter*)arg;
+    const size_t* M = sc->m->pos;
+    size_t cnt = sc->m->n, fl = sc->from.len, tl = sc->to.len;
+    size_t lo = i * sc->chunk, hi = i + 1 == sc->nchunks ? sc->len : (i + 1) * sc->chunk;
+
+    size_t j = 0, top = cnt;      /* first match at or after lo */
+    while (j < top) {
+        size_t mid = j + (top - j) / 2;
+        if (M[mid] < lo) j = mid + 1; else top = mid;
+    }
+
+    size_t r = lo;
+    if (j && M[j - 1] + fl > lo) r = M[j - 1] + fl;  /* lo is inside the previous match */
+
+    for (; j < cnt && M[j] < hi; ++j) {
+        memcpy(sc->dst + r - j * fl + j * tl, sc->src + r, M[j] - r);
+        memcpy(sc->dst + M[j] - j * fl + j * tl, sc->to.data, tl);
+        r = M[j] + fl;
+    }
+    if (r < hi)
+        memcpy(sc->dst + r - j * fl + j * tl, sc->src + r, hi - r);
+}
+
+/* rs_string_replace_all, on the pool for large strings: the matches come from the
+ * chunked search, then every chunk writes its part of the output independently.
+ * Returns the number of replacements, or -1 on allocation failure. */
+static inline int rs_string_replace_all_par(rs_string* s, rs_sv from, rs_sv to) {
+    size_t len = rs_string_len(s);
+
+    if (len < RS_PAR_THRESHOLD || from.len == 0 || rs__par_width() == 1)
+        return rs_string_replace_all(s, from, to);
+
+    RS__STAT(replaces, 1);
+    rs__par_hits h;
+    rs_alloc a = rs_default_alloc();
+    if (rs__par_find(rs_string_sv(s), from, a, &h) != 0) return -1;
+    if (h.n == 0) return 0;
+
+    size_t nlen = len - h.n * from.len + h.n * to.len;
+    rs_string out;
+    rs_string_init(&out);
+
+    if (rs__reserve(&out, nlen, rs__alloc_of(s)) != 0) {
+        rs__par_hits_free(&h, a);
+        return -1;
+    }
+
+    size_t n = len / RS_PAR_CHUNK_MIN, width = rs__par_width();
+    if (n > width * 4) n = width * 4;
+    if (n == 0) n = 1;
+
+    rs__par_scatter sc = { &h, rs__cdata(s), rs__data(&out), from, to, len, len / n, n };
+    rs__par_for(n, rs__par_scatter_chunk, &sc);
+
+    rs__data(&out)[nlen] = '\0';
+    rs__set_len(&out, nlen);
+    rs_string_free(s);
+    *s = out;
+
+    int count = (int)h.n;
+    rs__par_hits_free(&h, a);
+    return count;
+}
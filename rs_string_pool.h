@@ -0,0 +1,311 @@
+// MIT License
+//
+// Copyright (c) 2025 Raman Sharkovich
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// rs_string_pool.h — size-class pooled allocator for small heap strings (header-only)
+// Usage: static rs_pool pool; rs_pool_init(&pool);
+//        rs_string s = rs_string_from_val_ex("...", rs_pool_alloc(&pool));
+// Power-of-two classes from RS_POOL_MIN_BLOCK to RS_POOL_MAX_BLOCK; larger requests go
+// to malloc. Each thread keeps a small free list per class and trades whole batches
+// with the pool's global depot. Call rs_pool_thread_flush() before a worker thread exits.
+#pragma once
+#include <threads.h>
+#include "rs_string.h"
+
+#ifndef RS_POOL_MIN_SHIFT
+#define RS_POOL_MIN_SHIFT 6      /* 64-byte blocks */
+#endif
+#ifndef RS_POOL_CLASSES
+#define RS_POOL_CLASSES 7        /* 64 .. 4096 */
+#endif
+#ifndef RS_POOL_BATCH
+#define RS_POOL_BATCH 32         /* blocks moved per depot transfer */
+#endif
+#ifndef RS_POOL_CHUNK
+#define RS_POOL_CHUNK (64 * 1024)
+#endif
+
+#define RS_POOL_MIN_BLOCK ((size_t)1 << RS_POOL_MIN_SHIFT)
+#define RS_POOL_MAX_BLOCK ((size_t)1 << (RS_POOL_MIN_SHIFT + RS_POOL_CLASSES - 1))
+
+#ifdef _MSC_VER
+#  define RS__POOL_THREAD_LOCAL __declspec(thread)
+#else
+#  define RS__POOL_THREAD_LOCAL _Thread_local
+#endif
+
+/* every block starts with a 16-byte prefix holding its class (RS__POOL_LARGE for malloc) */
+#define RS__POOL_PREFIX 16
+#define RS__POOL_LARGE  0xFFFFFFFFu
+
+typedef struct rs__pool_node { struct rs__pool_node* next; } rs__pool_node;
+
+typedef struct {
+    size_t hits;        /* served from a thread cache */
+    size_t misses;      /* had to go to the depot or carve a new chunk */
+    size_t large;       /* too big for a class, sent to malloc */
+    size_t bytes_held;  /* bytes of chunk memory owned by the pool */
+} rs_pool_stats;
+
+typedef struct {
+    mtx_t          m;
+    rs__pool_node* depot[RS_POOL_CLASSES];
+    rs__pool_node* chunks;  /* carved chunks, released by rs_pool_destroy */
+    rs_pool_stats  st;
+} rs_pool;
+
+typedef struct {
+    rs_pool*       pool;    /* pool this thread's cache is bound to */
+    rs__pool_node* head[RS_POOL_CLASSES];
+    size_t         n[RS_POOL_CLASSES];
+    size_t         hits;    /* published to the pool on every depot trip */
+} rs__pool_tcache;
+
+static RS__POOL_THREAD_LOCAL rs__pool_tcache rs__pool_tls;
+
+static inline int rs_pool_init(rs_pool* p) {
+    memset(p, 0, sizeof *p);
+    return mtx_init(&p->m, mtx_plain) == thrd_success ? 0 : -1;
+}
+
+static inline unsigned rs__pool_class(size_t n) {
+    unsigned c = 0;
+    size_t sz = RS_POOL_MIN_BLOCK;
+
+    while (sz < n) { sz <<= 1; ++c; }
+    return c;
+}
+static inline size_t    rs__pool_block(unsigned c) { return RS_POOL_MIN_BLOCK << c; }
+static inline uint32_t* rs__pool_tag(void* p)      { return (uint32_t*)((char*)p - RS__POOL_PREFIX); }
+
+/* with the pool lock held: pull up to one batch for class c, carving a chunk if needed */
+static inline rs__pool_node* rs__pool_take_batch(rs_pool* p, unsigned c, size_t* got) {
+    if (!p->depot[c]) {
+        size_t bs = rs__pool_block(c);
+        size_t chunk = RS_POOL_CHUNK > bs * RS_POOL_BATCH ? RS_POOL_CHUNK : bs * RS_POOL_BATCH;
+        char* mem = (char*)malloc(chunk);
+
+        if (!mem) { *got = 0; return NULL; }
+
+        /* the first block of each chunk links the chunk list */
+        rs__pool_node* ch = (rs__pool_node*)mem;
+        ch->next = p->chunks;
+        p->chunks = ch;
+        p->st.bytes_held += chunk;
+
+        for (size_t off = chunk / bs * bs; off > bs; ) {
+            off -= bs;
+            rs__pool_node* nd = (rs__pool_node*)(mem + off);
+            nd->next = p->depot[c];
+            p->depot[c] = nd;
+        }
+    }
+
+    rs__pool_node* head = p->depot[c];
+    rs__pool_node* tail = head;
+    size_t n = 1;
+
+    while (n < RS_POOL_BATCH && tail->next) { tail = tail->next; ++n; }
+    p->depot[c] = tail->next;
+    tail->next = NULL;
+    *got = n;
+
+    return head;
+}
+
+static inline void* rs__pool_m(size_t n, void* ctx) {
+    rs_pool* p = (rs_pool*)ctx;
+    size_t total = n + RS__POOL_PREFIX;
+
+    if (total > RS_POOL_MAX_BLOCK) {
+        char* b = (char*)malloc(total);
+        if (!b) return NULL;
+        mtx_lock(&p->m); p->st.large++; mtx_unlock(&p->m);
+        *(uint32_t*)b = RS__POOL_LARGE;
+        return b + RS__POOL_PREFIX;
+    }
+
+    unsigned c = rs__pool_class(total);
+    rs__pool_tcache* tc = &rs__pool_tls;
+    rs__pool_node* nd;
+
+    if (!tc->pool) tc->pool = p;
+
+    if (tc->pool == p && tc->head[c]) {
+        nd = tc->head[c];
+        tc->head[c] = nd->next;
+        tc->n[c]--;
+        tc->hits++;
+    } else {
+        size_t got;
+
+        mtx_lock(&p->m);
+        p->st.misses++;
+        if (tc->pool == p) { p->st.hits += tc->hits; tc->hits = 0; }
+        nd = rs__pool_take_batch(p, c, &got);
+        mtx_unlock(&p->m);
+
+        if (!nd) return NULL;
+
+        if (tc->pool == p) {
+            tc->head[c] = nd->next;
+            tc->n[c] = got - 1;
+        } else if (nd->next) { /* cache bound to another pool: hand the rest straight back */
+            rs__pool_node* tail = nd->next;
+            while (tail->next) tail = tail->next;
+            mtx_lock(&p->m);
+            tail->next = p->depot[c];
+            p->depot[c] = nd->next;
+            mtx_unlock(&p->m);
+        }
+    }
+
+    *(uint32_t*)nd = c;
+    return (char*)nd + RS__POOL_PREFIX;
+}
+
+static inline void rs__pool_f(void* ptr, void* ctx) {
+    rs_pool* p = (rs_pool*)ctx;
+
+    if (!ptr) return;
+
+    uint32_t c = *rs__pool_tag(ptr);
+    rs__pool_node* nd = (rs__pool_node*)((char*)ptr - RS__POOL_PREFIX);
+
+    if (c == RS__POOL_LARGE) { free(nd); return; }
+
+    rs__pool_tcache* tc = &rs__pool_tls;
+
+    if (!tc->pool) tc->pool = p;
+    if (tc->pool != p) {
+        mtx_lock(&p->m);
+        nd->next = p->depot[c];
+        p->depot[c] = nd;
+        mtx_unlock(&p->m);
+        return;
+    }
+
+    nd->next = tc->head[c];
+    tc->head[c] = nd;
+
+    /* batch return: keep one batch locally, give the other back to the depot */
+    if (++tc->n[c] >= 2 * RS_POOL_BATCH) {
+        rs__pool_node* head = tc->head[c];
+        rs__pool_node* tail = head;
+
+        for (size_t i = 1; i < RS_POOL_BATCH; ++i) tail = tail->next;
+        tc->head[c] = tail->next;
+        tc->n[c] -= RS_POOL_BATCH;
+
+        mtx_lock(&p->m);
+        tail->next = p->depot[c];
+        p->depot[c] = head;
+        p->st.hits += tc->hits; tc->hits = 0;
+        mtx_unlock(&p->m);
+    }
+}
+
+static inline void* rs__pool_r(void* ptr, size_t n, void* ctx) {
+    if (!ptr) return rs__pool_m(n, ctx);
+
+    uint32_t c = *rs__pool_tag(ptr);
+
+    if (c == RS__POOL_LARGE) {
+        if (n + RS__POOL_PREFIX > RS_POOL_MAX_BLOCK) {
+            char* b = (char*)realloc((char*)ptr - RS__POOL_PREFIX, n + RS__POOL_PREFIX);
+            return b ? b + RS__POOL_PREFIX : NULL;
+        }
+    } else if (n + RS__POOL_PREFIX <= rs__pool_block(c)) {
+        return ptr; /* still fits its class */
+    }
+
+    size_t old = c == RS__POOL_LARGE ? n : rs__pool_block(c) - RS__POOL_PREFIX;
+    void* q = rs__pool_m(n, ctx);
+
+    if (!q) return NULL;
+
+    memcpy(q, ptr, old < n ? old : n);
+    rs__pool_f(ptr, ctx);
+
+    return q;
+}
+
+/* usable size of the block a request of n bytes would get */
+static inline size_t rs__pool_round(size_t n, void* ctx) {
+    (void)ctx;
+    if (n + RS__POOL_PREFIX > RS_POOL_MAX_BLOCK) return n;
+    return rs__pool_block(rs__pool_class(n + RS__POOL_PREFIX)) - RS__POOL_PREFIX;
+}
+
+static inline rs_alloc rs_pool_alloc(rs_pool* p) {
+    return (rs_alloc){ &rs__pool_m, &rs__pool_r, &rs__pool_f, p, &rs__pool_round, NULL, NULL };
+}
+
+/* hand this thread's cached blocks back to the depot and unbind the cache */
+static inline void rs_pool_thread_flush(rs_pool* p) {
+    rs__pool_tcache* tc = &rs__pool_tls;
+
+    if (tc->pool != p) return;
+
+    mtx_lock(&p->m);
+    for (unsigned c = 0; c < RS_POOL_CLASSES; ++c) {
+        rs__pool_node* nd = tc->head[c];
+        while (nd) {
+            rs__pool_node* nx = nd->next;
+            nd->next = p->depot[c];
+            p->depot[c] = nd;
+            nd = nx;
+        }
+        tc->head[c] = NULL;
+        tc->n[c] = 0;
+    }
+    p->st.hits += tc->hits;
+    mtx_unlock(&p->m);
+
+    memset(tc, 0, sizeof *tc);
+}
+
+/* Counters are exact for the calling thread; other threads publish theirs on depot trips. */
+static inline rs_pool_stats rs_pool_get_stats(rs_pool* p) {
+    rs_pool_stats st;
+    mtx_lock(&p->m);
+    st = p->st;
+    mtx_unlock(&p->m);
+    if (rs__pool_tls.pool == p) st.hits += rs__pool_tls.hits;
+    return st;
+}
+
+/* Releases every chunk. All strings allocated from the pool must be gone and every
+ * other thread must have called rs_pool_thread_flush(). */
+static inline void rs_pool_destroy(rs_pool* p) {
+    if (rs__pool_tls.pool == p) memset(&rs__pool_tls, 0, sizeof rs__pool_tls);
+
+    rs__pool_node* ch = p->chunks;
+    while (ch) {
+        rs__pool_node* nx = ch->next;
+        free(ch);
+        ch = nx;
+    }
+
+    mtx_destroy(&p->m);
+    memset(p, 0, sizeof *p);
+}
@@ -0,0 +1,367 @@
+// MIT License
+//
+// Copyright (c) 2025 Raman Sharkovich
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// rs_string_rope.h — rope of shared rs_string chunks for large incremental edits (header-only)
+// Usage: rs_rope r; rs_rope_init(&r);
+//        rs_rope_append(&r, rs_sv_from_cstr("hello world"));
+//        rs_rope_insert(&r, 5, rs_sv_from_cstr(","));          /* O(log n), no tail memmove */
+//        for (rs_rope_iter it = rs_rope_iter_begin(&r); rs_rope_iter_next(&it, &piece); ) ...
+//        rs_rope_flatten(&r, &s); rs_rope_free(&r);
+// The tree is an implicit treap of pieces; each piece is a byte range of an rs_string chunk
+// shared through the heap refcount. Nodes are refcounted as well: rs_rope_share is O(1),
+// rs_rope_substr path-copies O(log n) nodes, and uniquely owned nodes are edited in place.
+#pragma once
+#include "rs_string.h"
+
+#ifndef RS_ROPE_CHUNK
+#define RS_ROPE_CHUNK 4096   /* small appends coalesce into the last chunk up to this size */
+#endif
+
+typedef struct rs__rope_node {
+    struct rs__rope_node* l;
+    struct rs__rope_node* r;
+    rs_rc_t   rc;
+    uint32_t  prio;
+    size_t    total;     /* bytes in this subtree */
+    size_t    off, len;  /* piece = chunk[off, off + len) */
+    rs_string chunk;
+} rs__rope_node;
+
+typedef struct {
+    rs__rope_node* root;
+    uint32_t       seed;
+} rs_rope;
+
+static inline size_t      rs__rope_total(const rs__rope_node* n) { return n ? n->total : 0; }
+static inline const char* rs__rope_piece(const rs__rope_node* n) { return rs__cdata(&n->chunk) + n->off; }
+static inline void        rs__rope_fix(rs__rope_node* n)         { n->total = rs__rope_total(n->l) + n->len + rs__rope_total(n->r); }
+
+static inline uint32_t rs__rope_prio(rs_rope* r) {
+    uint32_t x = r->seed ? r->seed : 0x9E3779B9u;
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    return r->seed = x;
+}
+
+static inline rs__rope_node* rs__rope_retain(rs__rope_node* n) {
+    if (n) rs__rc_inc(&n->rc);
+    return n;
+}
+
+static inline void rs__rope_release(rs__rope_node* n) {
+    while (n && rs__rc_drop(&n->rc)) {
+        rs__rope_node* r = n->r;
+        const rs_alloc* a = rs__alloc_of(&n->chunk);
+        rs__rope_release(n->l);
+        rs_string_free(&n->chunk);
+        if (a->f) a->f(n, a->ctx);
+        n = r;
+    }
+}
+
+/* new node sharing `chunk`, allocated from the chunk's allocator; takes over the
+ * references l and r (the caller keeps them if this fails) */
+static inline rs__rope_node* rs__rope_mk(const rs_string* chunk, size_t off, size_t len, uint32_t prio,
+                                         rs__rope_node* l, rs__rope_node* r) {
+    const rs_alloc* a = rs__alloc_of(chunk);
+    rs__rope_node* n = (rs__rope_node*)a->m(sizeof *n, a->ctx);
+
+    if (!n) return NULL;
+
+    n->chunk = *chunk;
+    rs__retain(&n->chunk);
+    n->l = l; n->r = r; n->rc = 1; n->prio = prio; n->off = off; n->len = len;
+    rs__rope_fix(n);
+
+    return n;
+}
+
+/* Make every node on the way down to `pos` uniquely owned (shared ones are path-copied),
+ * so a split there only relinks nodes. If `pos` falls inside a piece, *spare gets the
+ * node that split needs for the right half. On failure the rope reads the same: a path
+ * owned only part of the way down still holds the same pieces. */
+static inline int rs__rope_own_path(rs__rope_node** t, size_t pos, rs__rope_node** spare) {
+    *spare = NULL;
+
+    for (rs__rope_node* n; (n = *t) != NULL; ) {
+        if (rs__rc_get(&n->rc) != 1) {
+            rs__rope_node* c = rs__rope_mk(&n->chunk, n->off, n->len, n->prio, rs__rope_retain(n->l), rs__rope_retain(n->r));
+
+            if (!c) {
+                rs__rope_release(n->l);
+                rs__rope_release(n->r);
+                return -1;
+            }
+            rs__rope_release(n);
+            *t = n = c;
+        }
+
+        size_t L = rs__rope_total(n->l);
+
+        if (pos <= L) { t = &n->l; continue; }
+        if (pos >= L + n->len) { pos -= L + n->len; t = &n->r; continue; }
+
+        *spare = rs__rope_mk(&n->chunk, 0, 0, 0, NULL, NULL);
+        return *spare ? 0 : -1;
+    }
+
+    return 0;
+}
+
+/* consumes t, whose path to pos has been owned (rs__rope_own_path); *a gets the first
+ * pos bytes, *b the rest. Leaves the right spine of *a and the left spine of *b owned. */
+static inline void rs__rope_split(rs__rope_node* t, size_t pos, rs__rope_node** spare,
+                                  rs__rope_node** a, rs__rope_node** b) {
+    *a = *b = NULL;
+
+    if (!t) return;
+
+    size_t L = rs__rope_total(t->l);
+
+    if (pos <= L) {
+        rs__rope_node* lb;
+        rs__rope_split(t->l, pos, spare, a, &lb);
+        t->l = lb;
+        rs__rope_fix(t);
+        *b = t;
+        return;
+    }
+
+    if (pos >= L + t->len) {
+        rs__rope_node* ra;
+        rs__rope_split(t->r, pos - L - t->len, spare, &ra, b);
+        t->r = ra;
+        rs__rope_fix(t);
+        *a = t;
+        return;
+    }
+
+    /* split inside this piece: the spare (same chunk) takes the right half */
+    size_t k = pos - L;
+    rs__rope_node* right = *spare;
+
+    *spare = NULL;
+    right->off = t->off + k; right->len = t->len - k; right->prio = t->prio; right->r = t->r;
+    rs__rope_fix(right);
+
+    t->r = NULL;
+    t->len = k;
+    rs__rope_fix(t);
+    *a = t;
+    *b = right;
+}
+
+/* consumes a and b; every byte of a goes before b. The right spine of a and the left
+ * spine of b are owned (as a split leaves them), so this only relinks and cannot fail. */
+static inline rs__rope_node* rs__rope_merge(rs__rope_node* a, rs__rope_node* b) {
+    if (!a) return b;
+    if (!b) return a;
+
+    if (a->prio >= b->prio) {
+        a->r = rs__rope_merge(a->r, b);
+        rs__rope_fix(a);
+        return a;
+    } else {
+        b->l = rs__rope_merge(a, b->l);
+        rs__rope_fix(b);
+        return b;
+    }
+}
+
+static inline void   rs_rope_init(rs_rope* r)            { r->root = NULL; r->seed = 0; }
+static inline void   rs_rope_free(rs_rope* r)            { rs__rope_release(r->root); rs_rope_init(r); }
+static inline size_t rs_rope_len(const rs_rope* r)       { return rs__rope_total(r->root); }
+
+/* O(1): both ropes share every node until one of them is edited */
+static inline void rs_rope_share(rs_rope* dst, const rs_rope* src) {
+    if (dst == src) return;
+    rs__rope_node* root = rs__rope_retain(src->root);
+    rs_rope_free(dst);
+    dst->root = root;
+    dst->seed = src->seed;
+}
+
+/* zero-copy: the rope keeps a reference on the string's heap buffer */
+static inline int rs_rope_insert_string(rs_rope* r, size_t pos, const rs_string* s) {
+    size_t n = rs_string_len(s);
+    rs__rope_node *leaf, *spare, *a, *b;
+
+    if (n == 0) return 0;
+    if (pos > rs_rope_len(r)) pos = rs_rope_len(r);
+
+    if (rs__rope_own_path(&r->root, pos, &spare) != 0) return -1;
+    if (!(leaf = rs__rope_mk(s, 0, n, rs__rope_prio(r), NULL, NULL))) {
+        rs__rope_release(spare);
+        return -1;
+    }
+
+    rs__rope_split(r->root, pos, &spare, &a, &b);
+    r->root = rs__rope_merge(rs__rope_merge(a, leaf), b);
+    return 0;
+}
+
+static inline int rs_rope_insert(rs_rope* r, size_t pos, rs_sv v) {
+    if (v.len == 0) return 0;
+
+    rs_string chunk;
+    rs_string_init(&chunk);
+
+    if (rs_string_assign(&chunk, v) != 0) return -1;
+
+    int e = rs_rope_insert_string(r, pos, &chunk);
+    rs_string_free(&chunk);
+
+    return e;
+}
+
+/* Small appends are written straight into the last chunk when the whole right spine
+ * and that chunk are uniquely owned; otherwise a new piece is merged in. */
+static inline int rs_rope_append(rs_rope* r, rs_sv v) {
+    rs__rope_node* n = r->root;
+
+    if (v.len == 0) return 0;
+
+    while (n && rs__rc_get(&n->rc) == 1 && n->r) n = n->r;
+
+    if (n && rs__rc_get(&n->rc) == 1 && n->off + n->len == rs_string_len(&n->chunk)
+        && rs_string_len(&n->chunk) + v.len <= RS_ROPE_CHUNK
+        && (!rs_string_is_heap(&n->chunk) || rs__rc_get(&rs__hdr_of(&n->chunk)->rc) == 1)) {
+        if (rs_string_append(&n->chunk, v) != 0) return -1;
+
+        n->len += v.len;
+        for (rs__rope_node* p = r->root; p; p = p->r)
+            p->total += v.len;
+        return 0;
+    }
+
+    return rs_rope_insert(r, rs_rope_len(r), v);
+}
+
+static inline int rs_rope_append_string(rs_rope* r, const rs_string* s) {
+    return rs_rope_insert_string(r, rs_rope_len(r), s);
+}
+
+/* Both cut paths are owned before anything is cut, so a failed allocation leaves the
+ * rope as it was. */
+static inline int rs_rope_erase(rs_rope* r, size_t pos, size_t n) {
+    size_t len = rs_rope_len(r);
+    rs__rope_node *s1, *s2, *a, *mid, *b;
+
+    if (pos > len) pos = len;
+    if (n > len - pos) n = len - pos;
+    if (n == 0) return 0;
+
+    if (rs__rope_own_path(&r->root, pos, &s1) != 0) return -1;
+    if (rs__rope_own_path(&r->root, pos + n, &s2) != 0) {
+        rs__rope_release(s1);
+        return -1;
+    }
+
+    rs__rope_split(r->root, pos, &s1, &a, &mid);
+    rs__rope_split(mid, n, &s2, &mid, &b);
+    rs__rope_release(mid);
+    rs__rope_release(s1);
+    rs__rope_release(s2);
+    r->root = rs__rope_merge(a, b);
+
+    return 0;
+}
+
+/* dst = src[pos, pos + n); shares everything but the O(log n) nodes on the cut paths.
+ * On failure dst is unchanged. */
+static inline int rs_rope_substr(rs_rope* dst, const rs_rope* src, size_t pos, size_t n) {
+    rs__rope_node* root = rs__rope_retain(src->root);
+    size_t len = rs__rope_total(root);
+    rs__rope_node *s1, *s2 = NULL, *a, *mid, *b;
+
+    if (pos > len) pos = len;
+    if (n > len - pos) n = len - pos;
+
+    if (rs__rope_own_path(&root, pos, &s1) != 0 || rs__rope_own_path(&root, pos + n, &s2) != 0) {
+        rs__rope_release(s1);
+        rs__rope_release(root);
+        return -1;
+    }
+
+    rs__rope_split(root, pos, &s1, &a, &mid);
+    rs__rope_release(a);
+    rs__rope_split(mid, n, &s2, &mid, &b);
+    rs__rope_release(b);
+    rs__rope_release(s1);
+    rs__rope_release(s2);
+
+    rs_rope_free(dst);
+    dst->root = mid;
+    dst->seed = src->seed;
+
+    return 0;
+}
+
+static inline const rs__rope_node* rs__rope_locate(const rs__rope_node* n, size_t pos, size_t* k) {
+    while (n) {
+        size_t L = rs__rope_total(n->l);
+
+        if (pos < L) { n = n->l; continue; }
+        pos -= L;
+        if (pos < n->len) { *k = pos; return n; }
+        pos -= n->len;
+        n = n->r;
+    }
+    return NULL;
+}
+
+static inline char rs_rope_at(const rs_rope* r, size_t pos) {
+    size_t k;
+    const rs__rope_node* n = rs__rope_locate(r->root, pos, &k);
+    return n ? rs__rope_piece(n)[k] : '\0';
+}
+
+/* chunk iterator: yields the pieces in order as views (e.g. to fill an iovec for writev) */
+typedef struct {
+    const rs__rope_node* root;
+    size_t pos;
+} rs_rope_iter;
+
+static inline rs_rope_iter rs_rope_iter_begin(const rs_rope* r) { return (rs_rope_iter){ r->root, 0 }; }
+
+static inline bool rs_rope_iter_next(rs_rope_iter* it, rs_sv* out) {
+    size_t k;
+    const rs__rope_node* n = rs__rope_locate(it->root, it->pos, &k);
+
+    if (!n) return false;
+
+    *out = (rs_sv){ rs__rope_piece(n) + k, n->len - k };
+    it->pos += n->len - k;
+
+    return true;
+}
+
+static inline int rs_rope_flatten(const rs_rope* r, rs_string* out) {
+    rs_sv piece;
+
+    if (rs_string_clear(out) != 0 || rs_string_reserve(out, rs_rope_len(r)) != 0) return -1;
+
+    for (rs_rope_iter it = rs_rope_iter_begin(r); rs_rope_iter_next(&it, &piece); )
+        if (rs_string_append(out, piece) != 0) return -1;
+
+    return 0;
+}
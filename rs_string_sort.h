@@ -0,0 +1,129 @@
+// MIT License
+//
+// Copyright (c) 2025 Raman Sharkovich
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// rs_string_sort.h — sorting string views (header-only)
+// Usage: rs_sv keys[n] = ...;
+//        if (rs_sort_views(keys, n) != 0) ...    /* out of memory: keys untouched */
+// Order is rs_sv_cmp's: bytewise, a proper prefix first. The sort is a multikey
+// quicksort over cached 8-byte big-endian prefix keys. Each partition compares one
+// uint64_t per element and does not touch the string bytes. Only groups that tie on
+// all 8 bytes reload at the next 8, so a long shared prefix costs a pass per 8 bytes
+// rather than a memcmp per comparison. Small partitions finish by insertion sort.
+// Not stable: equal views may come out in any order.
+#pragma once
+#include "rs_string.h"
+
+#define RS_SORT_SMALL 16    /* partitions up to this size are insertion sorted */
+
+typedef struct {
+    uint64_t key;           /* bytes [d, d + 8) of v, big-endian, zero padded */
+    rs_sv    v;
+} rs__skey;
+
+static inline uint64_t rs__sort_key(rs_sv v, size_t d) {
+    unsigned char b[8] = { 0 };
+    size_t k = v.len > d ? v.len - d : 0;
+
+    if (k > 8) k = 8;
+    if (k) memcpy(b, v.data + d, k);
+    return (uint64_t)b[0] << 56 | (uint64_t)b[1] << 48 | (uint64_t)b[2] << 40 | (uint64_t)b[3] << 32 |
+           (uint64_t)b[4] << 24 | (uint64_t)b[5] << 16 | (uint64_t)b[6] << 8  | (uint64_t)b[7];
+}
+
+static inline void rs__skey_swap(rs__skey* a, rs__skey* b) { rs__skey t = *a; *a = *b; *b = t; }
+
+static inline uint64_t rs__med3(uint64_t a, uint64_t b, uint64_t c) {
+    return a < b ? (b < c ? b : a < c ? c : a) : (a < c ? a : b < c ? c : b);
+}
+
+/* every element shares its first d bytes with the others (and is at least d long) */
+static inline void rs__sort_small(rs__skey* a, size_t n, size_t d) {
+    for (size_t i = 1; i < n; ++i) {
+        rs__skey t = a[i];
+        rs_sv tv = { t.v.data + d, t.v.len - d };
+        size_t j = i;
+
+        while (j > 0 && (a[j - 1].key > t.key ||
+                         (a[j - 1].key == t.key && rs_sv_cmp((rs_sv){ a[j - 1].v.data + d, a[j - 1].v.len - d }, tv) > 0))) {
+            a[j] = a[j - 1];
+            --j;
+        }
+        a[j] = t;
+    }
+}
+
+static inline void rs__mkqs(rs__skey* a, size_t n, size_t d) {
+    while (n > RS_SORT_SMALL) {
+        uint64_t p = n > 128
+            ? rs__med3(rs__med3(a[0].key, a[n / 8].key, a[n / 4].key),
+                       rs__med3(a[3 * n / 8].key, a[n / 2].key, a[5 * n / 8].key),
+                       rs__med3(a[3 * n / 4].key, a[7 * n / 8].key, a[n - 1].key))
+            : rs__med3(a[0].key, a[n / 2].key, a[n - 1].key);
+
+        /* [0, lt) < p, [lt, gt) == p, [gt, n) > p */
+        size_t lt = 0, i = 0, gt = n;
+        while (i < gt) {
+            if (a[i].key < p)      rs__skey_swap(&a[lt++], &a[i++]);
+            else if (a[i].key > p) rs__skey_swap(&a[i], &a[--gt]);
+            else                   ++i;
+        }
+
+        /* Views that end inside the key are finished. They share their bytes
+         * and end in [d, d + 8], so a pass per length puts them in order. They
+         * sort ahead of all that continue, which they are a prefix of. */
+        rs__skey* e = a + lt;
+        size_t m = gt - lt, fin = 0;
+        for (size_t j = 0; j < m; ++j)
+            if (e[j].v.len <= d + 8) rs__skey_swap(&e[fin++], &e[j]);
+        for (size_t len = d, k = 0; k + 1 < fin && len <= d + 8; ++len)
+            for (size_t j = k; j < fin; ++j)
+                if (e[j].v.len == len) rs__skey_swap(&e[k++], &e[j]);
+        for (size_t j = fin; j < m; ++j) e[j].key = rs__sort_key(e[j].v, d + 8);
+
+        /* recurse on the two smaller parts (each at most n / 2), loop on the largest */
+        struct { rs__skey* a; size_t n, d; } part[3] = { { a, lt, d }, { e + fin, m - fin, d + 8 }, { a + gt, n - gt, d } };
+        size_t big = part[1].n > part[0].n ? 1 : 0;
+        if (part[2].n > part[big].n) big = 2;
+        for (size_t j = 0; j < 3; ++j)
+            if (j != big && part[j].n > 1) rs__mkqs(part[j].a, part[j].n, part[j].d);
+        a = part[big].a, n = part[big].n, d = part[big].d;
+    }
+    rs__sort_small(a, n, d);
+}
+
+/* Sort v[0..n) in place. 0 on success, -1 if the key scratch (24 bytes per view)
+ * cannot be allocated, in which case v is unchanged. */
+static inline int rs_sort_views(rs_sv* v, size_t n) {
+    if (n < 2) return 0;
+    if (n > SIZE_MAX / sizeof(rs__skey)) return -1;
+
+    rs__skey* a = (rs__skey*)malloc(n * sizeof(rs__skey));
+    if (!a) return -1;
+
+    for (size_t i = 0; i < n; ++i) a[i] = (rs__skey){ rs__sort_key(v[i], 0), v[i] };
+    rs__mkqs(a, n, 0);
+    for (size_t i = 0; i < n; ++i) v[i] = a[i].v;
+
+    free(a);
+    return 0;
+}
@@ -28,13 +28,216 @@
 // Created by Raman Sharkovich on 24.09.25.
 //
 
+// rs_string_ts.h — lock-free concurrent append buffer (header-only)
+// Usage: rs_string_ts t; rs_string_ts_init(&t);
+//        rs_string_ts_append(&t, line);            /* from any number of threads */
+//        size_t n = rs_string_ts_len(&t);          /* never blocks */
+//        rs_string_ts_snapshot(&t, &out);          /* bytes appended so far, in order */
+//        rs_string_ts_free(&t);                    /* once every writer is done */
+// An append makes sure the segments under the tail exist, reserves its record with one
+// compare-and-swap on the tail and copies into segments that never move, in parallel
+// with every other writer. Records are then
+// published in reservation order without anyone waiting: a finished writer marks its
+// record done and pushes the published prefix over every done record it finds, so
+// whoever finishes last carries the others through.
 #pragma once
 #include <threads.h>
 #include <stdarg.h>
+#include <stdatomic.h>
 #include "rs_string.h"
 
-typedef struct { rs_string s; mtx_t m; } rs_string_ts;
-static inline int rs_string_ts_init(rs_string_ts* t) { rs_string_init(&t->s); return mtx_init(&t->m, mtx_plain)==thrd_success?0:-1; }
-static inline void rs_string_ts_free(rs_string_ts* t) { mtx_lock(&t->m); rs_string_free(&t->s); mtx_unlock(&t->m); mtx_destroy(&t->m); }
-static inline int rs_string_ts_append(rs_string_ts* t, rs_sv v) { mtx_lock(&t->m); int r=rs_string_append(&t->s,v); mtx_unlock(&t->m); return r; }
-static inline size_t rs_string_ts_len(rs_string_ts* t) { mtx_lock(&t->m); size_t r=rs_string_len(&t->s); mtx_unlock(&t->m); return r; }
+/* segment k holds RS_TS_SEG0 << k bytes, so the table never has to be reallocated */
+#ifndef RS_TS_SEG0
+#define RS_TS_SEG0 4096       /* multiple of 8 */
+#endif
+#define RS__TS_SEGS 40
+
+/* record: 8-byte header (length | RS__TS_DONE), then the bytes, padded to 8 */
+#define RS__TS_DONE ((uint64_t)1 << 63)
+#define RS__TS_REC(n) (8 + (((n) + 7) & ~(size_t)7))
+
+typedef struct {
+    _Atomic size_t   tail;        /* bytes reserved (records) */
+    _Atomic size_t   committed;   /* records in [0, committed) are complete */
+    _Atomic size_t   bytes;       /* payload published */
+    char             pad[64];     /* keep the segment table off the writers' cache line */
+    _Atomic(char*)   seg[RS__TS_SEGS];
+} rs_string_ts;
+
+static inline int rs_string_ts_init(rs_string_ts* t) {
+    atomic_init(&t->tail, 0);
+    atomic_init(&t->committed, 0);
+    atomic_init(&t->bytes, 0);
+    for (int k = 0; k < RS__TS_SEGS; ++k) atomic_init(&t->seg[k], NULL);
+    return 0;
+}
+
+/* not concurrent with anything else */
+static inline void rs_string_ts_free(rs_string_ts* t) {
+    for (int k = 0; k < RS__TS_SEGS; ++k)
+        free(atomic_load_explicit(&t->seg[k], memory_order_relaxed));
+    rs_string_ts_init(t);
+}
+
+/* offset -> segment index and the segment's first offset */
+static inline unsigned rs__ts_seg_of(size_t off, size_t* start) {
+    unsigned k = 63u - rs__clz64((uint64_t)(off / RS_TS_SEG0) + 1);
+    *start = RS_TS_SEG0 * (((size_t)1 << k) - 1);
+    return k;
+}
+
+/* the segment, allocated (zeroed: a header of 0 means "not done") if `make` */
+static inline char* rs__ts_seg(rs_string_ts* t, unsigned k, bool make) {
+    if (k >= RS__TS_SEGS) return NULL;
+
+    char* p = atomic_load_explicit(&t->seg[k], memory_order_acquire);
+    if (p || !make) return p;
+
+    char* fresh = (char*)calloc(1, (size_t)RS_TS_SEG0 << k);
+    if (!fresh) return NULL;
+
+    if (!atomic_compare_exchange_strong_explicit(&t->seg[k], &p, fresh, memory_order_acq_rel, memory_order_acquire)) {
+        free(fresh); /* another writer got there first */
+        return p;
+    }
+    return fresh;
+}
+
+/* Headers are 8-aligned and segments are multiples of 8, so a header never straddles. */
+static inline _Atomic uint64_t* rs__ts_hdr(rs_string_ts* t, size_t off, bool make) {
+    size_t start;
+    unsigned k = rs__ts_seg_of(off, &start);
+    char* s = rs__ts_seg(t, k, make);
+    return s ? (_Atomic uint64_t*)(void*)(s + (off - start)) : NULL;
+}
+
+/* Copy n bytes at `off` in or out of the segments. */
+static inline int rs__ts_copy(rs_string_ts* t, size_t off, char* buf, size_t n, bool in) {
+    while (n) {
+        size_t start;
+        unsigned k = rs__ts_seg_of(off, &start);
+        char* s = rs__ts_seg(t, k, in);
+
+        if (!s) return -1;
+
+        size_t at = off - start, room = ((size_t)RS_TS_SEG0 << k) - at;
+        size_t c = n < room ? n : room;
+
+        if (in) memcpy(s + at, buf, c);
+        else    memcpy(buf, s + at, c);
+        off += c; buf += c; n -= c;
+    }
+    return 0;
+}
+
+/* Move the published prefix over every consecutive done record. The caller has just
+ * stored a DONE header; this load of `committed` and a publisher's CAS-then-header-load
+ * are the store-buffering pattern, so both sides order through seq_cst: at least one of
+ * the two writers sees the other's store, and the record is carried through. */
+static inline void rs__ts_advance(rs_string_ts* t) {
+    size_t c = atomic_load_explicit(&t->committed, memory_order_acquire);
+
+    for (;;) {
+        _Atomic uint64_t* h = rs__ts_hdr(t, c, false);
+        uint64_t hv = h ? atomic_load_explicit(h, memory_order_acquire) : 0;
+
+        if (!(hv & RS__TS_DONE)) return;  /* its writer will call us again */
+
+        size_t n = (size_t)(hv & ~RS__TS_DONE);
+        if (atomic_compare_exchange_weak_explicit(&t->committed, &c, c + RS__TS_REC(n),
+                                                  memory_order_seq_cst, memory_order_acquire)) {
+            atomic_fetch_add_explicit(&t->bytes, n, memory_order_relaxed);
+            c += RS__TS_REC(n);
+            atomic_thread_fence(memory_order_seq_cst);   /* before the next header load */
+        }
+    }
+}
+
+/* Allocate every segment under [off, off + n), so a record there cannot fail later. */
+static inline int rs__ts_make(rs_string_ts* t, size_t off, size_t n) {
+    size_t start;
+    unsigned last = rs__ts_seg_of(off + n - 1, &start);
+
+    if (last >= RS__TS_SEGS) return -1;  /* past the table: do not allocate the rest first */
+    for (unsigned k = rs__ts_seg_of(off, &start); k <= last; ++k)
+        if (!rs__ts_seg(t, k, true)) return -1;
+    return 0;
+}
+
+/* A reserved record must be published or every record after it stays unpublished, so
+ * the tail only moves over segments that already exist: a failed allocation fails this
+ * append alone, before it holds a place in the order. */
+static inline int rs_string_ts_append(rs_string_ts* t, rs_sv v) {
+    if (v.len > SIZE_MAX / 2) return -1;
+
+    const size_t rec = RS__TS_REC(v.len);
+    size_t off = atomic_load_explicit(&t->tail, memory_order_relaxed);
+    do {
+        if (off > SIZE_MAX - rec || rs__ts_make(t, off, rec) != 0) return -1;
+    } while (!atomic_compare_exchange_weak_explicit(&t->tail, &off, off + rec,
+                                                    memory_order_relaxed, memory_order_relaxed));
+
+    _Atomic uint64_t* h = rs__ts_hdr(t, off, false);
+    rs__ts_copy(t, off + 8, (char*)v.data, v.len, true);
+
+    atomic_store_explicit(h, (uint64_t)v.len | RS__TS_DONE, memory_order_release);
+    atomic_thread_fence(memory_order_seq_cst);           /* before loading `committed` */
+    rs__ts_advance(t);
+
+    return 0;
+}
+
+static inline int rs_string_ts_appendf(rs_string_ts* t, const char* fmt, ...) {
+    char small[256];
+    va_list ap, ap2;
+    va_start(ap, fmt);
+    va_copy(ap2, ap);
+    int n = vsnprintf(small, sizeof small, fmt, ap);
+    va_end(ap);
+
+    int r = -1;
+    if (n >= 0 && (size_t)n < sizeof small) {
+        r = rs_string_ts_append(t, (rs_sv){ small, (size_t)n });
+    } else if (n >= 0) {
+        char* big = (char*)malloc((size_t)n + 1);
+        if (big) {
+            vsnprintf(big, (size_t)n + 1, fmt, ap2);
+            r = rs_string_ts_append(t, (rs_sv){ big, (size_t)n });
+            free(big);
+        }
+    }
+    va_end(ap2);
+
+    return r;
+}
+
+/* Bytes published so far: a lower bound while writers are running. */
+static inline size_t rs_string_ts_len(rs_string_ts* t) {
+    return atomic_load_explicit(&t->bytes, memory_order_relaxed);
+}
+
+/* Replace `out` with every published append, in append order. May run while writers
+ * are active; returns -1 if `out` cannot grow. */
+static inline int rs_string_ts_snapshot(rs_string_ts* t, rs_string* out) {
+    size_t end = atomic_load_explicit(&t->committed, memory_order_acquire), total = 0;
+
+    rs_string_clear(out);
+
+    for (size_t at = 0; at < end; ) {
+        size_t n = (size_t)(atomic_load_explicit(rs__ts_hdr(t, at, false), memory_order_relaxed) & ~RS__TS_DONE);
+        total += n;
+        at += RS__TS_REC(n);
+    }
+
+    char* w = rs_string_prepare(out, total);
+    if (!w) return -1;
+
+    for (size_t at = 0; at < end; ) {
+        size_t n = (size_t)(atomic_load_explicit(rs__ts_hdr(t, at, false), memory_order_relaxed) & ~RS__TS_DONE);
+        rs__ts_copy(t, at + 8, w, n, false);
+        w += n;
+        at += RS__TS_REC(n);
+    }
+
+    return rs_string_commit(out, total);
+}
@@ -0,0 +1,121 @@
+// MIT License
+//
+// Copyright (c) 2025 Raman Sharkovich
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// rs_string_utf8proc.c — utf8proc adapter for rs_string_utf8proc.h
+#include "rs_string_utf8proc.h"
+
+#ifdef USE_UTF8PROC
+#include <utf8proc.h>
+
+#define RS__FOLD_OPTS (UTF8PROC_STABLE | UTF8PROC_COMPOSE | UTF8PROC_CASEFOLD)
+
+/* rewrite s code point by code point; lengths may change ("İ" lowers to one byte less) */
+static int rs__u8p_map_cp(rs_string* s, utf8proc_int32_t (*fn)(utf8proc_int32_t)) {
+    rs_sv v = rs_string_sv(s);
+    const utf8proc_uint8_t* p = (const utf8proc_uint8_t*)v.data;
+    rs_string out;
+    rs_string_init(&out);
+
+    if (rs_string_reserve_ex(&out, v.len, rs__alloc_of(s)) != 0) return -1;
+
+    for (size_t i = 0; i < v.len;) {
+        size_t run = i;
+        while (run < v.len && p[run] < 0x80) ++run;
+        if (run > i) {                         /* ASCII stretches: copy, then fix in bulk */
+            size_t at = rs_string_len(&out);
+            if (rs_string_append(&out, (rs_sv){ v.data + i, run - i }) != 0) goto fail;
+            rs__case_flip(rs__data(&out) + at, run - i, fn == utf8proc_tolower ? 'A' : 'a');
+            i = run;
+            continue;
+        }
+
+        utf8proc_int32_t cp;
+        utf8proc_ssize_t k = utf8proc_iterate(p + i, (utf8proc_ssize_t)(v.len - i), &cp);
+        if (k < 0) goto fail;
+
+        utf8proc_uint8_t buf[4];
+        utf8proc_ssize_t w = utf8proc_encode_char(fn(cp), buf);
+        if (rs_string_append(&out, (rs_sv){ (const char*)buf, (size_t)w }) != 0) goto fail;
+        i += (size_t)k;
+    }
+
+    rs_string_free(s);
+    *s = out;
+    return 0;
+
+fail:
+    rs_string_free(&out);
+    return -1;
+}
+
+int rs_string_casefold_utf8(rs_string* s) {
+    rs_sv v = rs_string_sv(s);
+    utf8proc_uint8_t* dst = NULL;
+
+    if (rs_sv_is_ascii(v)) return rs_string_to_lower_ascii(s);
+
+    utf8proc_ssize_t n = utf8proc_map((const utf8proc_uint8_t*)v.data, (utf8proc_ssize_t)v.len, &dst, RS__FOLD_OPTS);
+    if (n < 0) return -1;
+
+    int r = rs_string_assign(s, (rs_sv){ (const char*)dst, (size_t)n });
+    free(dst);
+    return r;
+}
+
+int rs_string_to_lower_utf8(rs_string* s) {
+    return rs_sv_is_ascii(rs_string_sv(s)) ? rs_string_to_lower_ascii(s) : rs__u8p_map_cp(s, utf8proc_tolower);
+}
+
+int rs_string_to_upper_utf8(rs_string* s) {
+    return rs_sv_is_ascii(rs_string_sv(s)) ? rs_string_to_upper_ascii(s) : rs__u8p_map_cp(s, utf8proc_toupper);
+}
+
+bool rs_sv_ieq_utf8(rs_sv a, rs_sv b) {
+    if (rs_sv_is_ascii(a) && rs_sv_is_ascii(b)) return rs_sv_ieq_ascii(a, b);
+
+    utf8proc_uint8_t *fa = NULL, *fb = NULL;
+    utf8proc_ssize_t na = utf8proc_map((const utf8proc_uint8_t*)a.data, (utf8proc_ssize_t)a.len, &fa, RS__FOLD_OPTS);
+    utf8proc_ssize_t nb = na < 0 ? -1 : utf8proc_map((const utf8proc_uint8_t*)b.data, (utf8proc_ssize_t)b.len, &fb, RS__FOLD_OPTS);
+    bool eq = na >= 0 && nb >= 0 && na == nb && memcmp(fa, fb, (size_t)na) == 0;
+
+    free(fa);
+    free(fb);
+    return eq;
+}
+
+#else /* ASCII only */
+
+int rs_string_casefold_utf8(rs_string* s) {
+    return rs_sv_is_ascii(rs_string_sv(s)) ? rs_string_to_lower_ascii(s) : -1;
+}
+int rs_string_to_lower_utf8(rs_string* s) {
+    return rs_sv_is_ascii(rs_string_sv(s)) ? rs_string_to_lower_ascii(s) : -1;
+}
+int rs_string_to_upper_utf8(rs_string* s) {
+    return rs_sv_is_ascii(rs_string_sv(s)) ? rs_string_to_upper_ascii(s) : -1;
+}
+bool rs_sv_ieq_utf8(rs_sv a, rs_sv b) {
+    return rs_sv_is_ascii(a) && rs_sv_is_ascii(b) && rs_sv_ieq_ascii(a, b);
+}
+
+#endif
@@ -0,0 +1,39 @@
+// MIT License
+//
+// Copyright (c) 2025 Raman Sharkovich
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// rs_string_utf8proc.h — full Unicode case mapping through utf8proc (link rs_utf8proc_adapter)
+// Usage: rs_string_casefold_utf8(&key);             /* "Straße" -> "strasse" */
+//        if (rs_sv_ieq_utf8(a, b)) ...              /* caseless comparison */
+// Pure-ASCII input takes the inline ASCII kernels and never reaches utf8proc. Without
+// utf8proc (USE_UTF8PROC undefined) only that fast path works; anything else returns
+// -1 / false. Invalid UTF-8 returns -1 and leaves the string as it was.
+#pragma once
+#include "rs_string.h"
+
+/* Unicode case folding (full: "ß" -> "ss"), composed to NFC. */
+int  rs_string_casefold_utf8(rs_string* s);
+/* Per-code-point simple lower / upper case mapping. */
+int  rs_string_to_lower_utf8(rs_string* s);
+int  rs_string_to_upper_utf8(rs_string* s);
+/* a and b are equal once both are case folded */
+bool rs_sv_ieq_utf8(rs_sv a, rs_sv b);
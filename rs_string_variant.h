@@ -0,0 +1,317 @@
+// MIT License
+//
+// Copyright (c) 2025 Raman Sharkovich
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// rs_string_variant.h — string types with their own inline capacity (header-only)
+// Usage: RS_DEFINE_STRING(rs_key, 15)        /* rs_key, rs_key_init, rs_key_append, ... */
+//        RS_DEFINE_STRING(rs_path, 63)
+//      or, to also route the rs_string_* front end (len, sv, cstr, append, ...) by type:
+//        #define RS_STRING_VARIANTS(X) X(rs_key, 15) X(rs_path, 63)
+//        #include "rs_string_variant.h"
+//        rs_path p; rs_string_init(&p); rs_string_append(&p, rs_sv_from_cstr("/usr/lib"));
+//
+// A variant keeps up to name_SSO_CAP bytes inline and spills to the same heap buffers as
+// rs_string: same header, refcount, COW, slices and allocators. Handles convert both
+// ways (name_from_string / name_to_string) without copying a heap buffer, so any
+// rs_string operation is one conversion away. name_SSO_CAP is the requested capacity
+// rounded up to what the handle holds anyway: at least RS_SSO_CAP and three words, up to
+// the next word. The limit is 127. Each variant is a plain struct of name_SSO_CAP + 1
+// bytes, so one translation unit can mix 24-byte keys with 64-byte paths.
+//
+// The tag byte is the last byte of the handle. An inline string keeps name_SSO_CAP - len
+// there, so a full string's NUL doubles as the tag. A heap handle sets 0x80 and the words
+// {p, len, cap}; a slice sets 0xC0 and keeps its offset where the capacity goes, as in
+// the compact layout. Heap operations load the words into a stack rs_string, run the
+// usual code and store them back; inline edits never leave the handle.
+#pragma once
+#include "rs_string.h"
+
+typedef struct {
+    char*  p;
+    size_t len;
+    size_t w;               /* capacity, or a slice's offset (RS__W3_ENC, tag on top) */
+} rs__vheap;
+
+#define RS__VMAX(a, b) ((a) > (b) ? (a) : (b))
+#define RS__VSIZE(cap) \
+    ((RS__VMAX(RS__VMAX((size_t)(cap), (size_t)RS_SSO_CAP), 3 * sizeof(size_t) - 1) + sizeof(size_t)) / sizeof(size_t) * sizeof(size_t))
+
+// Shared code: `v` is a variant handle of `z` bytes (so z - 1 inline bytes)
+static inline unsigned char rs__v_tag(const void* v, size_t z) { return ((const unsigned char*)v)[z - 1]; }
+static inline bool rs__v_heap(const void* v, size_t z) { return (rs__v_tag(v, z) & 0x80) != 0; }
+static inline size_t rs__v_len(const void* v, size_t z) {
+    return rs__v_heap(v, z) ? ((const rs__vheap*)v)->len : z - 1 - rs__v_tag(v, z);
+}
+static inline rs_sv rs__v_sv(const void* v, size_t z) {
+    if (rs__v_heap(v, z)) return (rs_sv){ ((const rs__vheap*)v)->p, ((const rs__vheap*)v)->len };
+    return (rs_sv){ (const char*)v, z - 1 - rs__v_tag(v, z) };
+}
+
+static inline void rs__v_init(void* v, size_t z) {
+    ((char*)v)[0] = '\0';
+    ((char*)v)[z - 1] = (char)(z - 1);
+}
+static inline void rs__v_set_inline(void* v, size_t z, size_t len) {
+    ((char*)v)[len] = '\0';
+    ((char*)v)[z - 1] = (char)(z - 1 - len);
+}
+
+/* The handle as an rs_string, without touching the refcount. Only for heap handles and
+ * inline ones short enough for rs_string's own inline buffer. */
+static inline rs_string rs__v_load(const void* v, size_t z) {
+    rs_string t;
+    const rs__vheap* h = (const rs__vheap*)v;
+
+    if (rs__v_tag(v, z) == 0xC0)      rs__set_slice(&t, h->p, RS__W3_DEC(h->w), h->len);
+    else if (rs__v_tag(v, z) == 0x80) rs__set_heap(&t, h->p, h->len, RS__W3_DEC(h->w));
+    else {
+        size_t len = rs__v_len(v, z);
+        rs_string_init(&t);
+        memcpy(rs__inline(&t), v, len);
+        rs__inline(&t)[len] = '\0';
+        rs__set_len(&t, len);
+    }
+    return t;
+}
+
+static inline void rs__v_store_heap(void* v, size_t z, const rs_string* t) {
+    rs__vheap* h = (rs__vheap*)v;
+    unsigned char tag = rs__is_slice(t) ? 0xC0 : 0x80;
+
+    h->p = rs__heap_ptr(t);
+    h->len = rs_string_len(t);
+    h->w = RS__W3_ENC(tag == 0xC0 ? rs__off(t) : rs_string_cap(t), tag);
+    ((unsigned char*)v)[z - 1] = tag;
+}
+
+/* take over t's state (z - 1 >= RS_SSO_CAP, so an inline rs_string always fits) */
+static inline void rs__v_store(void* v, size_t z, const rs_string* t) {
+    if (rs_string_is_heap(t)) {
+        rs__v_store_heap(v, z, t);
+    } else {
+        size_t len = rs_string_len(t);
+        memcpy(v, rs__cdata(t), len);
+        rs__v_set_inline(v, z, len);
+    }
+}
+
+/* the inline bytes don't fit rs_string's buffer: only a variant larger than it */
+static inline bool rs__v_big_inline(const void* v, size_t z) {
+    return !rs__v_heap(v, z) && rs__v_len(v, z) > RS_SSO_CAP;
+}
+
+static inline void rs__v_free(void* v, size_t z) {
+    if (rs__v_heap(v, z)) {
+        rs_string t = rs__v_load(v, z);
+        rs_string_free(&t);
+    }
+    rs__v_init(v, z);
+}
+
+static inline size_t rs__v_cap(const void* v, size_t z) {
+    if (!rs__v_heap(v, z)) return z - 1;
+
+    rs_string t = rs__v_load(v, z);
+    return rs_string_cap(&t);
+}
+
+/* move the inline bytes into a fresh heap buffer with room for `need` */
+static inline int rs__v_spill(void* v, size_t z, size_t need, rs_alloc a) {
+    rs_string t;
+    size_t len = rs__v_len(v, z);
+
+    rs_string_init(&t);
+    if (rs_string_reserve_ex(&t, need, a) != 0) return -1;
+    memcpy(rs__heap_ptr(&t), v, len);
+    rs__heap_ptr(&t)[len] = '\0';
+    rs__set_len(&t, len);
+    rs__v_store_heap(v, z, &t);           /* need > z - 1 >= RS_SSO_CAP: on the heap */
+    return 0;
+}
+
+static inline int rs__v_reserve_ex(void* v, size_t z, size_t need, rs_alloc a) {
+    if (!rs__v_heap(v, z)) return need <= z - 1 ? 0 : rs__v_spill(v, z, need, a);
+
+    rs_string t = rs__v_load(v, z);
+    int r = rs_string_reserve_ex(&t, need, a);
+    rs__v_store(v, z, &t);
+    return r;
+}
+
+static inline int rs__v_append(void* v, size_t z, rs_sv s) {
+    size_t len = rs__v_len(v, z);
+
+    if (!rs__v_heap(v, z)) {
+        if (len + s.len <= z - 1) {
+            memmove((char*)v + len, s.data, s.len);
+            rs__v_set_inline(v, z, len + s.len);
+            return 0;
+        }
+        /* the spill overwrites the inline bytes: a view of them follows the copy */
+        uintptr_t at = (uintptr_t)s.data - (uintptr_t)v;
+        bool self = at < z;
+        if (rs__v_spill(v, z, len + s.len, rs_default_alloc()) != 0) return -1;
+        if (self) s.data = ((rs__vheap*)v)->p + at;
+    }
+
+    rs_string t = rs__v_load(v, z);
+    int r = rs_string_append(&t, s);
+    rs__v_store(v, z, &t);
+    return r;
+}
+
+/* values that fit go inline (dropping any heap buffer); longer ones use the buffer */
+static inline int rs__v_assign(void* v, size_t z, rs_sv s) {
+    if (s.len <= z - 1) {
+        rs_string t;
+        bool heap = rs__v_heap(v, z);
+
+        if (heap) t = rs__v_load(v, z);      /* keeps the bytes alive while `s` is copied */
+        memmove(v, s.data, s.len);
+        rs__v_set_inline(v, z, s.len);
+        if (heap) rs_string_free(&t);
+        return 0;
+    }
+    if (!rs__v_heap(v, z)) {
+        rs_string t;
+        rs_string_init(&t);
+        if (rs_string_assign(&t, s) != 0) return -1;   /* `s` is at most z - 1 inline bytes: not from v */
+        rs__v_store(v, z, &t);
+        return 0;
+    }
+
+    rs_string t = rs__v_load(v, z);
+    int r = rs_string_assign(&t, s);
+    rs__v_store(v, z, &t);
+    return r;
+}
+
+static inline const char* rs__v_cstr(const void* v, size_t z) { return rs__v_sv(v, z).data; }
+
+static inline void rs__v_share(void* dst, const void* src, size_t z) {
+    if (dst == src) return;
+
+    rs__v_free(dst, z);
+    memcpy(dst, src, z);
+    if (rs__v_heap(src, z)) {
+        rs_string t = rs__v_load(src, z);
+        rs__retain(&t);
+    }
+}
+
+static inline uint64_t rs__v_hash(const void* v, size_t z) {
+    if (!rs__v_heap(v, z)) return rs_sv_hash(rs__v_sv(v, z));
+
+    rs_string t = rs__v_load(v, z);
+    return rs_string_hash(&t);            /* the memo lives in the shared header */
+}
+
+/* dst becomes another handle to src's bytes */
+static inline void rs__v_from_string(void* dst, size_t z, const rs_string* src) {
+    rs_string t;
+
+    rs_string_init(&t);
+    rs_string_share(&t, src);
+    rs__v_free(dst, z);
+    rs__v_store(dst, z, &t);
+}
+static inline int rs__v_to_string(rs_string* dst, const void* src, size_t z) {
+    if (rs__v_big_inline(src, z)) return rs_string_assign(dst, rs__v_sv(src, z));
+
+    rs_string t = rs__v_load(src, z);
+    rs__retain(&t);
+    rs_string_free(dst);
+    *dst = t;
+    return 0;
+}
+
+// Generator
+#define RS_DEFINE_STRING(name, sso_cap)                                                            \
+    typedef struct name {                                                                          \
+        union { rs__vheap h; char raw[RS__VSIZE(sso_cap)]; } u;                                    \
+    } name;                                                                                        \
+    enum { name##_SSO_CAP = (int)RS__VSIZE(sso_cap) - 1 };                                         \
+    _Static_assert(RS__VSIZE(sso_cap) <= 128, #name ": inline capacity is limited to 127");        \
+                                                                                                   \
+    static inline void name##_init(name* s)                  { rs__v_init(s, sizeof(name)); }      \
+    static inline void name##_free(name* s)                  { rs__v_free(s, sizeof(name)); }      \
+    static inline size_t name##_len(const name* s)           { return rs__v_len(s, sizeof(name)); }\
+    static inline size_t name##_cap(const name* s)           { return rs__v_cap(s, sizeof(name)); }\
+    static inline bool name##_is_heap(const name* s)         { return rs__v_heap(s, sizeof(name)); }\
+    static inline rs_sv name##_sv(const name* s)             { return rs__v_sv(s, sizeof(name)); } \
+    static inline const char* name##_cstr(const name* s)     { return rs__v_cstr(s, sizeof(name)); }\
+    static inline int name##_reserve_ex(name* s, size_t n, rs_alloc a) {                           \
+        return rs__v_reserve_ex(s, sizeof(name), n, a);                                            \
+    }                                                                                              \
+    static inline int name##_reserve(name* s, size_t n)      { return name##_reserve_ex(s, n, rs_default_alloc()); } \
+    static inline int name##_assign(name* s, rs_sv v)        { return rs__v_assign(s, sizeof(name), v); } \
+    static inline int name##_clear(name* s)                  { return rs__v_assign(s, sizeof(name), (rs_sv){ "", 0 }); } \
+    static inline int name##_append(name* s, rs_sv v)        { return rs__v_append(s, sizeof(name), v); } \
+    static inline int name##_push_char(name* s, char c)      { return rs__v_append(s, sizeof(name), (rs_sv){ &c, 1 }); } \
+    static inline void name##_share(name* d, const name* s)  { rs__v_share(d, s, sizeof(name)); }  \
+    static inline bool name##_eq(const name* a, const name* b) { return rs_sv_eq(name##_sv(a), name##_sv(b)); } \
+    static inline int name##_cmp(const name* a, const name* b) { return rs_sv_cmp(name##_sv(a), name##_sv(b)); } \
+    static inline uint64_t name##_hash(const name* s)        { return rs__v_hash(s, sizeof(name)); }\
+    static inline void name##_from_string(name* d, const rs_string* s) { rs__v_from_string(d, sizeof(name), s); } \
+    static inline int name##_to_string(rs_string* d, const name* s)    { return rs__v_to_string(d, s, sizeof(name)); }
+
+// Type-routed front end: the rs_string_* names below accept a pointer to any listed
+// variant and keep calling the functions for everything else.
+#ifdef RS_STRING_VARIANTS
+#define RS__VDEF(name, cap) RS_DEFINE_STRING(name, cap)
+RS_STRING_VARIANTS(RS__VDEF)
+#undef RS__VDEF
+
+#define RS__VM_init(name, cap)      , name*: name##_init
+#define RS__VM_free(name, cap)      , name*: name##_free
+#define RS__VM_len(name, cap)       , name*: name##_len, const name*: name##_len
+#define RS__VM_cap(name, cap)       , name*: name##_cap, const name*: name##_cap
+#define RS__VM_is_heap(name, cap)   , name*: name##_is_heap, const name*: name##_is_heap
+#define RS__VM_sv(name, cap)        , name*: name##_sv, const name*: name##_sv
+#define RS__VM_cstr(name, cap)      , name*: name##_cstr, const name*: name##_cstr
+#define RS__VM_reserve(name, cap)   , name*: name##_reserve
+#define RS__VM_assign(name, cap)    , name*: name##_assign
+#define RS__VM_clear(name, cap)     , name*: name##_clear
+#define RS__VM_append(name, cap)    , name*: name##_append
+#define RS__VM_push_char(name, cap) , name*: name##_push_char
+#define RS__VM_eq(name, cap)        , name*: name##_eq, const name*: name##_eq
+#define RS__VM_cmp(name, cap)       , name*: name##_cmp, const name*: name##_cmp
+#define RS__VM_hash(name, cap)      , name*: name##_hash, const name*: name##_hash
+#define RS__VGEN(op, s) _Generic((s), default: rs_string_##op RS_STRING_VARIANTS(RS__VM_##op))
+#define RS__VFIRST(a, ...) a       /* variadic, so compound literals may hold commas */
+
+#define rs_string_init(...)       RS__VGEN(init, RS__VFIRST(__VA_ARGS__, 0))(__VA_ARGS__)
+#define rs_string_free(...)       RS__VGEN(free, RS__VFIRST(__VA_ARGS__, 0))(__VA_ARGS__)
+#define rs_string_len(...)        RS__VGEN(len, RS__VFIRST(__VA_ARGS__, 0))(__VA_ARGS__)
+#define rs_string_cap(...)        RS__VGEN(cap, RS__VFIRST(__VA_ARGS__, 0))(__VA_ARGS__)
+#define rs_string_is_heap(...)    RS__VGEN(is_heap, RS__VFIRST(__VA_ARGS__, 0))(__VA_ARGS__)
+#define rs_string_sv(...)         RS__VGEN(sv, RS__VFIRST(__VA_ARGS__, 0))(__VA_ARGS__)
+#define rs_string_cstr(...)       RS__VGEN(cstr, RS__VFIRST(__VA_ARGS__, 0))(__VA_ARGS__)
+#define rs_string_reserve(...)    RS__VGEN(reserve, RS__VFIRST(__VA_ARGS__, 0))(__VA_ARGS__)
+#define rs_string_assign(...)     RS__VGEN(assign, RS__VFIRST(__VA_ARGS__, 0))(__VA_ARGS__)
+#define rs_string_clear(...)      RS__VGEN(clear, RS__VFIRST(__VA_ARGS__, 0))(__VA_ARGS__)
+#define rs_string_append(...)     RS__VGEN(append, RS__VFIRST(__VA_ARGS__, 0))(__VA_ARGS__)
+#define rs_string_push_char(...)  RS__VGEN(push_char, RS__VFIRST(__VA_ARGS__, 0))(__VA_ARGS__)
+#define rs_string_eq(...)         RS__VGEN(eq, RS__VFIRST(__VA_ARGS__, 0))(__VA_ARGS__)
+#define rs_string_cmp(...)        RS__VGEN(cmp, RS__VFIRST(__VA_ARGS__, 0))(__VA_ARGS__)
+#define rs_string_hash(...)       RS__VGEN(hash, RS__VFIRST(__VA_ARGS__, 0))(__VA_ARGS__)
+#endif
@@ -2,7 +2,32 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <ctype.h>
 #include "rs_string.h"
+#include "rs_string_arena.h"
+#include "rs_string_pool.h"
+#include "rs_string_intern.h"
+#include "rs_string_rope.h"
+#include "rs_string_num.h"
+#include "rs_string_builder.h"
+#include "rs_string_io.h"
+#include "rs_string_ts.h"
+#define RS_PAR_THRESHOLD 4096   /* small inputs still take the chunked path */
+#define RS_PAR_CHUNK_MIN 1000
+#define RS_PAR_THREADS   4
+#include "rs_string_par.h"
+#include "rs_string_match.h"
+#include "rs_string_sort.h"
+#include "rs_string_iov.h"
+#if RS__HAVE_WRITEV
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#define RS_ENABLE_FLUENT 1
+#include "rs_string_fluent.h"
+#include "rs_string_api.h"
+#define RS_STRING_VARIANTS(X) X(rs_key, 15) X(rs_path, 63)
+#include "rs_string_variant.h"
 
 static void test_basic() {
     rs_string s = rs_string_from_val("Hello");
@@ -22,6 +47,106 @@ static void test_basic() {
     rs_string_free(&s);
 }
 
+static void test_layout() {
+#if RS_LAYOUT_COMPACT
+    assert(sizeof(rs_string) == 3 * sizeof(size_t));
+#endif
+    /* inline strings survive being copied by value, up to the very last inline byte */
+    char full[RS_SSO_CAP + 1];
+    memset(full, 'k', RS_SSO_CAP);
+    full[RS_SSO_CAP] = '\0';
+
+    rs_string a = rs_string_from_val(full);
+    rs_string b = a;
+    assert(!rs_string_is_heap(&b) && rs_string_len(&b) == RS_SSO_CAP);
+    assert(strcmp(rs_string_cstr(&b), full) == 0);
+
+    rs_string_push_char(&b, 'k'); /* spills to the heap */
+    assert(rs_string_is_heap(&b) && rs_string_len(&b) == RS_SSO_CAP + 1);
+    assert(strncmp(rs_string_cstr(&b), full, RS_SSO_CAP) == 0);
+
+    rs_string_erase(&b, 0, 2);
+    assert(rs_string_len(&b) == RS_SSO_CAP - 1 && rs_string_cap(&b) > RS_SSO_CAP);
+    rs_string_free(&b);
+    assert(!rs_string_is_heap(&b) && rs_string_len(&b) == 0 && rs_string_cstr(&b)[0] == '\0');
+}
+
+static void test_format() {
+    rs_string s; rs_string_init(&s);
+
+    /* fits the spare room (one byte is kept free behind the terminator) */
+    assert(rs_string_appendf(&s, "%d-%s", 7, "x") == 3 && strcmp(rs_string_cstr(&s), "7-x") == 0);
+    assert(rs_string_appendf(&s, "%0*d", (int)(RS_SSO_CAP - 4), 0) == (int)(RS_SSO_CAP - 4));
+    assert(!rs_string_is_heap(&s) && rs_string_len(&s) == RS_SSO_CAP - 1 && rs_string_cstr(&s)[RS_SSO_CAP - 1] == '\0');
+
+    /* does not fit: grows once, the argument may be the string itself */
+    const char* old = rs_string_cstr(&s);
+    assert(rs_string_appendf(&s, "|%s|", old) == (int)RS_SSO_CAP + 1);
+    assert(rs_string_is_heap(&s) && rs_string_len(&s) == 2 * RS_SSO_CAP);
+    assert(strncmp(rs_string_cstr(&s) + RS_SSO_CAP - 1, "|7-x", 4) == 0);
+    assert(rs_string_appendf(&s, "%s", rs_string_cstr(&s)) == (int)(2 * RS_SSO_CAP)); /* s += s, in place */
+    assert(rs_string_len(&s) == 4 * RS_SSO_CAP && memcmp(rs_string_cstr(&s), rs_string_cstr(&s) + 2 * RS_SSO_CAP, 2 * RS_SSO_CAP) == 0);
+
+    /* printf overwrites, also with its own bytes as argument */
+    assert(rs_string_printf(&s, "[%.3s] len=%zu", rs_string_cstr(&s), rs_string_len(&s)) > 0);
+    assert(strncmp(rs_string_cstr(&s), "[7-x] len=", 10) == 0);
+
+    /* a shared buffer is left alone */
+    rs_string t; rs_string_init(&t);
+    rs_string_share(&t, &s);
+    rs_string_appendf(&t, "%s", "!");
+    assert(rs_string_cstr(&s)[rs_string_len(&s) - 1] != '!' && rs_string_cstr(&t)[rs_string_len(&t) - 1] == '!');
+    rs_string_free(&t);
+
+    /* numbers */
+    rs_string_clear(&s);
+    rs_string_append_i64(&s, INT64_MIN);
+    rs_string_push_char(&s, ' ');
+    rs_string_append_u64(&s, UINT64_MAX);
+    rs_string_push_char(&s, ' ');
+    rs_string_append_i64(&s, 0);
+    assert(strcmp(rs_string_cstr(&s), "-9223372036854775808 18446744073709551615 0") == 0);
+
+    static const struct { double v; const char* want; } f[] = {
+        { 0.1, "0.1" }, { 1.0 / 3, "0.3333333333333333" }, { 100, "100" }, { -2.5, "-2.5" }, { 1e21, "1e+21" },
+        { 1e20, "100000000000000000000" }, { 1e-7, "1e-7" }, { 0.000001, "0.000001" }, { 5e-324, "5e-324" },
+        { 1.7976931348623157e308, "1.7976931348623157e+308" }, { -0.0, "-0" }, { 9007199254740993.0, "9007199254740992" },
+    };
+    for (size_t i = 0; i < sizeof f / sizeof *f; ++i) {
+        char buf[RS_NUM_BUF];
+        size_t n = rs_fmt_f64(f[i].v, buf);
+        assert(n == strlen(f[i].want) && memcmp(buf, f[i].want, n) == 0);
+    }
+
+    /* shortest round trip on random bit patterns */
+    uint64_t x = 88172645463325252ull;
+    for (int i = 0; i < 20000; ++i) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        uint64_t bits = i % 2 ? x : (x & 0x800FFFFFFFFFFFFFull) | ((uint64_t)(1023 - 40 + (int)(x >> 40) % 80) << 52);
+        double d, back;
+        char buf[RS_NUM_BUF + 1], ref[40];
+        memcpy(&d, &bits, sizeof d);
+        if (d != d || d - d != 0) continue; /* nan / inf */
+
+        buf[rs_fmt_f64(d, buf)] = '\0';
+        back = strtod(buf, NULL);
+        assert(memcmp(&back, &d, sizeof d) == 0);
+
+        int digits = 0; /* shortest %e that round-trips has as many significant digits */
+        do snprintf(ref, sizeof ref, "%.*e", digits++, d); while (strtod(ref, NULL) != d);
+        int sig = 0, lead = 1;
+        for (const char* p = buf; *p && *p != 'e'; ++p) {
+            if (*p >= '1' && *p <= '9') lead = 0;
+            if (!lead && *p >= '0' && *p <= '9') ++sig;
+        }
+        if (!strchr(buf, '.') && !strchr(buf, 'e'))
+            for (const char* p = buf + strlen(buf); p[-1] == '0'; --p) --sig;
+        assert(sig == digits);
+    }
+
+    rs_string_free(&s);
+}
+
 static void test_cow() {
     rs_string a = rs_string_from_val("data");
     rs_string b;
@@ -32,9 +157,88 @@ static void test_cow() {
     assert(strcmp(rs_string_cstr(&b), "data") == 0);
     rs_string_free(&a);
     rs_string_free(&b);
+
+    /* one reference per handle */
+    rs_string h = rs_string_from_val("a heap string, longer than the inline buffer");
+    rs_string c1, c2; rs_string_init(&c1); rs_string_init(&c2);
+    rs_string_share(&c1, &h);
+    rs_string_share(&c2, &c1);
+    rs_string_share(&c2, &h); /* re-sharing the same buffer keeps the count */
+    assert(rs__rc_get(&rs__hdr_of(&h)->rc) == 3);
+    rs_string_free(&c1);
+    assert(rs__rc_get(&rs__hdr_of(&h)->rc) == 2);
+
+    /* a confined buffer behaves the same, just without atomics */
+    rs_string_free(&c2);
+    assert(rs_string_confine(&h) == 0);
+    rs_string_share(&c1, &h);
+    assert(rs_string_confine(&h) == -1 && rs__rc_get(&rs__hdr_of(&h)->rc) == 2);
+    rs_string_append(&c1, rs_sv_from_cstr("!")); /* the copy stays confined */
+    assert(rs__rc_get(&rs__hdr_of(&h)->rc) == 1 && rs__hdr_is_local(rs__hdr_of(&c1)) == rs__hdr_is_local(rs__hdr_of(&h)));
+    rs_string_publish(&h);
+    assert(!rs__hdr_is_local(rs__hdr_of(&h)));
+    rs_string_free(&c1);
+    rs_string_free(&h);
 }
 
 
+static void test_slice() {
+    const char* text = "GET /a/fairly/long/request/path/that/lives/on/the/heap HTTP/1.1";
+    size_t tl = strlen(text);
+    rs_string req = rs_string_from_val(text);
+    rs_string path; rs_string_init(&path);
+    rs_string tail; rs_string_init(&tail);
+    rs_string verb; rs_string_init(&verb);
+    rs_string mid;  rs_string_init(&mid);
+
+    /* a slice that runs to the end shares the buffer, terminator included */
+    assert(rs_string_slice(&path, &req, 4, (size_t) - 1) == 0);
+    assert(rs_string_is_heap(&path) && rs_string_len(&path) == tl - 4);
+    assert(rs__heap_ptr(&path) == rs__heap_ptr(&req) + 4); /* zero-copy */
+    assert(rs__hdr_of(&req)->rc == 2 && rs_string_cap(&path) == tl - 4);
+    assert(rs_string_cstr(&path) == rs__heap_ptr(&req) + 4);
+    assert(rs_string_starts_with(&path, rs_sv_from_cstr("/a/fairly")));
+    assert(rs_string_find(&path, rs_sv_from_cstr("heap"), 0) == 46);
+    assert(rs_string_hash(&path) == rs_sv_hash((rs_sv){ text + 4, tl - 4 }));
+    assert(rs__hdr_of(&req)->hash == 0); /* the header's memo belongs to req's bytes */
+
+    /* slice of a slice still points into the original buffer */
+    assert(rs_string_slice(&tail, &path, 15, (size_t) - 1) == 0);
+    assert(rs__heap_ptr(&tail) == rs__heap_ptr(&req) + 19 && rs__hdr_of(&tail) == rs__hdr_of(&req));
+    assert(strcmp(rs_string_cstr(&tail), "request/path/that/lives/on/the/heap HTTP/1.1") == 0);
+
+    /* one that ends inside a shared buffer is copied, so it has its own terminator */
+    assert(rs_string_slice(&mid, &req, 4, 50) == 0 && rs_string_is_heap(&mid) && !rs__is_slice(&mid));
+    assert(strcmp(rs_string_cstr(&mid), "/a/fairly/long/request/path/that/lives/on/the/heap") == 0);
+    assert(rs__hdr_of(&req)->rc == 3 && strcmp(rs_string_cstr(&req), text) == 0);
+
+    /* short results are plain inline copies */
+    assert(rs_string_slice(&verb, &req, 0, 3) == 0);
+    assert(!rs_string_is_heap(&verb) && strcmp(rs_string_cstr(&verb), "GET") == 0);
+
+    /* writes detach only the slice */
+    assert(rs_string_push_char(&path, '/') == 0);
+    assert(rs__heap_ptr(&path) != rs__heap_ptr(&req) + 4 && !rs__is_slice(&path));
+    assert(strcmp(rs_string_cstr(&path), "/a/fairly/long/request/path/that/lives/on/the/heap HTTP/1.1/") == 0);
+    assert(strcmp(rs_string_cstr(&req), text) == 0);
+
+    /* the slice keeps the buffer alive and becomes its sole owner */
+    rs_string_free(&req);
+    assert(rs__hdr_of(&tail)->rc == 1);
+    assert(rs_string_erase(&tail, 0, 8) == 0 && rs__is_slice(&tail));
+    assert(strcmp(rs_string_cstr(&tail), "path/that/lives/on/the/heap HTTP/1.1") == 0);
+    char* at = rs__heap_ptr(&tail);
+    assert(rs_string_slice(&tail, &tail, 0, 27) == 0 && rs__is_slice(&tail)); /* in place */
+    assert(rs__heap_ptr(&tail) == at && strcmp(rs_string_cstr(&tail), "path/that/lives/on/the/heap") == 0);
+    assert(rs_string_append(&tail, rs_sv_from_cstr("!")) == 0);
+    assert(strcmp(rs_string_cstr(&tail), "path/that/lives/on/the/heap!") == 0);
+
+    rs_string_free(&path);
+    rs_string_free(&tail);
+    rs_string_free(&verb);
+    rs_string_free(&mid);
+}
+
 static void test_trim_split_replace() {
     rs_string s = rs_string_from_val(" \t hi  ");
     rs_string_trim(&s);
@@ -54,6 +258,1060 @@ static void test_trim_split_replace() {
     rs_string_free(&r);
 }
 
+/* reference splitter: every byte of `set` (or the whole of `sep`) ends a token */
+static size_t naive_split(rs_sv s, rs_sv sep, int byte_set, int keep_empty, rs_sv* out) {
+    size_t n = 0, start = 0, i = 0;
+    while (sep.len && i < s.len) {
+        size_t w = byte_set ? (memchr(sep.data, s.data[i], sep.len) ? 1 : 0)
+                            : (i + sep.len <= s.len && memcmp(s.data + i, sep.data, sep.len) == 0 ? sep.len : 0);
+        if (!w) { ++i; continue; }
+        if (i > start || keep_empty) out[n++] = (rs_sv){ s.data + start, i - start };
+        start = i += w;
+    }
+    if (s.len > start || keep_empty) out[n++] = (rs_sv){ s.data + start, s.len - start };
+    return n;
+}
+
+static void test_split_iter() {
+    static const char* seps[] = { ",", ",;", " \t\n,;", "ab", "", "a" };
+    char buf[200];
+    rs_sv want[256], got[256];
+    unsigned seed = 7;
+
+    for (int round = 0; round < 400; ++round) {
+        size_t len = (size_t)(round % 97) + (round > 300 ? 100 : 0);
+        for (size_t i = 0; i < len; ++i) {
+            seed = seed * 1103515245u + 12345u;
+            buf[i] = "ab,; \tx"[(seed >> 16) % 7];
+        }
+        rs_sv s = { buf, len };
+
+        for (size_t k = 0; k < sizeof seps / sizeof *seps; ++k) {
+            rs_sv sep = rs_sv_from_cstr(seps[k]);
+            for (int keep = 0; keep <= 1; ++keep) {
+                /* multi-byte separator: pull iterator */
+                size_t nw = naive_split(s, sep, 0, keep, want), ng = 0;
+                rs_sv_split_iter it;
+                rs_sv_split_iter_init(&it, s, sep, keep);
+                while (rs_sv_split_iter_next(&it, &got[ng])) ++ng;
+                assert(ng == nw);
+                for (size_t t = 0; t < nw; ++t) assert(got[t].data == want[t].data && got[t].len == want[t].len);
+
+                /* byte set: batch tokenizer, with a batch size that forces resuming */
+                nw = naive_split(s, sep, 1, keep, want);
+                size_t batch = (size_t)(round % 5) + 1, n;
+                rs_sv_tokenizer tk;
+                rs_sv_tokenizer_init(&tk, s, sep, keep);
+                ng = 0;
+                while ((n = rs_sv_tokenize(&tk, got + ng, batch)) != 0) ng += n;
+                assert(ng == nw);
+                for (size_t t = 0; t < nw; ++t) assert(got[t].data == want[t].data && got[t].len == want[t].len);
+            }
+        }
+    }
+
+    /* rs_sv_split keeps its callback shape on top of the iterator */
+    int tokens = 0;
+    rs_sv_split(rs_sv_from_cstr(",,"), rs_sv_from_cstr(","), 0, cb_count, &tokens);
+    assert(tokens == 0);
+    rs_sv_split(rs_sv_from_cstr(""), rs_sv_from_cstr(","), 1, cb_count, &tokens);
+    assert(tokens == 1);
+
+    rs_sv_tokenizer tk;
+    rs_sv_tokenizer_init_byte(&tk, rs_sv_from_cstr("k=v"), '=', 0);
+    assert(rs_sv_tokenize(&tk, got, 8) == 2 && got[1].len == 1 && got[1].data[0] == 'v');
+    assert(rs_sv_tokenize(&tk, got, 8) == 0);
+}
+
+static void test_replace_all() {
+    rs_string s = rs_string_from_val("aXbXXc");
+    assert(rs_string_replace_all(&s, rs_sv_from_cstr("X"), rs_sv_from_cstr("")) == 3);
+    assert(strcmp(rs_string_cstr(&s), "abc") == 0 && rs_string_len(&s) == 3);
+    assert(rs_string_replace_all(&s, rs_sv_from_cstr("zz"), rs_sv_from_cstr("y")) == 0);
+
+    /* growing: SSO -> heap in one allocation */
+    assert(rs_string_replace_all(&s, rs_sv_from_cstr("b"), rs_sv_from_cstr("-long replacement text-")) == 1);
+    assert(strcmp(rs_string_cstr(&s), "a-long replacement text-c") == 0);
+
+    /* non-overlapping, left to right */
+    rs_string_assign(&s, rs_sv_from_cstr("aaaaa"));
+    assert(rs_string_replace_all(&s, rs_sv_from_cstr("aa"), rs_sv_from_cstr("b")) == 2);
+    assert(strcmp(rs_string_cstr(&s), "bba") == 0);
+
+    /* shared buffer is detached, the other owner keeps the original */
+    rs_string big = rs_string_from_val("key=value; key=value; key=value");
+    rs_string alias; rs_string_init(&alias);
+    rs_string_share(&alias, &big);
+    assert(rs_string_replace_all(&big, rs_sv_from_cstr("key"), rs_sv_from_cstr("k")) == 3);
+    assert(strcmp(rs_string_cstr(&big), "k=value; k=value; k=value") == 0);
+    assert(strcmp(rs_string_cstr(&alias), "key=value; key=value; key=value") == 0);
+
+    /* needles past RS_FIND_SHORT_MAX, shrinking and growing */
+    const char* word = "a needle long enough for the Horspool path";
+    rs_string_assign(&s, rs_sv_from_cstr(word));
+    rs_string_append(&s, rs_sv_from_cstr(" | "));
+    rs_string_append(&s, rs_sv_from_cstr(word));
+    assert(rs_string_replace_all(&s, rs_sv_from_cstr(word), rs_sv_from_cstr("n")) == 2);
+    assert(strcmp(rs_string_cstr(&s), "n | n") == 0);
+    assert(rs_string_replace_all(&s, rs_sv_from_cstr("n"), rs_sv_from_cstr(word)) == 2);
+    assert(rs_string_replace_all(&s, rs_sv_from_cstr(word), rs_sv_from_cstr("[the same needle, grown by a little more]")) == 2);
+    assert(strcmp(rs_string_cstr(&s), "[the same needle, grown by a little more] | [the same needle, grown by a little more]") == 0);
+
+    /* a result past SIZE_MAX fails before touching the string */
+    assert(rs_string_replace_all(&s, rs_sv_from_cstr(" "), (rs_sv){ word, SIZE_MAX / 4 }) == -1);
+    assert(strcmp(rs_string_cstr(&s), "[the same needle, grown by a little more] | [the same needle, grown by a little more]") == 0);
+
+    rs_string_free(&alias);
+    rs_string_free(&big);
+    rs_string_free(&s);
+}
+
+static void test_trim_views() {
+    /* the block scans against a byte loop, across every alignment of the 16-byte blocks */
+    char buf[80];
+    uint32_t x = 7;
+    for (int round = 0; round < 2000; ++round) {
+        size_t n = (size_t)round % 70, lead = 0, keep;
+        for (size_t i = 0; i < n; ++i) { x ^= x << 13; x ^= x >> 17; x ^= x << 5; buf[i] = x % 3 ? " \t\n\r\x01"[x % 5] : (char)('!' + x % 90); }
+        while (lead < n && (unsigned char)buf[lead] <= 0x20) ++lead;
+        keep = n;
+        while (keep > lead && (unsigned char)buf[keep - 1] <= 0x20) --keep;
+
+        rs_sv v = { buf, n }, l = rs_sv_trim_left(v), r = rs_sv_trim_right(v), b = rs_sv_trim(v);
+        assert(l.data == buf + lead && l.len == n - lead);
+        assert(r.data == buf && (lead == n ? r.len == 0 : r.len == keep));
+        assert(b.data == buf + (lead == n ? 0 : lead) && b.len == (lead == n ? 0 : keep - lead));
+    }
+    assert(rs_sv_trim((rs_sv){ "", 0 }).len == 0);
+
+    rs_sv q = rs_sv_trim_cut(rs_sv_from_cstr("\"'quoted' \"'"), rs_sv_from_cstr("'\" "));
+    assert(q.len == 6 && memcmp(q.data, "quoted", 6) == 0);
+    rs_byteset digits = rs_byteset_of(rs_sv_from_cstr("0123456789"));
+    q = rs_sv_trim_set(rs_sv_from_cstr("0042abc17"), &digits);
+    assert(q.len == 3 && memcmp(q.data, "abc", 3) == 0);
+    assert(rs_sv_trim_set(rs_sv_from_cstr("123"), &digits).len == 0);
+
+    /* a heap string trims without moving or copying its bytes */
+    char text[200];
+    memset(text, ' ', sizeof text);
+    memcpy(text + 50, "payload", 7);
+    rs_string s; rs_string_init(&s);
+    rs_string_assign(&s, (rs_sv){ text, sizeof text });
+    const char* base = rs__cdata(&s);
+    size_t cap = rs_string_cap(&s);
+    assert(rs_string_trim_left(&s) == 0);
+    assert(rs__cdata(&s) == base + 50 && rs_string_len(&s) == 150);
+    assert(rs_string_cap(&s) == cap - 50);                        /* the room behind stays usable */
+    assert(rs_string_trim(&s) == 0 && rs_string_len(&s) == 7);
+    assert(rs_string_cstr(&s) == base + 50 && strcmp(rs_string_cstr(&s), "payload") == 0); /* terminated in place */
+    assert(rs_string_push_char(&s, '!') == 0 && strcmp(rs_string_cstr(&s), "payload!") == 0);
+    while (rs_string_len(&s) < cap - 50) assert(rs_string_push_char(&s, 'x') == 0);
+    assert(rs__cdata(&s) == base + 50 && rs_string_cstr(&s)[cap - 50] == '\0');       /* no realloc */
+    rs_string_free(&s);
+
+    /* on a shared buffer, a trim that keeps the end narrows without copying; one that
+     * cuts the end copies the kept bytes out (the other handle does not change) */
+    rs_string a, b; rs_string_init(&a); rs_string_init(&b);
+    rs_string_assign(&a, (rs_sv){ text, 57 });                        /* ends in "payload" */
+    rs_string_share(&b, &a);
+    assert(rs_string_trim(&b) == 0 && rs_string_len(&b) == 7);
+    assert(rs_string_is_heap(&a) && rs__rc_get(&rs__hdr_of(&a)->rc) == 2);
+    assert(rs_string_sv(&b).data - rs_string_sv(&a).data == 50);
+    assert(strcmp(rs_string_cstr(&b), "payload") == 0);
+    rs_string_assign(&a, (rs_sv){ text, sizeof text });
+    rs_string_share(&b, &a);
+    assert(rs_string_trim(&b) == 0 && strcmp(rs_string_cstr(&b), "payload") == 0);
+    assert(rs__rc_get(&rs__hdr_of(&a)->rc) == 1 && rs_string_len(&a) == sizeof text);
+    rs_string_share(&b, &a);
+    assert(rs_string_trim_left(&b) == 0 && rs_string_trim_cut(&b, rs_sv_from_cstr(" d")) == 0);
+    assert(strcmp(rs_string_cstr(&b), "payloa") == 0 && rs_string_cstr(&a)[57] == ' ');
+
+    /* trim_cut, inline and heap */
+    rs_string_assign(&a, rs_sv_from_cstr("--==[x]==--"));
+    assert(rs_string_trim_cut(&a, rs_sv_from_cstr("-=")) == 0 && strcmp(rs_string_cstr(&a), "[x]") == 0);
+    rs_string_assign(&a, rs_sv_from_cstr("################ the long heap title ################"));
+    assert(rs_string_trim_cut(&a, rs_sv_from_cstr("# ")) == 0 && strcmp(rs_string_cstr(&a), "the long heap title") == 0);
+    assert(rs_string_trim_cut(&a, rs_sv_from_cstr("te")) == 0 && strcmp(rs_string_cstr(&a), "he long heap titl") == 0);
+
+    /* all space: empty, inline or heap */
+    rs_string_assign(&a, rs_sv_from_cstr(" \t "));
+    assert(rs_string_trim(&a) == 0 && rs_string_len(&a) == 0 && rs_string_cstr(&a)[0] == '\0');
+    rs_string_assign(&a, (rs_sv){ text, 40 });
+    assert(rs_string_trim(&a) == 0 && rs_string_len(&a) == 0 && rs_string_cstr(&a)[0] == '\0');
+    rs_string_free(&a);
+    rs_string_free(&b);
+}
+
+static void test_append_many() {
+    rs_string s = rs_string_from_val("GET ");
+    rs_sv path = rs_sv_from_cstr("/index.html");
+    assert(rs_concat(&s, path, rs_sv_from_cstr(" HTTP/1.1"), rs_sv_from_cstr("\r\n")) == 0);
+    assert(rs_sv_eq(rs_string_sv(&s), rs_sv_from_cstr("GET /index.html HTTP/1.1\r\n")) && rs_string_cstr(&s)[26] == '\0');
+    size_t cap = rs_string_cap(&s);
+    assert(rs_string_append_many(&s, NULL, 0) == 0 && rs_string_cap(&s) == cap);
+
+    /* parts that view `s` itself survive the growth */
+    rs_sv self = rs_string_sv(&s);
+    assert(rs_concat(&s, self, self, self) == 0 && rs_string_len(&s) == 4 * self.len);
+    for (int i = 1; i < 4; ++i)
+        assert(memcmp(rs_string_cstr(&s) + i * self.len, "GET /index.html HTTP/1.1\r\n", self.len) == 0);
+
+    /* shared and sliced strings detach first */
+    rs_string other; rs_string_init(&other);
+    rs_string_share(&other, &s);
+    assert(rs_concat(&s, rs_sv_from_cstr("!")) == 0 && rs_string_len(&other) == 4 * self.len);
+    rs_string sl; rs_string_init(&sl);
+    assert(rs_string_slice(&sl, &other, 4, 40) == 0);
+    assert(rs_concat(&sl, rs_string_sv(&sl)) == 0 && rs_string_len(&sl) == 80);
+    assert(memcmp(rs_string_cstr(&sl), rs_string_cstr(&sl) + 40, 40) == 0 && rs_string_cstr(&sl)[80] == '\0');
+
+    /* builder: many small views, one allocation for the result */
+    rs_builder b; rs_builder_init(&b);
+    rs_string want; rs_string_init(&want);
+    const char* words[] = { "alpha", "beta", "", "gamma", "delta" };
+    for (int i = 0; i < 100; ++i) {
+        assert(rs_builder_add_cstr(&b, words[i % 5]) == 0);
+        assert(rs_builder_add(&b, rs_sv_from_cstr(",")) == 0);
+        rs_string_push_cstr(&want, words[i % 5]);
+        rs_string_push_char(&want, ',');
+    }
+    const char* run = "contiguous";
+    rs_builder_add(&b, (rs_sv){ run, 3 });
+    rs_builder_add(&b, (rs_sv){ run + 3, 7 }); /* continues the previous view */
+    rs_string_push_cstr(&want, run);
+    assert(rs_builder_count(&b) == 181 && rs_builder_len(&b) == rs_string_len(&want));
+
+    rs_string out = rs_string_from_val("> ");
+    assert(rs_builder_build(&b, &out) == 0 && rs_string_len(&out) == 2 + rs_string_len(&want));
+    assert(memcmp(rs_string_cstr(&out) + 2, rs_string_cstr(&want), rs_string_len(&want)) == 0);
+    assert(rs_string_cap(&out) - rs_string_len(&out) < 32); /* sized to fit, up to allocator rounding */
+
+    rs_builder_reset(&b);
+    rs_builder_add_string(&b, &want);
+    rs_string_clear(&out);
+    assert(rs_builder_build(&b, &out) == 0 && strcmp(rs_string_cstr(&out), rs_string_cstr(&want)) == 0);
+
+    rs_builder_free(&b);
+    rs_string_free(&out);
+    rs_string_free(&want);
+    rs_string_free(&sl);
+    rs_string_free(&other);
+    rs_string_free(&s);
+}
+
+static size_t fill_digits(char* p, size_t n, void* ctx) {
+    size_t keep = *(size_t*)ctx;
+    for (size_t i = keep; i < n; ++i) p[i] = (char)('0' + i % 10);
+    return n - 1; /* drop the last byte */
+}
+
+static void test_prepare_commit() {
+    rs_string s; rs_string_init(&s);
+
+    /* inline: the whole spare room can be filled */
+    char* w = rs_string_prepare(&s, 4);
+    assert(w && rs_string_avail(&s) == RS_SSO_CAP);
+    memset(w, 'x', RS_SSO_CAP);
+    assert(rs_string_commit(&s, RS_SSO_CAP + 1) == -1 && rs_string_len(&s) == 0);
+    assert(rs_string_commit(&s, RS_SSO_CAP) == 0 && !rs_string_is_heap(&s));
+    assert(rs_string_len(&s) == RS_SSO_CAP && rs_string_cstr(&s)[RS_SSO_CAP] == '\0');
+
+    /* read() straight into the final buffer */
+    FILE* f = tmpfile();
+    assert(f);
+    for (int i = 0; i < 1000; ++i) fputs("0123456789", f);
+    rewind(f);
+    rs_string_clear(&s);
+    for (;;) {
+        char* dst = rs_string_prepare(&s, 256);
+        assert(dst && rs_string_avail(&s) >= 256);
+        size_t got = fread(dst, 1, 256, f);
+        assert(rs_string_commit(&s, got) == 0);
+        if (got < 256) break;
+    }
+    fclose(f);
+    assert(rs_string_len(&s) == 10000 && rs_string_cstr(&s)[10000] == '\0');
+    assert(memcmp(rs_string_cstr(&s) + 9990, "0123456789", 10) == 0);
+
+    /* prepare on a shared string writes into a private copy */
+    rs_string other; rs_string_init(&other);
+    rs_string_share(&other, &s);
+    w = rs_string_prepare(&s, 1);
+    assert(w && rs_string_cstr(&other) != rs_string_cstr(&s));
+    *w = '!';
+    assert(rs_string_commit(&s, 1) == 0 && rs_string_len(&other) == 10000 && rs_string_cstr(&s)[10000] == '!');
+
+    /* resize_uninit keeps the prefix; resize_and_overwrite keeps what op returns */
+    char* p = rs_string_resize_uninit(&s, 12);
+    assert(p && rs_string_len(&s) == 12 && memcmp(p, "0123456789", 10) == 0 && p[12] == '\0');
+    size_t keep = 12;
+    assert(rs_string_resize_and_overwrite(&s, 100, fill_digits, &keep) == 0);
+    assert(rs_string_len(&s) == 99 && memcmp(rs_string_cstr(&s) + 90, "012345678", 10) == 0);
+
+    rs_string_free(&other);
+    rs_string_free(&s);
+}
+
+static void test_file_io() {
+    const char* path = "rs_string_test_io.tmp";
+    FILE* f = fopen(path, "wb");
+    assert(f);
+    for (int i = 0; i < 20000; ++i) fprintf(f, i % 3 ? "line %d\n" : "line %d\r\n", i);
+    for (int i = 0; i < 150000; ++i) fputc('a' + i % 26, f);  /* one line longer than a chunk */
+    fputs("\n\ntail", f);                                  /* empty line, no final newline */
+    fclose(f);
+
+    rs_string m; rs_string_init(&m);
+    assert(rs_string_map_file(&m, "rs_string_test_io.does-not-exist") == -1 && rs_string_len(&m) == 0);
+    assert(rs_string_map_file(&m, path) == 0);
+#if RS__HAVE_MMAP
+    assert(rs_string_is_mapped(&m));
+#endif
+    size_t size = rs_string_len(&m);
+    const char* data = rs_string_sv(&m).data;
+    assert(size > 200000 && rs_string_cstr(&m) == data && data[size] == '\0'); /* terminated, not copied */
+    assert(memcmp(data + size - 6, "\n\ntail", 6) == 0);
+
+    /* COW: shares and slices view the mapping, a write copies out */
+    rs_string cp; rs_string_init(&cp);
+    rs_string_share(&cp, &m);
+    rs_string part; rs_string_init(&part);
+    assert(rs_string_slice(&part, &m, size - 100, (size_t) - 1) == 0 && rs_string_sv(&part).data == data + size - 100);
+    assert(rs_string_cstr(&part)[100] == '\0');
+    assert(rs_string_hash(&cp) == rs_string_hash(&m));
+    assert(rs_string_append(&cp, rs_sv_from_cstr("!")) == 0 && !rs_string_is_mapped(&cp));
+    assert(rs_string_len(&cp) == size + 1 && rs_string_sv(&m).data == data);
+    rs_string_free(&cp);
+
+    /* streaming and in-memory readers agree line by line */
+    rs_line_reader fr, mr;
+    assert(rs_line_reader_open(&fr, path) == 0);
+    rs_line_reader_init_sv(&mr, rs_string_sv(&m));
+    rs_sv a, b;
+    size_t lines = 0;
+    char want[32];
+    while (rs_line_reader_next(&fr, &a)) {
+        assert(rs_line_reader_next(&mr, &b));
+        assert(a.len == b.len && memcmp(a.data, b.data, a.len) == 0);
+        if (lines < 20000) {
+            int n = snprintf(want, sizeof want, "line %zu", lines);
+            assert(a.len == (size_t)n && memcmp(a.data, want, a.len) == 0);
+        }
+        ++lines;
+    }
+    assert(!rs_line_reader_next(&mr, &b) && !rs_line_reader_error(&fr));
+    assert(lines == 20003 && a.len == 4 && memcmp(a.data, "tail", 4) == 0);
+    rs_line_reader_close(&fr);
+    rs_line_reader_close(&mr);
+
+    /* a small file is read instead */
+    const char* small = "rs_string_test_io_small.tmp";
+    f = fopen(small, "wb");
+    assert(f);
+    fputs("x\ny", f);
+    fclose(f);
+    rs_string_free(&m);
+    assert(rs_string_map_file(&m, small) == 0 && !rs_string_is_mapped(&m));
+    assert(strcmp(rs_string_cstr(&m), "x\ny") == 0);
+    assert(memcmp(rs_string_sv(&part).data + 94, "\n\ntail", 6) == 0); /* the old mapping lives on */
+
+    remove(small);
+    remove(path);
+    rs_string_free(&part);
+    rs_string_free(&m);
+}
+
+static size_t naive_find(rs_sv h, rs_sv n, size_t from) {
+    for (size_t i = from; i + n.len <= h.len; ++i)
+        if (memcmp(h.data + i, n.data, n.len) == 0) return i;
+    return (size_t)-1;
+}
+
+static void test_find() {
+    rs_string s = rs_string_from_val("the cat sat on the mat");
+    assert(rs_string_find(&s, rs_sv_from_cstr("at"), 0) == 5);
+    assert(rs_string_find(&s, rs_sv_from_cstr("at"), 6) == 9);
+    assert(rs_string_find(&s, rs_sv_from_cstr("dog"), 0) == (size_t)-1);
+    assert(rs_string_rfind(&s, rs_sv_from_cstr("the"), (size_t)-1) == 15);
+    assert(rs_string_rfind(&s, rs_sv_from_cstr("the"), 14) == 0);
+    assert(rs_string_rfind(&s, rs_sv_from_cstr(""), (size_t)-1) == rs_string_len(&s));
+    rs_string_free(&s);
+
+    /* differential check of every kernel (byte, SIMD short, Horspool) over a small alphabet */
+    char hay[700], ndl[80];
+    unsigned seed = 12345;
+    for (int iter = 0; iter < 2000; ++iter) {
+        size_t hn = (seed = seed * 1103515245u + 12345u) % sizeof hay;
+        size_t nn = 1 + (seed = seed * 1103515245u + 12345u) % (iter % 3 ? 6 : sizeof ndl);
+        for (size_t i = 0; i < hn; ++i) hay[i] = "ab"[(seed = seed * 1103515245u + 12345u) >> 16 & 1];
+        for (size_t i = 0; i < nn; ++i) ndl[i] = "ab"[(seed = seed * 1103515245u + 12345u) >> 16 & 1];
+        rs_sv h = { hay, hn }, n = { ndl, nn };
+        size_t from = hn ? iter % (hn + 1) : 0;
+
+        rs_finder f;
+        rs_finder_init(&f, n);
+        size_t want = naive_find(h, n, from);
+        assert(rs_sv_find(h, n, from) == want);
+        assert(rs_finder_find(&f, h, from) == want);
+
+        size_t last = (size_t)-1;
+        for (size_t p = naive_find(h, n, 0); p != (size_t)-1; p = naive_find(h, n, p + 1)) last = p;
+        assert(rs_sv_rfind(h, n, (size_t)-1) == last);
+    }
+}
+
+typedef struct { int mallocs, reallocs, frees; } counting_ctx;
+static void* cnt_m(size_t n, void* c)          { ((counting_ctx*)c)->mallocs++;  return malloc(n); }
+static void* cnt_r(void* p, size_t n, void* c) { ((counting_ctx*)c)->reallocs++; return realloc(p, n); }
+static void  cnt_f(void* p, void* c)           { ((counting_ctx*)c)->frees++;    free(p); }
+
+static void test_hash() {
+    char buf[128];
+    uint64_t seen[129];
+    for (size_t n = 0; n <= sizeof buf; ++n) { /* every tail path: 0..3, 4..16, 17..48, >48 */
+        memset(buf, 'h', n);
+        seen[n] = rs_sv_hash((rs_sv){ buf, n });
+        for (size_t k = 0; k < n; ++k) assert(seen[k] != seen[n]);
+    }
+    assert(rs_sv_hash(rs_sv_from_cstr("abc")) != rs_sv_hash_seed(rs_sv_from_cstr("abc"), 1));
+
+    rs_string small = rs_string_from_val("key");
+    rs_string big = rs_string_from_val("a key long enough to live on the heap");
+    assert(rs_string_hash(&small) == rs_sv_hash(rs_sv_from_cstr("key")));
+
+    uint64_t h = rs_string_hash(&big);
+    assert(h == rs_sv_hash(rs_sv_from_cstr("a key long enough to live on the heap")));
+    assert(rs__hdr_of(&big)->hash == h); /* memoized */
+    assert(rs_string_hash(&big) == h);
+
+    /* any write drops the memo */
+    rs_string_push_char(&big, '!');
+    assert(rs_string_hash(&big) == rs_sv_hash(rs_sv_from_cstr("a key long enough to live on the heap!")));
+    rs_string_erase(&big, 0, 2);
+    assert(rs_string_hash(&big) == rs_sv_hash(rs_sv_from_cstr("key long enough to live on the heap!")));
+
+    /* heap and inline copies of the same bytes hash alike */
+    rs_string_assign(&big, rs_sv_from_cstr("key"));
+    assert(rs_string_is_heap(&big) && rs_string_hash(&big) == rs_string_hash(&small));
+
+    rs_string_free(&small);
+    rs_string_free(&big);
+}
+
+#if RS_STATS
+static int stats_worker(void* arg) {
+    rs_string s = rs_string_from_val("a string long enough to live on the heap");
+    assert(rs_string_find(&s, rs_sv_from_cstr("heap"), 0) != (size_t)-1);
+    rs_string_free(&s);
+    (void)arg;
+    return 0;
+}
+#endif
+
+static void test_stats() {
+    rs_stats_reset();
+    rs_string s = rs_string_from_val("short");
+    rs_string t; rs_string_init(&t);
+    rs_string_append(&s, rs_sv_from_cstr(" and now too long for the inline buffer"));  /* promotion */
+    rs_string_share(&t, &s);
+    rs_string_push_char(&t, '!');                                                  /* COW copy */
+    rs_string_insert(&s, 5, rs_sv_from_cstr("[x]"));                               /* moves the tail */
+    size_t tail = rs_string_len(&s) - 8;
+    rs_string_find(&s, rs_sv_from_cstr("now"), 0);
+    rs_string_replace_all(&s, rs_sv_from_cstr("o"), rs_sv_from_cstr("0"));
+    rs_stats st = rs_stats_snapshot();
+
+#if RS_STATS
+    assert(st.heap_promotions == 1 && st.cow_copies == 1);
+    assert(st.moved_bytes == tail && st.finds == 1 && st.replaces == 1);
+    uint64_t sum = 0;
+    for (int b = 0; b < RS_STATS_BUCKETS; ++b) sum += st.reallocs_by_size[b];
+    assert(st.reallocs >= 1 && sum == st.reallocs && st.reallocs_by_size[0] >= 1);   /* the promotion: <= 64 bytes */
+
+    /* a thread's counts outlive it */
+    thrd_t th;
+    thrd_create(&th, stats_worker, NULL);
+    thrd_join(th, NULL);
+    st = rs_stats_snapshot();
+    assert(st.heap_promotions == 2 && st.finds == 2);
+
+    rs_stats_reset();
+    st = rs_stats_snapshot();
+    assert(st.heap_promotions == 0 && st.finds == 0 && st.moved_bytes == 0);
+
+    /* replace_all counts as one replace, not a find per match */
+    assert(rs_string_replace_all(&s, rs_sv_from_cstr("0"), rs_sv_from_cstr("oo")) == 6);
+    st = rs_stats_snapshot();
+    assert(st.finds == 0 && st.replaces == 1);
+#else
+    (void)tail;
+    static const rs_stats zero;
+    assert(memcmp(&st, &zero, sizeof st) == 0);   /* nothing is counted */
+#endif
+    rs_string_free(&s);
+    rs_string_free(&t);
+}
+
+/* blocks that really are rounded up to 64 bytes, and say so */
+static void* pad_m(size_t n, void* c) {
+    size_t* b = (size_t*)malloc(16 + ((n + 63) & ~(size_t)63));
+    (void)c;
+    if (!b) return NULL;
+    b[0] = (n + 63) & ~(size_t)63;
+    return (char*)b + 16;
+}
+static void  pad_f(void* p, void* c) { (void)c; if (p) free((char*)p - 16); }
+static size_t pad_usable(void* p, void* c) { (void)c; return *(size_t*)(void*)((char*)p - 16); }
+
+static size_t grow_calls;
+static size_t grow_double(size_t cap, size_t need, void* c) { (void)c; ++grow_calls; return cap * 2 > need ? cap * 2 : need; }
+
+static void test_shrink_growth() {
+    char big[5000];
+    memset(big, 'q', sizeof big);
+
+    /* back into SSO */
+    rs_string s; rs_string_init(&s);
+    rs_string_assign(&s, (rs_sv){ big, sizeof big });
+    rs_string_erase(&s, 10, sizeof big);
+    assert(rs_string_is_heap(&s) && rs_string_shrink_to_fit(&s) == 0);
+    assert(!rs_string_is_heap(&s) && rs_string_len(&s) == 10 && strcmp(rs_string_cstr(&s), "qqqqqqqqqq") == 0);
+
+    /* down to its length */
+    rs_string_assign(&s, (rs_sv){ big, sizeof big });
+    rs_string_erase(&s, 100, sizeof big);
+    assert(rs_string_cap(&s) >= sizeof big && rs_string_shrink_to_fit(&s) == 0);
+    assert(rs_string_cap(&s) >= 100 && rs_string_cap(&s) < 200 && rs_string_len(&s) == 100);
+    assert(rs_string_cstr(&s)[99] == 'q' && rs_string_cstr(&s)[100] == '\0');
+    rs_string_push_char(&s, '!');
+    assert(rs_string_len(&s) == 101);
+
+    /* a shared buffer stays shared */
+    rs_string t; rs_string_init(&t);
+    rs_string_reserve(&s, 4000);
+    rs_string_share(&t, &s);
+    size_t cap = rs_string_cap(&s);
+    assert(rs_string_shrink_to_fit(&t) == 0 && rs_string_cap(&t) == cap && rs__cdata(&t) == rs__cdata(&s));
+
+    /* a slice lets go of its parent */
+    rs_string_assign(&s, (rs_sv){ big, sizeof big });
+    rs_string_slice(&t, &s, sizeof big - 60, (size_t) - 1);
+    assert(rs__rc_get(&rs__hdr_of(&s)->rc) == 2);
+    assert(rs_string_shrink_to_fit(&t) == 0 && rs__rc_get(&rs__hdr_of(&s)->rc) == 1);
+    assert(rs_string_len(&t) == 60 && rs_string_cap(&t) >= 60 && rs_string_cstr(&t)[60] == '\0');
+    rs_string_free(&t);
+
+    /* per-allocator growth policy */
+    counting_ctx cc = {0};
+    rs_alloc ex = { cnt_m, cnt_r, cnt_f, &cc, NULL, rs_grow_exact, NULL };
+    rs_string e; rs_string_init(&e);
+    rs_string_reserve_ex(&e, 30, ex);
+    for (int i = 0; i < 40; ++i) {
+        rs_string_push_char(&e, 'x');
+        if (rs_string_len(&e) > 30) assert(rs_string_cap(&e) == rs_string_len(&e));  /* never any slack */
+    }
+    rs_string_free(&e);
+
+    rs_alloc dbl = { cnt_m, cnt_r, cnt_f, &cc, NULL, grow_double, NULL };
+    rs_string_reserve_ex(&e, 100, dbl);
+    for (int i = 0; i < 1000; ++i) rs_string_push_char(&e, 'x');
+    assert(rs_string_cap(&e) == 1600 && grow_calls == 5);   /* 100 -> 200 -> ... -> 1600 */
+    rs_string_free(&e);
+    assert(cc.frees == cc.mallocs);
+
+    /* the default: x1.5, then whole pages */
+    assert(rs_grow_default(100, 101, NULL) == 151 && rs_grow_default(100, 500, NULL) == 500);
+    size_t pg = rs_grow_default(1 << 20, (1 << 20) + 1, NULL);
+    assert(pg >= (1 << 20) + (1 << 19) && pg < (1 << 20) + (1 << 19) + RS_GROW_PAGE);
+    assert((pg + sizeof(rs__hdr) + 1 + 2 * sizeof(size_t)) % RS_GROW_PAGE == 0);
+
+    /* slack the allocator reports becomes capacity */
+    rs_alloc pad = { pad_m, NULL, pad_f, NULL, NULL, NULL, pad_usable };
+    rs_string_reserve_ex(&e, 100, pad);
+    cap = rs_string_cap(&e);
+    assert((cap + sizeof(rs__hdr) + 1) % 64 == 0 && cap >= 100);
+    for (size_t i = 0; i < cap; ++i) rs_string_push_char(&e, 'y');
+    assert(rs_string_cap(&e) == cap && rs_string_shrink_to_fit(&e) == 0);
+    assert(rs_string_len(&e) == cap && rs_string_cstr(&e)[cap - 1] == 'y');
+    rs_string_free(&e);
+    rs_string_free(&s);
+}
+
+/* the descriptor dies with this frame; the string must not depend on it */
+static rs_string from_scoped_alloc(counting_ctx* cc, const char* text) {
+    return rs_string_from_val_ex(text, (rs_alloc){ cnt_m, cnt_r, cnt_f, cc, NULL, NULL, NULL });
+}
+
+static void test_alloc_hook() {
+    counting_ctx cc = {0};
+    rs_alloc a = { cnt_m, cnt_r, cnt_f, &cc, NULL, NULL, NULL };
+
+    rs_string s = rs_string_from_val_ex("a string that does not fit inline", a);
+    rs_string t; rs_string_init(&t);
+    rs_string_share(&t, &s);
+    rs_string_append(&s, rs_sv_from_cstr(" ... and keeps growing past its capacity")); /* COW copy + grow */
+    rs_string_insert(&t, 0, rs_sv_from_cstr(">> "));
+    rs_string_replace_all(&s, rs_sv_from_cstr("a"), rs_sv_from_cstr("AAA"));
+    assert(cc.mallocs >= 3 && cc.reallocs >= 1);
+    assert(strncmp(rs_string_cstr(&t), ">> a string", 11) == 0);
+    rs_string_free(&s);
+    rs_string_free(&t);
+    assert(cc.frees == cc.mallocs); /* every buffer freed, through the hook */
+
+    unsigned char* bytes = NULL; size_t n = 0;
+    cc = (counting_ctx){0};
+    assert(0 == rs_utf16_from_ascii_bytes(rs_sv_from_cstr("hi"), 1, 0, a, &bytes, &n));
+    assert(cc.mallocs == 1);
+    free(bytes);
+
+    /* descriptors are copied in: one copy per distinct descriptor, outliving the caller's */
+    cc = (counting_ctx){0};
+    s = from_scoped_alloc(&cc, "a string that does not fit inline");
+    t = from_scoped_alloc(&cc, "another string too long for inline");
+    assert(rs__alloc_of(&s) == rs__alloc_of(&t) && rs__alloc_of(&s)->ctx == &cc);
+    rs_string_append(&s, rs_sv_from_cstr(" ... and keeps growing past its capacity"));
+    rs_string_free(&s);
+    rs_string_free(&t);
+    assert(cc.mallocs == 2 && cc.reallocs >= 1 && cc.frees == 2);
+    assert(rs__alloc_of(&s) == rs__alloc_intern((rs_alloc){0}));
+}
+
+static void test_arena() {
+    rs_arena ar;
+    rs_arena_init(&ar, 256);
+    rs_alloc a = rs_arena_alloc(&ar);
+
+    for (int round = 0; round < 3; ++round) {
+        rs_string s = rs_string_from_val_ex("", a);
+        rs_string_reserve_ex(&s, 40, a);
+        for (int i = 0; i < 100; ++i)
+            rs_string_append(&s, rs_sv_from_cstr("0123456789"));
+        assert(rs_string_len(&s) == 1000);
+        assert(rs_string_find(&s, rs_sv_from_cstr("90123"), 0) == 9);
+
+        rs_string k = rs_string_from_val_ex("key that lives in the arena too", a);
+        assert(strcmp(rs_string_cstr(&k), "key that lives in the arena too") == 0);
+
+        rs_arena_reset(&ar); /* no per-string free */
+    }
+
+    rs_arena_free(&ar);
+}
+
+static void test_pool() {
+    rs_pool pool;
+    assert(rs_pool_init(&pool) == 0);
+    rs_alloc a = rs_pool_alloc(&pool);
+
+    /* capacity is rounded up to the size class: prefix + header + 40 + NUL fit a 128-byte block */
+    rs_string s = rs_string_from_val_ex("0123456789012345678901234567890123456789", a);
+    size_t block = 64;
+    while (block < 16 + sizeof(rs__hdr) + 40 + 1) block *= 2;
+    assert(rs_string_cap(&s) == block - 16 - sizeof(rs__hdr) - 1);
+    size_t cap = rs_string_cap(&s);
+    while (rs_string_len(&s) < cap)
+        rs_string_push_char(&s, 'x');
+    assert(rs_string_cap(&s) == cap); /* the slack was usable without regrowing */
+
+    rs_string keys[100];
+    for (int i = 0; i < 100; ++i)
+        keys[i] = rs_string_from_val_ex("a key that is just past the inline capacity", a);
+    for (int i = 0; i < 100; ++i)
+        rs_string_free(&keys[i]);
+    for (int i = 0; i < 100; ++i)
+        keys[i] = rs_string_from_val_ex("a key that is just past the inline capacity", a);
+
+    rs_pool_stats st = rs_pool_get_stats(&pool);
+    assert(st.hits > 100 && st.misses > 0 && st.bytes_held >= RS_POOL_CHUNK);
+
+    for (int i = 0; i < 100; ++i)
+        rs_string_free(&keys[i]);
+
+    /* larger than the biggest class: plain malloc behind the same hook */
+    rs_string big; rs_string_init(&big);
+    rs_string_reserve_ex(&big, 10000, a);
+    rs_string_append(&big, rs_sv_from_cstr("big"));
+    assert(rs_pool_get_stats(&pool).large == 1);
+
+    rs_string_free(&big);
+    rs_string_free(&s);
+    rs_pool_thread_flush(&pool);
+    rs_pool_destroy(&pool);
+}
+
+static void* intern_m(size_t n, void* c) { return (*(int*)c)-- > 0 ? malloc(n) : NULL; }
+static void  intern_f(void* p, void* c)  { (void)c; free(p); }
+
+static void test_intern() {
+    rs_intern t;
+    rs_intern_init(&t);
+    rs_string a, b, c;
+    rs_string_init(&a); rs_string_init(&b); rs_string_init(&c);
+
+    assert(rs_intern_get(&t, rs_sv_from_cstr("host"), &a) == 0);
+    assert(rs_intern_get(&t, rs_sv_from_cstr("host"), &b) == 0);
+    assert(rs_intern_get(&t, rs_sv_from_cstr("port"), &c) == 0);
+    assert(rs_intern_same(&a, &b) && !rs_intern_same(&a, &c));
+    assert(rs_intern_count(&t) == 2);
+
+    /* writing to a handle detaches it; the canonical copy is untouched */
+    rs_string_append(&b, rs_sv_from_cstr("name"));
+    assert(strcmp(rs_string_cstr(&b), "hostname") == 0 && !rs_intern_same(&a, &b));
+    rs_intern_get(&t, rs_sv_from_cstr("host"), &b);
+    assert(rs_intern_same(&a, &b) && strcmp(rs_string_cstr(&b), "host") == 0);
+
+    /* enough keys to force several rehashes */
+    char key[32];
+    for (int round = 0; round < 2; ++round)
+        for (int i = 0; i < 1000; ++i) {
+            snprintf(key, sizeof key, "field_%d", i);
+            rs_intern_get(&t, rs_sv_from_cstr(key), &c);
+            assert(strcmp(rs_string_cstr(&c), key) == 0);
+        }
+    assert(rs_intern_count(&t) == 1002);
+
+    rs_intern_free(&t);
+    assert(strcmp(rs_string_cstr(&a), "host") == 0); /* handles outlive the table */
+    rs_string_free(&a); rs_string_free(&b); rs_string_free(&c);
+
+    /* a full table under memory pressure still answers hits; only inserts fail */
+    int budget = 1 << 20;
+    rs_intern_init_ex(&t, (rs_alloc){ intern_m, NULL, intern_f, &budget, NULL, NULL, NULL });
+    for (int i = 0; i < 48; ++i) {                 /* 48 of 64 slots: the next insert grows */
+        snprintf(key, sizeof key, "k%d", i);
+        assert(rs_intern_get(&t, rs_sv_from_cstr(key), &c) == 0);
+    }
+    budget = 0;
+    assert(rs_intern_get(&t, rs_sv_from_cstr("k7"), &c) == 0 && strcmp(rs_string_cstr(&c), "k7") == 0);
+    assert(rs_intern_get(&t, rs_sv_from_cstr("new"), &c) == -1 && rs_intern_count(&t) == 48);
+    rs_intern_free(&t);
+    rs_string_free(&c);
+}
+
+#ifdef RS_ATOMIC_REFCOUNT
+static rs_intern_mt g_mt;
+static int intern_worker(void* arg) {
+    rs_string s; rs_string_init(&s);
+    char key[32];
+    for (int i = 0; i < 2000; ++i) {
+        snprintf(key, sizeof key, "tag_%d", (i * 7 + (int)(intptr_t)arg) % 500);
+        rs_intern_mt_get(&g_mt, rs_sv_from_cstr(key), &s);
+        assert(strcmp(rs_string_cstr(&s), key) == 0);
+    }
+    rs_string_free(&s);
+    return 0;
+}
+
+static rs_string g_shared;
+static int share_worker(void* arg) {
+    (void)arg;
+    rs_string mine; rs_string_init(&mine);
+    for (int i = 0; i < 100000; ++i) {
+        rs_string_share(&mine, &g_shared);
+        assert(rs_string_len(&mine) == 64 && rs_string_cstr(&mine)[63] == 'z');
+        if (i % 1000 == 0) { /* writes detach without touching the shared copy */
+            rs_string_push_char(&mine, '!');
+            assert(rs_string_len(&mine) == 65);
+        }
+    }
+    rs_string_free(&mine);
+    return 0;
+}
+
+static void test_share_mt() {
+    char buf[65];
+    memset(buf, 'z', 64); buf[64] = '\0';
+    g_shared = rs_string_from_val(buf);
+
+    thrd_t th[4];
+    for (int i = 0; i < 4; ++i) thrd_create(&th[i], share_worker, NULL);
+    for (int i = 0; i < 4; ++i) thrd_join(th[i], NULL);
+    assert(rs__rc_get(&rs__hdr_of(&g_shared)->rc) == 1);
+    rs_string_free(&g_shared);
+}
+
+static void test_intern_mt() {
+    thrd_t th[4];
+    assert(rs_intern_mt_init(&g_mt) == 0);
+    for (int i = 0; i < 4; ++i) thrd_create(&th[i], intern_worker, (void*)(intptr_t)i);
+    for (int i = 0; i < 4; ++i) thrd_join(th[i], NULL);
+    assert(rs_intern_mt_count(&g_mt) == 500);
+    rs_intern_mt_free(&g_mt);
+}
+#endif
+
+static rs_string_ts g_ts;
+#define TS_THREADS 8
+#define TS_LINES   20000
+static int ts_worker(void* arg) {
+    char rec[16];
+    for (int i = 0; i < TS_LINES; ++i) {
+        snprintf(rec, sizeof rec, "%02d:%07d\n", (int)(intptr_t)arg, i); /* 11 bytes */
+        assert(rs_string_ts_append(&g_ts, (rs_sv){ rec, 11 }) == 0);
+    }
+    return 0;
+}
+
+/* every record whole; each writer's records in its own order */
+static void ts_check(const rs_string* s) {
+    int next[TS_THREADS] = { 0 };
+    const char* d = rs_string_cstr(s);
+    assert(rs_string_len(s) % 11 == 0);
+    for (size_t at = 0; at < rs_string_len(s); at += 11) {
+        int th = (d[at] - '0') * 10 + (d[at + 1] - '0'), seq = 0;
+        for (int i = 3; i < 10; ++i) seq = seq * 10 + (d[at + i] - '0');
+        assert(d[at + 2] == ':' && d[at + 10] == '\n');
+        assert(th >= 0 && th < TS_THREADS && seq == next[th]++);
+    }
+}
+
+static void test_ts() {
+    thrd_t th[TS_THREADS];
+    rs_string snap; rs_string_init(&snap);
+    assert(rs_string_ts_init(&g_ts) == 0);
+    for (int i = 0; i < TS_THREADS; ++i) thrd_create(&th[i], ts_worker, (void*)(intptr_t)i);
+
+    /* readers run alongside the writers */
+    for (int i = 0; i < 50; ++i) {
+        size_t before = rs_string_ts_len(&g_ts);
+        assert(rs_string_ts_snapshot(&g_ts, &snap) == 0 && rs_string_len(&snap) >= before);
+        ts_check(&snap);
+    }
+    for (int i = 0; i < TS_THREADS; ++i) thrd_join(th[i], NULL);
+
+    assert(rs_string_ts_len(&g_ts) == (size_t)TS_THREADS * TS_LINES * 11);
+    assert(rs_string_ts_appendf(&g_ts, "%0*d", 300, 7) == 0); /* longer than appendf's stack buffer */
+    assert(rs_string_ts_snapshot(&g_ts, &snap) == 0 && rs_string_len(&snap) == (size_t)TS_THREADS * TS_LINES * 11 + 300);
+    assert(rs_string_cstr(&snap)[rs_string_len(&snap) - 1] == '7');
+    rs_string_erase(&snap, rs_string_len(&snap) - 300, 300);
+    ts_check(&snap);
+
+    /* an append that cannot get its segments fails alone; later ones still publish */
+    assert(rs_string_ts_append(&g_ts, (rs_sv){ "x", SIZE_MAX / 4 }) == -1);
+    assert(rs_string_ts_append(&g_ts, (rs_sv){ "after", 5 }) == 0);
+    assert(rs_string_ts_len(&g_ts) == (size_t)TS_THREADS * TS_LINES * 11 + 305);
+    assert(rs_string_ts_snapshot(&g_ts, &snap) == 0 && rs_string_len(&snap) == rs_string_ts_len(&g_ts));
+
+    rs_string_ts_free(&g_ts);
+    assert(rs_string_ts_len(&g_ts) == 0);
+    rs_string_free(&snap);
+}
+
+static void test_par() {
+    static const char* needles[] = { "a", "aa", "aaa", "ab", "aba", "abab", "baab", "bbbbbbbb" };
+    uint32_t x = 12345;
+    rs_string s; rs_string_init(&s);
+
+    for (int round = 0; round < 6; ++round) {
+        rs_string_clear(&s);
+        size_t n = round == 5 ? 3000 : 20000 + 7919 * (size_t)round; /* the last one stays serial */
+        char* w = rs_string_prepare(&s, n);
+        for (size_t i = 0; i < n; ++i) {
+            x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+            w[i] = round == 0 ? 'a' : (x % (2 + round % 3) ? 'a' : 'b');  /* round 0: one long run */
+        }
+        rs_string_commit(&s, n);
+
+        for (size_t k = 0; k < sizeof needles / sizeof *needles; ++k) {
+            rs_sv nd = rs_sv_from_cstr(needles[k]);
+            size_t* at = NULL; size_t cnt = 0, want = 0;
+            assert(rs_string_find_all(&s, nd, (rs_alloc){0}, &at, &cnt) == 0);
+            for (size_t p = rs_string_find(&s, nd, 0); p != (size_t)-1; p = rs_string_find(&s, nd, p + nd.len))
+                assert(want < cnt && at[want++] == p);
+            assert(want == cnt && rs_string_count(&s, nd) == cnt);
+            free(at);
+
+            /* growing, shrinking and same-size replacement all match the serial one */
+            static const char* tos[] = { "", "X", "<replacement>" };
+            for (int t = 0; t < 3; ++t) {
+                rs_string a, b; rs_string_init(&a); rs_string_init(&b);
+                rs_string_assign(&a, rs_string_sv(&s));
+                rs_string_assign(&b, rs_string_sv(&s));
+                int ra = rs_string_replace_all_par(&a, nd, rs_sv_from_cstr(tos[t]));
+                int rb = rs_string_replace_all(&b, nd, rs_sv_from_cstr(tos[t]));
+                assert(ra == rb && (size_t)ra == cnt);
+                assert(rs_string_len(&a) == rs_string_len(&b) && strcmp(rs_string_cstr(&a), rs_string_cstr(&b)) == 0);
+                rs_string_free(&a); rs_string_free(&b);
+            }
+        }
+    }
+
+    size_t* at = (size_t*)1; size_t cnt = 1;
+    assert(rs_string_find_all(&s, rs_sv_from_cstr(""), (rs_alloc){0}, &at, &cnt) == 0 && cnt == 0 && at == NULL);
+    assert(rs_string_count(&s, rs_sv_from_cstr("zzz")) == 0);
+    rs_string_free(&s);
+}
+
+/* leftmost-longest by brute force; ties go to the lower id */
+static bool naive_find_any(rs_sv h, const rs_sv* pats, size_t n, size_t from, rs_match* out) {
+    for (size_t p = from; p < h.len; ++p) {
+        bool hit = false;
+        for (size_t k = 0; k < n; ++k)
+            if (pats[k].len && pats[k].len <= h.len - p && (!hit || pats[k].len > out->len) &&
+                memcmp(h.data + p, pats[k].data, pats[k].len) == 0) {
+                *out = (rs_match){ p, pats[k].len, k };
+                hit = true;
+            }
+        if (hit) return true;
+    }
+    return false;
+}
+
+static void test_matcher() {
+    static const char* words[] = { "ab", "abc", "b", "bca", "cab", "aaaa", "c", "", "bb", "abcabc",
+                                   "ca", "acb", "ba", "cc", "aab", "bcb", "cba", "abab", "a", "bac" };
+    uint32_t x = 99;
+    char text[700];
+
+    for (size_t np = 1; np <= 20; ++np) {
+        rs_sv pats[20], repl[20];
+        char rbuf[20][4];
+        for (size_t k = 0; k < np; ++k) {
+            pats[k] = rs_sv_from_cstr(words[(k * 7 + np) % 20]);
+            snprintf(rbuf[k], sizeof rbuf[k], "<%c>", (char)('A' + k));
+            repl[k] = rs_sv_from_cstr(rbuf[k]);
+        }
+        rs_matcher m;
+        assert(rs_matcher_init(&m, pats, np) == 0);
+
+        for (int round = 0; round < 4; ++round) {
+            size_t n = 1 + (size_t)round * 230;
+            for (size_t i = 0; i < n; ++i) { x ^= x << 13; x ^= x >> 17; x ^= x << 5; text[i] = (char)('a' + x % (3 + round % 2)); }
+            rs_sv h = { text, n };
+
+            /* every match, walked non-overlapping, as replace_many sees them */
+            rs_string want; rs_string_init(&want);
+            rs_match a, b;
+            size_t r = 0, cnt = 0;
+            while (naive_find_any(h, pats, np, r, &a)) {
+                assert(rs_matcher_find(&m, h, r, &b));
+                assert(a.pos == b.pos && a.len == b.len && a.id == b.id);
+                rs_string_append(&want, (rs_sv){ text + r, a.pos - r });
+                rs_string_append(&want, repl[a.id]);
+                r = a.pos + a.len;
+                ++cnt;
+            }
+            assert(!rs_matcher_find(&m, h, r, &b));
+            rs_string_append(&want, (rs_sv){ text + r, n - r });
+
+            /* from every offset, not only the ones a replace visits */
+            for (size_t from = 0; from < n; from += 13) {
+                bool ha = naive_find_any(h, pats, np, from, &a), hb = rs_matcher_find(&m, h, from, &b);
+                assert(ha == hb && (!ha || (a.pos == b.pos && a.len == b.len && a.id == b.id)));
+            }
+
+            rs_string s; rs_string_init(&s);
+            rs_string_assign(&s, h);
+            size_t id = 99, at = rs_string_find_any(&s, &m, 0, &id);
+            assert(cnt ? at != (size_t)-1 && id < np : at == (size_t)-1);
+            assert(rs_string_replace_many(&s, &m, repl) == (int)cnt);
+            assert(rs_string_len(&s) == rs_string_len(&want) && strcmp(rs_string_cstr(&s), rs_string_cstr(&want)) == 0);
+            rs_string_free(&s); rs_string_free(&want);
+        }
+        rs_matcher_free(&m);
+    }
+
+    /* the patterns are copies; bytes above 0x7F hit the high nibble tables */
+    char tmp[] = "\xC3\xA9t\xC3\xA9";
+    rs_sv one = rs_sv_from_cstr(tmp);
+    rs_matcher m;
+    assert(rs_matcher_init(&m, &one, 1) == 0);
+    tmp[0] = 'x';
+    rs_string s = rs_string_from_val("caf\xC3\xA9t\xC3\xA9 l'\xC3\xA9t\xC3\xA9");
+    assert(rs_string_replace_many(&s, &m, &(rs_sv){ "summer", 6 }) == 2);
+    assert(strcmp(rs_string_cstr(&s), "cafsummer l'summer") == 0);
+    assert(rs_matcher_pattern(&m, 0).len == 5 && rs_matcher_pattern(&m, 0).data[0] == '\xC3');
+    rs_matcher_free(&m);
+
+    /* patterns over every byte value: one class per byte, no more */
+    char all[256];
+    for (int b = 0; b < 256; ++b) all[b] = (char)(255 - b);
+    rs_sv many[16];
+    for (int k = 0; k < 16; ++k) many[k] = (rs_sv){ all + 16 * k, 16 };
+    assert(rs_matcher_init(&m, many, 16) == 0);
+    assert(m.ncls == 256 && m.nstates == 257);
+    rs_match hit;
+    for (size_t k = 0; k < 16; ++k)
+        assert(rs_matcher_find(&m, (rs_sv){ all, sizeof all }, 16 * k - (k > 0), &hit) && hit.pos == 16 * k && hit.id == k);
+    assert(!rs_matcher_find(&m, (rs_sv){ all, sizeof all - 1 }, 241, &hit));
+    rs_matcher_free(&m);
+
+    rs_sv empty = { "", 0 };
+    assert(rs_matcher_init(&m, &empty, 1) == 0);
+    assert(rs_string_find_any(&s, &m, 0, NULL) == (size_t)-1 && rs_string_replace_many(&s, &m, &empty) == 0);
+    rs_matcher_free(&m);
+    rs_string_free(&s);
+}
+
+static void test_rope() {
+    rs_rope r, snap, sub;
+    rs_rope_init(&r); rs_rope_init(&snap); rs_rope_init(&sub);
+    rs_string ref, flat;
+    rs_string_init(&ref); rs_string_init(&flat);
+
+    char text[64];
+    unsigned seed = 777;
+    for (int i = 0; i < 3000; ++i) {
+        size_t len = rs_rope_len(&r);
+        assert(len == rs_string_len(&ref));
+        seed = seed * 1103515245u + 12345u;
+        size_t pos = len ? (seed >> 8) % (len + 1) : 0;
+        size_t n = 1 + (seed >> 20) % 40;
+        for (size_t k = 0; k < n; ++k) text[k] = (char)('a' + (i + k) % 26);
+
+        switch (seed % 5) {
+        case 0: case 1:
+            rs_rope_append(&r, (rs_sv){ text, n });
+            rs_string_append(&ref, (rs_sv){ text, n });
+            break;
+        case 2:
+            rs_rope_insert(&r, pos, (rs_sv){ text, n });
+            rs_string_insert(&ref, pos, (rs_sv){ text, n });
+            break;
+        case 3:
+            rs_rope_erase(&r, pos, n / 2);
+            rs_string_erase(&ref, pos, n / 2);
+            break;
+        default:
+            if (len) assert(rs_rope_at(&r, pos % len) == rs_string_cstr(&ref)[pos % len]);
+        }
+    }
+
+    rs_rope_flatten(&r, &flat);
+    assert(strcmp(rs_string_cstr(&flat), rs_string_cstr(&ref)) == 0);
+
+    /* snapshots and substrings share nodes; editing one leaves the other intact */
+    rs_rope_share(&snap, &r);
+    rs_rope_substr(&sub, &r, 10, 100);
+    rs_rope_erase(&r, 0, rs_rope_len(&r) / 2);
+    rs_rope_insert(&r, 3, rs_sv_from_cstr("<edit>"));
+
+    rs_rope_flatten(&snap, &flat);
+    assert(strcmp(rs_string_cstr(&flat), rs_string_cstr(&ref)) == 0);
+    rs_rope_flatten(&sub, &flat);
+    assert(rs_string_len(&flat) == 100 && memcmp(rs_string_cstr(&flat), rs_string_cstr(&ref) + 10, 100) == 0);
+
+    /* the chunk iterator covers every byte exactly once */
+    size_t total = 0;
+    rs_sv piece;
+    for (rs_rope_iter it = rs_rope_iter_begin(&snap); rs_rope_iter_next(&it, &piece); ) {
+        assert(memcmp(piece.data, rs_string_cstr(&ref) + total, piece.len) == 0);
+        total += piece.len;
+    }
+    assert(total == rs_string_len(&ref));
+
+    /* zero-copy insertion of an existing heap string */
+    rs_string big = rs_string_from_val("a heap string shared into the rope");
+    rs_rope_insert_string(&sub, 0, &big);
+    assert(rs__hdr_of(&big)->rc == 2);
+    rs_rope_free(&sub);
+    assert(rs__hdr_of(&big)->rc == 1);
+
+    rs_string_free(&big);
+    rs_rope_free(&r); rs_rope_free(&snap);
+    rs_string_free(&ref); rs_string_free(&flat);
+}
+
 static void test_utf_converters() {
     /* UTF-16 <-> UTF-8 */
     unsigned char* u16 = NULL;
@@ -76,6 +1334,59 @@ static void test_utf_converters() {
     free(u32);
     rs_string_free(&u8b);
 
+    /* exact bytes, both byte orders, surrogate pairs */
+    static const unsigned char le16[] = { 0xFF,0xFE, 'H',0, 'i',0, ' ',0, 0x3D,0xD8, 0x0D,0xDC, 0,0 };
+    assert(0 == rs_utf16_from_utf8_bytes(rs_sv_from_cstr("Hi 🐍"), 1, 1, (rs_alloc){0}, &u16, &u16len));
+    assert(u16len == sizeof le16 && memcmp(u16, le16, sizeof le16) == 0);
+    free(u16);
+    assert(0 == rs_utf16_from_utf8_bytes(rs_sv_from_cstr("é"), 0, 0, (rs_alloc){0}, &u16, &u16len));
+    assert(u16len == 4 && u16[0] == 0x00 && u16[1] == 0xE9 && u16[2] == 0 && u16[3] == 0);
+    free(u16);
+
+    /* round trips over mixed text long enough for the ASCII blocks, through a custom allocator */
+    counting_ctx cc = {0};
+    rs_alloc ca = { cnt_m, cnt_r, cnt_f, &cc, NULL, NULL, NULL };
+    rs_string text; rs_string_init(&text);
+    static const char* pieces[] = { "plain ascii run that is long enough, ", "é", "€", "𝄞", "\x7f", "ж", "0123456789abcdef" };
+    for (int i = 0; i < 200; ++i) rs_string_push_cstr(&text, pieces[(i * 7 + i / 3) % 7]);
+
+    for (int le = 0; le <= 1; ++le) {
+        for (int bom = 0; bom <= 1; ++bom) {
+            rs_string back; rs_string_init(&back);
+
+            assert(0 == rs_utf16_from_utf8_bytes(rs_string_sv(&text), le, bom, ca, &u16, &u16len));
+            assert(0 == rs_utf8_from_utf16_bytes(&back, (rs_sv){ (const char*)u16, u16len }, bom ? !le : le));
+            assert(rs_string_len(&back) == rs_string_len(&text) && strcmp(rs_string_cstr(&back), rs_string_cstr(&text)) == 0);
+            cnt_f(u16, &cc);
+
+            assert(0 == rs_utf32_from_utf8_bytes(rs_string_sv(&text), le, bom, ca, &u32, &u32len));
+            assert(0 == rs_utf8_from_utf32_bytes(&back, (rs_sv){ (const char*)u32, u32len }, bom ? !le : le));
+            assert(strcmp(rs_string_cstr(&back), rs_string_cstr(&text)) == 0);
+            cnt_f(u32, &cc);
+
+            rs_string_free(&back);
+        }
+    }
+    assert(cc.mallocs == 8 && cc.frees == 8 && cc.reallocs == 0); /* one exact allocation each */
+    rs_string_free(&text);
+
+    /* malformed input is rejected, NUL ends a decoded string */
+    static const char* bad8[] = { "\xC0\xAF", "\xE0\x80\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80", "\xE2\x82", "\x80" };
+    for (size_t i = 0; i < sizeof bad8 / sizeof *bad8; ++i) {
+        assert(-1 == rs_utf16_from_utf8_bytes(rs_sv_from_cstr(bad8[i]), 1, 0, (rs_alloc){0}, &u16, &u16len));
+        assert(-1 == rs_utf32_from_utf8_bytes(rs_sv_from_cstr(bad8[i]), 1, 0, (rs_alloc){0}, &u32, &u32len));
+    }
+    rs_string d; rs_string_init(&d);
+    static const unsigned char lone[] = { 'a',0, 0x00,0xDC, 'b',0 };
+    static const unsigned char cut[]  = { 'a',0, 0x3D,0xD8 };
+    static const unsigned char nul[]  = { 'a',0, 0,0, 'b',0 };
+    static const unsigned char big32[] = { 0x00,0x00,0x11,0x00 };
+    assert(-1 == rs_utf8_from_utf16_bytes(&d, (rs_sv){ (const char*)lone, sizeof lone }, 1));
+    assert(-1 == rs_utf8_from_utf16_bytes(&d, (rs_sv){ (const char*)cut, sizeof cut }, 1));
+    assert(-1 == rs_utf8_from_utf32_bytes(&d, (rs_sv){ (const char*)big32, sizeof big32 }, 1));
+    assert(0 == rs_utf8_from_utf16_bytes(&d, (rs_sv){ (const char*)nul, sizeof nul }, 1) && strcmp(rs_string_cstr(&d), "a") == 0);
+    rs_string_free(&d);
+
     /* UTF-16 <-> ASCII */
     unsigned char* u16a = NULL; size_t u16alen = 0;
     assert(0 == rs_utf16_from_ascii_bytes(rs_sv_from_cstr("Hello"), 1, 1, (rs_alloc){0}, &u16a, &u16alen));
@@ -86,11 +1397,449 @@ static void test_utf_converters() {
     rs_string_free(&asc);
 }
 
+static void test_utf8_validate() {
+    static const char* atoms[] = { "a", "z0 ", "\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x90\x8D", "\xED\x9F\xBF", "\xF4\x8F\xBF\xBF",
+                                   /* broken */ "\x80", "\xC0\xAF", "\xE0\x9F\xBF", "\xED\xA0\x80", "\xF4\x90\x80\x80", "\xF5", "\xC3", "\xE2\x82" };
+    char buf[256];
+    unsigned seed = 99;
+
+    for (int round = 0; round < 3000; ++round) {
+        size_t len = 0, cps = 0;
+        while (len < (size_t)(round % 120)) {
+            seed = seed * 1103515245u + 12345u;
+            size_t k = (seed >> 16) % 7;
+            if ((seed >> 8) % 23 == 0) k = 7 + (seed >> 4) % 8; /* an occasional bad atom */
+            size_t al = strlen(atoms[k]);
+            if (len + al > sizeof buf) break;
+            memcpy(buf + len, atoms[k], al);
+            len += al;
+        }
+        rs_sv s = { buf, len };
+        int want = rs__utf8_measure(s, &cps, NULL) == 0; /* scalar reference */
+
+        assert(rs_utf8_validate(s) == want);
+#ifdef RS__SSSE3
+        assert(rs__utf8_valid_ssse3((const unsigned char*)buf, len) == want);
+#endif
+#ifdef RS__AVX2_DISPATCH
+        if (rs__cpu_has_avx2()) assert(rs__utf8_valid_avx2((const unsigned char*)buf, len) == want);
+#endif
+        if (want) assert(rs_utf8_count(s) == cps);
+    }
+
+    /* truncation counts code points and cuts on a boundary */
+    rs_string s = rs_string_from_val("h\xC3\xA9llo w\xC3\xB6rld, \xE2\x82\xAC and \xF0\x9F\x90\x8D and more ascii");
+    rs_string alias; rs_string_init(&alias);
+    assert(rs_utf8_count(rs_string_sv(&s)) == 35);
+    assert(rs_string_utf8_valid(&s) && (rs__hdr_of(&s)->flags & RS__HDR_UTF8_VALID));
+    rs_string_share(&alias, &s);
+    assert(rs_utf8_truncate(&s, 33) == 0 && rs_string_len(&s) == 40); /* shared: copied out */
+    assert(!rs__is_slice(&s) && rs__heap_ptr(&s) != rs__heap_ptr(&alias));
+    assert(rs_string_cstr(&s)[40] == '\0' && rs_string_len(&alias) == 42);
+    assert(rs_utf8_truncate(&s, 20) == 0 && rs_sv_eq(rs_string_sv(&s), rs_sv_from_cstr("h\xC3\xA9llo w\xC3\xB6rld, \xE2\x82\xAC and \xF0\x9F\x90\x8D")));
+    assert(rs_utf8_truncate(&s, 100) == 0 && rs_utf8_count(rs_string_sv(&s)) == 20);
+    assert(rs_utf8_truncate(&alias, 2) == 0 && rs_sv_eq(rs_string_sv(&alias), rs_sv_from_cstr("h\xC3\xA9")));
+
+    /* transcoder output is known valid; a write forgets it */
+    rs_string big; rs_string_init(&big);
+    static const unsigned char u16[] = { 0x3D,0xD8, 0x0D,0xDC, 'a',0, 'b',0, 'c',0, 'd',0, 'e',0, 'f',0, 'g',0, 'h',0,
+                                         'i',0, 'j',0, 'k',0, 'l',0, 'm',0, 'n',0, 'o',0, 'p',0, 'q',0, 'r',0, 's',0, 't',0 };
+    assert(0 == rs_utf8_from_utf16_bytes(&big, (rs_sv){ (const char*)u16, sizeof u16 }, 1));
+    assert(rs_string_is_heap(&big) && (rs__hdr_of(&big)->flags & RS__HDR_UTF8_VALID));
+    rs_string_push_char(&big, (char)0xFF);
+    assert(!(rs__hdr_of(&big)->flags & RS__HDR_UTF8_VALID) && !rs_string_utf8_valid(&big));
+
+    rs_string_free(&s);
+    rs_string_free(&alias);
+    rs_string_free(&big);
+}
+
+static void test_case_ascii() {
+    /* kernels against byte-at-a-time references, across alignments; bytes >= 0x80 never fold */
+    static const char alpha[] = "aAzZ@[`{09 \xC0\xC1\xDA\xE1\xFA\x80\xFF";
+    char hay[96], ndl[24], low[96];
+    uint32_t x = 11;
+    for (int round = 0; round < 4000; ++round) {
+        size_t n = (size_t)round % 90, m = 1 + (size_t)round % 7, off = (size_t)round % 5;
+        for (size_t i = 0; i < n; ++i) { x ^= x << 13; x ^= x >> 17; x ^= x << 5; hay[off + i] = alpha[x % 4 ? x % 4 : x % (sizeof alpha - 1)]; }
+        for (size_t i = 0; i < m; ++i) { x ^= x << 13; x ^= x >> 17; x ^= x << 5; ndl[i] = alpha[x % 4 ? x % 4 : x % (sizeof alpha - 1)]; }
+        rs_sv h = { hay + off, n }, nd = { ndl, m };
+
+        size_t want = (size_t)-1;
+        for (size_t i = 0; want == (size_t)-1 && i + m <= n; ++i) {
+            size_t k = 0;
+            while (k < m && tolower((unsigned char)h.data[i + k]) == tolower((unsigned char)ndl[k]) &&
+                   ((unsigned char)ndl[k] < 0x80 || h.data[i + k] == ndl[k])) ++k;
+            if (k == m) want = i;
+        }
+        assert(rs_sv_icase_find(h, nd, 0) == want);
+
+        bool ascii = true;
+        for (size_t i = 0; i < n; ++i) {
+            unsigned char c = (unsigned char)h.data[i];
+            low[i] = (char)(c >= 'A' && c <= 'Z' ? c + 32 : c);
+            ascii = ascii && c < 0x80;
+        }
+        assert(rs_sv_is_ascii(h) == ascii);
+        assert(rs_sv_ieq_ascii(h, (rs_sv){ low, n }));
+        if (n) {
+            low[n / 2] ^= 0x01;
+            assert(!rs_sv_ieq_ascii(h, (rs_sv){ low, n }));
+        }
+    }
+    assert(!rs_sv_ieq_ascii(rs_sv_from_cstr("\xC0"), rs_sv_from_cstr("\xE0"))); /* 'À' vs 'à': not ASCII */
+    assert(rs_sv_icase_find(rs_sv_from_cstr("abc"), rs_sv_from_cstr(""), 2) == 2);
+    assert(rs_sv_icase_find(rs_sv_from_cstr("abc"), rs_sv_from_cstr("C"), 3) == (size_t)-1);
+
+    /* in place: inline and heap */
+    rs_string a = rs_string_from_val("MiXeD 123");
+    assert(rs_string_to_lower_ascii(&a) == 0 && strcmp(rs_string_cstr(&a), "mixed 123") == 0);
+    assert(rs_string_to_upper_ascii(&a) == 0 && strcmp(rs_string_cstr(&a), "MIXED 123") == 0);
+
+    rs_string b = rs_string_from_val("The Quick Brown Fox Jumps Over The Lazy Dog \xC3\xA9 -- twice over");
+    rs_string c; rs_string_init(&c);
+    rs_string_share(&c, &b);
+    assert(rs_string_to_upper_ascii(&b) == 0);                       /* detaches, c keeps its bytes */
+    assert(strcmp(rs_string_cstr(&b), "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG \xC3\xA9 -- TWICE OVER") == 0);
+    assert(strcmp(rs_string_cstr(&c), "The Quick Brown Fox Jumps Over The Lazy Dog \xC3\xA9 -- twice over") == 0);
+    assert(rs__heap_ptr(&b) != rs__heap_ptr(&c));
+
+    rs_string_share(&c, &b);
+    assert(rs_string_to_upper_ascii(&c) == 0 && rs__heap_ptr(&b) == rs__heap_ptr(&c)); /* nothing to change: still shared */
+
+    rs_string_free(&a);
+    rs_string_free(&b);
+    rs_string_free(&c);
+}
+
+static int cmp_ref(rs_sv a, rs_sv b) {
+    size_t n = a.len < b.len ? a.len : b.len;
+    int c = n ? memcmp(a.data, b.data, n) : 0;
+    return c ? (c < 0 ? -1 : 1) : (a.len < b.len ? -1 : a.len > b.len);
+}
+static int qsort_sv(const void* x, const void* y) { return cmp_ref(*(const rs_sv*)x, *(const rs_sv*)y); }
+
+static void test_cmp_sort() {
+    /* eq / cmp / common prefix against memcmp, a difference at every offset of the blocks */
+    char a[80], b[80];
+    for (size_t n = 0; n < 70; ++n)
+        for (size_t at = 0; at <= n; ++at) {
+            for (size_t i = 0; i < n; ++i) a[i] = b[i] = (char)(i * 7);
+            if (at < n) b[at] = (char)(a[at] ^ (at & 1 ? 0x80 : 0x01));   /* high-bit bytes order unsigned */
+            rs_sv x = { a, n }, y = { b, n };
+            assert(rs_sv_common_prefix(x, y) == at);
+            assert(rs_sv_eq(x, y) == (at == n));
+            assert(rs_sv_cmp(x, y) == cmp_ref(x, y) && rs_sv_cmp(y, x) == -cmp_ref(x, y));
+            if (n) assert(rs_sv_cmp((rs_sv){ a, n - 1 }, x) < 0 && !rs_sv_eq((rs_sv){ a, n - 1 }, x));
+        }
+    assert(rs_sv_cmp((rs_sv){ "a\0b", 3 }, (rs_sv){ "a\0c", 3 }) < 0);   /* NULs are ordinary bytes */
+    assert(!rs_sv_eq((rs_sv){ "a\0b", 3 }, (rs_sv){ "a\0c", 3 }));
+
+    rs_string s = rs_string_from_val("a heap string well past the inline capacity"), t, u;
+    rs_string_init(&t); rs_string_init(&u);
+    rs_string_share(&t, &s);
+    assert(rs_string_eq(&s, &t) && rs_string_cmp(&s, &t) == 0);
+    rs_string_assign(&u, rs_string_sv(&s));
+    assert(rs_string_eq(&s, &u));
+    (void)rs_string_hash(&s);
+    rs_string_assign(&u, rs_sv_from_cstr("a heap string well past the inline capacitz"));
+    (void)rs_string_hash(&u);
+    assert(!rs_string_eq(&s, &u) && rs_string_cmp(&s, &u) < 0 && rs_string_eq_sv(&u, rs_string_sv(&u)));
+
+    /* the sort against qsort: tiny alphabets (with NUL and 0xFF) for many ties, long shared prefixes */
+    static const char alpha[] = { 'a', 'b', '\0', (char)0xFF };
+    static const char pre[] = "https://example.com/assets/images/";
+    char pool[4000 * 48];
+    rs_sv v[4000], w[4000];
+    uint32_t x = 5;
+    for (int round = 0; round < 40; ++round) {
+        size_t n = round < 20 ? (size_t)round : (size_t)round * 100, plen = round % 3 ? 0 : sizeof pre - 1;
+        for (size_t i = 0; i < n; ++i) {
+            char* p = pool + i * 48;
+            x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+            size_t len = plen + x % (round % 4 == 1 ? 3 : 14);
+            memcpy(p, pre, plen);
+            for (size_t k = plen; k < len; ++k) { x ^= x << 13; x ^= x >> 17; x ^= x << 5; p[k] = alpha[x % (round % 2 ? 2 : 4)]; }
+            v[i] = w[i] = (rs_sv){ p, len };
+        }
+        assert(rs_sort_views(v, n) == 0);
+        if (n) qsort(w, n, sizeof *w, qsort_sv);
+        for (size_t i = 0; i < n; ++i) assert(rs_sv_eq(v[i], w[i]));
+    }
+
+    rs_string_free(&s);
+    rs_string_free(&t);
+    rs_string_free(&u);
+}
+
+static void test_variants() {
+    assert(sizeof(rs_key) == 3 * sizeof(size_t) || sizeof(rs_key) == RS__VSIZE(RS_SSO_CAP));
+    assert(rs_key_SSO_CAP >= 15 && rs_key_SSO_CAP >= RS_SSO_CAP && sizeof(rs_key) == rs_key_SSO_CAP + 1);
+    assert(rs_path_SSO_CAP == 63 && sizeof(rs_path) == 64);
+
+    /* the front end routes by type; a full inline path spills on the next byte */
+    char text[200];
+    for (size_t i = 0; i < sizeof text; ++i) text[i] = (char)('a' + i % 26);
+    rs_path p; rs_string_init(&p);
+    for (size_t i = 0; i < 63; ++i) assert(rs_string_push_char(&p, text[i]) == 0);
+    assert(!rs_string_is_heap(&p) && rs_string_len(&p) == 63 && rs_string_cap(&p) == 63);
+    assert(memcmp(rs_string_cstr(&p), text, 63) == 0 && rs_string_cstr(&p)[63] == '\0');
+    assert(rs_string_append(&p, (rs_sv){ text + 63, 5 }) == 0 && rs_string_is_heap(&p));
+    assert(rs_sv_eq(rs_string_sv(&p), (rs_sv){ text, 68 }) && strlen(rs_string_cstr(&p)) == 68);
+
+    /* appending its own inline bytes across the spill */
+    rs_path q; rs_string_init(&q);
+    rs_string_assign(&q, (rs_sv){ text, 40 });
+    assert(rs_string_append(&q, rs_string_sv(&q)) == 0 && rs_string_len(&q) == 80);
+    assert(memcmp(rs_string_cstr(&q), text, 40) == 0 && memcmp(rs_string_cstr(&q) + 40, text, 40) == 0);
+
+    /* keys share heap buffers and copy on write */
+    rs_key a, b; rs_key_init(&a); rs_key_init(&b);
+    rs_string_assign(&a, (rs_sv){ text, 100 });
+    rs_key_share(&b, &a);
+    assert(rs_string_sv(&a).data == rs_string_sv(&b).data && rs_string_eq(&a, &b) && rs_string_hash(&a) == rs_string_hash(&b));
+    assert(rs_string_push_char(&b, '!') == 0 && rs_string_sv(&a).data != rs_string_sv(&b).data);
+    assert(rs_string_len(&a) == 100 && rs_string_len(&b) == 101 && rs_string_cmp(&a, &b) < 0);
+    assert(rs_string_assign(&b, rs_sv_from_cstr("short")) == 0 && !rs_string_is_heap(&b)); /* back inline */
+    assert(strcmp(rs_string_cstr(&b), "short") == 0 && rs_string_hash(&b) == rs_sv_hash(rs_sv_from_cstr("short")));
+    assert(rs_string_clear(&b) == 0 && rs_string_len(&b) == 0);
+
+    /* to and from rs_string without copying heap bytes; slices stay slices */
+    rs_string s = rs_string_from_val("a heap string well past the inline capacity of the default"), t, u;
+    rs_string_init(&t); rs_string_init(&u);
+    rs_key_from_string(&b, &s);
+    assert(rs_string_sv(&b).data == rs_string_sv(&s).data);
+    assert(rs_string_slice(&t, &s, 2, 30) == 0);
+    rs_key_from_string(&a, &t);
+    assert(rs_string_sv(&a).data == rs_string_sv(&t).data && strcmp(rs_string_cstr(&a), "heap string well past the inli") == 0);
+    assert(rs_key_to_string(&u, &b) == 0 && rs_string_sv(&u).data == rs_string_sv(&s).data);
+    assert(rs_path_to_string(&u, &q) == 0 && rs_string_eq_sv(&u, rs_string_sv(&q)));
+    rs_string_free(&s);
+    rs_string_free(&t);
+    rs_string_free(&u);
+    assert(memcmp(rs_string_cstr(&b), "a heap string", 13) == 0);        /* b still holds a reference */
+
+    rs_string_assign(&q, (rs_sv){ text, 50 });                             /* inline > RS_SSO_CAP */
+    rs_string_init(&u);
+    assert(rs_path_to_string(&u, &q) == 0 && rs_string_eq_sv(&u, (rs_sv){ text, 50 }));
+    rs_string_free(&u);
+
+    rs_string_free(&a);
+    rs_string_free(&b);
+    rs_string_free(&p);
+    rs_string_free(&q);
+}
+
+static void* budget_m(size_t n, void* c) { return (*(int*)c)-- > 0 ? malloc(n) : NULL; }
+static void  budget_f(void* p, void* c)  { (void)c; free(p); }
+static const char text_40[] = "0123456789012345678901234567890123456789";
+
+static void test_fluent() {
+    rs_string s = rs_string_from_val("  padded  "), t;
+    rs_string_init(&t);
+
+    /* steps run in order on the target; nested chains keep their own */
+    assert(RS(&s, trim(), append((rs_sv){ ", x", 3 }), push_char('!'), replace_all((rs_sv){ "x", 1 }, (rs_sv){ "yy", 2 })) == 0);
+    assert(strcmp(rs_string_cstr(&s), "padded, yy!") == 0);
+    assert(RS(&s, appendf(" %d", RS(&t, assign(rs_sv_from_cstr("inner")), to_upper_ascii()) + 7), insert(0, (rs_sv){ ">", 1 })) == 0);
+    assert(strcmp(rs_string_cstr(&s), ">padded, yy! 7") == 0 && strcmp(rs_string_cstr(&t), "INNER") == 0);
+
+    /* the first failure stops the chain */
+    int budget = 1;
+    rs_alloc once = { budget_m, NULL, budget_f, &budget, NULL, NULL, NULL };
+    rs_string u; rs_string_init(&u);
+    assert(rs_string_reserve_ex(&u, 30, once) == 0 && rs_string_is_heap(&u));
+    assert(RS(&u, assign((rs_sv){ "abc", 3 }), append((rs_sv){ text_40, 40 }), clear()) == -1);
+    assert(strcmp(rs_string_cstr(&u), "abc") == 0);
+    rs_string_free(&u);
+    rsf c = { &s, 0 };
+    assert(rsf_trim_cut(rsf_clear(&c), rs_sv_from_cstr(" "))->err == 0 && rs_string_len(&s) == 0);
+
+    /* is_shared / retain / release */
+    rs_string_assign(&s, rs_sv_from_cstr("a heap string past the inline capacity"));
+    assert(!rs_string_is_shared(&s));
+    rs_string copy = s;
+    assert(rs_string_retain(&copy) == 0 && rs_string_is_shared(&s) && rs_string_is_shared(&copy));
+    rs_string_release(&copy);
+    assert(!rs_string_is_shared(&s) && rs_string_len(&copy) == 0);
+
+    assert(RS(&s, free_()) == 0 && rs_string_len(&s) == 0);
+    RS(&t, clear(), push_cstr("stmt"));   /* statement use, result ignored */
+
+    /* rs(f) is the direct function; rs() is the table of the same functions */
+    assert(rs(append)(&t, (rs_sv){ "!", 1 }) == 0 && rs(len)(&t) == 5);
+    assert(rs()->append == rs_string_append && rs()->free_ == rs_string_free);
+    assert(rs()->trim(&t) == 0 && strcmp(rs(cstr)(&t), "stmt!") == 0);
+    rs_string_free(&t);
+}
+
+static void test_iov() {
+    /* a heap string, an inline one, borrowed bytes and a rope, without concatenating */
+    char big[3000];
+    for (size_t i = 0; i < sizeof big; ++i) big[i] = (char)('a' + i % 26);
+    rs_string body = rs_string_from_val("this body lives in a heap buffer of its own"), small = rs_string_from_val("hdr: 1\r\n");
+    rs_rope r; rs_rope_init(&r);
+    for (int i = 0; i < 40; ++i) rs_rope_append(&r, (rs_sv){ big, 100 + (size_t)i });
+    rs_rope_insert(&r, 50, (rs_sv){ "<ins>", 5 });
+    rs_string want; rs_string_init(&want);
+    rs_rope_flatten(&r, &want);
+    rs_string_iov q; rs_string_iov_init(&q);
+
+    assert(rs_string_iov_add_sv(&q, rs_sv_from_cstr("HTTP/1.1 200 OK\r\n")) == 0);
+    assert(rs_string_iov_add(&q, &small) == 0 && rs_string_iov_add(&q, &body) == 0);
+    assert(rs_string_is_shared(&body));                          /* pinned, not copied */
+    assert(rs_string_iov_add_rope(&q, &r) == 0 && rs_string_iov_add_sv(&q, (rs_sv){ "", 0 }) == 0);
+    rs_string_insert(&want, 0, rs_string_sv(&body));
+    rs_string_insert(&want, 0, rs_sv_from_cstr("HTTP/1.1 200 OK\r\nhdr: 1\r\n"));
+    rs_string_free(&body);                                         /* the queue keeps the bytes */
+    rs_string_free(&small);
+    rs_rope_free(&r);
+    assert(rs_string_iov_len(&q) == rs_string_len(&want) && rs_string_iov_count(&q) >= 4);
+
+    /* drain in uneven steps, checking the gathered bytes each time */
+    size_t done = 0, step = 1;
+    rs_iovec v[8];
+    while (rs_string_iov_len(&q)) {
+        size_t k = rs_string_iov_fill(&q, v, 8), at = done;
+        for (size_t i = 0; i < k; ++i) {
+            assert(memcmp(v[i].iov_base, rs_string_cstr(&want) + at, v[i].iov_len) == 0);
+            at += v[i].iov_len;
+        }
+        rs_string_iov_consume(&q, step);
+        done += step < at - done ? step : at - done;
+        assert(rs_string_iov_len(&q) == rs_string_len(&want) - done);
+        step = step * 3 + 1;
+        if (step > 700) step = 5;
+    }
+    assert(rs_string_iov_count(&q) == 0);
+
+#if RS__HAVE_WRITEV
+    /* partial writes through a non-blocking pipe */
+    int fd[2];
+    assert(pipe(fd) == 0 && fcntl(fd[0], F_SETFL, O_NONBLOCK) == 0 && fcntl(fd[1], F_SETFL, O_NONBLOCK) == 0);
+    rs_string blob; rs_string_init(&blob);
+    for (int i = 0; i < 3000; ++i) rs_string_append(&blob, (rs_sv){ big, 97 });   /* > a pipe buffer */
+    for (int i = 0; i < 3000; ++i) rs_string_iov_add_sv(&q, (rs_sv){ rs_string_cstr(&blob) + (size_t)i * 97, 97 });
+    rs_string_iov_add(&q, &blob);                      /* one segment larger than the pipe */
+    rs_string got; rs_string_init(&got);
+    char buf[8192];
+    size_t total = 0;
+    int partial = 0;                                   /* writes that stop mid-segment */
+    while (rs_string_iov_len(&q)) {
+        ptrdiff_t w = rs_string_iov_writev(&q, fd[1]);
+        assert(w > 0 || (w < 0 && errno == EAGAIN));
+        if (w > 0) {                                   /* keep writing until the pipe is full */
+            total += (size_t)w;
+            partial += total % 97 != 0;
+            continue;
+        }
+        ptrdiff_t n;
+        while ((n = read(fd[0], buf, sizeof buf)) > 0) rs_string_append(&got, (rs_sv){ buf, (size_t)n });
+    }
+    ptrdiff_t n;
+    while ((n = read(fd[0], buf, sizeof buf)) > 0) rs_string_append(&got, (rs_sv){ buf, (size_t)n });
+    assert(rs_string_len(&got) == 2 * rs_string_len(&blob) && partial > 0);
+    assert(!memcmp(rs_string_cstr(&got), rs_string_cstr(&blob), rs_string_len(&blob)));
+    assert(!memcmp(rs_string_cstr(&got) + rs_string_len(&blob), rs_string_cstr(&blob), rs_string_len(&blob)));
+    close(fd[0]);
+    close(fd[1]);
+    rs_string_free(&blob);
+    rs_string_free(&got);
+#endif
+
+    rs_string_iov_free(&q);
+    rs_string_free(&want);
+}
+
+/* cases the differential fuzzer (fuzz_rs_string.c) found */
+static void* fail_nth_m(size_t n, void* c) { return (*(int*)c)-- == 0 ? NULL : malloc(n); }
+
+static void test_fuzz_finds() {
+    /* erase with a count of "to the end" */
+    rs_string s = rs_string_from_val("hello world");
+    assert(rs_string_erase(&s, 5, (size_t)-1) == 0 && strcmp(rs_string_cstr(&s), "hello") == 0);
+
+    /* append_many of a self view on a narrowed heap string whose result fits inline */
+    rs_string_assign(&s, (rs_sv){ "                                      ab", 40 });
+    assert(rs_string_trim(&s) == 0 && rs_string_len(&s) == 2);
+    rs_sv parts[2] = { rs_string_sv(&s), { "cd", 2 } };
+    assert(rs_string_append_many(&s, parts, 2) == 0 && strcmp(rs_string_cstr(&s), "ababcd") == 0);
+    rs_string_free(&s);
+
+    /* replace_first on a shared buffer whose private copy fails: all or nothing */
+    int fail_in = 1;
+    rs_alloc a = { fail_nth_m, NULL, budget_f, &fail_in, NULL, NULL, NULL };
+    rs_string t;
+    rs_string_init(&t);
+    assert(rs_string_reserve_ex(&s, 64, a) == 0 && rs_string_assign(&s, (rs_sv){ text_40, 40 }) == 0);
+    rs_string_share(&t, &s);
+    assert(rs_string_replace_first(&s, (rs_sv){ "12", 2 }, (rs_sv){ "twelve", 6 }) == -1);
+    assert(rs_string_eq_sv(&s, (rs_sv){ text_40, 40 }) && rs_string_eq(&s, &t));
+    assert(rs_string_replace_first(&s, (rs_sv){ "12", 2 }, (rs_sv){ "twelve", 6 }) == 0);
+    assert(strncmp(rs_string_cstr(&s), "0twelve345", 10) == 0 && rs_string_eq_sv(&t, (rs_sv){ text_40, 40 }));
+    rs_string_free(&s);
+    rs_string_free(&t);
+
+    /* rope edits whose node allocation fails leave the rope as it was; nodes come from
+     * the chunk's allocator */
+    int budget = 3;
+    rs_alloc b = { budget_m, NULL, budget_f, &budget, NULL, NULL, NULL };
+    rs_rope r, snap, sub;
+    rs_rope_init(&r); rs_rope_init(&snap); rs_rope_init(&sub);
+    assert(rs_string_reserve_ex(&s, 64, b) == 0 && rs_string_assign(&s, (rs_sv){ text_40, 40 }) == 0);
+    assert(rs_rope_insert_string(&r, 0, &s) == 0);
+    rs_rope_share(&snap, &r);
+    assert(rs_rope_insert_string(&r, 10, &s) == -1);        /* copied the root, then ran out */
+    assert(rs_rope_erase(&r, 5, 10) == -1 && rs_rope_substr(&sub, &r, 5, 10) == -1);
+    assert(rs_rope_flatten(&r, &t) == 0 && rs_string_eq_sv(&t, (rs_sv){ text_40, 40 }));
+    assert(rs_rope_flatten(&snap, &t) == 0 && rs_string_eq_sv(&t, (rs_sv){ text_40, 40 }));
+    assert(rs_rope_len(&sub) == 0);
+    budget = 8;
+    assert(rs_rope_erase(&r, 5, 10) == 0 && rs_rope_substr(&sub, &r, 5, 10) == 0);
+    assert(rs_rope_flatten(&sub, &t) == 0 && rs_string_eq_sv(&t, (rs_sv){ "5678901234", 10 }));
+    assert(rs_rope_flatten(&snap, &t) == 0 && rs_string_eq_sv(&t, (rs_sv){ text_40, 40 }));
+    rs_rope_free(&r); rs_rope_free(&snap); rs_rope_free(&sub);
+    rs_string_free(&s);
+    rs_string_free(&t);
+}
+
 int main(void) {
     test_basic();
+    test_layout();
+    test_format();
     test_cow();
+    test_slice();
     test_trim_split_replace();
+    test_trim_views();
+    test_split_iter();
+    test_replace_all();
+    test_append_many();
+    test_prepare_commit();
+    test_file_io();
+    test_find();
+    test_hash();
+    test_alloc_hook();
+    test_shrink_growth();
+    test_stats();
+    test_arena();
+    test_pool();
+    test_intern();
+    test_rope();
+    test_ts();
+    test_par();
+    test_matcher();
+#ifdef RS_ATOMIC_REFCOUNT
+    test_intern_mt();
+    test_share_mt();
+#endif
     test_utf_converters();
+    test_utf8_validate();
+    test_case_ascii();
+    test_cmp_sort();
+    test_variants();
+    test_fluent();
+    test_iov();
+    test_fuzz_finds();
     puts("All tests passed.");
     return 0;
 }